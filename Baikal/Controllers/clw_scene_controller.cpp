@@ -10,13 +10,18 @@
 #include "SceneGraph/uberv2material.h"
 #include "SceneGraph/inputmaps.h"
 #include "Utils/distribution1d.h"
+#include "Utils/light_tree.h"
 #include "Utils/log.h"
 #include "Utils/cl_inputmap_generator.h"
+#include "Utils/cl_inputmap_bytecode_generator.h"
 #include "Utils/cl_program_manager.h"
 #include "Utils/cl_uberv2_generator.h"
 
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <memory>
 #include <stack>
 #include <vector>
@@ -31,6 +36,337 @@ namespace Baikal
         return (value + 0xF) / 0x10 * 0x10;
     }
 
+    // Side of texture tile in texels, should match TEXTURE_TILE_SIZE in texture.cl
+    static int const kTextureTileSize = 64;
+    // Default size of the tile pool for on-demand texture residency
+    static std::size_t const kDefaultTexturePoolBudget = 256 * 1024 * 1024;
+
+    // Max resolution of environment map sampling distribution
+    static std::uint32_t const kEnvDistributionMaxWidth = 512;
+    static std::uint32_t const kEnvDistributionMaxHeight = 256;
+    // Fraction of average luminance added to each cell of environment distribution,
+    // keeps PDF positive where override textures might still have energy
+    static float const kEnvDistributionMinWeight = 0.01f;
+
+    // Append 1D distribution in the layout expected by Distribution1D_* kernel functions:
+    // number of segments, num_segments + 1 CDF values, num_segments PDF values
+    static void WriteDistribution(Distribution1D const& distribution, std::vector<int>& out)
+    {
+        auto offset = out.size();
+        out.resize(offset + 1 + 2 * distribution.m_num_segments + 1);
+        out[offset] = static_cast<int>(distribution.m_num_segments);
+
+        auto values = reinterpret_cast<float*>(&out[offset + 1]);
+        std::copy(distribution.m_cdf.cbegin(), distribution.m_cdf.cend(), values);
+
+        values += distribution.m_num_segments + 1;
+
+        for (auto i = 0u; i < distribution.m_num_segments; ++i)
+        {
+            values[i] = distribution.m_func_values[i] / distribution.m_func_sum;
+        }
+    }
+
+    // Build luminance based distribution over lat-long environment map and serialize it
+    // in the layout expected by Distribution2D_* kernel functions:
+    // num_u, num_v, marginal distribution, num_v conditional distributions
+    static void WriteEnvironmentDistribution(Texture const& texture, std::vector<int>& out)
+    {
+        auto size = texture.GetSize();
+        auto num_u = std::min(static_cast<std::uint32_t>(size.x), kEnvDistributionMaxWidth);
+        auto num_v = std::min(static_cast<std::uint32_t>(size.y), kEnvDistributionMaxHeight);
+
+        // Average texel luminance within each cell
+        std::vector<float> values(num_u * num_v, 0.f);
+        std::vector<int> counts(num_u * num_v, 0);
+
+        for (auto y = 0; y < size.y; ++y)
+        {
+            auto row = static_cast<std::uint32_t>(y) * num_v / size.y;
+
+            for (auto x = 0; x < size.x; ++x)
+            {
+                auto column = static_cast<std::uint32_t>(x) * num_u / size.x;
+                auto texel = texture.GetTexel(x, y);
+                values[row * num_u + column] += 0.2126f * texel.x + 0.7152f * texel.y + 0.0722f * texel.z;
+                ++counts[row * num_u + column];
+            }
+        }
+
+        float average = 0.f;
+        for (auto i = 0u; i < values.size(); ++i)
+        {
+            values[i] = counts[i] > 0 ? std::max(values[i] / counts[i], 0.f) : 0.f;
+            average += values[i] / values.size();
+        }
+
+        // Account for solid angle of the cell (rows are uniform in theta)
+        for (auto y = 0u; y < num_v; ++y)
+        {
+            auto sin_theta = std::sin(PI * (y + 0.5f) / num_v);
+
+            for (auto x = 0u; x < num_u; ++x)
+            {
+                auto& value = values[y * num_u + x];
+                value = average > 0.f ? (value + kEnvDistributionMinWeight * average) * sin_theta : sin_theta;
+            }
+        }
+
+        Distribution2D distribution(&values[0], num_u, num_v);
+
+        out.push_back(static_cast<int>(num_u));
+        out.push_back(static_cast<int>(num_v));
+
+        WriteDistribution(distribution.m_marginal, out);
+
+        for (auto const& conditional : distribution.m_conditional)
+        {
+            WriteDistribution(conditional, out);
+        }
+    }
+
+    // Transform point/vector the same way matrix_mul_point3/matrix_mul_vector3 do in kernels
+    static float3 TransformPoint(matrix const& m, float3 const& p)
+    {
+        return float3(m.m00 * p.x + m.m01 * p.y + m.m02 * p.z + m.m03,
+                      m.m10 * p.x + m.m11 * p.y + m.m12 * p.z + m.m13,
+                      m.m20 * p.x + m.m21 * p.y + m.m22 * p.z + m.m23);
+    }
+
+    static float3 TransformVector(matrix const& m, float3 const& v)
+    {
+        return float3(m.m00 * v.x + m.m01 * v.y + m.m02 * v.z,
+                      m.m10 * v.x + m.m11 * v.y + m.m12 * v.z,
+                      m.m20 * v.x + m.m21 * v.y + m.m22 * v.z);
+    }
+
+    // Emission bounds of a finite light for the light tree
+    static LightBounds GetLightBounds(Light const& light, ClwScene::Light const& clw_light, float power)
+    {
+        LightBounds bounds;
+        bounds.pmin = bounds.pmax = light.GetPosition();
+        bounds.axis = float3(0.f, 0.f, 1.f);
+        // Point lights emit in all directions
+        bounds.cos_theta_o = -1.f;
+        bounds.cos_theta_e = 0.f;
+        bounds.power = power;
+        bounds.two_sided = false;
+
+        if (clw_light.type == ClwScene::kSpot)
+        {
+            bounds.axis = normalize(light.GetDirection());
+            bounds.cos_theta_o = clw_light.oa;
+        }
+        else if (clw_light.type == ClwScene::kArea)
+        {
+            auto mesh = std::static_pointer_cast<Mesh>(static_cast<AreaLight const&>(light).GetShape());
+            auto transform = mesh->GetTransform();
+            auto indices = mesh->GetIndices() + 3 * clw_light.primidx;
+
+            float3 v[3];
+            for (auto i = 0; i < 3; ++i)
+            {
+                v[i] = TransformPoint(transform, mesh->GetVertices()[indices[i]]);
+            }
+
+            bounds.pmin = vmin(v[0], vmin(v[1], v[2]));
+            bounds.pmax = vmax(v[0], vmax(v[1], v[2]));
+
+            // Emission goes along interpolated shading normals,
+            // so the cone around face normal has to include all of them
+            auto face_normal = cross(v[1] - v[0], v[2] - v[0]);
+
+            if (face_normal.sqnorm() > 0.f && mesh->GetNumNormals() > 0)
+            {
+                float3 n[3];
+                for (auto i = 0; i < 3; ++i)
+                {
+                    n[i] = normalize(TransformVector(transform, mesh->GetNormals()[indices[i]]));
+                }
+
+                bounds.axis = normalize(face_normal);
+                if (dot(bounds.axis, n[0] + n[1] + n[2]) < 0.f)
+                {
+                    bounds.axis = -bounds.axis;
+                }
+
+                bounds.cos_theta_o = std::min(dot(bounds.axis, n[0]), std::min(dot(bounds.axis, n[1]), dot(bounds.axis, n[2])));
+            }
+            else
+            {
+                bounds.two_sided = true;
+                bounds.axis = face_normal.sqnorm() > 0.f ? normalize(face_normal) : bounds.axis;
+                bounds.cos_theta_o = face_normal.sqnorm() > 0.f ? 1.f : -1.f;
+            }
+        }
+        else if (clw_light.type == ClwScene::kEmissiveMesh)
+        {
+            auto& mesh_light = static_cast<EmissiveMeshLight const&>(light);
+            auto mesh = mesh_light.GetMesh();
+            auto transform = mesh_light.GetShape()->GetTransform();
+            auto num_vertices = mesh->GetNumVertices();
+
+            for (auto i = 0u; i < num_vertices; ++i)
+            {
+                auto v = TransformPoint(transform, mesh->GetVertices()[i]);
+                bounds.pmin = i > 0 ? vmin(bounds.pmin, v) : v;
+                bounds.pmax = i > 0 ? vmax(bounds.pmax, v) : v;
+            }
+
+            // Cone around average shading normal including all of them,
+            // meshes without normals emit in all directions
+            if (num_vertices > 0 && mesh->GetNumNormals() == num_vertices)
+            {
+                float3 axis;
+                for (auto i = 0u; i < num_vertices; ++i)
+                {
+                    axis += normalize(TransformVector(transform, mesh->GetNormals()[i]));
+                }
+
+                if (axis.sqnorm() > 0.f)
+                {
+                    bounds.axis = normalize(axis);
+                    bounds.cos_theta_o = 1.f;
+
+                    for (auto i = 0u; i < num_vertices; ++i)
+                    {
+                        auto n = normalize(TransformVector(transform, mesh->GetNormals()[i]));
+                        bounds.cos_theta_o = std::min(bounds.cos_theta_o, dot(bounds.axis, n));
+                    }
+                }
+            }
+            else
+            {
+                bounds.two_sided = true;
+            }
+        }
+
+        return bounds;
+    }
+
+    // Serialize light tree in the layout expected by LightTree_* kernel functions
+    static void WriteLightTree(std::vector<ClwScene::Light> const& lights, std::vector<LightBounds> const& light_bounds,
+                               std::vector<int> const& infinite_lights, std::vector<int>& out)
+    {
+        LightTree tree;
+        tree.Build(light_bounds);
+
+        // Area light lookup by shape and primitive index to evaluate PDF when emissive geometry is hit,
+        // table of each shape is sized by its max primitive index (emissive meshes store their primitive count)
+        std::vector<int> num_prims;
+        for (auto const& light : lights)
+        {
+            if (light.type == ClwScene::kArea || light.type == ClwScene::kEmissiveMesh)
+            {
+                auto light_prims = light.type == ClwScene::kArea ? light.primidx + 1 : light.primidx;
+                num_prims.resize(std::max(num_prims.size(), static_cast<std::size_t>(light.shapeidx + 1)), 0);
+                num_prims[light.shapeidx] = std::max(num_prims[light.shapeidx], light_prims);
+            }
+        }
+
+        std::vector<int> data = { static_cast<int>(tree.m_nodes.size()), static_cast<int>(infinite_lights.size()),
+                                  static_cast<int>(lights.size()), static_cast<int>(num_prims.size()), 0 };
+
+        data.insert(data.end(), infinite_lights.cbegin(), infinite_lights.cend());
+
+        for (auto bit_trail : tree.m_bit_trails)
+        {
+            data.push_back(static_cast<int>(bit_trail));
+        }
+
+        for (auto light : infinite_lights)
+        {
+            data[5 + infinite_lights.size() + light] = -2;
+        }
+
+        auto shape_offsets = data.size();
+        data.resize(data.size() + num_prims.size(), -1);
+
+        for (auto i = 0u; i < num_prims.size(); ++i)
+        {
+            if (num_prims[i] > 0)
+            {
+                data[shape_offsets + i] = static_cast<int>(data.size());
+                data.resize(data.size() + num_prims[i], -1);
+            }
+        }
+
+        for (auto i = 0u; i < lights.size(); ++i)
+        {
+            if (lights[i].type == ClwScene::kArea)
+            {
+                data[data[shape_offsets + lights[i].shapeidx] + lights[i].primidx] = static_cast<int>(i);
+            }
+            else if (lights[i].type == ClwScene::kEmissiveMesh)
+            {
+                auto table = data.begin() + data[shape_offsets + lights[i].shapeidx];
+                std::fill(table, table + lights[i].primidx, static_cast<int>(i));
+            }
+        }
+
+        data[4] = static_cast<int>(data.size());
+        tree.Write(data);
+
+        out.insert(out.end(), data.cbegin(), data.cend());
+    }
+
+    // Upload elements of data which differ from the ones uploaded last time,
+    // adjacent changed elements are merged into a single write.
+    // Returns the number of bytes written.
+    // Host element type may differ from the buffer one as long as their sizes match.
+    template <typename T, typename U>
+    static std::size_t WriteChangedRanges(CLWContext context, CLWBuffer<U> buffer,
+                                          std::vector<T> const& data, std::vector<T>& uploaded)
+    {
+        static_assert(sizeof(T) == sizeof(U), "Host and device element sizes should match");
+
+        // Layout has changed, upload everything
+        if (data.size() != uploaded.size())
+        {
+            if (!data.empty())
+            {
+                context.WriteBuffer(0, buffer, reinterpret_cast<U const*>(data.data()), data.size()).Wait();
+            }
+
+            uploaded = data;
+            return data.size() * sizeof(T);
+        }
+
+        auto changed = [&data, &uploaded](std::size_t i)
+        {
+            return std::memcmp(&data[i], &uploaded[i], sizeof(T)) != 0;
+        };
+
+        std::size_t num_bytes_written = 0;
+
+        for (std::size_t i = 0; i < data.size();)
+        {
+            if (!changed(i))
+            {
+                ++i;
+                continue;
+            }
+
+            auto begin = i;
+            while (i < data.size() && changed(i))
+            {
+                ++i;
+            }
+
+            std::copy(data.begin() + begin, data.begin() + i, uploaded.begin() + begin);
+            context.WriteBuffer(0, buffer, reinterpret_cast<U const*>(uploaded.data() + begin), begin, i - begin);
+            num_bytes_written += (i - begin) * sizeof(T);
+        }
+
+        // Make sure host data is not touched until the writes are done
+        if (num_bytes_written > 0)
+        {
+            context.Finish(0);
+        }
+
+        return num_bytes_written;
+    }
+
     static CameraType GetCameraType(Camera& camera)
     {
         auto perspective = dynamic_cast<PerspectiveCamera*>(&camera);
@@ -56,6 +392,10 @@ namespace Baikal
     , m_api(api)
     , m_default_material(UberV2Material::Create())
     , m_program_manager(program_manager)
+    , m_texture_pool_mode(TexturePoolMode::kLinear)
+    , m_texture_pool_budget(kDefaultTexturePoolBudget)
+    , m_input_map_mode(InputMapMode::kGenerated)
+    , m_env_importance_sampling(true)
     {
         auto acc_type = "fatbvh";
         auto builder_type = "sah";
@@ -77,6 +417,49 @@ namespace Baikal
 
     ClwSceneController::~ClwSceneController()
     {
+        SetProfiler(nullptr);
+    }
+
+    void ClwSceneController::SetProfiler(std::shared_ptr<ClwProfiler> profiler)
+    {
+        if (m_profiler)
+        {
+            for (auto scene : m_tracked_scenes)
+            {
+                m_profiler->ReleaseAllocations(scene);
+            }
+        }
+
+        m_tracked_scenes.clear();
+        m_profiler = profiler;
+    }
+
+    void ClwSceneController::TrackSceneMemory(ClwScene const& scene) const
+    {
+        if (!m_profiler)
+        {
+            return;
+        }
+
+        auto geometry_size =
+            ClwProfiler::GetBufferSize(scene.vertices) + ClwProfiler::GetBufferSize(scene.normals) +
+            ClwProfiler::GetBufferSize(scene.uvs) + ClwProfiler::GetBufferSize(scene.indices) +
+            ClwProfiler::GetBufferSize(scene.shapes);
+
+        auto textures_size =
+            ClwProfiler::GetBufferSize(scene.textures) + ClwProfiler::GetBufferSize(scene.texturedata) +
+            ClwProfiler::GetBufferSize(scene.texture_feedback);
+
+        auto scene_size =
+            ClwProfiler::GetBufferSize(scene.material_attributes) + ClwProfiler::GetBufferSize(scene.lights) +
+            ClwProfiler::GetBufferSize(scene.volumes) + ClwProfiler::GetBufferSize(scene.camera) +
+            ClwProfiler::GetBufferSize(scene.light_distributions) + ClwProfiler::GetBufferSize(scene.input_map_data);
+
+        m_profiler->SetAllocation(&scene, ClwProfiler::MemoryCategory::kGeometry, geometry_size);
+        m_profiler->SetAllocation(&scene, ClwProfiler::MemoryCategory::kTextures, textures_size);
+        m_profiler->SetAllocation(&scene, ClwProfiler::MemoryCategory::kScene, scene_size);
+
+        m_tracked_scenes.insert(&scene);
     }
 
     static void SplitMeshesAndInstances(Iterator& shape_iter, std::set<Mesh::Ptr>& meshes, std::set<Instance::Ptr>& instances, std::set<Mesh::Ptr>& excluded_meshes)
@@ -338,6 +721,7 @@ namespace Baikal
         if (out.camera.GetElementCount() == 0)
         {
             out.camera = m_context.CreateBuffer<ClwScene::Camera>(1, CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
         }
 
         // TODO: remove this
@@ -444,20 +828,20 @@ namespace Baikal
         // Total number of entries in shapes GPU array
         auto num_shapes = meshes.size() + excluded_meshes.size() + instances.size();
         out.shapes = m_context.CreateBuffer<ClwScene::Shape>(num_shapes, CL_MEM_READ_ONLY);
+        TrackSceneMemory(out);
 
         float3* vertices = nullptr;
         float3* normals = nullptr;
         float2* uvs = nullptr;
         int* indices = nullptr;
-        ClwScene::Shape* shapes = nullptr;
+        std::vector<ClwScene::Shape> shapes(num_shapes);
 
         // Map arrays and prepare to write data
         LogInfo("Mapping buffers...\n");
         m_context.MapBuffer(0, out.vertices, CL_MAP_WRITE, &vertices);
         m_context.MapBuffer(0, out.normals, CL_MAP_WRITE, &normals);
         m_context.MapBuffer(0, out.uvs, CL_MAP_WRITE, &uvs);
-        m_context.MapBuffer(0, out.indices, CL_MAP_WRITE, &indices);
-        m_context.MapBuffer(0, out.shapes, CL_MAP_WRITE, &shapes).Wait();
+        m_context.MapBuffer(0, out.indices, CL_MAP_WRITE, &indices).Wait();
 
         // Keep associated shapes data for instance look up.
         // We retrieve data from here while serializing instances,
@@ -612,8 +996,13 @@ namespace Baikal
         m_context.UnmapBuffer(0, out.vertices, vertices);
         m_context.UnmapBuffer(0, out.normals, normals);
         m_context.UnmapBuffer(0, out.uvs, uvs);
-        m_context.UnmapBuffer(0, out.indices, indices);
-        m_context.UnmapBuffer(0, out.shapes, shapes).Wait();
+        m_context.UnmapBuffer(0, out.indices, indices).Wait();
+
+        // Buffers are recreated, so everything is uploaded
+        out.shapes_host.clear();
+        m_upload_stats.shape_bytes += WriteChangedRanges(m_context, out.shapes, shapes, out.shapes_host);
+        m_upload_stats.shape_bytes += num_vertices * sizeof(float3) + num_normals * sizeof(float3) +
+            num_uvs * sizeof(float2) + num_indices * sizeof(int);
 
         LogInfo("Updating intersector...\n");
 
@@ -634,12 +1023,10 @@ namespace Baikal
         std::set<Instance::Ptr> instances;
         SplitMeshesAndInstances(*shape_iter, meshes, instances, excluded_meshes);
 
-        ClwScene::Shape* shapes = nullptr;
-
-        // Map arrays and prepare to write data
-        m_context.MapBuffer(0, out.shapes, CL_MAP_READ | CL_MAP_WRITE, &shapes).Wait();
+        // Start from the data uploaded last time, only changed shapes are written
+        std::vector<ClwScene::Shape> shapes(out.shapes_host);
 
-        auto current_shape = shapes;
+        auto current_shape = shapes.data();
         for (auto& iter : meshes)
         {
             auto mesh = iter;
@@ -701,7 +1088,7 @@ namespace Baikal
             ++current_shape;
         }
 
-        m_context.UnmapBuffer(0, out.shapes, shapes).Wait();
+        m_upload_stats.shape_bytes += WriteChangedRanges(m_context, out.shapes, shapes, out.shapes_host);
     }
 
     void ClwSceneController::UpdateCurrentScene(Scene1 const& scene, ClwScene& out) const
@@ -747,17 +1134,12 @@ namespace Baikal
         {
             // Create material buffer
             out.material_attributes = m_context.CreateBuffer<int32_t>(mat_buffer.size(), CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
+            out.material_attributes_host.clear();
         }
 
-        int32_t *materials = nullptr;
-
-        // Map GPU materials buffer
-        m_context.MapBuffer(0, out.material_attributes, CL_MAP_WRITE, &materials).Wait();
-
-        memcpy(materials, mat_buffer.data(), mat_buffer.size() * sizeof(int32_t));
-
-        // Unmap material buffer
-        m_context.UnmapBuffer(0, out.material_attributes, materials);
+        // Upload changed materials only
+        m_upload_stats.material_bytes += WriteChangedRanges(m_context, out.material_attributes, mat_buffer, out.material_attributes_host);
     }
 
     void ClwSceneController::UpdateVolumes(Scene1 const& scene, Collector& volume_collector, Collector& tex_collector, ClwScene& out) const
@@ -773,6 +1155,7 @@ namespace Baikal
         {
             // Create material buffer
             out.volumes = m_context.CreateBuffer<ClwScene::Volume>(vol_buffer_size, CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
         }
 
         ClwScene::Volume* volumes = nullptr;
@@ -817,10 +1200,30 @@ namespace Baikal
         std::size_t tex_buffer_size = tex_collector.GetNumItems();
         std::size_t tex_data_buffer_size = 0;
 
+        // Drop tiled pool data, it is rebuilt by UpdateTexturesTiled if needed
+        out.texture_pages.clear();
+        out.texture_pool_textures.clear();
+        out.texture_pool_begin = out.texture_pool_end = out.texture_pool_used = 0;
+
+        if (out.texture_feedback.GetElementCount() == 0)
+        {
+            out.texture_feedback = m_context.CreateBuffer<int>(1, CL_MEM_READ_WRITE);
+            m_context.FillBuffer(0, out.texture_feedback, 0, 1).Wait();
+        }
+
         if (tex_buffer_size == 0)
         {
             out.textures = m_context.CreateBuffer<ClwScene::Texture>(1, CL_MEM_READ_ONLY);
             out.texturedata = m_context.CreateBuffer<char>(1, CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
+            out.textures_host.clear();
+            out.texturedata_offsets.clear();
+            return;
+        }
+
+        if (m_texture_pool_mode != TexturePoolMode::kLinear)
+        {
+            UpdateTexturesTiled(tex_collector, out);
             return;
         }
 
@@ -829,14 +1232,13 @@ namespace Baikal
         {
             // Create material buffer
             out.textures = m_context.CreateBuffer<ClwScene::Texture>(tex_buffer_size, CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
+            out.textures_host.clear();
         }
 
-        ClwScene::Texture* textures = nullptr;
+        std::vector<ClwScene::Texture> textures(tex_buffer_size);
         std::size_t num_textures_written = 0;
 
-        // Map GPU materials buffer
-        m_context.MapBuffer(0, out.textures, CL_MAP_WRITE, &textures).Wait();
-
         // Update material bundle first to be able to track differences
         out.texture_bundle.reset(tex_collector.CreateBundle());
 
@@ -848,43 +1250,293 @@ namespace Baikal
         {
             auto tex = tex_iter->ItemAs<Texture>();
 
-            WriteTexture(*tex, tex_data_buffer_size, textures + num_textures_written);
+            WriteTexture(*tex, tex_data_buffer_size, &textures[num_textures_written]);
 
             ++num_textures_written;
 
             tex_data_buffer_size += align16(tex->GetSizeInBytes());
         }
 
-        // Unmap material buffer
-        m_context.UnmapBuffer(0, out.textures, textures);
+        m_upload_stats.texture_bytes += WriteChangedRanges(m_context, out.textures, textures, out.textures_host);
 
         // Recreate material buffer if it needs resize
         if (tex_data_buffer_size > out.texturedata.GetElementCount())
         {
             // Create material buffer
             out.texturedata = m_context.CreateBuffer<char>(tex_data_buffer_size, CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
+            out.texturedata_offsets.clear();
         }
 
-        char* data = nullptr;
+        std::unordered_map<std::uint32_t, std::size_t> texturedata_offsets;
         std::size_t num_bytes_written = 0;
+        std::size_t num_bytes_uploaded = 0;
 
         tex_iter->Reset();
 
-        // Map GPU materials buffer
-        m_context.MapBuffer(0, out.texturedata, CL_MAP_WRITE, &data).Wait();
-
-        // Write texture data for all textures
+        // Write data of textures which have been changed or moved
         for (; tex_iter->IsValid(); tex_iter->Next())
         {
             auto tex = tex_iter->ItemAs<Texture>();
 
-            WriteTextureData(*tex, data + num_bytes_written);
+            auto iter = out.texturedata_offsets.find(tex->GetId());
+            bool moved = iter == out.texturedata_offsets.cend() || iter->second != num_bytes_written;
+
+            if ((moved || tex->IsDirty()) && tex->GetSizeInBytes() > 0)
+            {
+                m_context.WriteBuffer(0, out.texturedata, tex->GetData(), num_bytes_written, tex->GetSizeInBytes());
+                num_bytes_uploaded += tex->GetSizeInBytes();
+            }
 
+            texturedata_offsets[tex->GetId()] = num_bytes_written;
             num_bytes_written += align16(tex->GetSizeInBytes());
         }
 
-        // Unmap material buffer
-        m_context.UnmapBuffer(0, out.texturedata, data);
+        if (num_bytes_uploaded > 0)
+        {
+            m_context.Finish(0);
+        }
+
+        out.texturedata_offsets = std::move(texturedata_offsets);
+        m_upload_stats.texture_bytes += num_bytes_uploaded;
+    }
+
+    void ClwSceneController::UpdateTexturesTiled(Collector& tex_collector, ClwScene& out) const
+    {
+        std::size_t tex_buffer_size = tex_collector.GetNumItems();
+
+        // Recreate texture buffer if it needs resize
+        if (tex_buffer_size > out.textures.GetElementCount())
+        {
+            out.textures = m_context.CreateBuffer<ClwScene::Texture>(tex_buffer_size, CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
+            out.textures_host.clear();
+        }
+
+        std::vector<ClwScene::Texture> textures(tex_buffer_size);
+
+        out.texture_bundle.reset(tex_collector.CreateBundle());
+
+        std::unique_ptr<Iterator> tex_iter(tex_collector.CreateIterator());
+
+        // Page tables (and volume or compressed textures, which are not tiled) go first, tiles follow
+        std::size_t header_size = 0;
+        std::size_t total_tile_bytes = 0;
+        std::size_t tail_tile_bytes = 0;
+
+        for (int i = 0; tex_iter->IsValid(); tex_iter->Next(), ++i)
+        {
+            auto tex = tex_iter->ItemAs<Texture>();
+
+            WriteTexture(*tex, header_size, &textures[i]);
+            out.texture_pool_textures.push_back(tex);
+
+            if (tex->GetSize().z > 1 || tex->IsCompressed())
+            {
+                header_size += align16(tex->GetSizeInBytes());
+                continue;
+            }
+
+            auto num_mips = tex->GetNumMipLevels();
+            auto tile_bytes = align16(kTextureTileSize * kTextureTileSize * tex->GetPixelSizeInBytes());
+            std::size_t num_pages = 0;
+
+            textures[i].num_mips = static_cast<int>(num_mips);
+            textures[i].first_page = static_cast<int>(out.texture_pages.size());
+
+            for (std::uint32_t level = 0; level < num_mips; ++level)
+            {
+                auto size = tex->GetMipSize(level);
+                int num_tiles_x = (size.x + kTextureTileSize - 1) / kTextureTileSize;
+                int num_tiles_y = (size.y + kTextureTileSize - 1) / kTextureTileSize;
+
+                for (int y = 0; y < num_tiles_y; ++y)
+                {
+                    for (int x = 0; x < num_tiles_x; ++x)
+                    {
+                        ClwScene::TexturePage page;
+                        page.texture = i;
+                        page.level = static_cast<int>(level);
+                        page.x = x;
+                        page.y = y;
+                        page.entry_offset = header_size + sizeof(int) * (num_mips + num_pages);
+                        page.data_offset = -1;
+                        out.texture_pages.push_back(page);
+
+                        ++num_pages;
+                        total_tile_bytes += tile_bytes;
+                    }
+                }
+
+                // Levels fitting into a single tile are always resident
+                if (num_tiles_x == 1 && num_tiles_y == 1)
+                {
+                    tail_tile_bytes += tile_bytes;
+                }
+            }
+
+            header_size += align16(sizeof(int) * (num_mips + num_pages));
+        }
+
+        // Keep everything resident unless streaming is requested
+        bool on_demand = m_texture_pool_mode == TexturePoolMode::kTiledOnDemand;
+        std::size_t pool_size = on_demand ?
+            std::min(std::max(m_texture_pool_budget, tail_tile_bytes), total_tile_bytes) : total_tile_bytes;
+
+        out.texture_pool_begin = header_size;
+        out.texture_pool_end = header_size + pool_size;
+        out.texture_pool_used = header_size;
+
+        if (out.texture_pool_end > out.texturedata.GetElementCount())
+        {
+            out.texturedata = m_context.CreateBuffer<char>(std::max(out.texture_pool_end, std::size_t(1)), CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
+        }
+
+        std::vector<char> data(header_size + (on_demand ? tail_tile_bytes : total_tile_bytes));
+
+        // Copy volume and compressed textures
+        for (std::size_t i = 0; i < tex_buffer_size; ++i)
+        {
+            if (textures[i].num_mips == 0)
+            {
+                WriteTextureData(*out.texture_pool_textures[i], &data[textures[i].dataoffset]);
+            }
+        }
+
+        // Write page tables and resident tiles
+        for (std::size_t i = 0; i < out.texture_pages.size(); ++i)
+        {
+            auto& page = out.texture_pages[i];
+            auto const& tex = *out.texture_pool_textures[page.texture];
+            auto page_table = reinterpret_cast<int*>(&data[textures[page.texture].dataoffset]);
+
+            // Remember where each level starts
+            if (page.x == 0 && page.y == 0)
+            {
+                page_table[page.level] = static_cast<int>(i) - textures[page.texture].first_page;
+            }
+
+            auto size = tex.GetMipSize(page.level);
+
+            if (!on_demand || (size.x <= kTextureTileSize && size.y <= kTextureTileSize))
+            {
+                page.data_offset = static_cast<int>(out.texture_pool_used);
+                WriteTextureTile(tex, page.level, page.x, page.y, &data[out.texture_pool_used]);
+                out.texture_pool_used += align16(kTextureTileSize * kTextureTileSize * tex.GetPixelSizeInBytes());
+            }
+
+            *reinterpret_cast<int*>(&data[page.entry_offset]) = page.data_offset;
+        }
+
+        if (!data.empty())
+        {
+            m_context.WriteBuffer(0, out.texturedata, data.data(), data.size());
+            m_context.Finish(0);
+        }
+
+        m_upload_stats.texture_bytes += WriteChangedRanges(m_context, out.textures, textures, out.textures_host);
+        m_upload_stats.texture_bytes += data.size();
+
+        // Feedback buffer is indexed by page
+        out.texture_feedback = m_context.CreateBuffer<int>(std::max(out.texture_pages.size(), std::size_t(1)), CL_MEM_READ_WRITE);
+        TrackSceneMemory(out);
+        m_context.FillBuffer(0, out.texture_feedback, 0, out.texture_feedback.GetElementCount()).Wait();
+
+        // Linear layout needs full re-upload after this
+        out.texturedata_offsets.clear();
+    }
+
+    std::size_t ClwSceneController::UpdateTextureResidency(ClwScene& scene) const
+    {
+        if (scene.texture_pages.empty())
+        {
+            return 0;
+        }
+
+        std::vector<int> feedback(scene.texture_pages.size());
+        m_context.ReadBuffer(0, scene.texture_feedback, feedback.data(), feedback.size()).Wait();
+
+        // Tiles are allocated sequentially, so all new tiles form a single range of the pool
+        std::vector<char> tiles;
+        std::size_t tiles_begin = scene.texture_pool_used;
+        std::size_t num_uploaded = 0;
+
+        for (std::size_t i = 0; i < feedback.size(); ++i)
+        {
+            auto& page = scene.texture_pages[i];
+
+            if (!feedback[i] || page.data_offset >= 0)
+            {
+                continue;
+            }
+
+            auto const& tex = *scene.texture_pool_textures[page.texture];
+            auto tile_bytes = align16(kTextureTileSize * kTextureTileSize * tex.GetPixelSizeInBytes());
+
+            // Pool is exhausted, kernels keep using coarser levels for this tile
+            if (scene.texture_pool_used + tile_bytes > scene.texture_pool_end)
+            {
+                continue;
+            }
+
+            tiles.resize(tiles.size() + tile_bytes);
+            WriteTextureTile(tex, page.level, page.x, page.y, &tiles[scene.texture_pool_used - tiles_begin]);
+            page.data_offset = static_cast<int>(scene.texture_pool_used);
+            scene.texture_pool_used += tile_bytes;
+            ++num_uploaded;
+        }
+
+        if (num_uploaded > 0)
+        {
+            m_context.WriteBuffer(0, scene.texturedata, tiles.data(), tiles_begin, tiles.size());
+
+            // Update page table entries
+            for (auto const& page : scene.texture_pages)
+            {
+                if (page.data_offset >= static_cast<int>(tiles_begin))
+                {
+                    m_context.WriteBuffer(0, scene.texturedata, reinterpret_cast<char const*>(&page.data_offset),
+                                          page.entry_offset, sizeof(int));
+                }
+            }
+
+            m_context.Finish(0);
+            m_upload_stats.texture_bytes += tiles.size() + num_uploaded * sizeof(int);
+        }
+
+        m_context.FillBuffer(0, scene.texture_feedback, 0, scene.texture_feedback.GetElementCount()).Wait();
+
+        return num_uploaded;
+    }
+
+    ClwSceneController::TextureMemoryStatistics ClwSceneController::GetTextureMemoryStatistics(ClwScene const& scene) const
+    {
+        TextureMemoryStatistics stats;
+        stats.pool_bytes = scene.texturedata.GetElementCount();
+
+        if (scene.texture_pages.empty())
+        {
+            stats.resident_bytes = stats.total_bytes = stats.pool_bytes;
+            return stats;
+        }
+
+        stats.resident_bytes = scene.texture_pool_used;
+        stats.total_bytes = scene.texture_pool_begin;
+        stats.num_pages = scene.texture_pages.size();
+
+        for (auto const& page : scene.texture_pages)
+        {
+            auto const& tex = *scene.texture_pool_textures[page.texture];
+            stats.total_bytes += align16(kTextureTileSize * kTextureTileSize * tex.GetPixelSizeInBytes());
+
+            if (page.data_offset >= 0)
+            {
+                ++stats.num_resident_pages;
+            }
+        }
+
+        return stats;
     }
 
 #ifndef NDEBUG
@@ -1009,6 +1661,10 @@ namespace Baikal
         {
             return ClwScene::kIbl;
         }
+        else if (dynamic_cast<EmissiveMeshLight const*>(&light))
+        {
+            return ClwScene::kEmissiveMesh;
+        }
         else
         {
             return ClwScene::LightType::kArea;
@@ -1084,6 +1740,23 @@ namespace Baikal
                 break;
             }
 
+            case ClwScene::kEmissiveMesh:
+            {
+                auto& mesh_light = static_cast<EmissiveMeshLight const&>(light);
+                auto shape = mesh_light.GetShape();
+
+                auto shape_iter = scene.CreateShapeIterator();
+
+                auto idx = GetShapeIdx(*shape_iter, shape);
+
+                clw_light->id = shape->GetId();
+                clw_light->shapeidx = static_cast<int>(idx);
+                // Number of primitives, triangle distribution offset is set in UpdateLights
+                clw_light->primidx = static_cast<int>(mesh_light.GetMesh()->GetNumIndices() / 3);
+                clw_light->prim_distribution = 0;
+                break;
+            }
+
             default:
             assert(false);
             break;
@@ -1097,18 +1770,16 @@ namespace Baikal
         auto env_override = scene.GetEnvironmentOverride();
 
         auto num_lights = scene.GetNumLights();
-        auto distribution_buffer_size = (1 + 1 + num_lights + num_lights);
 
         // Create light buffer if needed
         if (num_lights > out.lights.GetElementCount())
         {
             out.lights = m_context.CreateBuffer<ClwScene::Light>(num_lights, CL_MEM_READ_ONLY);
-            out.light_distributions = m_context.CreateBuffer<int>(distribution_buffer_size, CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
+            out.lights_host.clear();
         }
 
-        ClwScene::Light* lights = nullptr;
-
-        m_context.MapBuffer(0, out.lights, CL_MAP_WRITE, &lights).Wait();
+        std::vector<ClwScene::Light> lights(num_lights);
         std::unique_ptr<Iterator> light_iter(scene.CreateLightIterator());
 
         // Disable IBL by default
@@ -1118,12 +1789,22 @@ namespace Baikal
         std::vector<float> light_power(num_lights);
         std::uint32_t k = 0;
 
+        // Texture of the IBL used for importance sampling
+        Texture::Ptr env_texture;
+
+        // Bounds of finite lights for the light tree, infinite lights are sampled separately
+        std::vector<LightBounds> light_bounds(num_lights);
+        std::vector<int> infinite_lights;
+
+        // Emissive meshes get their triangle distributions appended after the light tree
+        std::vector<std::pair<std::size_t, EmissiveMeshLight const*>> mesh_lights;
+
         // Serialize
         {
             for (; light_iter->IsValid(); light_iter->Next())
             {
                 auto light = light_iter->ItemAs<Light>();
-                WriteLight(scene, *light, tex_collector, lights + num_lights_written);
+                WriteLight(scene, *light, tex_collector, &lights[num_lights_written]);
 
 
                 // Find and update IBL idx
@@ -1131,6 +1812,7 @@ namespace Baikal
                 if (ibl)
                 {
                     out.envmapidx = static_cast<int>(num_lights_written);
+                    env_texture = ibl->GetTexture();
                 }
 
                 ++num_lights_written;
@@ -1138,39 +1820,88 @@ namespace Baikal
                 auto power = light->GetPower(scene);
 
                 // TODO: move luminance calculation into utility function
-                light_power[k++] = 0.2126f * power.x + 0.7152f * power.y + 0.0722f * power.z;
+                light_power[k] = 0.2126f * power.x + 0.7152f * power.y + 0.0722f * power.z;
+
+                auto const& clw_light = lights[num_lights_written - 1];
+
+                if (clw_light.type == ClwScene::kEmissiveMesh)
+                {
+                    mesh_lights.emplace_back(k, static_cast<EmissiveMeshLight const*>(light.get()));
+                }
+
+                if (clw_light.type == ClwScene::kIbl || clw_light.type == ClwScene::kDirectional)
+                {
+                    infinite_lights.push_back(static_cast<int>(k));
+                    light_bounds[k].power = 0.f;
+                }
+                else
+                {
+                    light_bounds[k] = GetLightBounds(*light, clw_light, light_power[k]);
+                }
+
+                ++k;
             }
         }
 
-        m_context.UnmapBuffer(0, out.lights, lights);
-
         // Create distribution over light sources based on their power
         Distribution1D light_distribution(&light_power[0], (std::uint32_t)light_power.size());
 
         // Write distribution data
-        int* distribution_ptr = nullptr;
-        m_context.MapBuffer(0, out.light_distributions, CL_MAP_WRITE, &distribution_ptr).Wait();
-        auto current = distribution_ptr;
+        std::vector<int> distribution;
+        WriteDistribution(light_distribution, distribution);
 
-        // Write the number of segments first
-        *current++ = (int)light_distribution.m_num_segments;
+        // Environment map distribution follows light distribution,
+        // rebuild it only if IBL texture has been changed
+        if (!env_texture || !m_env_importance_sampling)
+        {
+            out.env_distribution.clear();
+            out.env_distribution_texture = ~0u;
+        }
+        else if (env_texture->GetId() != out.env_distribution_texture || env_texture->IsDirty())
+        {
+            out.env_distribution.clear();
+            WriteEnvironmentDistribution(*env_texture, out.env_distribution);
+            out.env_distribution_texture = env_texture->GetId();
+        }
 
-        // Then write num_segments  + 1 CDF values
-        auto values = reinterpret_cast<float*>(current);
-        for (auto i = 0u; i < light_distribution.m_num_segments + 1; ++i)
+        if (out.env_distribution.empty())
         {
-            values[i] = light_distribution.m_cdf[i];
+            // Zero resolution means uniform sampling
+            distribution.push_back(0);
+            distribution.push_back(0);
+        }
+        else
+        {
+            distribution.insert(distribution.end(), out.env_distribution.cbegin(), out.env_distribution.cend());
         }
 
-        // Then write num_segments PDF values
-        values += light_distribution.m_num_segments + 1;
+        // Light tree goes next
+        WriteLightTree(lights, light_bounds, infinite_lights, distribution);
 
-        for (auto i = 0u; i < light_distribution.m_num_segments; ++i)
+        // Triangle area distributions of emissive meshes go last,
+        // those are cached by the lights and only rebuilt when the mesh changes
+        for (auto const& mesh_light : mesh_lights)
         {
-            values[i] = light_distribution.m_func_values[i] / light_distribution.m_func_sum;
+            auto const& prim_distribution = mesh_light.second->GetPrimitiveDistribution();
+
+            if (prim_distribution.m_num_segments > 0)
+            {
+                lights[mesh_light.first].prim_distribution = static_cast<int>(distribution.size());
+                WriteDistribution(prim_distribution, distribution);
+            }
+        }
+
+        m_upload_stats.light_bytes += WriteChangedRanges(m_context, out.lights, lights, out.lights_host);
+
+        // Create distribution buffer if needed
+        if (distribution.size() > out.light_distributions.GetElementCount())
+        {
+            out.light_distributions = m_context.CreateBuffer<int>(distribution.size(), CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
+            out.light_distributions_host.clear();
         }
 
-        m_context.UnmapBuffer(0, out.light_distributions, distribution_ptr);
+        m_upload_stats.light_bytes += WriteChangedRanges(m_context, out.light_distributions, distribution, out.light_distributions_host);
 
         out.num_lights = static_cast<int>(num_lights_written);
     }
@@ -1184,6 +1915,16 @@ namespace Baikal
             case Texture::Format::kRgba8: return ClwScene::TextureFormat::RGBA8;
             case Texture::Format::kRgba16: return ClwScene::TextureFormat::RGBA16;
             case Texture::Format::kRgba32: return ClwScene::TextureFormat::RGBA32;
+            case Texture::Format::kBc1: return ClwScene::TextureFormat::BC1;
+            case Texture::Format::kBc4: return ClwScene::TextureFormat::BC4;
+            case Texture::Format::kBc5: return ClwScene::TextureFormat::BC5;
+            case Texture::Format::kBc6h: return ClwScene::TextureFormat::BC6H;
+            case Texture::Format::kBc7: return ClwScene::TextureFormat::BC7;
+            case Texture::Format::kR8: return ClwScene::TextureFormat::R8;
+            case Texture::Format::kR16: return ClwScene::TextureFormat::R16;
+            case Texture::Format::kR32: return ClwScene::TextureFormat::R32;
+            case Texture::Format::kRg8: return ClwScene::TextureFormat::RG8;
+            case Texture::Format::kRg16: return ClwScene::TextureFormat::RG16;
             default: return ClwScene::TextureFormat::RGBA8;
         }
     }
@@ -1199,6 +1940,9 @@ namespace Baikal
         clw_texture->d = dim.z;
         clw_texture->fmt = GetTextureFormat(texture);
         clw_texture->dataoffset = static_cast<int>(data_offset);
+        clw_texture->num_mips = 0;
+        clw_texture->first_page = 0;
+        clw_texture->padding = 0;
     }
 
     void ClwSceneController::WriteTextureData(Texture const& texture, void* data) const
@@ -1208,6 +1952,27 @@ namespace Baikal
         std::copy(begin, end, static_cast<char*>(data));
     }
 
+    void ClwSceneController::WriteTextureTile(Texture const& texture, int level, int x, int y, void* data) const
+    {
+        auto size = texture.GetMipSize(level);
+        auto pixel_size = texture.GetPixelSizeInBytes();
+        auto src = texture.GetMipData(level);
+        auto dst = static_cast<char*>(data);
+
+        for (int j = 0; j < kTextureTileSize; ++j)
+        {
+            for (int i = 0; i < kTextureTileSize; ++i)
+            {
+                // Clamp to level borders
+                int src_x = std::min(x * kTextureTileSize + i, size.x - 1);
+                int src_y = std::min(y * kTextureTileSize + j, size.y - 1);
+
+                std::memcpy(dst + (j * kTextureTileSize + i) * pixel_size,
+                            src + (src_y * size.x + src_x) * pixel_size, pixel_size);
+            }
+        }
+    }
+
     void ClwSceneController::WriteVolume(VolumeMaterial const& volume, Collector& tex_collector, void* data) const
     {
         auto clw_volume = reinterpret_cast<ClwScene::Volume*>(data);
@@ -1266,6 +2031,28 @@ namespace Baikal
 
     void Baikal::ClwSceneController::UpdateInputMaps(const Baikal::Scene1& scene, Baikal::Collector& input_map_collector, Collector& input_map_leafs_collector, ClwScene& out) const
     {
+        if (m_input_map_mode == InputMapMode::kBytecode)
+        {
+            CLInputMapBytecodeGenerator generator;
+
+            if (generator.Generate(input_map_collector, input_map_leafs_collector))
+            {
+                // Evaluator source never changes, so only the data is updated
+                out.input_map_bytecode = generator.GetBytecode();
+                WriteInputMapData(out);
+                m_program_manager->AddHeader("inputmaps.cl", CLInputMapBytecodeGenerator::GetEvaluatorSource());
+                return;
+            }
+
+            LogInfo("Input maps are too deep for bytecode evaluation, falling back to generated code\n");
+        }
+
+        if (!out.input_map_bytecode.empty())
+        {
+            out.input_map_bytecode.clear();
+            WriteInputMapData(out);
+        }
+
         CLInputMapGenerator generator;
         generator.Generate(input_map_collector, input_map_leafs_collector);
         std::string source = generator.GetGeneratedSource();
@@ -1274,40 +2061,57 @@ namespace Baikal
 
     void Baikal::ClwSceneController::UpdateLeafsData(Scene1 const& scene, Collector& input_map_leafs_collector, Collector& tex_collector, ClwScene& out) const
     {
-        // Get new buffer size
-        std::size_t buffer_size = input_map_leafs_collector.GetNumItems();
+        std::vector<ClwScene::InputMapInstruction> leafs(input_map_leafs_collector.GetNumItems(), ClwScene::InputMapInstruction{ 0, { 0, 0, 0 } });
 
-        // Recreate input map leafs buffer if it needs resize
-        if (buffer_size > out.input_map_data.GetElementCount())
-        {
-            // Create material buffer
-            out.input_map_data = m_context.CreateBuffer<ClwScene::InputMapData>(buffer_size, CL_MEM_READ_ONLY);
-        }
+        // Update input map leafs bundle to be able to track differences
+        out.input_map_leafs_bundle.reset(input_map_leafs_collector.CreateBundle());
+
+        // leaf iterator
+        auto iter = input_map_leafs_collector.CreateIterator();
+        std::size_t num_inputmap_leafs_written = 0;
 
-        if (buffer_size > 0)
+        // Iterate and serialize
+        for (; iter->IsValid(); iter->Next())
         {
-            ClwScene::InputMapData *input_map_data = nullptr;
+            WriteInputMapLeaf(*iter->ItemAs<InputMap>(), tex_collector, &leafs[num_inputmap_leafs_written]);
+            ++num_inputmap_leafs_written;
+        }
 
-            // Map GPU input map buffer
-            m_context.MapBuffer(0, out.input_map_data, CL_MAP_WRITE, &input_map_data).Wait();
+        out.input_map_leafs = std::move(leafs);
+        WriteInputMapData(out);
+    }
 
-            // Update input map leafs bundle to be able to track differences
-            out.input_map_leafs_bundle.reset(input_map_leafs_collector.CreateBundle());
+    void ClwSceneController::WriteInputMapData(ClwScene& out) const
+    {
+        std::vector<ClwScene::InputMapInstruction> data;
 
-            // leaf iterator
-            auto iter = input_map_leafs_collector.CreateIterator();
-            std::size_t num_inputmap_leafs_written = 0;
+        if (out.input_map_bytecode.empty())
+        {
+            data = out.input_map_leafs;
+        }
+        else
+        {
+            // Header with bytecode offset, then leafs and bytecode
+            data.reserve(1 + out.input_map_leafs.size() + out.input_map_bytecode.size());
+            data.push_back({ 0, { static_cast<int>(1 + out.input_map_leafs.size()), 0, 0 } });
+            data.insert(data.end(), out.input_map_leafs.cbegin(), out.input_map_leafs.cend());
+            data.insert(data.end(), out.input_map_bytecode.cbegin(), out.input_map_bytecode.cend());
+        }
 
-            // Iterate and serialize
-            for (; iter->IsValid(); iter->Next())
-            {
-                WriteInputMapLeaf(*iter->ItemAs<InputMap>(), tex_collector, input_map_data + num_inputmap_leafs_written);
-                ++num_inputmap_leafs_written;
-            }
+        if (data.empty())
+        {
+            return;
+        }
 
-            //Unmap buffer
-            m_context.UnmapBuffer(0, out.input_map_data, input_map_data);
+        // Recreate input map buffer if it needs resize
+        if (data.size() > out.input_map_data.GetElementCount())
+        {
+            out.input_map_data = m_context.CreateBuffer<ClwScene::InputMapData>(data.size(), CL_MEM_READ_ONLY);
+            TrackSceneMemory(out);
+            out.input_map_data_host.clear();
         }
+
+        m_upload_stats.material_bytes += WriteChangedRanges(m_context, out.input_map_data, data, out.input_map_data_host);
     }
 
     void Baikal::ClwSceneController::WriteInputMapLeaf(InputMap const& leaf, Collector& tex_collector, void* data) const
@@ -32,9 +32,13 @@
 #include "CLW.h"
 
 #include "SceneGraph/clwscene.h"
+#include "Utils/clw_profiler.h"
 
 #include "radeon_rays_cl.h"
 
+#include <memory>
+#include <unordered_set>
+
 namespace Baikal
 {
     class Scene1;
@@ -65,6 +69,78 @@ namespace Baikal
         // Get underlying intersection API.
         RadeonRays::IntersectionApi* GetIntersectionApi() { return  m_api; }
 
+        // Amount of data uploaded into scene buffers
+        struct UploadStatistics
+        {
+            std::size_t shape_bytes = 0;
+            std::size_t material_bytes = 0;
+            std::size_t light_bytes = 0;
+            std::size_t texture_bytes = 0;
+        };
+
+        // Get upload statistics accumulated since the last reset
+        UploadStatistics const& GetUploadStatistics() const { return m_upload_stats; }
+        void ResetUploadStatistics() { m_upload_stats = UploadStatistics(); }
+
+        // Set profiler for device memory accounting, compiled scenes are reported
+        // when their buffers are reallocated next time
+        void SetProfiler(std::shared_ptr<ClwProfiler> profiler);
+
+        // Texture memory layout
+        enum class TexturePoolMode
+        {
+            // Each texture is stored as a single linear level
+            kLinear,
+            // Textures are split into 64x64 tiles with full mip chains, all tiles are resident
+            kTiled,
+            // Same as kTiled, but only the coarsest levels are resident initially,
+            // other tiles are streamed in by UpdateTextureResidency when kernels request them
+            kTiledOnDemand
+        };
+
+        // Texture memory usage
+        struct TextureMemoryStatistics
+        {
+            // Size of texture data buffer
+            std::size_t pool_bytes = 0;
+            // Bytes occupied by resident tiles (or linear textures)
+            std::size_t resident_bytes = 0;
+            // Bytes required to keep everything resident
+            std::size_t total_bytes = 0;
+            std::size_t num_pages = 0;
+            std::size_t num_resident_pages = 0;
+        };
+
+        // Set texture layout, takes effect on the next texture update
+        void SetTexturePoolMode(TexturePoolMode mode) { m_texture_pool_mode = mode; }
+        TexturePoolMode GetTexturePoolMode() const { return m_texture_pool_mode; }
+        // Set the size of tile pool for kTiledOnDemand mode
+        void SetTexturePoolBudget(std::size_t bytes) { m_texture_pool_budget = bytes; }
+        // Stream in tiles requested by kernels since the last call, should be called between frames.
+        // Returns the number of tiles uploaded.
+        std::size_t UpdateTextureResidency(ClwScene& scene) const;
+        // Get texture memory statistics for the scene
+        TextureMemoryStatistics GetTextureMemoryStatistics(ClwScene const& scene) const;
+
+        // Input map evaluation
+        enum class InputMapMode
+        {
+            // Input map graphs are compiled into kernel code, changing a graph recompiles kernels
+            kGenerated,
+            // Input map graphs are uploaded as bytecode and interpreted by kernels,
+            // graphs can be edited without kernel recompilation
+            kBytecode
+        };
+
+        // Set input map evaluation, takes effect on the next input map update
+        void SetInputMapMode(InputMapMode mode) { m_input_map_mode = mode; }
+        InputMapMode GetInputMapMode() const { return m_input_map_mode; }
+
+        // Enable luminance based sampling of environment light (on by default),
+        // when disabled environment is sampled uniformly. Takes effect on the next light update
+        void SetEnvironmentImportanceSampling(bool enable) { m_env_importance_sampling = enable; }
+        bool GetEnvironmentImportanceSampling() const { return m_env_importance_sampling; }
+
     protected:
         // Clear intersector and load meshes into it.
         void ReloadIntersector(Scene1 const& scene, ClwScene& inout) const;
@@ -109,6 +185,8 @@ namespace Baikal
         void WriteTexture(Texture const& texture, std::size_t data_offset, void* data) const;
         // Write out texture data at data pointer.
         void WriteTextureData(Texture const& texture, void* data) const;
+        // Write out single tile of texture mip level at data pointer.
+        void WriteTextureTile(Texture const& texture, int level, int x, int y, void* data) const;
         // Write single volume at data pointer
         void WriteVolume(VolumeMaterial const& volume, Collector& tex_collector, void* data) const;
         // Write single input map leaf at data pointer
@@ -123,6 +201,12 @@ namespace Baikal
         int GetTextureIndex(Collector const& collector, Texture::Ptr material) const;
         int GetVolumeIndex(Collector const& collector, VolumeMaterial::Ptr volume) const;
         int GetMaterialLayers(Material::Ptr material) const;
+        // Upload textures as page tables and tiles
+        void UpdateTexturesTiled(Collector& tex_collector, ClwScene& out) const;
+        // Report scene buffer memory to the profiler
+        void TrackSceneMemory(ClwScene const& scene) const;
+        // Upload input map leafs (and bytecode if any) into input_map_data buffer
+        void WriteInputMapData(ClwScene& out) const;
 
         // Context
         CLWContext m_context;
@@ -134,5 +218,17 @@ namespace Baikal
         const CLProgramManager *m_program_manager;
         // Material to device material map
         mutable std::unordered_map<std::uint32_t, std::int32_t> m_materialid_to_offset;
+        // Upload statistics
+        mutable UploadStatistics m_upload_stats;
+        // Texture layout
+        TexturePoolMode m_texture_pool_mode;
+        std::size_t m_texture_pool_budget;
+        // Input map evaluation
+        InputMapMode m_input_map_mode;
+        // Environment light sampling
+        bool m_env_importance_sampling;
+        // Profiler and scenes reported to it
+        std::shared_ptr<ClwProfiler> m_profiler;
+        mutable std::unordered_set<ClwScene const*> m_tracked_scenes;
     };
 }
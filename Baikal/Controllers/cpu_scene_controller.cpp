@@ -0,0 +1,266 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#include "cpu_scene_controller.h"
+
+#include "SceneGraph/scene1.h"
+#include "SceneGraph/camera.h"
+#include "SceneGraph/light.h"
+#include "SceneGraph/shape.h"
+#include "SceneGraph/uberv2material.h"
+#include "SceneGraph/iterator.h"
+
+namespace Baikal
+{
+    using namespace RadeonRays;
+
+    namespace
+    {
+        float3 TransformPoint(matrix const& m, float3 const& p)
+        {
+            return float3(m.m00 * p.x + m.m01 * p.y + m.m02 * p.z + m.m03,
+                          m.m10 * p.x + m.m11 * p.y + m.m12 * p.z + m.m13,
+                          m.m20 * p.x + m.m21 * p.y + m.m22 * p.z + m.m23);
+        }
+
+        float3 TransformVector(matrix const& m, float3 const& v)
+        {
+            return float3(m.m00 * v.x + m.m01 * v.y + m.m02 * v.z,
+                          m.m10 * v.x + m.m11 * v.y + m.m12 * v.z,
+                          m.m20 * v.x + m.m21 * v.y + m.m22 * v.z);
+        }
+
+        // Append world space triangles of a mesh
+        void FlattenMesh(Mesh const& mesh, matrix const& transform, int material_idx, int shape_id, CpuScene& out)
+        {
+            auto indices = mesh.GetIndices();
+            auto num_triangles = mesh.GetNumIndices() / 3;
+            auto has_normals = mesh.GetNumNormals() > 0;
+            auto has_uvs = mesh.GetNumUVs() > 0;
+
+            for (auto i = 0u; i < num_triangles; ++i)
+            {
+                float3 v[3];
+                for (auto j = 0u; j < 3; ++j)
+                {
+                    v[j] = TransformPoint(transform, mesh.GetVertices()[indices[3 * i + j]]);
+                }
+
+                auto face_normal = cross(v[1] - v[0], v[2] - v[0]);
+                face_normal = face_normal.sqnorm() > 0.f ? normalize(face_normal) : float3(0.f, 1.f, 0.f);
+
+                for (auto j = 0u; j < 3; ++j)
+                {
+                    auto idx = indices[3 * i + j];
+                    out.vertices.push_back(v[j]);
+                    out.normals.push_back(has_normals ? normalize(TransformVector(transform, mesh.GetNormals()[idx])) : face_normal);
+                    out.uvs.push_back(has_uvs ? mesh.GetUVs()[idx] : float2());
+                }
+
+                out.triangle_materials.push_back(material_idx);
+                out.triangle_shape_ids.push_back(shape_id);
+            }
+        }
+    }
+
+    CpuSceneController::CpuSceneController()
+        : m_default_material(UberV2Material::Create())
+    {
+    }
+
+    Material::Ptr CpuSceneController::GetDefaultMaterial() const
+    {
+        return m_default_material;
+    }
+
+    void CpuSceneController::UpdateCamera(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, Collector& vol_collector, CpuScene& out) const
+    {
+        auto camera = scene.GetCamera();
+
+        auto& data = out.camera;
+        data.forward = camera->GetForwardVector();
+        data.up = camera->GetUpVector();
+        data.right = camera->GetRightVector();
+        data.p = camera->GetPosition();
+        data.aspect_ratio = camera->GetAspectRatio();
+        data.dim = camera->GetSensorSize();
+        data.zcap = camera->GetDepthRange();
+        data.aperture = 0.f;
+        data.focal_length = 0.f;
+        data.focus_distance = 0.f;
+        data.orthographic = dynamic_cast<OrthographicCamera*>(camera.get()) != nullptr;
+
+        if (auto perspective = std::dynamic_pointer_cast<PerspectiveCamera>(camera))
+        {
+            data.aperture = perspective->GetAperture();
+            data.focal_length = perspective->GetFocalLength();
+            data.focus_distance = perspective->GetFocusDistance();
+        }
+    }
+
+    void CpuSceneController::UpdateShapes(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, Collector& vol_collector, CpuScene& out) const
+    {
+        out.vertices.clear();
+        out.normals.clear();
+        out.uvs.clear();
+        out.triangle_materials.clear();
+        out.triangle_shape_ids.clear();
+
+        auto get_material_idx = [this, &mat_collector](Shape const& shape)
+        {
+            auto material = shape.GetMaterial();
+            return static_cast<int>(mat_collector.GetItemIndex(material ? material : m_default_material));
+        };
+
+        auto shape_iter = scene.CreateShapeIterator();
+
+        for (; shape_iter->IsValid(); shape_iter->Next())
+        {
+            auto shape = shape_iter->ItemAs<Shape>();
+
+            if (auto instance = std::dynamic_pointer_cast<Instance>(shape))
+            {
+                auto base_mesh = std::static_pointer_cast<Mesh>(instance->GetBaseShape());
+                FlattenMesh(*base_mesh, instance->GetTransform(), get_material_idx(*instance), static_cast<int>(instance->GetId()), out);
+            }
+            else
+            {
+                auto mesh = std::static_pointer_cast<Mesh>(shape);
+                FlattenMesh(*mesh, mesh->GetTransform(), get_material_idx(*mesh), static_cast<int>(mesh->GetId()), out);
+            }
+        }
+
+        out.bvh.Build(out.vertices.data(), out.triangle_materials.size());
+    }
+
+    void CpuSceneController::UpdateShapeProperties(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, Collector& vol_collector, CpuScene& out) const
+    {
+        // Transforms are baked into vertices
+        UpdateShapes(scene, mat_collector, tex_collector, vol_collector, out);
+    }
+
+    void CpuSceneController::UpdateMaterials(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, CpuScene& out) const
+    {
+        out.materials.assign(mat_collector.GetNumItems(), CpuScene::Material());
+
+        auto mat_iter = mat_collector.CreateIterator();
+
+        for (; mat_iter->IsValid(); mat_iter->Next())
+        {
+            auto material = mat_iter->ItemAs<Material>();
+            auto& data = out.materials[mat_collector.GetItemIndex(material)];
+
+            // Materials other than UberV2 are not supported and stay black
+            data.layers = 0;
+
+            if (auto uberv2 = std::dynamic_pointer_cast<UberV2Material>(material))
+            {
+                data.layers = uberv2->GetLayers();
+                data.diffuse_color = uberv2->GetInputValue("uberv2.diffuse.color").input_map_value;
+                data.emission_color = uberv2->GetInputValue("uberv2.emission.color").input_map_value;
+                data.transparency = uberv2->GetInputValue("uberv2.transparency").input_map_value;
+            }
+        }
+
+        out.material_bundle.reset(mat_collector.CreateBundle());
+    }
+
+    void CpuSceneController::UpdateLights(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, CpuScene& out) const
+    {
+        out.lights.clear();
+        out.envmapidx = -1;
+
+        auto light_iter = scene.CreateLightIterator();
+
+        for (; light_iter->IsValid(); light_iter->Next())
+        {
+            auto light = light_iter->ItemAs<Light>();
+
+            CpuScene::Light data = {};
+            data.p = light->GetPosition();
+            data.d = light->GetDirection();
+            data.intensity = light->GetEmittedRadiance();
+
+            if (std::dynamic_pointer_cast<PointLight>(light))
+            {
+                data.type = CpuScene::LightType::kPoint;
+            }
+            else if (std::dynamic_pointer_cast<DirectionalLight>(light))
+            {
+                data.type = CpuScene::LightType::kDirectional;
+            }
+            else if (auto spot = std::dynamic_pointer_cast<SpotLight>(light))
+            {
+                data.type = CpuScene::LightType::kSpot;
+                data.ia = spot->GetConeShape().x;
+                data.oa = spot->GetConeShape().y;
+            }
+            else if (auto ibl = std::dynamic_pointer_cast<ImageBasedLight>(light))
+            {
+                data.type = CpuScene::LightType::kIbl;
+                data.texture = ibl->GetTexture();
+                data.multiplier = ibl->GetMultiplier();
+                data.mirror_x = ibl->GetMirrorX();
+                out.envmapidx = static_cast<int>(out.lights.size());
+            }
+            else
+            {
+                // Area and emissive mesh lights are accounted for
+                // when emissive geometry is hit
+                continue;
+            }
+
+            out.lights.push_back(data);
+        }
+    }
+
+    void CpuSceneController::UpdateTextures(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, CpuScene& out) const
+    {
+        // Textures are sampled directly from the scene graph
+        out.texture_bundle.reset(tex_collector.CreateBundle());
+    }
+
+    void CpuSceneController::UpdateInputMaps(Scene1 const& scene, Collector& input_map_collector, Collector& input_map_leafs_collector, CpuScene& out) const
+    {
+        // Input maps are evaluated directly from the scene graph
+        out.input_map_bundle.reset(input_map_collector.CreateBundle());
+    }
+
+    void CpuSceneController::UpdateLeafsData(Scene1 const& scene, Collector& input_map_leafs_collector, Collector& tex_collector, CpuScene& out) const
+    {
+        out.input_map_leafs_bundle.reset(input_map_leafs_collector.CreateBundle());
+    }
+
+    void CpuSceneController::UpdateCurrentScene(Scene1 const& scene, CpuScene& out) const
+    {
+    }
+
+    void CpuSceneController::UpdateVolumes(Scene1 const& scene, Collector& volume_collector, Collector& tex_collector, CpuScene& out) const
+    {
+        // Volumes are not supported
+        out.volume_bundle.reset(volume_collector.CreateBundle());
+    }
+
+    void CpuSceneController::UpdateSceneAttributes(Scene1 const& scene, Collector& tex_collector, CpuScene& out) const
+    {
+        out.background = scene.GetBackgroundImage();
+    }
+}
@@ -0,0 +1,70 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#pragma once
+
+#include "scene_controller.h"
+
+#include "SceneGraph/cpuscene.h"
+
+namespace Baikal
+{
+    /**
+     \brief Tracks changes of a scene and keeps corresponding CpuScene up to date.
+
+     Updates are coarse: any change of geometry flattens all shapes into world
+     space triangles again and rebuilds the BVH.
+     */
+    class CpuSceneController : public SceneController<CpuScene>
+    {
+    public:
+        CpuSceneController();
+        virtual ~CpuSceneController() = default;
+
+        // Update camera data only.
+        void UpdateCamera(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, Collector& vol_collector, CpuScene& out) const override;
+        // Update shape data only.
+        void UpdateShapes(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, Collector& vol_collector, CpuScene& out) const override;
+        // Update shape transforms
+        void UpdateShapeProperties(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, Collector& vol_collector, CpuScene& out) const override;
+        // Update lights data only.
+        void UpdateLights(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, CpuScene& out) const override;
+        // Update material data.
+        void UpdateMaterials(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, CpuScene& out) const override;
+        // Update texture data only.
+        void UpdateTextures(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, CpuScene& out) const override;
+        // Update input maps only
+        void UpdateInputMaps(Scene1 const& scene, Collector& input_map_collector, Collector& input_map_leafs_collector, CpuScene& out) const override;
+        // Update input map leafs only
+        void UpdateLeafsData(Scene1 const& scene, Collector& input_map_leafs_collector, Collector& tex_collector, CpuScene& out) const override;
+        // Get default material
+        Material::Ptr GetDefaultMaterial() const override;
+        // If m_current_scene changes
+        void UpdateCurrentScene(Scene1 const& scene, CpuScene& out) const override;
+        // Update volume materials
+        void UpdateVolumes(Scene1 const& scene, Collector& volume_collector, Collector& tex_collector, CpuScene& out) const override;
+        // If scene attributes changed
+        void UpdateSceneAttributes(Scene1 const& scene, Collector& tex_collector, CpuScene& out) const override;
+
+    private:
+        Material::Ptr m_default_material;
+    };
+}
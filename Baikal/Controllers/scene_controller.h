@@ -32,8 +32,11 @@
 #include "SceneGraph/material.h"
 #include "SceneGraph/scene1.h"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <map>
+#include <vector>
 
 namespace Baikal
 {
@@ -41,9 +44,19 @@ namespace Baikal
     class Bundle;
     class Material;
     class Light;
+    class Shape;
     class Texture;
     class VolumeMaterial;
 
+    // Get new revision for compiled scene data. Revisions are unique across all
+    // controllers and scenes, so results cached by renderers can not be matched by
+    // another scene compiled at the same address.
+    inline std::uint64_t NextCompiledSceneRevision()
+    {
+        static std::atomic<std::uint64_t> revision(0);
+        return ++revision;
+    }
+
     /**
      \brief Tracks changes of a scene and serialized data if needed.
 
@@ -62,6 +75,10 @@ namespace Baikal
         CompiledScene& CompileScene(Scene1::Ptr scene) const;
 
         CompiledScene& GetCachedScene(Scene1::Ptr scene) const;
+
+        // Bump revision of the compiled scene, so renderers drop results cached for it
+        // (e.g. AOVs). Needed only for changes dirty tracking does not see.
+        void InvalidateCachedScene(Scene1::Ptr scene) const;
     protected:
         // Recompile the scene from scratch, i.e. not loading from cache.
         // All the buffers are recreated and reloaded.
@@ -73,6 +90,24 @@ namespace Baikal
         void DropCameraDirty(Scene1 const& scene) const;
         // set dirty flag to false for iterator
         void DropDirty(Iterator& light_iterator) const;
+        // Shapes, lights and materials marked dirty since the last compilation
+        struct DirtyObjects
+        {
+            std::vector<std::shared_ptr<Shape>> shapes;
+            std::vector<std::shared_ptr<Light>> lights;
+            std::vector<Material::Ptr> materials;
+        };
+
+        // Try to update cached scene without re-collecting the scene graph, only dirty
+        // shapes, lights and materials are updated. Returns false if full change tracking is required.
+        bool UpdateIncremental(Scene1 const& scene, CompiledScene& out) const;
+        // Sum of revisions of the objects incremental update can handle (shapes, lights
+        // and collected materials), dirty ones are added to dirty if it is not null
+        std::uint64_t GetTrackedRevision(Scene1 const& scene, DirtyObjects* dirty) const;
+        // Check that everything dirty objects reference has been collected by the last compilation
+        bool IsCollected(DirtyObjects const& dirty) const;
+        // Remember change journal state after the scene has been compiled
+        void CommitRevision(Scene1 const& scene, std::uint64_t tracked_revision) const;
     public:
         // Update camera data only.
         virtual void UpdateCamera(Scene1 const& scene, Collector& mat_collector, Collector& tex_collector, Collector& vol_collector, CompiledScene& out) const = 0;
@@ -102,6 +137,12 @@ namespace Baikal
 
     private:
         mutable Scene1::Ptr m_current_scene;
+        // Camera of the current scene at the time of last compilation
+        mutable Camera::Ptr m_current_camera;
+        // Change journal revisions at the time of last compilation
+        mutable std::uint64_t m_global_revision = 0;
+        mutable std::uint64_t m_camera_revision = 0;
+        mutable std::uint64_t m_tracked_revision = 0;
         // Scene cache map (CPU scene -> GPU scene mapping)
         mutable std::map<Scene1::Ptr, CompiledScene> m_scene_cache;
 
@@ -10,7 +10,6 @@
 
 #include <chrono>
 #include <memory>
-#include <stack>
 #include <vector>
 #include <array>
 
@@ -48,6 +47,19 @@ namespace Baikal
         // As soon as we have this mapping we are analyzing dirty flags and
         // updating necessary parts.
 
+        // If only the camera or properties of already collected shapes, lights and
+        // materials have been changed since the last compilation there is no need
+        // to re-collect the scene graph.
+        if (scene == m_current_scene)
+        {
+            auto iter = m_scene_cache.find(scene);
+
+            if (iter != m_scene_cache.cend() && UpdateIncremental(*scene, iter->second))
+            {
+                return iter->second;
+            }
+        }
+
         // We need to make sure collectors are empty before proceeding
         m_material_collector.Clear();
         m_texture_collector.Clear();
@@ -60,18 +72,14 @@ namespace Baikal
         auto light_iter = scene->CreateLightIterator();
 
         auto default_material = GetDefaultMaterial();
+        // Material stack reused by all shapes
+        std::vector<Material::Ptr> material_stack;
         // Collect materials from shapes first
-        m_material_collector.Collect(*shape_iter,
-                              // This function adds all materials to resulting map
+        m_material_collector.CollectInto(*shape_iter,
+                              // This function adds all materials to the collector
                               // recursively via Material dependency API
-                              [default_material](SceneObject::Ptr item) ->
-                              std::set<SceneObject::Ptr>
+                              [default_material, &material_stack](SceneObject::Ptr item, Collector& collector)
                               {
-                                  // Resulting material set
-                                  std::set<SceneObject::Ptr> mats;
-                                  // Material stack
-                                  std::stack<Material::Ptr> material_stack;
-
                                   // Get material from current shape
                                   auto shape = std::static_pointer_cast<Shape>(item);
                                   auto material = shape->GetMaterial();
@@ -83,17 +91,17 @@ namespace Baikal
                                   }
 
                                   // Push to stack as an initializer
-                                  material_stack.push(material);
+                                  material_stack.push_back(material);
 
                                   // Drain the stack
                                   while (!material_stack.empty())
                                   {
                                       // Get current material
-                                      auto m = material_stack.top();
-                                      material_stack.pop();
+                                      auto m = material_stack.back();
+                                      material_stack.pop_back();
 
-                                      // Emplace into the set
-                                      mats.emplace(m);
+                                      // Add to the collection
+                                      collector.Collect(m);
 
                                       // Create dependency iterator
                                       auto mat_iter = m->CreateMaterialIterator();
@@ -101,14 +109,11 @@ namespace Baikal
                                       // Push all dependencies into the stack
                                       for (; mat_iter->IsValid(); mat_iter->Next())
                                       {
-                                          material_stack.push(
+                                          material_stack.push_back(
                                             mat_iter->ItemAs<Material>()
                                           );
                                       }
                                   }
-
-                                  // Return resulting set
-                                  return mats;
                               });
 
         // Commit stuff (we can iterate over it after commit has happened)
@@ -117,20 +122,15 @@ namespace Baikal
         // set iterator position at begin
         shape_iter->Reset();
         // Collect volume materials from shapes first
-        m_volume_collector.Collect(*shape_iter,
-                                    [](SceneObject::Ptr item) -> std::set<SceneObject::Ptr>
+        m_volume_collector.CollectInto(*shape_iter,
+                                    [](SceneObject::Ptr item, Collector& collector)
                                     {
-                                        // Resulting material set
-                                        std::set<SceneObject::Ptr> vol_mats;
-
                                         // Get volume material from current shape
                                         auto shape = std::static_pointer_cast<Shape>(item);
                                         auto volume_material = shape->GetVolumeMaterial();
 
                                         if (volume_material)
-                                            vol_mats.emplace(volume_material);
-
-                                        return vol_mats;
+                                            collector.Collect(volume_material);
                                     });
 
         // Commit stuff
@@ -141,25 +141,19 @@ namespace Baikal
         auto mat_iter = m_material_collector.CreateIterator();
 
         // Collect textures from materials
-        m_texture_collector.Collect(*mat_iter,
-                                    [](SceneObject::Ptr item) -> std::set<SceneObject::Ptr>
+        m_texture_collector.CollectInto(*mat_iter,
+                                    [](SceneObject::Ptr item, Collector& collector)
                               {
-                                  // Texture set
-                                  std::set<SceneObject::Ptr> textures;
-
                                   auto material = std::static_pointer_cast<Material>(item);
 
                                   // Create texture dependency iterator
                                   auto tex_iter = material->CreateTextureIterator();
 
-                                  // Emplace all dependent textures
+                                  // Add all dependent textures
                                   for (; tex_iter->IsValid(); tex_iter->Next())
                                   {
-                                      textures.emplace(tex_iter->ItemAs<Texture>());
+                                      collector.Collect(tex_iter->Item());
                                   }
-
-                                  // Return resulting set
-                                  return textures;
                               });
 
         // Now we need to collect textures from volumes
@@ -167,92 +161,68 @@ namespace Baikal
         auto vol_iter = m_volume_collector.CreateIterator();
 
         // Collect textures from materials
-        m_texture_collector.Collect(*vol_iter,
-            [](SceneObject::Ptr item) -> std::set<SceneObject::Ptr>
+        m_texture_collector.CollectInto(*vol_iter,
+            [](SceneObject::Ptr item, Collector& collector)
         {
-            // Texture set
-            std::set<SceneObject::Ptr> textures;
-
             auto volume = std::static_pointer_cast<VolumeMaterial>(item);
 
             // Create texture dependency iterator
             auto tex_iter = volume->CreateTextureIterator();
 
-            // Emplace all dependent textures
+            // Add all dependent textures
             for (; tex_iter->IsValid(); tex_iter->Next())
             {
-                textures.emplace(tex_iter->ItemAs<Texture>());
+                collector.Collect(tex_iter->Item());
             }
-
-            // Return resulting set
-            return textures;
         });
 
         // Collect textures from lights
-        m_texture_collector.Collect(*light_iter,
-                                    [](SceneObject::Ptr item) -> std::set<SceneObject::Ptr>
+        m_texture_collector.CollectInto(*light_iter,
+                                    [](SceneObject::Ptr item, Collector& collector)
                               {
-                                  // Resulting set
-                                  std::set<SceneObject::Ptr> textures;
-
                                   auto light = std::static_pointer_cast<Light>(item);
 
                                   // Create texture dependency iterator
                                   auto tex_iter = light->CreateTextureIterator();
 
-                                  // Emplace all dependent textures
+                                  // Add all dependent textures
                                   for (; tex_iter->IsValid(); tex_iter->Next())
                                   {
-                                      textures.emplace(tex_iter->ItemAs<Texture>());
+                                      collector.Collect(tex_iter->Item());
                                   }
-
-                                  // Return resulting set
-                                  return textures;
                               });
 
         mat_iter->Reset();
-        m_input_maps_collector.Collect(*mat_iter,
-                                [](SceneObject::Ptr item) -> std::set<SceneObject::Ptr>
+        m_input_maps_collector.CollectInto(*mat_iter,
+                                [](SceneObject::Ptr item, Collector& collector)
                                 {
-                                    // Texture set
-                                    std::set<SceneObject::Ptr> input_maps;
-
                                     auto material = std::static_pointer_cast<Material>(item);
 
-                                    // Create texture dependency iterator
+                                    // Create input map dependency iterator
                                     auto input_map_iter = material->CreateInputMapsIterator();
 
-                                    // Emplace all dependent textures
+                                    // Add all dependent input maps
                                     for (; input_map_iter->IsValid(); input_map_iter->Next())
                                     {
-                                        input_maps.emplace(input_map_iter->ItemAs<InputMap>());
+                                        collector.Collect(input_map_iter->Item());
                                     }
-
-                                    // Return resulting set
-                                    return input_maps;
                                 });
         m_input_maps_collector.Commit();
 
         mat_iter->Reset();
-        m_input_map_leafs_collector.Collect(*mat_iter,
-                                [](SceneObject::Ptr item) -> std::set<SceneObject::Ptr>
+        m_input_map_leafs_collector.CollectInto(*mat_iter,
+                                [](SceneObject::Ptr item, Collector& collector)
                                 {
-                                    // Texture set
-                                    std::set<SceneObject::Ptr> input_maps;
-
                                     auto material = std::static_pointer_cast<Material>(item);
 
-                                    // Create texture dependency iterator
+                                    // Create input map leaf dependency iterator
                                     auto input_map_iter = material->CreateInputMapLeafsIterator();
 
-                                    // Emplace all dependent textures
+                                    // Add all dependent leafs
                                     for (; input_map_iter->IsValid(); input_map_iter->Next())
                                     {
-                                        input_maps.emplace(input_map_iter->ItemAs<InputMap>());
+                                        collector.Collect(input_map_iter->Item());
                                     }
-
-                                    // Return resulting set
-                                    return input_maps;
                                 });
         m_input_map_leafs_collector.Commit();
 
@@ -276,6 +246,7 @@ namespace Baikal
             // Recompile all the stuff into cached scene
             RecompileFull(*scene, m_material_collector, m_texture_collector, m_volume_collector,
                           m_input_maps_collector, m_input_map_leafs_collector, res.first->second);
+            res.first->second.revision = NextCompiledSceneRevision();
 
             // Set scene as current
             m_current_scene = scene;
@@ -283,6 +254,8 @@ namespace Baikal
             // Drop all dirty flags for the scene
             scene->ClearDirtyFlags();
 
+            CommitRevision(*scene, GetTrackedRevision(*scene, nullptr));
+
             // Drop dirty flags for materials
             m_material_collector.Finalize([](SceneObject::Ptr item)
             {
@@ -290,6 +263,12 @@ namespace Baikal
                 material->SetDirty(false);
             });
 
+            m_texture_collector.Finalize([](SceneObject::Ptr item)
+            {
+                auto tex = std::static_pointer_cast<Texture>(item);
+                tex->SetDirty(false);
+            });
+
             m_volume_collector.Finalize([](SceneObject::Ptr item)
             {
                 auto volume = std::static_pointer_cast<VolumeMaterial>(item);
@@ -313,40 +292,22 @@ namespace Baikal
             auto dirty = scene->GetDirtyFlags();
 
             bool should_update_materials = !out.material_bundle ||
-                m_material_collector.NeedsUpdate(out.material_bundle.get(),
-                                                 [](SceneObject::Ptr ptr)->bool
-            {
-                auto mat = std::static_pointer_cast<Material>(ptr);
-                return mat->IsDirty();
-            });
+                m_material_collector.NeedsUpdate(out.material_bundle.get());
 
             bool should_update_volumes = !out.volume_bundle ||
-                m_volume_collector.NeedsUpdate(out.volume_bundle.get(),
-                                               [](SceneObject::Ptr ptr)->bool
-            {
-                auto volume = std::static_pointer_cast<VolumeMaterial>(ptr);
-                return volume->IsDirty();
-            });
+                m_volume_collector.NeedsUpdate(out.volume_bundle.get());
 
             bool should_update_textures = m_texture_collector.GetNumItems() > 0 && (
                 !out.texture_bundle ||
-                m_texture_collector.NeedsUpdate(out.texture_bundle.get(), [](SceneObject::Ptr ptr) {
-                auto tex = std::static_pointer_cast<Texture>(ptr);
-                return tex->IsDirty(); }));
+                m_texture_collector.NeedsUpdate(out.texture_bundle.get()));
 
             bool should_update_leafs_data = (m_input_map_leafs_collector.GetNumItems() > 0) && (
                 !out.input_map_leafs_bundle ||
-                m_input_map_leafs_collector.NeedsUpdate(out.input_map_leafs_bundle.get(), [](SceneObject::Ptr ptr)
-                {
-                    return ptr->IsDirty();
-                }));
+                m_input_map_leafs_collector.NeedsUpdate(out.input_map_leafs_bundle.get()));
 
             bool should_update_input_maps = (m_input_maps_collector.GetNumItems() > 0) && (
                 !out.input_map_bundle ||
-                m_input_maps_collector.NeedsUpdate(out.input_map_bundle.get(), [](SceneObject::Ptr ptr)
-                {
-                    return ptr->IsDirty();
-                }));
+                m_input_maps_collector.NeedsUpdate(out.input_map_bundle.get()));
 
             // Check if we have valid camera
             auto camera = scene->GetCamera();
@@ -442,6 +403,8 @@ namespace Baikal
                 else if (shapes_changed)
                 {
                     UpdateShapeProperties(*scene, m_material_collector, m_texture_collector, m_volume_collector, out);
+                    shape_iter->Reset();
+                    DropDirty(*shape_iter);
                 }
             }
 
@@ -484,6 +447,11 @@ namespace Baikal
             // Make sure to clear dirty flags
             scene->ClearDirtyFlags();
 
+            // Results derived from the compiled scene are no longer valid
+            out.revision = NextCompiledSceneRevision();
+
+            CommitRevision(*scene, GetTrackedRevision(*scene, nullptr));
+
             // Clear material dirty flags
             m_material_collector.Finalize([](SceneObject::Ptr item)
             {
@@ -546,6 +514,217 @@ namespace Baikal
         UpdateSceneAttributes(scene, m_texture_collector, out);
     }
 
+    template <typename CompiledScene>
+    inline
+    void SceneController<CompiledScene>::InvalidateCachedScene(Scene1::Ptr scene) const
+    {
+        auto iter = m_scene_cache.find(scene);
+
+        if (iter != m_scene_cache.cend())
+        {
+            iter->second.revision = NextCompiledSceneRevision();
+        }
+    }
+
+    template <typename CompiledScene>
+    inline
+    bool SceneController<CompiledScene>::UpdateIncremental(
+        Scene1 const& scene, CompiledScene& out) const
+    {
+        auto camera = scene.GetCamera();
+
+        // Attached objects or scene attributes changed: full change tracking is required
+        if (!camera || camera != m_current_camera ||
+            (scene.GetDirtyFlags() & ~static_cast<Scene1::DirtyFlags>(Scene1::kCamera)) != 0)
+        {
+            return false;
+        }
+
+        // Every object marked dirty since the last compilation bumps global
+        // revision, if all the bumps come from the camera nothing else changed.
+        auto global_changes = SceneObject::GetGlobalRevision() - m_global_revision;
+        auto camera_changes = camera->GetRevision() - m_camera_revision;
+        auto tracked_revision = m_tracked_revision;
+
+        DirtyObjects dirty;
+
+        if (global_changes != camera_changes)
+        {
+            // Otherwise the rest of the bumps should come from shapes, lights and materials,
+            // changes of textures, input maps or volumes require full change tracking.
+            tracked_revision = GetTrackedRevision(scene, &dirty);
+
+            if (tracked_revision - m_tracked_revision + camera_changes != global_changes || !IsCollected(dirty))
+            {
+                return false;
+            }
+        }
+
+        bool changed = false;
+
+        if (scene.GetDirtyFlags() & Scene1::kCamera || camera->IsDirty())
+        {
+            UpdateCamera(scene, m_material_collector, m_texture_collector, m_volume_collector, out);
+            DropCameraDirty(scene);
+            changed = true;
+        }
+
+        // Lights and shapes depend on materials
+        if (!dirty.materials.empty())
+        {
+            UpdateMaterials(scene, m_material_collector, m_texture_collector, out);
+
+            for (auto const& material : dirty.materials)
+            {
+                material->SetDirty(false);
+            }
+
+            changed = true;
+        }
+
+        if (!dirty.lights.empty() || !dirty.materials.empty())
+        {
+            UpdateLights(scene, m_material_collector, m_texture_collector, out);
+
+            for (auto const& light : dirty.lights)
+            {
+                light->SetDirty(false);
+            }
+
+            changed = true;
+        }
+
+        if (!dirty.shapes.empty())
+        {
+            UpdateShapeProperties(scene, m_material_collector, m_texture_collector, m_volume_collector, out);
+
+            for (auto const& shape : dirty.shapes)
+            {
+                shape->SetDirty(false);
+            }
+
+            changed = true;
+        }
+
+        if (changed)
+        {
+            out.revision = NextCompiledSceneRevision();
+        }
+
+        scene.ClearDirtyFlags();
+
+        CommitRevision(scene, tracked_revision);
+
+        return true;
+    }
+
+    template <typename CompiledScene>
+    inline
+    std::uint64_t SceneController<CompiledScene>::GetTrackedRevision(
+        Scene1 const& scene, DirtyObjects* dirty) const
+    {
+        std::uint64_t revision = 0;
+
+        for (auto iter = scene.CreateShapeIterator(); iter->IsValid(); iter->Next())
+        {
+            auto shape = iter->ItemAs<Shape>();
+            revision += shape->GetRevision();
+
+            if (dirty && shape->IsDirty())
+            {
+                dirty->shapes.push_back(shape);
+            }
+        }
+
+        for (auto iter = scene.CreateLightIterator(); iter->IsValid(); iter->Next())
+        {
+            auto light = iter->ItemAs<Light>();
+            revision += light->GetRevision();
+
+            if (dirty && light->IsDirty())
+            {
+                dirty->lights.push_back(light);
+            }
+        }
+
+        for (auto iter = m_material_collector.CreateIterator(); iter->IsValid(); iter->Next())
+        {
+            auto material = iter->ItemAs<Material>();
+            revision += material->GetRevision();
+
+            if (dirty && material->IsDirty())
+            {
+                dirty->materials.push_back(material);
+            }
+        }
+
+        return revision;
+    }
+
+    template <typename CompiledScene>
+    inline
+    bool SceneController<CompiledScene>::IsCollected(DirtyObjects const& dirty) const
+    {
+        auto is_collected = [](Collector const& collector, std::unique_ptr<Iterator> iter)
+        {
+            for (; iter->IsValid(); iter->Next())
+            {
+                if (!collector.Contains(iter->Item()))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+        // Shapes might have been assigned new materials
+        for (auto const& shape : dirty.shapes)
+        {
+            auto material = shape->GetMaterial() ? shape->GetMaterial() : GetDefaultMaterial();
+            auto volume_material = shape->GetVolumeMaterial();
+
+            if (!m_material_collector.Contains(material) ||
+                (volume_material && !m_volume_collector.Contains(volume_material)))
+            {
+                return false;
+            }
+        }
+
+        // Lights might have been assigned new textures
+        for (auto const& light : dirty.lights)
+        {
+            if (!is_collected(m_texture_collector, light->CreateTextureIterator()))
+            {
+                return false;
+            }
+        }
+
+        // Materials might have been assigned new dependencies
+        for (auto const& material : dirty.materials)
+        {
+            if (!is_collected(m_material_collector, material->CreateMaterialIterator()) ||
+                !is_collected(m_texture_collector, material->CreateTextureIterator()) ||
+                !is_collected(m_input_maps_collector, material->CreateInputMapsIterator()) ||
+                !is_collected(m_input_map_leafs_collector, material->CreateInputMapLeafsIterator()))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    template <typename CompiledScene>
+    inline
+    void SceneController<CompiledScene>::CommitRevision(Scene1 const& scene, std::uint64_t tracked_revision) const
+    {
+        m_current_camera = scene.GetCamera();
+        m_global_revision = SceneObject::GetGlobalRevision();
+        m_camera_revision = m_current_camera ? m_current_camera->GetRevision() : 0;
+        m_tracked_revision = tracked_revision;
+    }
+
     template <typename CompiledScene>
     inline
     void SceneController<CompiledScene>::DropCameraDirty(Scene1 const& scene) const
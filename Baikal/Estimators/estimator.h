@@ -67,11 +67,20 @@ namespace Baikal
             float primary_throughput;
             float secondary_throughput;
             float shadow_throughput;
+            float shading_throughput;
+            float secondary_shading_throughput;
+            float sorted_secondary_shading_throughput;
         };
 
         using MissedPrimaryRaysHandler = std::function<void(
             CLWBuffer<ray> rays, CLWBuffer<Intersection> intersections, CLWBuffer<int> pixel_indices,
             CLWBuffer<int> output_indices, std::size_t size, CLWBuffer<RadeonRays::float3> output)>;
+
+        // Generates camera rays for a list of output indices (the count is a GPU buffer)
+        // with a given sample index into a ray buffer
+        using PrimaryRaysGenerator = std::function<void(
+            CLWBuffer<int> output_indices, CLWBuffer<int> num_rays, std::uint32_t sample_index,
+            CLWBuffer<ray> rays)>;
         
         Estimator(std::shared_ptr<RadeonRays::IntersectionApi> api)
             : m_intersector(api)
@@ -103,6 +112,13 @@ namespace Baikal
         */
         virtual void SetRandomSeed(std::uint32_t seed) = 0;
 
+        /**
+        \brief Set profiler for kernel timings and work buffer accounting.
+
+        \param profiler Profiler, nullptr disables profiling
+        */
+        virtual void SetProfiler(std::shared_ptr<ClwProfiler> profiler) {}
+
         /**
         \brief Get ray buffer handle.
 
@@ -209,6 +225,9 @@ namespace Baikal
         \param use_output_indices If set to false assumes 1 to 1 correspondence between the ray and the output
         \param atomic_update Tells an estimator that indices might contain duplicate elements and
                 hence atomic update is required while updating output buffer.
+        \param missedPrimaryRaysHandler Shades primary rays which have missed the scene.
+        \param primaryRaysGenerator Generates new camera samples for estimators which restart
+                terminated paths, each restarted path adds a sample to the output.
         */
         virtual void Estimate(
             ClwScene const& scene,
@@ -217,7 +236,8 @@ namespace Baikal
             CLWBuffer<RadeonRays::float3> output,
             bool use_output_indices = true,
             bool atomic_update = false,
-            MissedPrimaryRaysHandler missedPrimaryRaysHandler = nullptr
+            MissedPrimaryRaysHandler missedPrimaryRaysHandler = nullptr,
+            PrimaryRaysGenerator primaryRaysGenerator = nullptr
         ) = 0;
 
         /**
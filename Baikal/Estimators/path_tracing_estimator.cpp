@@ -16,6 +16,14 @@
 
 namespace Baikal
 {
+    namespace
+    {
+        // Sort hits by material if more than this fraction of neighbours differ in material
+        float const kMaterialSortDivergenceThreshold = 0.125f;
+        // Number of estimates between material divergence counter read backs
+        std::uint32_t const kMaterialSortUpdateInterval = 16u;
+    }
+
     struct PathTracingEstimator::PathState
     {
         float4 throughput;
@@ -47,6 +55,25 @@ namespace Baikal
         CLWBuffer<int> hitcount;
         CLWParallelPrimitives pp;
 
+        // Material sorting
+        CLWBuffer<int> material_keys[2];
+        CLWBuffer<int> sorted_indices;
+        CLWBuffer<int> material_counters;
+        std::vector<float> material_divergence;
+        std::vector<bool> material_sort;
+
+        // Path regeneration
+        CLWBuffer<int> free_ray_predicate;
+        CLWBuffer<int> free_path_predicate;
+        CLWBuffer<int> free_rays;
+        CLWBuffer<int> free_paths;
+        CLWBuffer<int> num_free_paths;
+        CLWBuffer<int> regeneration_output_indices;
+        CLWBuffer<ray> regeneration_rays;
+
+        // Number of rays traced for live paths
+        CLWBuffer<int> ray_counter;
+
         // RadeonRays stuff
         Buffer* fr_rays[2];
         Buffer* fr_shadowrays;
@@ -88,14 +115,27 @@ namespace Baikal
         , m_render_data(new RenderData)
         , m_sample_counter(0)
         , m_uberv2_kernels(context, program_manager, "../Baikal/Kernels/CL/path_tracing_estimator_uberv2.cl", "")
+        , m_material_sort_mode(MaterialSortMode::kAdaptive)
+        , m_regeneration_passes(0u)
     {
         // Create parallel primitives
         m_render_data->pp = CLWParallelPrimitives(context, GetFullBuildOpts().c_str());
         m_render_data->sobolmat = context.CreateBuffer<unsigned int>(1024 * 52, CL_MEM_READ_ONLY, &g_SobolMatrices[0]);
+
+        int zero = 0;
+        m_render_data->ray_counter = context.CreateBuffer<int>(1, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, &zero);
+
+        // Resolve variant used for atomic updates of the output
+        AddProgramVariant(" -D BAIKAL_ATOMIC_RESOLVE ");
     }
 
     PathTracingEstimator::~PathTracingEstimator()
     {
+        if (GetProfiler())
+        {
+            GetProfiler()->ReleaseAllocations(this);
+        }
+
         // Recreate FR buffers
         GetIntersector()->DeleteBuffer(m_render_data->fr_rays[0]);
         GetIntersector()->DeleteBuffer(m_render_data->fr_rays[1]);
@@ -136,6 +176,16 @@ namespace Baikal
         m_render_data->pixelindices[1] = GetContext().CreateBuffer<int>(size, CL_MEM_READ_WRITE);
         m_render_data->output_indices = GetContext().CreateBuffer<int>(size, CL_MEM_READ_WRITE);
         m_render_data->hitcount = GetContext().CreateBuffer<int>(1, CL_MEM_READ_WRITE);
+        m_render_data->material_keys[0] = GetContext().CreateBuffer<int>(size, CL_MEM_READ_WRITE);
+        m_render_data->material_keys[1] = GetContext().CreateBuffer<int>(size, CL_MEM_READ_WRITE);
+        m_render_data->sorted_indices = GetContext().CreateBuffer<int>(size, CL_MEM_READ_WRITE);
+        m_render_data->free_ray_predicate = GetContext().CreateBuffer<int>(size, CL_MEM_READ_WRITE);
+        m_render_data->free_path_predicate = GetContext().CreateBuffer<int>(size, CL_MEM_READ_WRITE);
+        m_render_data->free_rays = GetContext().CreateBuffer<int>(size, CL_MEM_READ_WRITE);
+        m_render_data->free_paths = GetContext().CreateBuffer<int>(size, CL_MEM_READ_WRITE);
+        m_render_data->num_free_paths = GetContext().CreateBuffer<int>(1, CL_MEM_READ_WRITE);
+        m_render_data->regeneration_output_indices = GetContext().CreateBuffer<int>(size, CL_MEM_READ_WRITE);
+        m_render_data->regeneration_rays = GetContext().CreateBuffer<ray>(size, CL_MEM_READ_WRITE);
 
         // Recreate FR buffers
         GetIntersector()->DeleteBuffer(m_render_data->fr_rays[0]);
@@ -154,6 +204,49 @@ namespace Baikal
         m_render_data->fr_shadowhits = CreateFromOpenClBuffer(intersector, m_render_data->shadowhits);
         m_render_data->fr_intersections = CreateFromOpenClBuffer(intersector, m_render_data->intersections);
         m_render_data->fr_hitcount = CreateFromOpenClBuffer(intersector, m_render_data->hitcount);
+
+        TrackWorkBuffers();
+    }
+
+    void PathTracingEstimator::SetProfiler(std::shared_ptr<ClwProfiler> profiler)
+    {
+        if (GetProfiler())
+        {
+            GetProfiler()->ReleaseAllocations(this);
+        }
+
+        ClwClass::SetProfiler(profiler);
+        TrackWorkBuffers();
+    }
+
+    void PathTracingEstimator::TrackWorkBuffers() const
+    {
+        auto profiler = GetProfiler();
+
+        if (!profiler)
+        {
+            return;
+        }
+
+        auto const& data = *m_render_data;
+
+        std::size_t size =
+            ClwProfiler::GetBufferSize(data.rays[0]) + ClwProfiler::GetBufferSize(data.rays[1]) +
+            ClwProfiler::GetBufferSize(data.hits) + ClwProfiler::GetBufferSize(data.intersections) +
+            ClwProfiler::GetBufferSize(data.shadowrays) + ClwProfiler::GetBufferSize(data.shadowhits) +
+            ClwProfiler::GetBufferSize(data.lightsamples) + ClwProfiler::GetBufferSize(data.paths) +
+            ClwProfiler::GetBufferSize(data.random) + ClwProfiler::GetBufferSize(data.sobolmat) +
+            ClwProfiler::GetBufferSize(data.iota) + ClwProfiler::GetBufferSize(data.compacted_indices) +
+            ClwProfiler::GetBufferSize(data.pixelindices[0]) + ClwProfiler::GetBufferSize(data.pixelindices[1]) +
+            ClwProfiler::GetBufferSize(data.output_indices) + ClwProfiler::GetBufferSize(data.hitcount) +
+            ClwProfiler::GetBufferSize(data.material_keys[0]) + ClwProfiler::GetBufferSize(data.material_keys[1]) +
+            ClwProfiler::GetBufferSize(data.sorted_indices) + ClwProfiler::GetBufferSize(data.material_counters) +
+            ClwProfiler::GetBufferSize(data.free_ray_predicate) + ClwProfiler::GetBufferSize(data.free_path_predicate) +
+            ClwProfiler::GetBufferSize(data.free_rays) + ClwProfiler::GetBufferSize(data.free_paths) +
+            ClwProfiler::GetBufferSize(data.num_free_paths) + ClwProfiler::GetBufferSize(data.regeneration_output_indices) +
+            ClwProfiler::GetBufferSize(data.regeneration_rays) + ClwProfiler::GetBufferSize(data.ray_counter);
+
+        profiler->SetAllocation(this, ClwProfiler::MemoryCategory::kWorkBuffers, size);
     }
 
     CLWBuffer<ray> PathTracingEstimator::GetRayBuffer() const
@@ -178,7 +271,8 @@ namespace Baikal
         CLWBuffer<RadeonRays::float3> output,
         bool use_output_indices,
         bool atomic_update,
-        MissedPrimaryRaysHandler missedPrimaryRaysHandler
+        MissedPrimaryRaysHandler missedPrimaryRaysHandler,
+        PrimaryRaysGenerator primaryRaysGenerator
     )
     {
         if (atomic_update)
@@ -189,14 +283,29 @@ namespace Baikal
         auto has_visibility_buffer = HasIntermediateValueBuffer(IntermediateValue::kVisibility);
         auto visibility_buffer = GetIntermediateValueBuffer(IntermediateValue::kVisibility);
 
+        // Restarted paths would not go through the missed primary rays handler
+        bool regenerate = m_regeneration_passes > 0 && primaryRaysGenerator && !missedPrimaryRaysHandler;
+        auto num_passes = GetMaxBounces() + (regenerate ? m_regeneration_passes : 0u);
+
         InitPathData(num_estimates, scene.camera_volume_index);
 
+        if (m_material_sort_mode != MaterialSortMode::kDisabled)
+        {
+            UpdateMaterialSortState();
+        }
+
         GetContext().CopyBuffer(0u, m_render_data->iota, m_render_data->pixelindices[0], 0, 0, num_estimates);
         GetContext().CopyBuffer(0u, m_render_data->iota, m_render_data->pixelindices[1], 0, 0, num_estimates);
 
         // Initialize first pass
-        for (auto pass = 0u; pass < GetMaxBounces(); ++pass)
+        for (auto pass = 0u; pass < num_passes; ++pass)
         {
+            // Attribute kernel timings of this pass to the bounce
+            if (GetProfiler())
+            {
+                GetProfiler()->SetBounce(static_cast<int>(pass));
+            }
+
             // Clear ray hits buffer
             // TODO: make it a kernel
             GetContext().FillBuffer(
@@ -244,6 +353,12 @@ namespace Baikal
                 m_render_data->hitcount
             );
 
+            // Group hits by material to improve shading coherence
+            if (m_material_sort_mode != MaterialSortMode::kDisabled)
+            {
+                SortHitsByMaterial(scene, pass, num_estimates, m_material_sort_mode == MaterialSortMode::kEnabled);
+            }
+
             // Advance indices to keep pixel indices up to date
             RestorePixelIndices(pass, num_estimates);
 
@@ -308,10 +423,121 @@ namespace Baikal
                 GatherVisibility(scene, pass, num_estimates, visibility_buffer, use_output_indices);
             }
 
+            // Refill slots of terminated paths for the next pass
+            if (regenerate && pass + 1 < num_passes)
+            {
+                RegeneratePaths(scene, pass, num_estimates, output, use_output_indices, primaryRaysGenerator, pass < m_regeneration_passes);
+            }
+
             GetContext().Flush(0);
         }
 
-        ++m_sample_counter;
+        if (GetProfiler())
+        {
+            GetProfiler()->SetBounce(-1);
+        }
+
+        // Restarted paths use sample indices of the passes they have been started at
+        m_sample_counter += regenerate ? num_passes : 1u;
+    }
+
+    void PathTracingEstimator::RegeneratePaths(
+        ClwScene const& scene,
+        int pass,
+        std::size_t size,
+        CLWBuffer<RadeonRays::float3> output,
+        bool use_output_indices,
+        PrimaryRaysGenerator const& generator,
+        bool restart
+    )
+    {
+        auto output_indices = use_output_indices ? m_render_data->output_indices : m_render_data->iota;
+
+        // Rays for the next pass are in compacted order, see ShadeSurface
+        auto pixel_indices = m_render_data->pixelindices[pass & 0x1];
+
+        GetContext().FillBuffer(0, m_render_data->free_path_predicate, 1, size);
+
+        {
+            auto find_kernel = GetKernel("FindRegenerationSlots");
+
+            int argc = 0;
+            find_kernel.SetArg(argc++, pixel_indices);
+            find_kernel.SetArg(argc++, m_render_data->hitcount);
+            find_kernel.SetArg(argc++, (cl_int)size);
+            find_kernel.SetArg(argc++, pass + 1);
+            find_kernel.SetArg(argc++, (cl_int)GetMaxBounces());
+            find_kernel.SetArg(argc++, m_render_data->paths);
+            find_kernel.SetArg(argc++, m_render_data->free_ray_predicate);
+            find_kernel.SetArg(argc++, m_render_data->free_path_predicate);
+
+            Launch1D("FindRegenerationSlots", ((size + 63) / 64) * 64, 64, find_kernel);
+        }
+
+        // Last passes only finish paths which are already in flight
+        if (!restart)
+        {
+            return;
+        }
+
+        // Both predicates have the same number of set elements, so counts go to the same buffer
+        m_render_data->pp.Compact(
+            0,
+            m_render_data->free_ray_predicate,
+            m_render_data->iota,
+            m_render_data->free_rays,
+            (std::uint32_t)size,
+            m_render_data->num_free_paths
+        );
+
+        m_render_data->pp.Compact(
+            0,
+            m_render_data->free_path_predicate,
+            m_render_data->iota,
+            m_render_data->free_paths,
+            (std::uint32_t)size,
+            m_render_data->num_free_paths
+        );
+
+        {
+            auto gather_kernel = GetKernel("GatherRegenerationOutputIndices");
+
+            int argc = 0;
+            gather_kernel.SetArg(argc++, m_render_data->free_paths);
+            gather_kernel.SetArg(argc++, m_render_data->num_free_paths);
+            gather_kernel.SetArg(argc++, output_indices);
+            gather_kernel.SetArg(argc++, m_render_data->regeneration_output_indices);
+
+            Launch1D("GatherRegenerationOutputIndices", ((size + 63) / 64) * 64, 64, gather_kernel);
+        }
+
+        // New paths are traced at the next pass and use its sample index
+        generator(
+            m_render_data->regeneration_output_indices,
+            m_render_data->num_free_paths,
+            m_sample_counter + pass + 1,
+            m_render_data->regeneration_rays);
+
+        {
+            auto regenerate_kernel = GetKernel("RegeneratePaths");
+
+            int argc = 0;
+            regenerate_kernel.SetArg(argc++, m_render_data->free_rays);
+            regenerate_kernel.SetArg(argc++, m_render_data->free_paths);
+            regenerate_kernel.SetArg(argc++, m_render_data->num_free_paths);
+            regenerate_kernel.SetArg(argc++, m_render_data->regeneration_rays);
+            regenerate_kernel.SetArg(argc++, output_indices);
+            regenerate_kernel.SetArg(argc++, (cl_int)size);
+            regenerate_kernel.SetArg(argc++, pass + 1);
+            regenerate_kernel.SetArg(argc++, scene.camera_volume_index);
+            regenerate_kernel.SetArg(argc++, m_render_data->rays[(pass + 1) & 0x1]);
+            regenerate_kernel.SetArg(argc++, pixel_indices);
+            regenerate_kernel.SetArg(argc++, m_render_data->hitcount);
+            regenerate_kernel.SetArg(argc++, m_render_data->paths);
+            regenerate_kernel.SetArg(argc++, output);
+
+            Launch1D("RegeneratePaths", ((size + 63) / 64) * 64, 64, regenerate_kernel);
+        }
     }
 
     void PathTracingEstimator::InitPathData(std::size_t size, int volume_idx)
@@ -326,7 +552,7 @@ namespace Baikal
         init_kernel.SetArg(argc++, m_render_data->paths);
 
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, init_kernel);
+            Launch1D("InitPathData", ((size + 63) / 64) * 64, 64, init_kernel);
         }
     }
 
@@ -359,6 +585,7 @@ namespace Baikal
         shadekernel.SetArg(argc++, scene.material_attributes);
         shadekernel.SetArg(argc++, scene.textures);
         shadekernel.SetArg(argc++, scene.texturedata);
+        shadekernel.SetArg(argc++, scene.texture_feedback);
         shadekernel.SetArg(argc++, scene.envmapidx);
         shadekernel.SetArg(argc++, scene.lights);
         shadekernel.SetArg(argc++, scene.light_distributions);
@@ -378,7 +605,7 @@ namespace Baikal
 
         // Run shading kernel
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, shadekernel);
+            Launch1D("ShadeSurfaceUberV2", ((size + 63) / 64) * 64, 64, shadekernel);
         }
     }
 
@@ -411,6 +638,7 @@ namespace Baikal
         shadekernel.SetArg(argc++, scene.material_attributes);
         shadekernel.SetArg(argc++, scene.textures);
         shadekernel.SetArg(argc++, scene.texturedata);
+        shadekernel.SetArg(argc++, scene.texture_feedback);
         shadekernel.SetArg(argc++, scene.envmapidx);
         shadekernel.SetArg(argc++, scene.lights);
         shadekernel.SetArg(argc++, scene.light_distributions);
@@ -430,7 +658,7 @@ namespace Baikal
 
         // Run shading kernel
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, shadekernel);
+            Launch1D("ShadeVolumeUberV2", ((size + 63) / 64) * 64, 64, shadekernel);
         }
     }
 
@@ -456,6 +684,7 @@ namespace Baikal
         sample_kernel.SetArg(argc++, scene.volumes);
         sample_kernel.SetArg(argc++, scene.textures);
         sample_kernel.SetArg(argc++, scene.texturedata);
+        sample_kernel.SetArg(argc++, scene.texture_feedback);
         sample_kernel.SetArg(argc++, rand_uint());
         sample_kernel.SetArg(argc++, m_render_data->random);
         sample_kernel.SetArg(argc++, m_render_data->sobolmat);
@@ -467,7 +696,7 @@ namespace Baikal
 
         // Run shading kernel
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, sample_kernel);
+            Launch1D("SampleVolume", ((size + 63) / 64) * 64, 64, sample_kernel);
         }
     }
 
@@ -495,12 +724,13 @@ namespace Baikal
         misskernel.SetArg(argc++, scene.envmapidx);
         misskernel.SetArg(argc++, scene.textures);
         misskernel.SetArg(argc++, scene.texturedata);
+        misskernel.SetArg(argc++, scene.texture_feedback);
         misskernel.SetArg(argc++, m_render_data->paths);
         misskernel.SetArg(argc++, scene.volumes);
         misskernel.SetArg(argc++, output);
 
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, misskernel);
+            Launch1D("ShadeBackgroundEnvMap", ((size + 63) / 64) * 64, 64, misskernel);
         }
     }
 
@@ -529,7 +759,7 @@ namespace Baikal
 
         // Run shading kernel
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, gatherkernel);
+            Launch1D("GatherLightSamples", ((size + 63) / 64) * 64, 64, gatherkernel);
         }
     }
 
@@ -568,7 +798,7 @@ namespace Baikal
 
         // Run shading kernel
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, volumekernel);
+            Launch1D("ApplyVolumeTransmissionUberV2", ((size + 63) / 64) * 64, 64, volumekernel);
         }
     }
 
@@ -595,7 +825,7 @@ namespace Baikal
 
         // Run shading kernel
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, gatherkernel);
+            Launch1D("GatherVisibility", ((size + 63) / 64) * 64, 64, gatherkernel);
         }
     }
 
@@ -614,7 +844,7 @@ namespace Baikal
 
         // Run shading kernel
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, restorekernel);
+            Launch1D("RestorePixelIndices", ((size + 63) / 64) * 64, 64, restorekernel);
         }
     }
 
@@ -628,10 +858,121 @@ namespace Baikal
         restorekernel.SetArg(argc++, m_render_data->pixelindices[(pass + 1) & 0x1]);
         restorekernel.SetArg(argc++, m_render_data->paths);
         restorekernel.SetArg(argc++, m_render_data->hits);
+        restorekernel.SetArg(argc++, m_render_data->ray_counter);
+
+        {
+            Launch1D("FilterPathStream", ((size + 63) / 64) * 64, 64, restorekernel);
+        }
+    }
+
+    bool PathTracingEstimator::SortHitsByMaterial(ClwScene const& scene, int pass, std::size_t size, bool force_sort)
+    {
+        auto keys_kernel = GetKernel("GenerateMaterialSortKeys");
+
+        int argc = 0;
+        keys_kernel.SetArg(argc++, m_render_data->intersections);
+        keys_kernel.SetArg(argc++, m_render_data->compacted_indices);
+        keys_kernel.SetArg(argc++, m_render_data->hitcount);
+        keys_kernel.SetArg(argc++, scene.shapes);
+        keys_kernel.SetArg(argc++, (cl_int)size);
+        keys_kernel.SetArg(argc++, pass);
+        keys_kernel.SetArg(argc++, m_render_data->material_keys[0]);
+        keys_kernel.SetArg(argc++, m_render_data->material_counters);
+
+        {
+            Launch1D("GenerateMaterialSortKeys", ((size + 63) / 64) * 64, 64, keys_kernel);
+        }
+
+        auto const& material_sort = m_render_data->material_sort;
 
+        if (!force_sort && (pass >= (int)material_sort.size() || !material_sort[pass]))
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, restorekernel);
+            return false;
         }
+
+        // Radix sort is stable, so hits sharing a material stay in ray order
+        m_render_data->pp.SortRadix(
+            0,
+            m_render_data->material_keys[0],
+            m_render_data->material_keys[1],
+            m_render_data->compacted_indices,
+            m_render_data->sorted_indices,
+            (int)size);
+
+        std::swap(m_render_data->compacted_indices, m_render_data->sorted_indices);
+
+        return true;
+    }
+
+    void PathTracingEstimator::UpdateMaterialSortState()
+    {
+        auto& counters = m_render_data->material_counters;
+
+        // Counters hold data of the previous estimate, read them back periodically
+        // to avoid stalling the queue every frame
+        if (counters.GetElementCount() > 0 && (m_sample_counter % kMaterialSortUpdateInterval) == 0)
+        {
+            std::vector<int> values(counters.GetElementCount());
+            GetContext().ReadBuffer(0, counters, values.data(), values.size()).Wait();
+
+            auto num_bounces = values.size() / 2;
+            m_render_data->material_divergence.resize(num_bounces);
+            m_render_data->material_sort.resize(num_bounces);
+
+            for (auto i = 0u; i < num_bounces; ++i)
+            {
+                auto num_hits = values[2 * i];
+                auto divergence = num_hits > 1 ? (float)values[2 * i + 1] / (num_hits - 1) : 0.f;
+
+                m_render_data->material_divergence[i] = divergence;
+                m_render_data->material_sort[i] = divergence > kMaterialSortDivergenceThreshold;
+            }
+        }
+
+        // Regenerating estimates run additional passes
+        auto num_counters = 2 * std::max(GetMaxBounces() + m_regeneration_passes, 2u);
+
+        if (counters.GetElementCount() < num_counters)
+        {
+            counters = GetContext().CreateBuffer<int>(num_counters, CL_MEM_READ_WRITE);
+            TrackWorkBuffers();
+        }
+
+        GetContext().FillBuffer(0, counters, 0, counters.GetElementCount());
+    }
+
+    void PathTracingEstimator::SetMaterialSortMode(MaterialSortMode mode)
+    {
+        m_material_sort_mode = mode;
+    }
+
+    PathTracingEstimator::MaterialSortMode PathTracingEstimator::GetMaterialSortMode() const
+    {
+        return m_material_sort_mode;
+    }
+
+    float PathTracingEstimator::GetMaterialDivergence(std::uint32_t bounce) const
+    {
+        auto const& divergence = m_render_data->material_divergence;
+        return bounce < divergence.size() ? divergence[bounce] : 0.f;
+    }
+
+    void PathTracingEstimator::SetRegenerationPasses(std::uint32_t num_passes)
+    {
+        m_regeneration_passes = num_passes;
+    }
+
+    std::uint32_t PathTracingEstimator::GetRegenerationPasses() const
+    {
+        return m_regeneration_passes;
+    }
+
+    std::uint32_t PathTracingEstimator::ReadTracedRayCount()
+    {
+        int count = 0;
+        GetContext().ReadBuffer(0, m_render_data->ray_counter, &count, 1).Wait();
+        GetContext().FillBuffer(0, m_render_data->ray_counter, 0, 1);
+        return static_cast<std::uint32_t>(count);
     }
 
     void PathTracingEstimator::ShadeMiss(
@@ -656,14 +997,16 @@ namespace Baikal
         misskernel.SetArg(argc++, scene.light_distributions);
         misskernel.SetArg(argc++, scene.num_lights);
         misskernel.SetArg(argc++, scene.envmapidx);
+        misskernel.SetArg(argc++, pass);
         misskernel.SetArg(argc++, scene.textures);
         misskernel.SetArg(argc++, scene.texturedata);
+        misskernel.SetArg(argc++, scene.texture_feedback);
         misskernel.SetArg(argc++, m_render_data->paths);
         misskernel.SetArg(argc++, scene.volumes);
         misskernel.SetArg(argc++, output);
 
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, misskernel);
+            Launch1D("ShadeMiss", ((size + 63) / 64) * 64, 64, misskernel);
         }
     }
 
@@ -778,6 +1121,34 @@ namespace Baikal
         // Advance indices to keep pixel indices up to date
         RestorePixelIndices(0, num_estimates);
 
+        // Shading mutates path state, so keep a copy to restore it after timing
+        auto paths = GetContext().CreateBuffer<PathState>(num_estimates, CL_MEM_READ_WRITE);
+
+        auto measure_shading = [&](int pass)
+        {
+            GetContext().CopyBuffer(0u, m_render_data->paths, paths, 0, 0, num_estimates);
+
+            auto shading_start = std::chrono::high_resolution_clock::now();
+
+            for (auto i = 0U; i < num_passes; ++i)
+            {
+                ShadeSurface(scene, pass, num_estimates, temporary, false);
+            }
+
+            GetContext().Finish(0);
+
+            auto shading_delta = std::chrono::high_resolution_clock::now() - shading_start;
+
+            GetContext().CopyBuffer(0u, paths, m_render_data->paths, 0, 0, num_estimates);
+
+            return num_estimates / (((float)std::chrono::duration_cast<std::chrono::milliseconds>(shading_delta).count()
+                / num_passes)
+                / 1000.f);
+        };
+
+        // Shade hits
+        stats.shading_throughput = measure_shading(0);
+
         // Shade hits
         ShadeSurface(scene, 0, num_estimates, temporary, false);
 
@@ -839,6 +1210,29 @@ namespace Baikal
             num_estimates / (((float)std::chrono::duration_cast<std::chrono::milliseconds>(delta).count()
                 / num_passes)
                 / 1000.f);
+
+        // Compact secondary hits
+        FilterPathStream(1, num_estimates);
+
+        m_render_data->pp.Compact(
+            0,
+            m_render_data->hits,
+            m_render_data->iota,
+            m_render_data->compacted_indices,
+            (std::uint32_t)num_estimates,
+            m_render_data->hitcount);
+
+        RestorePixelIndices(1, num_estimates);
+
+        // Shade secondary hits in ray order
+        stats.secondary_shading_throughput = measure_shading(1);
+
+        // Shade secondary hits sorted by material
+        UpdateMaterialSortState();
+        SortHitsByMaterial(scene, 1, num_estimates, true);
+        RestorePixelIndices(1, num_estimates);
+
+        stats.sorted_secondary_shading_throughput = measure_shading(1);
     }
 
     bool PathTracingEstimator::SupportsIntermediateValue(IntermediateValue value) const
@@ -870,7 +1264,7 @@ namespace Baikal
         misskernel.SetArg(argc++, output);
 
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, misskernel);
+            Launch1D("AdvanceIterationCount", ((size + 63) / 64) * 64, 64, misskernel);
         }
     }
 }
@@ -39,6 +39,21 @@ namespace Baikal
     class PathTracingEstimator : public Estimator, protected ClwClass
     {
     public:
+        /**
+        \brief Controls sorting of hits by material before shading.
+
+        Sorting groups hits with the same UberV2 layer combination and material inputs
+        together, which improves SIMD coherence of shading kernels on incoherent bounces.
+        In adaptive mode sorting is enabled per bounce when measured material divergence
+        exceeds a threshold.
+        */
+        enum class MaterialSortMode
+        {
+            kDisabled,
+            kEnabled,
+            kAdaptive
+        };
+
         PathTracingEstimator(
             CLWContext context,
             std::shared_ptr<RadeonRays::IntersectionApi> api,
@@ -68,6 +83,15 @@ namespace Baikal
         */
         void SetRandomSeed(std::uint32_t seed) override;
 
+        /**
+        \brief Set profiler for kernel timings and work buffer accounting.
+
+        Kernels of Estimate are attributed to the bounce they are launched for.
+
+        \param profiler Profiler, nullptr disables profiling
+        */
+        void SetProfiler(std::shared_ptr<ClwProfiler> profiler) override;
+
         /**
         \brief Get ray buffer handle.
 
@@ -124,6 +148,9 @@ namespace Baikal
         \param output Output buffer.
         \param atomic_update Tells an estimator that indices might contain duplicate elements and
         hence atomic update is required while updating output buffer.
+        \param missedPrimaryRaysHandler Shades primary rays which have missed the scene.
+        \param primaryRaysGenerator Generates camera rays for restarted paths, required for
+        path regeneration (see SetRegenerationPasses).
         */
         void Estimate(
             ClwScene const& scene,
@@ -132,7 +159,8 @@ namespace Baikal
             CLWBuffer<RadeonRays::float3> output,
             bool use_output_indices = true,
             bool atomic_update = false,
-            MissedPrimaryRaysHandler missedPrimaryRaysHandler = nullptr
+            MissedPrimaryRaysHandler missedPrimaryRaysHandler = nullptr,
+            PrimaryRaysGenerator primaryRaysGenerator = nullptr
         ) override;
 
         /**
@@ -185,9 +213,63 @@ namespace Baikal
         */
         bool SupportsIntermediateValue(IntermediateValue value) const override;
 
+        /**
+        \brief Set material sorting mode.
+
+        \param mode Sorting mode, adaptive by default.
+        */
+        void SetMaterialSortMode(MaterialSortMode mode);
+
+        /**
+        \brief Get material sorting mode.
+        */
+        MaterialSortMode GetMaterialSortMode() const;
+
+        /**
+        \brief Get last measured material divergence for a bounce.
+
+        Divergence is the fraction of neighbouring hits in unsorted shading order which
+        have different materials. Zero if nothing has been measured for the bounce yet.
+
+        \param bounce Bounce index.
+        */
+        float GetMaterialDivergence(std::uint32_t bounce) const;
+
+        /**
+        \brief Set number of passes which restart terminated paths.
+
+        By default all paths of an estimate start together and the number of active rays
+        drops every bounce. With regeneration enabled, after each of the first num_passes
+        passes ray slots of terminated paths are refilled with new camera samples for
+        the same pixels, so intersection and shading run on a nearly full buffer. Estimate
+        then runs num_passes + GetMaxBounces() passes and adds a variable number of samples
+        per pixel (sample count is accumulated per path in the w component of the output).
+
+        Regeneration is only applied if Estimate is given a primary rays generator and no
+        missed primary rays handler.
+
+        \param num_passes Number of regenerating passes, 0 (default) disables regeneration.
+        */
+        void SetRegenerationPasses(std::uint32_t num_passes);
+
+        /**
+        \brief Get number of passes which restart terminated paths.
+        */
+        std::uint32_t GetRegenerationPasses() const;
+
+        /**
+        \brief Read back the number of rays traced for live paths and reset the counter.
+
+        Blocks until queued work is finished, intended for benchmarking.
+        */
+        std::uint32_t ReadTracedRayCount();
+
     private:
         void InitPathData(std::size_t size, int volume_idx);
 
+        // Report work buffer memory to the profiler
+        void TrackWorkBuffers() const;
+
         void ShadeSurface(
             ClwScene const& scene,
             int pass,
@@ -261,11 +343,30 @@ namespace Baikal
         // Convert intersection info to compaction predicate
         void FilterPathStream(int pass, std::size_t size);
 
+        // Reorder compacted hits by material, returns true if hits were sorted
+        bool SortHitsByMaterial(ClwScene const& scene, int pass, std::size_t size, bool force_sort);
+
+        // Read back material divergence counters and update per bounce sorting decisions
+        void UpdateMaterialSortState();
+
+        // Terminate paths at max depth and restart terminated paths if restart is set
+        void RegeneratePaths(
+            ClwScene const& scene,
+            int pass,
+            std::size_t size,
+            CLWBuffer<RadeonRays::float3> output,
+            bool use_output_indices,
+            PrimaryRaysGenerator const& generator,
+            bool restart
+        );
+
         struct PathState;
         struct RenderData;
 
         std::unique_ptr<RenderData> m_render_data;
         mutable std::uint32_t m_sample_counter;
         ClwClass m_uberv2_kernels;
+        MaterialSortMode m_material_sort_mode;
+        std::uint32_t m_regeneration_passes;
     };
 }
@@ -1,6 +1,7 @@
 #ifndef BXDF_UBERV2_CL
 #define BXDF_UBERV2_CL
 
+#include <../Baikal/Kernels/CL/inputmap_evaluator.cl>
 #include <inputmaps.cl>
 
 typedef struct _UberV2ShaderData
@@ -0,0 +1,229 @@
+/**********************************************************************
+Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#ifndef INPUTMAP_EVALUATOR_CL
+#define INPUTMAP_EVALUATOR_CL
+
+// Stack machine interpreting input map bytecode produced by CLInputMapBytecodeGenerator.
+// Used instead of generated input map code while input map graphs are edited, so graph
+// changes only update input_map_values and do not require kernel recompilation.
+//
+// input_map_values layout in this mode:
+//   [0] header, args[0] is the offset of bytecode
+//   [1 .. bytecode offset) input map leafs
+//   bytecode:
+//     [0] args[0] is the number of directory entries
+//     [1 .. number of directory entries] directory sorted by input map id,
+//         op is the id, args[0] is the program offset relative to bytecode
+//     programs in postfix notation terminated by kInputMapOpReturn
+
+// Has to match CLInputMapBytecodeGenerator::kMaxStackDepth
+#define INPUTMAP_STACK_SIZE 8
+
+// Find program of input map, returns absolute offset or -1 if there is no such input map
+int InputMap_FindProgram(uint input_id, GLOBAL InputMapData const* restrict input_map_values)
+{
+    int bytecode_offset = input_map_values[0].instruction.args[0];
+    GLOBAL InputMapData const* restrict bytecode = input_map_values + bytecode_offset;
+    int num_entries = bytecode[0].instruction.args[0];
+
+    // Binary search for the first entry with id not less than input_id
+    int first = 1;
+    int last = num_entries + 1;
+
+    while (first < last)
+    {
+        int middle = (first + last) >> 1;
+
+        if ((uint)bytecode[middle].instruction.op < input_id)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    if (first > num_entries || (uint)bytecode[first].instruction.op != input_id)
+    {
+        return -1;
+    }
+
+    return bytecode_offset + bytecode[first].instruction.args[0];
+}
+
+// Pick components of a (and b) by indices packed into bytes of mask
+float4 InputMap_Shuffle(float4 a, float4 b, int mask, int index_mask)
+{
+    float values[8];
+    vstore4(a, 0, values);
+    vstore4(b, 1, values);
+
+    return (float4)(
+        values[mask & index_mask],
+        values[(mask >> 8) & index_mask],
+        values[(mask >> 16) & index_mask],
+        values[(mask >> 24) & index_mask]);
+}
+
+float4 InputMap_Evaluate(uint input_id, DifferentialGeometry const* dg, GLOBAL InputMapData const* restrict input_map_values, TEXTURE_ARG_LIST)
+{
+    int pc = InputMap_FindProgram(input_id, input_map_values);
+
+    if (pc < 0)
+    {
+        return 0.f;
+    }
+
+    GLOBAL InputMapData const* restrict leafs = input_map_values + 1;
+
+    float4 stack[INPUTMAP_STACK_SIZE];
+    int top = -1;
+
+    while (true)
+    {
+        InputMapInstruction instruction = input_map_values[pc++].instruction;
+        int arg = instruction.args[0];
+
+        switch (instruction.op)
+        {
+            // Leafs
+            case kInputMapOpConstantFloat3:
+            case kInputMapOpConstantFloat:
+                stack[++top] = (float4)(leafs[arg].float_value.value, 0.f);
+                break;
+            case kInputMapOpSampler:
+                stack[++top] = Texture_Sample2DFiltered(dg->uv, dg->uv_footprint, TEXTURE_ARGS_IDX(leafs[arg].int_values.idx));
+                break;
+            case kInputMapOpSamplerBumpmap:
+                stack[++top] = (float4)(Texture_SampleBumpFiltered(dg->uv, dg->uv_footprint, TEXTURE_ARGS_IDX(leafs[arg].int_values.idx)), 1.f);
+                break;
+            // Two inputs, a is below b on the stack
+            case kInputMapOpAdd:
+                --top; stack[top] = stack[top] + stack[top + 1];
+                break;
+            case kInputMapOpSub:
+                --top; stack[top] = stack[top] - stack[top + 1];
+                break;
+            case kInputMapOpMul:
+                --top; stack[top] = stack[top] * stack[top + 1];
+                break;
+            case kInputMapOpDiv:
+                --top; stack[top] = stack[top] / stack[top + 1];
+                break;
+            case kInputMapOpMin:
+                --top; stack[top] = min(stack[top], stack[top + 1]);
+                break;
+            case kInputMapOpMax:
+                --top; stack[top] = max(stack[top], stack[top + 1]);
+                break;
+            case kInputMapOpDot3:
+                --top; stack[top] = (float4)(dot(stack[top].xyz, stack[top + 1].xyz), 0.f, 0.f, 0.f);
+                break;
+            case kInputMapOpDot4:
+                --top; stack[top] = (float4)(dot(stack[top], stack[top + 1]), 0.f, 0.f, 0.f);
+                break;
+            case kInputMapOpCross3:
+                --top; stack[top] = (float4)(cross(stack[top].xyz, stack[top + 1].xyz), 0.f);
+                break;
+            case kInputMapOpCross4:
+                --top; stack[top] = cross(stack[top], stack[top + 1]);
+                break;
+            case kInputMapOpPow:
+                --top; stack[top] = pow(stack[top], (float4)(stack[top + 1].x));
+                break;
+            case kInputMapOpMod:
+                --top; stack[top] = fmod(stack[top], stack[top + 1]);
+                break;
+            // Single input
+            case kInputMapOpSin:
+                stack[top] = sin(stack[top]);
+                break;
+            case kInputMapOpCos:
+                stack[top] = cos(stack[top]);
+                break;
+            case kInputMapOpTan:
+                stack[top] = tan(stack[top]);
+                break;
+            case kInputMapOpAsin:
+                stack[top] = asin(stack[top]);
+                break;
+            case kInputMapOpAcos:
+                stack[top] = acos(stack[top]);
+                break;
+            case kInputMapOpAtan:
+                stack[top] = atan(stack[top]);
+                break;
+            case kInputMapOpLength3:
+                stack[top] = (float4)(length(stack[top].xyz), 0.f, 0.f, 0.f);
+                break;
+            case kInputMapOpNormalize3:
+                stack[top] = (float4)(normalize(stack[top].xyz), 0.f);
+                break;
+            case kInputMapOpFloor:
+                stack[top] = floor(stack[top]);
+                break;
+            case kInputMapOpAbs:
+                stack[top] = fabs(stack[top]);
+                break;
+            // Specials
+            case kInputMapOpLerp:
+                // a, b, control
+                top -= 2; stack[top] = mix(stack[top], stack[top + 1], stack[top + 2]);
+                break;
+            case kInputMapOpSelect:
+                stack[top] = (float4)(InputMap_Shuffle(stack[top], (float4)(0.f), arg, 3).x);
+                break;
+            case kInputMapOpShuffle:
+                stack[top] = InputMap_Shuffle(stack[top], (float4)(0.f), arg, 3);
+                break;
+            case kInputMapOpShuffle2:
+                --top; stack[top] = InputMap_Shuffle(stack[top], stack[top + 1], arg, 7);
+                break;
+            case kInputMapOpMatMul:
+            {
+                // Matrix rows follow the instruction
+                float4 v = stack[top];
+                stack[top] = (float4)(
+                    dot(input_map_values[pc].matrix_row.value, v),
+                    dot(input_map_values[pc + 1].matrix_row.value, v),
+                    dot(input_map_values[pc + 2].matrix_row.value, v),
+                    dot(input_map_values[pc + 3].matrix_row.value, v));
+                pc += 4;
+                break;
+            }
+            case kInputMapOpRemap:
+            {
+                // Destination range, source range, value
+                top -= 2;
+                float4 dest = stack[top];
+                float4 src = stack[top + 1];
+                stack[top] = mix((float4)(dest.x), (float4)(dest.y), (stack[top + 2] - src.x) / (src.y - src.x));
+                break;
+            }
+            default:
+                return top >= 0 ? stack[top] : 0.f;
+        }
+    }
+}
+
+#endif // INPUTMAP_EVALUATOR_CL
@@ -135,7 +135,7 @@ KERNEL void GenerateLightVertices(
         float2 sample1 = Sampler_Sample2D(&sampler, SAMPLER_ARGS);
 
         float selection_pdf;
-        int idx = Scene_SampleLight(&scene, Sampler_Sample1D(&sampler, SAMPLER_ARGS), &selection_pdf);
+        int idx = Scene_SampleLightByPower(&scene, Sampler_Sample1D(&sampler, SAMPLER_ARGS), &selection_pdf);
 
         float3 p, n, wo;
         float light_pdf;
@@ -173,7 +173,7 @@ KERNEL void GenerateLightVertices(
         my_path->throughput = ke * fabs(dot(n, my_ray->d.xyz)) / selection_pdf * light_pdf;
         my_path->volume = -1;
         my_path->flags = 0;
-        my_path->active = 0xFF;
+        my_path->start_pass = 0;
     }
 }
 
@@ -488,7 +488,7 @@ KERNEL void SampleSurface(
 #endif
 
             float selection_pdf;
-            int light_idx = Scene_SampleLight(&scene, Sampler_Sample1D(&sampler, SAMPLER_ARGS), &selection_pdf);
+            int light_idx = Scene_SampleLight(&scene, diffgeo.p, Sampler_Sample1D(&sampler, SAMPLER_ARGS), &selection_pdf);
 
             // Sample light
             float lightpdf = 0.f;
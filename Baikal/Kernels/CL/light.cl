@@ -115,6 +115,26 @@ float3 EnvironmentLight_GetLe(// Light
     return light->multiplier * Texture_SampleEnvMap(normalize(*wo), TEXTURE_ARGS_IDX(tex), light->ibl_mirror_x);
 }
 
+/// Get environment map sampling distribution (stored right after light distribution),
+/// returns 0 if environment should be sampled uniformly
+INLINE GLOBAL int const* EnvironmentLight_GetDistribution(Scene const* scene)
+{
+    GLOBAL int const* distribution = scene->light_distribution + Distribution1D_GetSize(scene->light_distribution);
+    return distribution[0] > 0 ? distribution : 0;
+}
+
+/// Map direction to lat-long environment map coordinates (v goes from theta = 0 to theta = PI)
+INLINE float2 EnvironmentLight_DirectionToUV(Light const* light, float3 d, float* sin_theta)
+{
+    float r, phi, theta;
+    CartesianToSpherical(d, &r, &phi, &theta);
+
+    *sin_theta = native_sin(theta);
+
+    float u = phi / (2.f * PI);
+    return make_float2(light->ibl_mirror_x ? 1.f - u : u, theta / PI);
+}
+
 /// Sample direction to the light
 float3 EnvironmentLight_Sample(// Light
                                Light const* light,
@@ -138,7 +158,24 @@ float3 EnvironmentLight_Sample(// Light
 {
     float3 d;
 
-    if (interaction_type != kLightInteractionVolume)
+    GLOBAL int const* distribution = EnvironmentLight_GetDistribution(scene);
+
+    if (distribution)
+    {
+        // Sample environment map proportionally to its luminance
+        float uv_pdf;
+        float2 uv = Distribution2D_Sample(sample, distribution, &uv_pdf);
+
+        float theta = uv.y * PI;
+        float phi = 2.f * PI * (light->ibl_mirror_x ? 1.f - uv.x : uv.x);
+        float sin_theta = native_sin(theta);
+
+        d = make_float3(sin_theta * native_sin(phi), native_cos(theta), sin_theta * native_cos(phi));
+
+        // Convert from (u, v) to solid angle measure
+        *pdf = sin_theta > 0.f ? uv_pdf / (2.f * PI * PI * sin_theta) : 0.f;
+    }
+    else if (interaction_type != kLightInteractionVolume)
     {
         d = Sample_MapToHemisphere(sample, dg->n, 0.f);
         *pdf = 1.f / (2.f * PI);
@@ -182,7 +219,15 @@ float EnvironmentLight_GetPdf(
                               TEXTURE_ARG_LIST
                               )
 {
-    if (interaction_type != kLightInteractionVolume)
+    GLOBAL int const* distribution = EnvironmentLight_GetDistribution(scene);
+
+    if (distribution)
+    {
+        float sin_theta;
+        float2 uv = EnvironmentLight_DirectionToUV(light, normalize(wo), &sin_theta);
+        return sin_theta > 0.f ? Distribution2D_GetPdf(uv, distribution) / (2.f * PI * PI * sin_theta) : 0.f;
+    }
+    else if (interaction_type != kLightInteractionVolume)
     {
         return 1.f / (2.f * PI);
     }
@@ -389,6 +434,97 @@ float3 AreaLight_SampleVertex(
     return ke;
 }
 
+/*
+ Emissive mesh
+ */
+/// Sample triangle of emissive mesh proportionally to its area,
+/// sample is remapped back into [0, 1) to be reused for the point on the triangle
+INLINE int EmissiveMeshLight_SamplePrimitive(// Emissive object
+                                             Light const* light,
+                                             // Scene
+                                             Scene const* scene,
+                                             // Sample
+                                             float* sample,
+                                             // Probability of the triangle
+                                             float* pdf)
+{
+    GLOBAL int const* distribution = scene->light_distribution + light->prim_distribution;
+    GLOBAL float const* cdf = (GLOBAL float const*)&distribution[1];
+
+    int primidx = Distribution1D_SampleDiscrete(*sample, distribution, pdf);
+
+    float width = cdf[primidx + 1] - cdf[primidx];
+    *sample = width > 0.f ? clamp((*sample - cdf[primidx]) / width, 0.f, 1.f) : 0.f;
+
+    return primidx;
+}
+
+/// Probability of sampling given triangle of emissive mesh
+INLINE float EmissiveMeshLight_GetPrimitivePdf(// Emissive object
+                                               Light const* light,
+                                               // Scene
+                                               Scene const* scene,
+                                               // Triangle
+                                               int primidx)
+{
+    return Distribution1D_GetPdfDiscreet(primidx, scene->light_distribution + light->prim_distribution);
+}
+
+/// Sample direction to the light
+float3 EmissiveMeshLight_Sample(// Emissive object
+                                Light const* light,
+                                // Scene
+                                Scene const* scene,
+                                // Geometry
+                                DifferentialGeometry const* dg,
+                                // Textures
+                                TEXTURE_ARG_LIST,
+                                // Sample
+                                float2 sample,
+                                // Direction to light source
+                                float3* wo,
+                                // PDF
+                                float* pdf)
+{
+    float prim_pdf;
+    float s = sample.x;
+    Light prim_light = *light;
+    prim_light.primidx = EmissiveMeshLight_SamplePrimitive(light, scene, &s, &prim_pdf);
+    sample.x = s;
+
+    float3 ke = AreaLight_Sample(&prim_light, scene, dg, TEXTURE_ARGS, sample, wo, pdf);
+    *pdf *= prim_pdf;
+    return ke;
+}
+
+float3 EmissiveMeshLight_SampleVertex(
+    // Emissive object
+    Light const* light,
+    // Scene
+    Scene const* scene,
+    // Textures
+    TEXTURE_ARG_LIST,
+    // Sample
+    float2 sample0,
+    float2 sample1,
+    // Direction to light source
+    float3* p,
+    float3* n,
+    float3* wo,
+    // PDF
+    float* pdf)
+{
+    float prim_pdf;
+    float s = sample0.x;
+    Light prim_light = *light;
+    prim_light.primidx = EmissiveMeshLight_SamplePrimitive(light, scene, &s, &prim_pdf);
+    sample0.x = s;
+
+    float3 ke = AreaLight_SampleVertex(&prim_light, scene, TEXTURE_ARGS, sample0, sample1, p, n, wo, pdf);
+    *pdf *= prim_pdf;
+    return ke;
+}
+
 /*
 Directional light
 */
@@ -662,6 +798,8 @@ float3 Light_Sample(// Light index
             return EnvironmentLight_Sample(&light, scene, dg, TEXTURE_ARGS, sample, bxdf_flags, interaction_type, wo, pdf);
         case kArea:
             return AreaLight_Sample(&light, scene, dg, TEXTURE_ARGS, sample, wo, pdf);
+        case kEmissiveMesh:
+            return EmissiveMeshLight_Sample(&light, scene, dg, TEXTURE_ARGS, sample, wo, pdf);
         case kDirectional:
             return DirectionalLight_Sample(&light, scene, dg, TEXTURE_ARGS, sample, wo, pdf);
         case kPoint:
@@ -736,6 +874,8 @@ float3 Light_SampleVertex(
     {
         case kArea:
             return AreaLight_SampleVertex(&light, scene, TEXTURE_ARGS, sample0, sample1, p, n, wo, pdf);
+        case kEmissiveMesh:
+            return EmissiveMeshLight_SampleVertex(&light, scene, TEXTURE_ARGS, sample0, sample1, p, n, wo, pdf);
         case kPoint:
             return PointLight_SampleVertex(&light, scene, TEXTURE_ARGS, sample0, sample1, p, n, wo, pdf);
     }
@@ -744,6 +884,21 @@ float3 Light_SampleVertex(
     return make_float3(0.f, 0.f, 0.f);
 }
 
+/// Probability of selecting emissive primitive once the light has been chosen
+float Light_GetPrimitivePdf(// Light index
+                            int idx,
+                            // Scene
+                            Scene const* scene,
+                            // Primitive index
+                            int primidx)
+{
+    Light light = scene->lights[idx];
+
+    // Emissive mesh lights are only hit through their geometry,
+    // so direction based Light_GetLe/Light_GetPdf do not handle them
+    return light.type == kEmissiveMesh ? EmissiveMeshLight_GetPrimitivePdf(&light, scene, primidx) : 1.f;
+}
+
 /// Check if the light is singular
 bool Light_IsSingular(__global Light const* light)
 {
@@ -0,0 +1,251 @@
+/**********************************************************************
+Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#ifndef LIGHT_TREE_CL
+#define LIGHT_TREE_CL
+
+#include <../Baikal/Kernels/CL/common.cl>
+#include <../Baikal/Kernels/CL/utils.cl>
+
+/// Light BVH sampling.
+/// Should match Baikal/Utils/light_tree.cpp.
+///
+/// Layout of the tree data (ints):
+///     num_nodes, num_infinite, num_lights, num_shapes, nodes_offset
+///     num_infinite indices of infinite lights
+///     num_lights bit trails (-1 for lights not in the tree, -2 for infinite lights)
+///     num_shapes offsets of primitive -> light tables (-1 for non emissive shapes)
+///     primitive -> light tables
+///     num_nodes nodes of LIGHT_TREE_NODE_SIZE ints at nodes_offset
+
+#define LIGHT_TREE_NODE_SIZE 16
+#define LIGHT_TREE_INVALID_TRAIL -1
+#define LIGHT_TREE_INFINITE_TRAIL -2
+#define LIGHT_TREE_ONE_MINUS_EPSILON 0.99999994f
+
+/// cos(max(0, a - b)) given sines and cosines of a and b
+INLINE float LightTree_CosSubClamped(float sin_a, float cos_a, float sin_b, float cos_b)
+{
+    return cos_a > cos_b ? 1.f : cos_a * cos_b + sin_a * sin_b;
+}
+
+/// sin(max(0, a - b)) given sines and cosines of a and b
+INLINE float LightTree_SinSubClamped(float sin_a, float cos_a, float sin_b, float cos_b)
+{
+    return cos_a > cos_b ? 0.f : sin_a * cos_b - cos_a * sin_b;
+}
+
+/// Importance of the lights below the node as seen from point p
+INLINE float LightTree_GetImportance(GLOBAL int const* node, float3 p)
+{
+    GLOBAL float const* values = (GLOBAL float const*)node;
+
+    float3 pmin = make_float3(values[0], values[1], values[2]);
+    float3 pmax = make_float3(values[3], values[4], values[5]);
+    float3 axis = make_float3(values[6], values[7], values[8]);
+    float cos_theta_o = values[9];
+    float cos_theta_e = values[10];
+    float power = values[11];
+    bool two_sided = (node[13] & 2) != 0;
+
+    if (power <= 0.f)
+    {
+        return 0.f;
+    }
+
+    float3 d = p - 0.5f * (pmin + pmax);
+    float len2 = dot(d, d);
+    float radius2 = 0.25f * dot(pmax - pmin, pmax - pmin);
+
+    // Avoid singularity when the point is close to the lights
+    float dist2 = max(max(len2, sqrt(radius2)), 1e-6f);
+    float3 wi = len2 > 0.f ? d / sqrt(len2) : make_float3(0.f, 0.f, 1.f);
+
+    // Angle between cone axis and direction to the point
+    float cos_theta_w = dot(axis, wi);
+    if (two_sided)
+    {
+        cos_theta_w = fabs(cos_theta_w);
+    }
+    float sin_theta_w = sqrt(max(1.f - cos_theta_w * cos_theta_w, 0.f));
+
+    // Angle subtended by the bounds as seen from the point
+    float cos_theta_b = len2 > radius2 ? sqrt(max(1.f - radius2 / len2, 0.f)) : -1.f;
+    float sin_theta_b = sqrt(max(1.f - cos_theta_b * cos_theta_b, 0.f));
+
+    // Minimal angle between emitter normals and direction to any point of the bounds
+    float sin_theta_o = sqrt(max(1.f - cos_theta_o * cos_theta_o, 0.f));
+    float cos_theta_x = LightTree_CosSubClamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o);
+    float sin_theta_x = LightTree_SinSubClamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o);
+    float cos_theta_p = LightTree_CosSubClamped(sin_theta_x, cos_theta_x, sin_theta_b, cos_theta_b);
+
+    if (cos_theta_p <= cos_theta_e)
+    {
+        return 0.f;
+    }
+
+    return power * cos_theta_p / dist2;
+}
+
+INLINE GLOBAL int const* LightTree_GetNode(GLOBAL int const* tree, int idx)
+{
+    return tree + tree[4] + idx * LIGHT_TREE_NODE_SIZE;
+}
+
+/// Probability of sampling infinite lights as a group
+INLINE float LightTree_GetInfiniteProbability(GLOBAL int const* tree)
+{
+    int num_nodes = tree[0];
+    int num_infinite = tree[1];
+    return num_infinite > 0 ? (float)num_infinite / (num_infinite + (num_nodes > 0 ? 1 : 0)) : 0.f;
+}
+
+/// Sample light index given point p, returns -1 if nothing can be sampled
+INLINE int LightTree_Sample(GLOBAL int const* tree, float3 p, float u, float* pdf)
+{
+    int num_nodes = tree[0];
+    int num_infinite = tree[1];
+
+    *pdf = 0.f;
+
+    // Infinite lights are selected uniformly
+    float infinite_pdf = LightTree_GetInfiniteProbability(tree);
+
+    if (u < infinite_pdf)
+    {
+        int idx = min((int)(u / infinite_pdf * num_infinite), num_infinite - 1);
+        *pdf = infinite_pdf / num_infinite;
+        return tree[5 + idx];
+    }
+
+    if (num_nodes == 0 || LightTree_GetImportance(LightTree_GetNode(tree, 0), p) <= 0.f)
+    {
+        return -1;
+    }
+
+    u = min((u - infinite_pdf) / (1.f - infinite_pdf), LIGHT_TREE_ONE_MINUS_EPSILON);
+
+    int node = 0;
+    float node_pdf = 1.f - infinite_pdf;
+
+    GLOBAL int const* data = LightTree_GetNode(tree, node);
+
+    while ((data[13] & 1) == 0)
+    {
+        int second = data[12];
+        float i0 = LightTree_GetImportance(LightTree_GetNode(tree, node + 1), p);
+        float i1 = LightTree_GetImportance(LightTree_GetNode(tree, second), p);
+
+        if (i0 + i1 <= 0.f)
+        {
+            return -1;
+        }
+
+        float p0 = i0 / (i0 + i1);
+
+        if (u < p0)
+        {
+            u = min(u / p0, LIGHT_TREE_ONE_MINUS_EPSILON);
+            node_pdf *= p0;
+            node = node + 1;
+        }
+        else
+        {
+            u = min((u - p0) / (1.f - p0), LIGHT_TREE_ONE_MINUS_EPSILON);
+            node_pdf *= 1.f - p0;
+            node = second;
+        }
+
+        data = LightTree_GetNode(tree, node);
+    }
+
+    *pdf = node_pdf;
+    return data[12];
+}
+
+/// Probability of selecting a light given point p
+INLINE float LightTree_GetPdf(GLOBAL int const* tree, int light, float3 p)
+{
+    int num_infinite = tree[1];
+    int bit_trail = tree[5 + num_infinite + light];
+
+    if (bit_trail == LIGHT_TREE_INFINITE_TRAIL)
+    {
+        return LightTree_GetInfiniteProbability(tree) / num_infinite;
+    }
+
+    if (bit_trail == LIGHT_TREE_INVALID_TRAIL || LightTree_GetImportance(LightTree_GetNode(tree, 0), p) <= 0.f)
+    {
+        return 0.f;
+    }
+
+    uint trail = as_uint(bit_trail);
+    int node = 0;
+    float pdf = 1.f - LightTree_GetInfiniteProbability(tree);
+
+    GLOBAL int const* data = LightTree_GetNode(tree, node);
+
+    while ((data[13] & 1) == 0)
+    {
+        int second = data[12];
+        float i0 = LightTree_GetImportance(LightTree_GetNode(tree, node + 1), p);
+        float i1 = LightTree_GetImportance(LightTree_GetNode(tree, second), p);
+
+        if (i0 + i1 <= 0.f)
+        {
+            return 0.f;
+        }
+
+        if (trail & 1u)
+        {
+            pdf *= i1 / (i0 + i1);
+            node = second;
+        }
+        else
+        {
+            pdf *= i0 / (i0 + i1);
+            node = node + 1;
+        }
+
+        trail >>= 1;
+        data = LightTree_GetNode(tree, node);
+    }
+
+    return pdf;
+}
+
+/// Find area or emissive mesh light index given emissive primitive, returns -1 if there is none
+INLINE int LightTree_GetAreaLight(GLOBAL int const* tree, int shape_idx, int prim_idx)
+{
+    int num_infinite = tree[1];
+    int num_lights = tree[2];
+    int num_shapes = tree[3];
+
+    if (shape_idx < 0 || shape_idx >= num_shapes)
+    {
+        return -1;
+    }
+
+    int offset = tree[5 + num_infinite + num_lights + shape_idx];
+    return offset < 0 ? -1 : tree[offset + prim_idx];
+}
+
+#endif // LIGHT_TREE_CL
@@ -118,7 +118,8 @@ void PerspectiveCamera_GeneratePaths(
         // Set ray max
         my_ray->extra.x = 0xFFFFFFFF;
         my_ray->extra.y = 0xFFFFFFFF;
-        Ray_SetExtra(my_ray, 1.f);
+        // Pass ray spread angle of a pixel to estimate texture footprint
+        Ray_SetExtra(my_ray, make_float2(1.f, camera->dim.y / (output_height * camera->focal_length)));
         Ray_SetMask(my_ray, VISIBILITY_MASK_PRIMARY);
     }
 }
@@ -214,7 +215,8 @@ KERNEL void PerspectiveCameraDof_GeneratePaths(
         // Set ray max
         my_ray->extra.x = 0xFFFFFFFF;
         my_ray->extra.y = 0xFFFFFFFF;
-        Ray_SetExtra(my_ray, 1.f);
+        // Pass ray spread angle of a pixel to estimate texture footprint
+        Ray_SetExtra(my_ray, make_float2(1.f, camera->dim.y / (output_height * camera->focal_length)));
         Ray_SetMask(my_ray, VISIBILITY_MASK_PRIMARY);
     }
 }
@@ -521,6 +523,8 @@ KERNEL void GenerateTileDomain(
     }
 }
 
+///< Generate pixel indices for a tile sampled from tile distribution,
+///< converged pixels (zero error) are skipped
 KERNEL void GenerateTileDomain_Adaptive(
     int output_width,
     int output_height,
@@ -533,7 +537,10 @@ KERNEL void GenerateTileDomain_Adaptive(
     GLOBAL uint* restrict random,
     GLOBAL uint const* restrict sobol_mat,
     GLOBAL int const* restrict tile_distribution,
+    // Per pixel error estimates (see EstimatePixelError)
+    GLOBAL float const* restrict pixel_error,
     GLOBAL int* restrict indices,
+    // Number of generated indices, has to be cleared
     GLOBAL int* restrict count
 )
 {
@@ -545,62 +552,77 @@ KERNEL void GenerateTileDomain_Adaptive(
     local_id.x = get_local_id(0);
     local_id.y = get_local_id(1);
 
-    int2 group_id;
-    group_id.x = get_group_id(0);
-    group_id.y = get_group_id(1);
-
     int2 tile_size;
     tile_size.x = get_local_size(0);
     tile_size.y = get_local_size(1);
 
+    int lid = local_id.y * tile_size.x + local_id.x;
 
-    // Initialize sampler  
-    Sampler sampler;
-    int x = global_id.x;
-    int y = global_id.y;
-#if SAMPLER == SOBOL
-    uint scramble = random[x + output_width * y] * 0x1fe3434f;
+    __local int tile;
+    __local int num_group_indices;
+    __local int group_offset;
 
-    if (frame & 0xF)
+    // Whole group handles a single tile
+    if (lid == 0)
     {
-        random[x + output_width * y] = WangHash(scramble);
-    }
+        // Initialize sampler
+        Sampler sampler;
+        int x = global_id.x;
+        int y = global_id.y;
+#if SAMPLER == SOBOL
+        uint scramble = random[x + output_width * y] * 0x1fe3434f;
+
+        if (frame & 0xF)
+        {
+            random[x + output_width * y] = WangHash(scramble);
+        }
 
-    Sampler_Init(&sampler, frame, SAMPLE_DIM_IMG_PLANE_EVALUATE_OFFSET, scramble);
+        Sampler_Init(&sampler, frame, SAMPLE_DIM_IMG_PLANE_EVALUATE_OFFSET, scramble);
 #elif SAMPLER == RANDOM
-    uint scramble = x + output_width * y * rng_seed;
-    Sampler_Init(&sampler, scramble);
+        uint scramble = x + output_width * y * rng_seed;
+        Sampler_Init(&sampler, scramble);
 #elif SAMPLER == CMJ
-    uint rnd = random[group_id.x + output_width *group_id.y];
-    uint scramble = rnd * 0x1fe3434f * ((frame + 133 * rnd) / (CMJ_DIM * CMJ_DIM));
-    Sampler_Init(&sampler, frame % (CMJ_DIM * CMJ_DIM), SAMPLE_DIM_IMG_PLANE_EVALUATE_OFFSET, scramble);
+        uint rnd = random[x + output_width * y];
+        uint scramble = rnd * 0x1fe3434f * ((frame + 133 * rnd) / (CMJ_DIM * CMJ_DIM));
+        Sampler_Init(&sampler, frame % (CMJ_DIM * CMJ_DIM), SAMPLE_DIM_IMG_PLANE_EVALUATE_OFFSET, scramble);
 #endif
 
-    float2 sample = Sampler_Sample2D(&sampler, SAMPLER_ARGS);
+        float2 sample = Sampler_Sample2D(&sampler, SAMPLER_ARGS);
 
-    float pdf;
-    int tile = Distribution1D_SampleDiscrete(sample.x, tile_distribution, &pdf);
+        float pdf;
+        tile = Distribution1D_SampleDiscrete(sample.x, tile_distribution, &pdf);
+        num_group_indices = 0;
+    }
 
-    int num_tiles_x = output_width / tile_size.x;
-    int num_tiles_y = output_height / tile_size.y;
+    barrier(CLK_LOCAL_MEM_FENCE);
 
-    int tile_y = clamp(tile / num_tiles_x , 0, num_tiles_y - 1);
-    int tile_x = clamp(tile % num_tiles_x, 0, num_tiles_x - 1);
+    // Same tiling as in EstimatePixelError
+    int num_tiles_x = (output_width + tile_size.x - 1) / tile_size.x;
 
-    int start_idx = output_width * offset_y + offset_x;
+    int x = (tile % num_tiles_x) * tile_size.x + local_id.x;
+    int y = (tile / num_tiles_x) * tile_size.y + local_id.y;
 
-    if (global_id.x < width && global_id.y < height)
-    {
-        int idx = start_idx +
-            (tile_y * tile_size.y + local_id.y) * output_width +
-            (tile_x * tile_size.x + local_id.x);
+    int idx = output_width * (offset_y + y) + offset_x + x;
 
-        indices[global_id.y * width + global_id.x] = idx;
+    bool active = global_id.x < width && global_id.y < height &&
+        offset_x + x < output_width && offset_y + y < output_height &&
+        pixel_error[idx] > 0.f;
+
+    // Compact active pixels within the group, then reserve space for the group
+    int local_idx = active ? atomic_inc(&num_group_indices) : 0;
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (lid == 0)
+    {
+        group_offset = num_group_indices > 0 ? atomic_add(count, num_group_indices) : 0;
     }
 
-    if (global_id.x == 0 && global_id.y == 0)
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (active)
     {
-        *count = width * height;
+        indices[group_offset + local_idx] = idx;
     }
 }
 
@@ -649,21 +671,55 @@ KERNEL void ApplyGammaAndCopyData(
     }
 } 
 
+// Resolve accumulated data and pack it for readback
+// (format: 1 - linear half4, 2 - gamma corrected RGBA8)
+KERNEL void ConvertOutputData(
+    GLOBAL float4 const* restrict data,
+    int num_elements,
+    int format,
+    float gamma,
+    GLOBAL uchar* restrict dst
+)
+{
+    int global_id = get_global_id(0);
+
+    if (global_id < num_elements)
+    {
+        float4 v = data[global_id];
+        float4 val = v.w > 0.f ? v / v.w : make_float4(0.f, 0.f, 0.f, 0.f);
+
+        if (format == 1)
+        {
+            vstore_half4(val, global_id, (GLOBAL half*)dst);
+        }
+        else
+        {
+            val = clamp(native_powr(max(val, 0.f), 1.f / gamma), 0.f, 1.f);
+            ((GLOBAL uchar4*)dst)[global_id] = convert_uchar4_sat_rte(val * 255.f);
+        }
+    }
+}
+
 KERNEL void AccumulateSingleSample(
     GLOBAL float4 const* restrict src_sample_data,
     GLOBAL float4* restrict dst_accumulation_data,
     GLOBAL int* restrict scatter_indices,
-    int num_elements
+    GLOBAL int const* restrict num_elements,
+    // Accumulated squared sample luminance
+    GLOBAL float* restrict dst_moments
 )
 {
     int global_id = get_global_id(0);
 
-    if (global_id < num_elements)
+    if (global_id < *num_elements)
     {
         int idx = scatter_indices[global_id];
         float4 sample = src_sample_data[global_id];
         dst_accumulation_data[idx].xyz += sample.xyz;
         dst_accumulation_data[idx].w += 1.f;
+
+        float l = luminance(sample.xyz);
+        dst_moments[idx] += l * l;
     }
 }
 
@@ -705,14 +761,25 @@ INLINE void group_reduce_max(__local float* lds, int size, int lid)
 }
 
 
-KERNEL void EstimateVariance(
+///< Estimate relative error of each pixel and sum errors of pixels per tile.
+///< Converged pixels get zero error.
+KERNEL void EstimatePixelError(
     GLOBAL float4 const* restrict image_buffer,
-    GLOBAL float* restrict variance_buffer,
+    GLOBAL float const* restrict moments,
     int width,
-    int height
+    int height,
+    // Target relative error
+    float target_error,
+    // Min number of samples before pixel is considered converged
+    int min_samples,
+    GLOBAL float* restrict pixel_error,
+    GLOBAL float* restrict tile_error,
+    // Number of pixels which have not converged, has to be cleared
+    GLOBAL int* restrict num_active_pixels
 )
 {
     __local float lds[256];
+    __local int num_group_pixels;
 
     int x = get_global_id(0);
     int y = get_global_id(1);
@@ -721,53 +788,132 @@ KERNEL void EstimateVariance(
     int gx = get_group_id(0);
     int gy = get_group_id(1);
     int wx = get_local_size(0);
-    int wy = get_local_size(1);
     int num_tiles = (width + wx - 1) / wx;
     int lid = ly * wx + lx;
 
-    float value = 0.f;
+    if (lid == 0)
+    {
+        num_group_pixels = 0;
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    float error = 0.f;
     if (x < width && y < height)
     {
-        float4 rw = image_buffer[y * width + x]; rw /= rw.w;
-        value = 4*luminance(clamp(rw.xyz, 0.f, 1.f));
-        rw = y + 1 < height ? image_buffer[(y + 1) * width + x] : image_buffer[y * width + x]; rw /= rw.w;
-        value -= luminance(clamp(rw.xyz, 0.f, 1.f));
-        rw = y - 1 >= 0 ? image_buffer[(y - 1) * width + x] : image_buffer[y * width + x]; rw /= rw.w;
-        value -= luminance(clamp(rw.xyz, 0.f, 1.f));
-        rw = x + 1 < width ? image_buffer[y * width + x + 1] : image_buffer[y * width + x]; rw /= rw.w;
-        value -= luminance(clamp(rw.xyz, 0.f, 1.f));
-        rw = x - 1 >= 0 ? image_buffer[y * width + x - 1] : image_buffer[y * width + x]; rw /= rw.w;
-        value -= luminance(clamp(rw.xyz, 0.f, 1.f));
-        //rw = y + 1 < height && x + 1 < width ? image_buffer[(y + 1) * width + x + 1] : image_buffer[y * width + x]; rw /= rw.w;
-        //value -= luminance(clamp(rw.xyz, 0.f, 1.f));
-        //rw = y - 1 >= 0 && x - 1 >= 0 ? image_buffer[(y - 1) * width + x - 1] : image_buffer[y * width + x]; rw /= rw.w;
-        //value -= luminance(clamp(rw.xyz, 0.f, 1.f));
-        //rw = y + 1 < height && x - 1 >= 0 ? image_buffer[(y + 1) * width + x - 1] : image_buffer[y * width + x]; rw /= rw.w;
-        //value -= luminance(clamp(rw.xyz, 0.f, 1.f));
-        //rw = y - 1 >= 0 && x + 1 < width ? image_buffer[(y - 1) * width + x + 1] : image_buffer[y * width + x]; rw /= rw.w;
-        //value -= luminance(clamp(rw.xyz, 0.f, 1.f));
+        int idx = y * width + x;
+        float4 v = image_buffer[idx];
+        float n = max(v.w, 1.f);
+
+        // Standard error of the mean relative to the mean, dark pixels are
+        // measured against a floor to keep them from dominating
+        float mean = luminance(v.xyz) / n;
+        float variance = max(moments[idx] / n - mean * mean, 0.f);
+        error = native_sqrt(variance / n) / max(mean, 1e-2f);
+
+        bool converged = v.w >= min_samples && error <= target_error;
+
+        if (converged)
+        {
+            error = 0.f;
+        }
+        else
+        {
+            // Keep unconverged pixels active even if they have no variance yet
+            error = max(error, FLT_MIN);
+            atomic_inc(&num_group_pixels);
+        }
+
+        pixel_error[idx] = error;
     }
 
-    value = fabs(value);
-    lds[lid] = value;
+    lds[lid] = error;
     barrier(CLK_LOCAL_MEM_FENCE);
 
     group_reduce_add(lds, 256, lid);
 
-    float mean = lds[0] / (wx * wy);
-    barrier(CLK_LOCAL_MEM_FENCE);
+    if (lid == 0)
+    {
+        tile_error[gy * num_tiles + gx] = lds[0];
+
+        if (num_group_pixels > 0)
+        {
+            atomic_add(num_active_pixels, num_group_pixels);
+        }
+    }
+}
+
+///< Build 1D distribution (see Distribution1D_SampleDiscrete for the layout)
+///< from per tile function values, has to be launched as a single group of 256
+KERNEL void BuildTileDistribution(
+    GLOBAL float const* restrict values,
+    int num_segments,
+    GLOBAL int* restrict distribution
+)
+{
+    __local float lds[256];
+    __local float carry;
+
+    int lid = get_local_id(0);
+
+    GLOBAL float* cdf = (GLOBAL float*)&distribution[1];
+    GLOBAL float* pdf = cdf + num_segments + 1;
+
+    if (lid == 0)
+    {
+        distribution[0] = num_segments;
+        cdf[0] = 0.f;
+        carry = 0.f;
+    }
 
-    /*lds[lid] = (mean - value) * (mean - value);
     barrier(CLK_LOCAL_MEM_FENCE);
 
-    group_reduce_add(lds, 256, lid);*/
+    // Inclusive scan of values in chunks of group size
+    for (int base = 0; base < num_segments; base += 256)
+    {
+        int i = base + lid;
+        lds[lid] = i < num_segments ? values[i] / num_segments : 0.f;
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        for (int offset = 1; offset < 256; offset <<= 1)
+        {
+            float v = lid >= offset ? lds[lid - offset] : 0.f;
+            barrier(CLK_LOCAL_MEM_FENCE);
+            lds[lid] += v;
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
 
-    if (x < width && y < height)
+        if (i < num_segments)
+        {
+            cdf[i + 1] = carry + lds[lid];
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        if (lid == 0)
+        {
+            carry += lds[255];
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    barrier(CLK_GLOBAL_MEM_FENCE);
+
+    // Normalize, fall back to uniform distribution if everything is zero
+    float sum = carry;
+
+    for (int i = lid; i < num_segments; i += 256)
     {
-        if (lx == 0 && ly == 0)
+        if (sum > 0.f)
         {
-            //float dev = lds[0] / (wx * wy - 1);
-            variance_buffer[gy * num_tiles + gx] = mean;
+            cdf[i + 1] /= sum;
+            pdf[i] = values[i] / sum;
+        }
+        else
+        {
+            cdf[i + 1] = (float)(i + 1) / num_segments;
+            pdf[i] = 1.f;
         }
     }
 }
@@ -854,7 +1000,7 @@ void  OrthographicCamera_GeneratePaths(
         // Set ray max
         my_ray->extra.x = 0xFFFFFFFF;
         my_ray->extra.y = 0xFFFFFFFF;
-        Ray_SetExtra(my_ray, 1.f);
+        Ray_SetExtra(my_ray, make_float2(1.f, 0.f));
         Ray_SetMask(my_ray, VISIBILITY_MASK_PRIMARY);
     }
 }
@@ -32,7 +32,7 @@ void DifferentialGeometry_ApplyNormalMap(DifferentialGeometry* diffgeo, TEXTURE_
     if (nmapidx != -1)
     {
         // Now n, dpdu, dpdv is orthonormal basis
-        float3 mappednormal = 2.f * Texture_Sample2D(diffgeo->uv, TEXTURE_ARGS_IDX(nmapidx)).xyz - make_float3(1.f, 1.f, 1.f);
+        float3 mappednormal = 2.f * Texture_Sample2DFiltered(diffgeo->uv, diffgeo->uv_footprint, TEXTURE_ARGS_IDX(nmapidx)).xyz - make_float3(1.f, 1.f, 1.f);
 
         // Return mapped version
         diffgeo->n = normalize(mappednormal.z *  diffgeo->n + mappednormal.x * diffgeo->dpdu + mappednormal.y * diffgeo->dpdv);
@@ -47,7 +47,7 @@ void DifferentialGeometry_ApplyBumpMap(DifferentialGeometry* diffgeo, TEXTURE_AR
     if (nmapidx != -1)
     {
         // Now n, dpdu, dpdv is orthonormal basis
-        float3 mappednormal = 2.f * Texture_SampleBump(diffgeo->uv, TEXTURE_ARGS_IDX(nmapidx)) - make_float3(1.f, 1.f, 1.f);
+        float3 mappednormal = 2.f * Texture_SampleBumpFiltered(diffgeo->uv, diffgeo->uv_footprint, TEXTURE_ARGS_IDX(nmapidx)) - make_float3(1.f, 1.f, 1.f);
 
         // Return mapped version
         diffgeo->n = normalize(mappednormal.z * diffgeo->n + mappednormal.x * diffgeo->dpdu + mappednormal.y * diffgeo->dpdv);
@@ -31,7 +31,8 @@ typedef struct _Path
     float3 throughput;
     int volume;
     int flags;
-    int active;
+    // Pass the path has been started at (see RegeneratePaths)
+    int start_pass;
     int extra1;
 } Path;
 
@@ -82,6 +83,11 @@ INLINE void Path_Restart(__global Path* path)
     path->flags = 0;
 }
 
+INLINE int Path_GetStartPass(__global Path const* path)
+{
+    return path->start_pass;
+}
+
 INLINE int Path_GetVolumeIdx(__global Path const* path)
 {
     return path->volume;
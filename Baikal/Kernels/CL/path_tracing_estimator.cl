@@ -56,7 +56,9 @@ void InitPathData(
         my_path->throughput = make_float3(1.f, 1.f, 1.f);
         my_path->volume = world_volume_idx;
         my_path->flags = 0;
-        my_path->active = 0xFF;
+        my_path->start_pass = 0;
+        // Ray cone width (see ShadeSurfaceUberV2)
+        my_path->extra1 = as_int(0.f);
     }
 }
 
@@ -228,10 +230,22 @@ KERNEL void FilterPathStream(
     // Paths
     GLOBAL Path* restrict paths,
     // Predicate
-    GLOBAL int* restrict predicate
+    GLOBAL int* restrict predicate,
+    // Number of rays traced for live paths
+    GLOBAL int* restrict ray_counter
 )
 {
     int global_id = get_global_id(0);
+    int local_id = get_local_id(0);
+
+    __local int num_live_rays;
+
+    if (local_id == 0)
+    {
+        num_live_rays = 0;
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
 
     // Handle only working subset
     if (global_id < *num_elements)
@@ -242,6 +256,8 @@ KERNEL void FilterPathStream(
 
         if (Path_IsAlive(path))
         {
+            atomic_inc(&num_live_rays);
+
             bool kill = (length(Path_GetThroughput(path)) < CRAZY_LOW_THROUGHPUT);
 
             if (!kill)
@@ -259,6 +275,93 @@ KERNEL void FilterPathStream(
             predicate[global_id] = 0;
         }
     }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (local_id == 0 && num_live_rays > 0)
+    {
+        atomic_add(ray_counter, num_live_rays);
+    }
+}
+
+// Material sort key: layer combination in high bits to group identical shading code,
+// material offset in low bits to group identical inputs and textures
+INLINE int GetMaterialSortKey(
+    GLOBAL Intersection const* restrict isects,
+    GLOBAL int const* restrict hit_indices,
+    GLOBAL Shape const* restrict shapes,
+    int idx
+)
+{
+    int shape_idx = isects[hit_indices[idx]].shapeid - 1;
+    Material material = shapes[shape_idx].material;
+    return ((material.layers & 0xff) << 23) | (material.offset & 0x7fffff);
+}
+
+///< Generate material sort keys for compacted hits and count material changes between neighbours
+KERNEL void GenerateMaterialSortKeys(
+    // Intersections
+    GLOBAL Intersection const* restrict isects,
+    // Compacted hit indices
+    GLOBAL int const* restrict hit_indices,
+    // Number of compacted indices
+    GLOBAL int const* restrict num_elements,
+    // Shapes
+    GLOBAL Shape const* restrict shapes,
+    // Number of items to generate keys for
+    int num_items,
+    // Current bounce
+    int bounce,
+    // Sort keys
+    GLOBAL int* restrict keys,
+    // Per bounce counters: number of hits, number of material changes
+    GLOBAL int* restrict counters
+)
+{
+    int global_id = get_global_id(0);
+    int local_id = get_local_id(0);
+
+    __local int num_changes;
+
+    if (local_id == 0)
+    {
+        num_changes = 0;
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (global_id < num_items)
+    {
+        int num_hits = *num_elements;
+
+        if (global_id < num_hits)
+        {
+            int key = GetMaterialSortKey(isects, hit_indices, shapes, global_id);
+            keys[global_id] = key;
+
+            if (global_id > 0 && key != GetMaterialSortKey(isects, hit_indices, shapes, global_id - 1))
+            {
+                atomic_inc(&num_changes);
+            }
+        }
+        else
+        {
+            // Move inactive items to the end
+            keys[global_id] = INT_MAX;
+        }
+
+        if (global_id == 0)
+        {
+            counters[2 * bounce] = num_hits;
+        }
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (local_id == 0 && num_changes > 0)
+    {
+        atomic_add(&counters[2 * bounce + 1], num_changes);
+    }
 }
 
 ///< Illuminate missing rays
@@ -279,6 +382,8 @@ KERNEL void ShadeMiss(
     // Number of emissive objects
     int num_lights,
     int env_light_idx,
+    // Current bounce
+    int bounce,
     // Textures
     TEXTURE_ARG_LIST,
     GLOBAL Path const* restrict paths,
@@ -301,10 +406,29 @@ KERNEL void ShadeMiss(
         {
             Light light = lights[env_light_idx];
 
+            // Camera rays of regenerated paths see the background (see ShadeBackgroundEnvMap)
+            if (bounce == Path_GetStartPass(path))
+            {
+                float4 v = 0.f;
+
+                int tex = EnvironmentLight_GetBackgroundTexture(&light);
+                if (tex != -1)
+                {
+                    v.xyz = light.multiplier * Texture_SampleEnvMap(rays[global_id].d.xyz, TEXTURE_ARGS_IDX(tex), light.ibl_mirror_x);
+                }
+
+                ADD_FLOAT4(&output[output_index], v);
+                return;
+            }
+
+            // Only light distribution is needed to evaluate environment light PDFs
+            Scene scene;
+            scene.light_distribution = light_distribution;
+
             // Apply MIS
             int bxdf_flags = Path_GetBxdfFlags(path);
-            float selection_pdf = Distribution1D_GetPdfDiscreet(env_light_idx, light_distribution);
-            float light_pdf = EnvironmentLight_GetPdf(&light, 0, 0, bxdf_flags, kLightInteractionSurface, rays[global_id].d.xyz, TEXTURE_ARGS);
+            float selection_pdf = Scene_GetLightPdf(&scene, env_light_idx, rays[global_id].o.xyz);
+            float light_pdf = EnvironmentLight_GetPdf(&light, &scene, 0, bxdf_flags, kLightInteractionSurface, rays[global_id].d.xyz, TEXTURE_ARGS);
             float2 extra = Ray_GetExtra(&rays[global_id]);
             float weight = extra.x > 0.f ? BalanceHeuristic(1, extra.x, 1, light_pdf * selection_pdf) : 1.f;
 
@@ -323,6 +447,135 @@ KERNEL void ShadeMiss(
     }
 }
 
+///< Find ray slots and paths which can be reused to start new paths
+KERNEL void FindRegenerationSlots(
+    // Pixel indices
+    GLOBAL int const* restrict pixel_indices,
+    // Number of rays
+    GLOBAL int const* restrict num_rays,
+    // Number of ray slots and paths
+    int num_estimates,
+    // Pass the rays are traced at
+    int pass,
+    // Max number of bounces
+    int max_bounces,
+    // Paths
+    GLOBAL Path* restrict paths,
+    // Predicate for ray slots which do not carry a live path
+    GLOBAL int* restrict free_rays,
+    // Predicate for paths which are not alive, has to be initialized to 1
+    GLOBAL int* restrict free_paths
+)
+{
+    int global_id = get_global_id(0);
+
+    if (global_id < num_estimates)
+    {
+        int is_free = 1;
+
+        if (global_id < *num_rays)
+        {
+            int pixel_idx = pixel_indices[global_id];
+
+            GLOBAL Path* path = paths + pixel_idx;
+
+            // Paths started later than the first pass are not limited by the loop,
+            // so terminate them once they reach max depth
+            if (pass - Path_GetStartPass(path) >= max_bounces)
+            {
+                Path_Kill(path);
+            }
+
+            if (Path_IsAlive(path))
+            {
+                free_paths[pixel_idx] = 0;
+                is_free = 0;
+            }
+        }
+
+        free_rays[global_id] = is_free;
+    }
+}
+
+///< Gather output indices of free paths to generate camera rays for them
+KERNEL void GatherRegenerationOutputIndices(
+    // Compacted free paths
+    GLOBAL int const* restrict free_paths,
+    // Number of free paths
+    GLOBAL int const* restrict num_free_paths,
+    // Output indices
+    GLOBAL int const* restrict output_indices,
+    // Output indices of free paths
+    GLOBAL int* restrict regeneration_output_indices
+)
+{
+    int global_id = get_global_id(0);
+
+    if (global_id < *num_free_paths)
+    {
+        regeneration_output_indices[global_id] = output_indices[free_paths[global_id]];
+    }
+}
+
+///< Start new paths in free ray slots, each new path adds a sample to its output
+KERNEL void RegeneratePaths(
+    // Compacted free ray slots
+    GLOBAL int const* restrict free_rays,
+    // Compacted free paths
+    GLOBAL int const* restrict free_paths,
+    // Number of free ray slots and paths (they are always equal)
+    GLOBAL int const* restrict num_free_paths,
+    // Camera rays for free paths
+    GLOBAL ray const* restrict camera_rays,
+    // Output indices
+    GLOBAL int const* restrict output_indices,
+    // Number of ray slots and paths
+    int num_estimates,
+    // Pass new rays are traced at
+    int pass,
+    int world_volume_idx,
+    // Rays
+    GLOBAL ray* restrict rays,
+    // Pixel indices
+    GLOBAL int* restrict pixel_indices,
+    // Number of rays
+    GLOBAL int* restrict num_rays,
+    // Paths
+    GLOBAL Path* restrict paths,
+    // Output values
+    GLOBAL float4* restrict output
+)
+{
+    int global_id = get_global_id(0);
+
+    // All slots are occupied after regeneration
+    if (global_id == 0)
+    {
+        *num_rays = num_estimates;
+    }
+
+    if (global_id < *num_free_paths)
+    {
+        int ray_idx = free_rays[global_id];
+        int pixel_idx = free_paths[global_id];
+
+        rays[ray_idx] = camera_rays[global_id];
+        pixel_indices[ray_idx] = pixel_idx;
+
+        GLOBAL Path* my_path = paths + pixel_idx;
+
+        my_path->throughput = make_float3(1.f, 1.f, 1.f);
+        my_path->volume = world_volume_idx;
+        my_path->flags = 0;
+        my_path->start_pass = pass;
+        my_path->extra1 = as_int(0.f);
+
+        // Each path is a new sample
+        float4 v = make_float4(0.f, 0.f, 0.f, 1.f);
+        ADD_FLOAT4(&output[output_indices[pixel_idx]], v);
+    }
+}
+
 ///< Advance iteration count. Used on missed rays
 KERNEL void AdvanceIterationCount(
     // Pixel indices
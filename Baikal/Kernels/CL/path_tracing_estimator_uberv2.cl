@@ -130,6 +130,10 @@ KERNEL void ShadeVolumeUberV2(
             return;
         }
 
+        // Regenerated paths use their own bounce and sample index
+        bounce -= Path_GetStartPass(path);
+        frame += Path_GetStartPass(path);
+
         // Fetch incoming ray
         float3 o = rays[hit_idx].o.xyz;
         float3 wi = -rays[hit_idx].d.xyz;
@@ -157,16 +161,20 @@ KERNEL void ShadeVolumeUberV2(
         float selection_pdf = 0.f;
         float3 wo;
 
-        int light_idx = Scene_SampleLight(&scene, Sampler_Sample1D(&sampler, SAMPLER_ARGS), &selection_pdf);
-
         // Here we need fake differential geometry for light sampling procedure
         DifferentialGeometry dg;
         // put scattering position in there (it is along the current ray at isect.distance
         // since EvaluateVolume has put it there
         dg.p = o - wi * Intersection_GetDistance(isects + hit_idx);
+
+        int light_idx = Scene_SampleLight(&scene, dg.p, Sampler_Sample1D(&sampler, SAMPLER_ARGS), &selection_pdf);
         // Get light sample intencity
         int bxdf_flags = Path_GetBxdfFlags(path); 
-        float3 le = Light_Sample(light_idx, &scene, &dg, TEXTURE_ARGS, Sampler_Sample2D(&sampler, SAMPLER_ARGS), bxdf_flags, kLightInteractionVolume, &wo, &pdf);
+        float3 le = 0.f;
+        if (light_idx > -1)
+        {
+            le = Light_Sample(light_idx, &scene, &dg, TEXTURE_ARGS, Sampler_Sample2D(&sampler, SAMPLER_ARGS), bxdf_flags, kLightInteractionVolume, &wo, &pdf);
+        }
 
         // Generate shadow ray
         float shadow_ray_length = length(wo); 
@@ -318,6 +326,10 @@ KERNEL void ShadeSurfaceUberV2(
             return;
         }
 
+        // Regenerated paths use their own bounce and sample index
+        bounce -= Path_GetStartPass(path);
+        frame += Path_GetStartPass(path);
+
         // Fetch incoming ray direction
         float3 wi = -normalize(rays[hit_idx].d.xyz);
 
@@ -338,6 +350,12 @@ KERNEL void ShadeSurfaceUberV2(
         DifferentialGeometry diffgeo;
         Scene_FillDifferentialGeometry(&scene, &isect, &diffgeo);
 
+        // Propagate ray cone (width is kept in the path, spread angle in the ray)
+        // to estimate texture footprint for mip level selection
+        float cone_spread = Ray_GetExtra(&rays[hit_idx]).y;
+        float cone_width = as_float(path->extra1) + cone_spread * isect.uvwt.w;
+        diffgeo.uv_footprint = diffgeo.uv_scale * cone_width;
+
         // Check if we are hitting from the inside
         float ngdotwi = dot(diffgeo.ng, wi);
         bool backfacing = ngdotwi < 0.f;
@@ -366,8 +384,11 @@ KERNEL void ShadeSurfaceUberV2(
                     float2 extra = Ray_GetExtra(&rays[hit_idx]);
                     float ld = isect.uvwt.w;
                     float denom = fabs(dot(diffgeo.n, wi)) * diffgeo.area;
-                    // TODO: num_lights should be num_emissies instead, presence of analytical lights breaks this code
-                    float bxdf_light_pdf = denom > 0.f ? (ld * ld / denom / num_lights) : 0.f;
+                    // Probability of selecting this primitive from the previous vertex
+                    int light_idx = LightTree_GetAreaLight(Scene_GetLightTree(&scene), isect.shapeid - 1, isect.primid);
+                    float selection_pdf = light_idx >= 0 ? Scene_GetLightPdf(&scene, light_idx, rays[hit_idx].o.xyz) *
+                        Light_GetPrimitivePdf(light_idx, &scene, isect.primid) : 0.f;
+                    float bxdf_light_pdf = denom > 0.f ? (ld * ld / denom * selection_pdf) : 0.f;
                     weight = extra.x > 0.f ? BalanceHeuristic(1, extra.x, 1, bxdf_light_pdf) : 1.f;
                 }
 
@@ -414,7 +435,7 @@ KERNEL void ShadeSurfaceUberV2(
         float bxdf_weight = 1.f;
         float light_weight = 1.f;
 
-        int light_idx = Scene_SampleLight(&scene, Sampler_Sample1D(&sampler, SAMPLER_ARGS), &selection_pdf);
+        int light_idx = Scene_SampleLight(&scene, diffgeo.p, Sampler_Sample1D(&sampler, SAMPLER_ARGS), &selection_pdf);
 
         float3 throughput = Path_GetThroughput(path);
 
@@ -490,7 +511,8 @@ KERNEL void ShadeSurfaceUberV2(
             int indirect_ray_mask = VISIBILITY_MASK_BOUNCE(bounce + 1);
 
             Ray_Init(indirect_rays + global_id, indirect_ray_o, indirect_ray_dir, CRAZY_HIGH_DISTANCE, 0.f, indirect_ray_mask);
-            Ray_SetExtra(indirect_rays + global_id, make_float2(Bxdf_IsSingular(&diffgeo) ? 0.f : bxdf_pdf, 0.f));
+            Ray_SetExtra(indirect_rays + global_id, make_float2(Bxdf_IsSingular(&diffgeo) ? 0.f : bxdf_pdf, cone_spread));
+            path->extra1 = as_int(cone_width);
 
             if (Bxdf_IsBtdf(&diffgeo))
             {
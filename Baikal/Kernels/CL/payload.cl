@@ -104,6 +104,53 @@ typedef enum
     kInt = 2
 } InputMapDataType;
 
+// Input map bytecode operations (see inputmap_evaluator.cl),
+// values match InputMap::InputMapType of the corresponding nodes
+typedef enum
+{
+    kInputMapOpConstantFloat3 = 0,
+    kInputMapOpConstantFloat,
+    kInputMapOpSampler,
+    kInputMapOpAdd,
+    kInputMapOpSub,
+    kInputMapOpMul,
+    kInputMapOpDiv,
+    kInputMapOpSin,
+    kInputMapOpCos,
+    kInputMapOpTan,
+    kInputMapOpSelect,
+    kInputMapOpDot3,
+    kInputMapOpCross3,
+    kInputMapOpLength3,
+    kInputMapOpNormalize3,
+    kInputMapOpPow,
+    kInputMapOpAcos,
+    kInputMapOpAsin,
+    kInputMapOpAtan,
+    kInputMapOpLerp,
+    kInputMapOpMin,
+    kInputMapOpMax,
+    kInputMapOpFloor,
+    kInputMapOpMod,
+    kInputMapOpAbs,
+    kInputMapOpShuffle,
+    kInputMapOpShuffle2,
+    kInputMapOpDot4,
+    kInputMapOpCross4,
+    kInputMapOpMatMul,
+    kInputMapOpRemap,
+    kInputMapOpSamplerBumpmap,
+    // Ends the program, result is on top of the stack
+    kInputMapOpReturn
+} InputMapOp;
+
+// Single instruction of input map bytecode
+typedef struct
+{
+    int op;
+    int args[3];
+} InputMapInstruction;
+
 // Input data for input maps
 typedef struct _InputMapData
 {
@@ -119,6 +166,12 @@ typedef struct _InputMapData
             int placeholder[2];
             int type; //We can use it since float3 is actually float4
         } int_values;
+        InputMapInstruction instruction;
+        // Matrix rows following kInputMapOpMatMul instruction
+        struct
+        {
+            float4 value;
+        } matrix_row;
     };
 } InputMapData;
 
@@ -134,20 +187,22 @@ enum LightType
     kDirectional,
     kSpot,
     kArea,
-    kIbl
+    kIbl,
+    kEmissiveMesh
 };
 
 typedef struct
 {
     union
     {
-        // Area light
+        // Area light & emissive mesh
         struct
         {
             int id;
             int shapeidx;
             int primidx;
-            int padding0;
+            // Offset of triangle area distribution in light distributions buffer
+            int prim_distribution;
         };
 
         // IBL
@@ -209,7 +264,19 @@ enum TextureFormat
     UNKNOWN,
     RGBA8,
     RGBA16,
-    RGBA32
+    RGBA32,
+    // Block compressed formats
+    BC1,
+    BC4,
+    BC5,
+    BC6H,
+    BC7,
+    // Single and dual channel formats
+    R8,
+    R16,
+    R32,
+    RG8,
+    RG16
 };
 
 /// Texture description
@@ -221,10 +288,15 @@ struct _Texture
     int h;
     int d;
     // Offset in texture data array
+    // (offset of the page table for tiled textures)
     int dataoffset;
     // Format
     int fmt;
-    int extra;
+    // Number of mip levels for tiled textures, 0 for linear ones
+    int num_mips;
+    // Index of the first page of tiled texture in the pool
+    int first_page;
+    int padding;
 } Texture;
 
 // Hit data
@@ -249,7 +321,10 @@ typedef struct _DifferentialGeometry
     Material mat;
     float  area;
     int transfer_mode;
-    int padding[2];
+    // UV units per world unit around the hit point
+    float uv_scale;
+    // Ray footprint in UV space, used for texture LOD selection
+    float uv_footprint;
 } DifferentialGeometry;
 
 
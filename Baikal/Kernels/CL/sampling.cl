@@ -433,6 +433,61 @@ float Distribution1D_GetPdfDiscreet(int d, GLOBAL int const* data)
     return pdf_data[d] / num_segments;
 }
 
+/// Size of serialized 1D distribution in ints
+int Distribution1D_GetSize(GLOBAL int const* data)
+{
+    return 2 + 2 * data[0];
+}
+
+/// Size of serialized 2D distribution in ints
+int Distribution2D_GetSize(GLOBAL int const* data)
+{
+    int num_u = data[0];
+    int num_v = data[1];
+    return num_u > 0 ? 2 + Distribution1D_GetSize(data + 2) + num_v * (2 + 2 * num_u) : 2;
+}
+
+/// Sample 2D distribution (marginal over v followed by conditional over u)
+float2 Distribution2D_Sample(float2 s, GLOBAL int const* data, float* pdf)
+{
+    int num_u = data[0];
+    int num_v = data[1];
+
+    GLOBAL int const* marginal = data + 2;
+
+    float pdf_v;
+    float v = Distribution1D_Sample(s.y, marginal, &pdf_v);
+    int row = clamp((int)(v * num_v), 0, num_v - 1);
+
+    GLOBAL int const* conditional = marginal + Distribution1D_GetSize(marginal) + row * (2 + 2 * num_u);
+
+    float pdf_u;
+    float u = Distribution1D_Sample(s.x, conditional, &pdf_u);
+
+    *pdf = pdf_u * pdf_v;
+
+    return make_float2(u, v);
+}
+
+/// PDF of 2D distribution
+float Distribution2D_GetPdf(float2 uv, GLOBAL int const* data)
+{
+    int num_u = data[0];
+    int num_v = data[1];
+
+    // Function is constant within a cell, so find it directly
+    int column = clamp((int)(uv.x * num_u), 0, num_u - 1);
+    int row = clamp((int)(uv.y * num_v), 0, num_v - 1);
+
+    GLOBAL int const* marginal = data + 2;
+    GLOBAL int const* conditional = marginal + Distribution1D_GetSize(marginal) + row * (2 + 2 * num_u);
+
+    GLOBAL float const* marginal_pdf = (GLOBAL float const*)&marginal[1] + num_v + 1;
+    GLOBAL float const* conditional_pdf = (GLOBAL float const*)&conditional[1] + num_u + 1;
+
+    return marginal_pdf[row] * conditional_pdf[column];
+}
+
 
 
 #endif // SAMPLING_CL
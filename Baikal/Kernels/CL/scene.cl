@@ -25,6 +25,8 @@ THE SOFTWARE.
 #include <../Baikal/Kernels/CL/common.cl>
 #include <../Baikal/Kernels/CL/utils.cl>
 #include <../Baikal/Kernels/CL/payload.cl>
+#include <../Baikal/Kernels/CL/sampling.cl>
+#include <../Baikal/Kernels/CL/light_tree.cl>
 
 typedef struct
 {
@@ -48,7 +50,8 @@ typedef struct
     int env_light_idx;
     // Number of emissive objects
     int num_lights;
-    // Light distribution 
+    // Light distributions: power based distribution over lights,
+    // environment map distribution and light tree
     GLOBAL int const* restrict light_distribution;
 } Scene;
 
@@ -257,6 +260,10 @@ void Scene_FillDifferentialGeometry(// Scene
     float3 dp2 = v1 - v2;
     float det = du1 * dv2 - dv1 * du2;
 
+    // UV units per world unit (used to convert ray footprint into texture LOD)
+    diffgeo->uv_scale = area > 0.f ? native_sqrt(0.5f * fabs(det) / area) : 0.f;
+    diffgeo->uv_footprint = 0.f;
+
     if (0 && det != 0.f)
     {
         float invdet = 1.f / det;
@@ -294,21 +301,29 @@ INLINE void DifferentialGeometry_CalculateTangentTransforms(DifferentialGeometry
     diffgeo->tangent_to_world.m2.w = diffgeo->p.z;
 }
 
-#define POWER_SAMPLING
+/// Get light tree data (stored after power and environment map distributions)
+INLINE GLOBAL int const* Scene_GetLightTree(Scene const* scene)
+{
+    GLOBAL int const* env_distribution = scene->light_distribution + Distribution1D_GetSize(scene->light_distribution);
+    return env_distribution + Distribution2D_GetSize(env_distribution);
+}
 
-// Sample light index
-INLINE int Scene_SampleLight(Scene const* scene, float sample, float* pdf)
+// Sample light index using light tree given shading point
+INLINE int Scene_SampleLight(Scene const* scene, float3 p, float sample, float* pdf)
 {
-#ifndef POWER_SAMPLING
-    int num_lights = scene->num_lights;
-    int light_idx = clamp((int)(sample * num_lights), 0, num_lights - 1);
-    *pdf = 1.f / num_lights;
-    return light_idx;
-#else
-    int num_lights = scene->num_lights;
-    int light_idx = Distribution1D_SampleDiscrete(sample, scene->light_distribution, pdf);
-    return light_idx;
-#endif
+    return LightTree_Sample(Scene_GetLightTree(scene), p, sample, pdf);
+}
+
+// Probability of sampling the light from shading point
+INLINE float Scene_GetLightPdf(Scene const* scene, int light_idx, float3 p)
+{
+    return LightTree_GetPdf(Scene_GetLightTree(scene), light_idx, p);
+}
+
+// Sample light index proportionally to its power
+INLINE int Scene_SampleLightByPower(Scene const* scene, float sample, float* pdf)
+{
+    return Distribution1D_SampleDiscrete(sample, scene->light_distribution, pdf);
 }
 
 #endif
@@ -25,17 +25,156 @@ THE SOFTWARE.
 
 #include <../Baikal/Kernels/CL/payload.cl>
 #include <../Baikal/Kernels/CL/utils.cl>
+#include <../Baikal/Kernels/CL/texture_bc.cl>
 
 
 /// To simplify a bit
-#define TEXTURE_ARG_LIST __global Texture const* textures, __global char const* texturedata
-#define TEXTURE_ARG_LIST_IDX(x) int x, __global Texture const* textures, __global char const* texturedata
-#define TEXTURE_ARGS textures, texturedata
-#define TEXTURE_ARGS_IDX(x) x, textures, texturedata
+#define TEXTURE_ARG_LIST __global Texture const* textures, __global char const* texturedata, __global int* texture_feedback
+#define TEXTURE_ARG_LIST_IDX(x) int x, __global Texture const* textures, __global char const* texturedata, __global int* texture_feedback
+#define TEXTURE_ARGS textures, texturedata, texture_feedback
+#define TEXTURE_ARGS_IDX(x) x, textures, texturedata, texture_feedback
 
-/// Sample 2D texture
+/// Size of the tile side in texels for tiled textures
+#define TEXTURE_TILE_SIZE 64
+
+/// Load single texel and convert it to float
 inline
-float4 Texture_Sample2D(float2 uv, TEXTURE_ARG_LIST_IDX(texidx))
+float4 Texture_LoadTexel(__global char const* data, int idx, int fmt)
+{
+    switch (fmt)
+    {
+        case RGBA32:
+        {
+            return *((__global float4 const*)data + idx);
+        }
+
+        case RGBA16:
+        {
+            return vload_half4(idx, (__global half const*)data);
+        }
+
+        case RGBA8:
+        {
+            uchar4 v = *((__global uchar4 const*)data + idx);
+            return make_float4((float)v.x / 255.f, (float)v.y / 255.f, (float)v.z / 255.f, (float)v.w / 255.f);
+        }
+
+        // Single channel is replicated to RGB
+        case R32:
+        {
+            float v = *((__global float const*)data + idx);
+            return make_float4(v, v, v, 1.f);
+        }
+
+        case R16:
+        {
+            float v = vload_half(idx, (__global half const*)data);
+            return make_float4(v, v, v, 1.f);
+        }
+
+        case R8:
+        {
+            float v = (float)(*((__global uchar const*)data + idx)) / 255.f;
+            return make_float4(v, v, v, 1.f);
+        }
+
+        case RG16:
+        {
+            float2 v = vload_half2(idx, (__global half const*)data);
+            return make_float4(v.x, v.y, 0.f, 1.f);
+        }
+
+        case RG8:
+        {
+            uchar2 v = *((__global uchar2 const*)data + idx);
+            return make_float4((float)v.x / 255.f, (float)v.y / 255.f, 0.f, 1.f);
+        }
+
+        default:
+        {
+            return make_float4(0.f, 0.f, 0.f, 0.f);
+        }
+    }
+}
+
+/// Fetch single texel of a tiled texture mip level.
+/// If the tile is not resident it is requested via feedback buffer and false is returned.
+inline
+bool Texture_FetchTiled(int x, int y, int level, float4* value, TEXTURE_ARG_LIST_IDX(texidx))
+{
+    __global Texture const* texture = textures + texidx;
+
+    // Page table starts with the indices of the first page of each level
+    __global int const* page_table = (__global int const*)(texturedata + texture->dataoffset);
+
+    int width = max(texture->w >> level, 1);
+    int num_tiles_x = (width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+    int page = page_table[level] + (y / TEXTURE_TILE_SIZE) * num_tiles_x + x / TEXTURE_TILE_SIZE;
+    int tile_offset = page_table[texture->num_mips + page];
+
+    if (tile_offset < 0)
+    {
+        texture_feedback[texture->first_page + page] = 1;
+        return false;
+    }
+
+    int texel = (y % TEXTURE_TILE_SIZE) * TEXTURE_TILE_SIZE + x % TEXTURE_TILE_SIZE;
+    *value = Texture_LoadTexel(texturedata + tile_offset, texel, texture->fmt);
+    return true;
+}
+
+/// Select mip level of a tiled texture given UV footprint
+inline
+int Texture_GetMipLevel(float footprint, __global Texture const* texture)
+{
+    float lod = log2(max(footprint * max(texture->w, texture->h), 1.f));
+    return min((int)(lod + 0.5f), texture->num_mips - 1);
+}
+
+/// Bilinearly sample tiled texture (UV is expected to be wrapped and flipped).
+/// If some tiles are not resident coarser levels are used.
+inline
+float4 Texture_SampleTiled(float2 uv, float footprint, TEXTURE_ARG_LIST_IDX(texidx))
+{
+    __global Texture const* texture = textures + texidx;
+
+    for (int level = Texture_GetMipLevel(footprint, texture); level < texture->num_mips; ++level)
+    {
+        int width = max(texture->w >> level, 1);
+        int height = max(texture->h >> level, 1);
+
+        // Calculate integer coordinates
+        int x0 = clamp((int)floor(uv.x * width), 0, width - 1);
+        int y0 = clamp((int)floor(uv.y * height), 0, height - 1);
+
+        // Calculate samples for linear filtering
+        int x1 = clamp(x0 + 1, 0, width - 1);
+        int y1 = clamp(y0 + 1, 0, height - 1);
+
+        // Calculate weights for linear filtering
+        float wx = uv.x * width - floor(uv.x * width);
+        float wy = uv.y * height - floor(uv.y * height);
+
+        // Fetch all 4 values even if some are missing, so all tiles are requested at once
+        float4 val00, val01, val10, val11;
+        bool resident = Texture_FetchTiled(x0, y0, level, &val00, TEXTURE_ARGS_IDX(texidx));
+        resident = Texture_FetchTiled(x1, y0, level, &val01, TEXTURE_ARGS_IDX(texidx)) && resident;
+        resident = Texture_FetchTiled(x0, y1, level, &val10, TEXTURE_ARGS_IDX(texidx)) && resident;
+        resident = Texture_FetchTiled(x1, y1, level, &val11, TEXTURE_ARGS_IDX(texidx)) && resident;
+
+        if (resident)
+        {
+            // Filter and return the result
+            return lerp(lerp(val00, val01, wx), lerp(val10, val11, wx), wy);
+        }
+    }
+
+    return make_float4(0.f, 0.f, 0.f, 0.f);
+}
+
+/// Sample 2D texture given UV footprint of the ray
+inline
+float4 Texture_Sample2DFiltered(float2 uv, float footprint, TEXTURE_ARG_LIST_IDX(texidx))
 {
     // Get width and height
     int width = textures[texidx].w;
@@ -53,6 +192,11 @@ float4 Texture_Sample2D(float2 uv, TEXTURE_ARG_LIST_IDX(texidx))
     // and our axis goes from down to top
     uv.y = 1.f - uv.y;
 
+    if (textures[texidx].num_mips > 0)
+    {
+        return Texture_SampleTiled(uv, footprint, TEXTURE_ARGS_IDX(texidx));
+    }
+
     // Calculate integer coordinates
     int x0 = clamp((int)floor(uv.x * width), 0, width - 1);
     int y0 = clamp((int)floor(uv.y * height), 0, height - 1);
@@ -114,6 +258,42 @@ float4 Texture_Sample2D(float2 uv, TEXTURE_ARG_LIST_IDX(texidx))
             return lerp(lerp(val00, val01, wx), lerp(val10, val11, wx), wy);
         }
 
+        case BC1:
+        case BC4:
+        case BC5:
+        case BC6H:
+        case BC7:
+        {
+            int fmt = textures[texidx].fmt;
+
+            // Decode 4 values
+            float4 val00 = Texture_LoadCompressedTexel(mydata, width, x0, y0, fmt);
+            float4 val01 = Texture_LoadCompressedTexel(mydata, width, x1, y0, fmt);
+            float4 val10 = Texture_LoadCompressedTexel(mydata, width, x0, y1, fmt);
+            float4 val11 = Texture_LoadCompressedTexel(mydata, width, x1, y1, fmt);
+
+            // Filter and return the result
+            return lerp(lerp(val00, val01, wx), lerp(val10, val11, wx), wy);
+        }
+
+        case R8:
+        case R16:
+        case R32:
+        case RG8:
+        case RG16:
+        {
+            int fmt = textures[texidx].fmt;
+
+            // Get 4 values
+            float4 val00 = Texture_LoadTexel(mydata, width * y0 + x0, fmt);
+            float4 val01 = Texture_LoadTexel(mydata, width * y0 + x1, fmt);
+            float4 val10 = Texture_LoadTexel(mydata, width * y1 + x0, fmt);
+            float4 val11 = Texture_LoadTexel(mydata, width * y1 + x1, fmt);
+
+            // Filter and return the result
+            return lerp(lerp(val00, val01, wx), lerp(val10, val11, wx), wy);
+        }
+
         default:
         {
             return make_float4(0.f, 0.f, 0.f, 0.f);
@@ -121,6 +301,13 @@ float4 Texture_Sample2D(float2 uv, TEXTURE_ARG_LIST_IDX(texidx))
     }
 }
 
+/// Sample 2D texture
+inline
+float4 Texture_Sample2D(float2 uv, TEXTURE_ARG_LIST_IDX(texidx))
+{
+    return Texture_Sample2DFiltered(uv, 0.f, TEXTURE_ARGS_IDX(texidx));
+}
+
 /// Sample lattitue-longitude environment map using 3d vector
 inline
 float3 Texture_SampleEnvMap(float3 d, TEXTURE_ARG_LIST_IDX(texidx), bool mirror_x)
@@ -290,9 +477,83 @@ inline float3 TextureData_SampleNormalFromBump_float4(__global float4 const* myd
 	return n;
 }
 
-/// Sample 2D texture
+inline float3 TextureData_SampleNormalFromBump_compressed(__global char const* mydata, int fmt, int width, int height, int t0, int s0)
+{
+	int t0minus = clamp(t0 - 1, 0, height - 1);
+	int t0plus = clamp(t0 + 1, 0, height - 1);
+	int s0minus = clamp(s0 - 1, 0, width - 1);
+	int s0plus = clamp(s0 + 1, 0, width - 1);
+
+	const float tex00 = Texture_LoadCompressedTexel(mydata, width, s0minus, t0minus, fmt).x;
+	const float tex10 = Texture_LoadCompressedTexel(mydata, width, s0, t0minus, fmt).x;
+	const float tex20 = Texture_LoadCompressedTexel(mydata, width, s0plus, t0minus, fmt).x;
+
+	const float tex01 = Texture_LoadCompressedTexel(mydata, width, s0minus, t0, fmt).x;
+	const float tex21 = Texture_LoadCompressedTexel(mydata, width, s0plus, t0, fmt).x;
+
+	const float tex02 = Texture_LoadCompressedTexel(mydata, width, s0minus, t0plus, fmt).x;
+	const float tex12 = Texture_LoadCompressedTexel(mydata, width, s0, t0plus, fmt).x;
+	const float tex22 = Texture_LoadCompressedTexel(mydata, width, s0plus, t0plus, fmt).x;
+
+	const float Gx = tex00 - tex20 + 2.0f * tex01 - 2.0f * tex21 + tex02 - tex22;
+	const float Gy = tex00 + 2.0f * tex10 + tex20 - tex02 - 2.0f * tex12 - tex22;
+	const float3 n = make_float3(Gx, Gy, 1.f);
+
+	return n;
+}
+
+inline float3 TextureData_SampleNormalFromBump_texel(__global char const* mydata, int fmt, int width, int height, int t0, int s0)
+{
+	int t0minus = clamp(t0 - 1, 0, height - 1);
+	int t0plus = clamp(t0 + 1, 0, height - 1);
+	int s0minus = clamp(s0 - 1, 0, width - 1);
+	int s0plus = clamp(s0 + 1, 0, width - 1);
+
+	const float tex00 = Texture_LoadTexel(mydata, width * t0minus + s0minus, fmt).x;
+	const float tex10 = Texture_LoadTexel(mydata, width * t0minus + (s0), fmt).x;
+	const float tex20 = Texture_LoadTexel(mydata, width * t0minus + s0plus, fmt).x;
+
+	const float tex01 = Texture_LoadTexel(mydata, width * (t0)+s0minus, fmt).x;
+	const float tex21 = Texture_LoadTexel(mydata, width * (t0)+s0plus, fmt).x;
+
+	const float tex02 = Texture_LoadTexel(mydata, width * t0plus + s0minus, fmt).x;
+	const float tex12 = Texture_LoadTexel(mydata, width * t0plus + (s0), fmt).x;
+	const float tex22 = Texture_LoadTexel(mydata, width * t0plus + s0plus, fmt).x;
+
+	const float Gx = tex00 - tex20 + 2.0f * tex01 - 2.0f * tex21 + tex02 - tex22;
+	const float Gy = tex00 + 2.0f * tex10 + tex20 - tex02 - 2.0f * tex12 - tex22;
+	const float3 n = make_float3(Gx, Gy, 1.f);
+
+	return n;
+}
+
+/// Calculate normal from bump for tiled texture using central differences
+/// at the mip level matching the footprint (UV is expected to be wrapped and flipped).
+inline float3 Texture_SampleNormalFromBumpTiled(float2 uv, float footprint, TEXTURE_ARG_LIST_IDX(texidx))
+{
+    __global Texture const* texture = textures + texidx;
+
+    int level = Texture_GetMipLevel(footprint, texture);
+    float du = 1.f / max(texture->w >> level, 1);
+    float dv = 1.f / max(texture->h >> level, 1);
+    float level_footprint = (float)(1 << level) / max(texture->w, texture->h);
+
+    const float left = Texture_SampleTiled(make_float2(max(uv.x - du, 0.f), uv.y), level_footprint, TEXTURE_ARGS_IDX(texidx)).x;
+    const float right = Texture_SampleTiled(make_float2(min(uv.x + du, 1.f), uv.y), level_footprint, TEXTURE_ARGS_IDX(texidx)).x;
+    const float top = Texture_SampleTiled(make_float2(uv.x, max(uv.y - dv, 0.f)), level_footprint, TEXTURE_ARGS_IDX(texidx)).x;
+    const float bottom = Texture_SampleTiled(make_float2(uv.x, min(uv.y + dv, 1.f)), level_footprint, TEXTURE_ARGS_IDX(texidx)).x;
+
+    // Scale to match Sobel filter used for linear textures
+    const float Gx = 4.f * (left - right);
+    const float Gy = 4.f * (top - bottom);
+    const float3 n = make_float3(Gx, Gy, 1.f);
+
+    return n;
+}
+
+/// Sample 2D texture given UV footprint of the ray
 inline
-float3 Texture_SampleBump(float2 uv, TEXTURE_ARG_LIST_IDX(texidx))
+float3 Texture_SampleBumpFiltered(float2 uv, float footprint, TEXTURE_ARG_LIST_IDX(texidx))
 {
     // Get width and height
     int width = textures[texidx].w;
@@ -310,6 +571,12 @@ float3 Texture_SampleBump(float2 uv, TEXTURE_ARG_LIST_IDX(texidx))
     // and our axis goes from down to top
     uv.y = 1.f - uv.y;
 
+    if (textures[texidx].num_mips > 0)
+    {
+        float3 n = Texture_SampleNormalFromBumpTiled(uv, footprint, TEXTURE_ARGS_IDX(texidx));
+        return 0.5f * normalize(n) + make_float3(0.5f, 0.5f, 0.5f);
+    }
+
     // Calculate integer coordinates
     int s0 = clamp((int)floor(uv.x * width), 0, width - 1);
     int t0 = clamp((int)floor(uv.y * height), 0, height - 1);
@@ -365,6 +632,42 @@ float3 Texture_SampleBump(float2 uv, TEXTURE_ARG_LIST_IDX(texidx))
 		return 0.5f * normalize(n) + make_float3(0.5f, 0.5f, 0.5f);
     }
 
+    case BC1:
+    case BC4:
+    case BC5:
+    case BC6H:
+    case BC7:
+    {
+        int fmt = textures[texidx].fmt;
+
+		float3 n00 = TextureData_SampleNormalFromBump_compressed(mydata, fmt, width, height, t0, s0);
+		float3 n01 = TextureData_SampleNormalFromBump_compressed(mydata, fmt, width, height, t0, s1);
+		float3 n10 = TextureData_SampleNormalFromBump_compressed(mydata, fmt, width, height, t1, s0);
+		float3 n11 = TextureData_SampleNormalFromBump_compressed(mydata, fmt, width, height, t1, s1);
+
+		float3 n = lerp3(lerp3(n00, n01, wx), lerp3(n10, n11, wx), wy);
+
+		return 0.5f * normalize(n) + make_float3(0.5f, 0.5f, 0.5f);
+    }
+
+    case R8:
+    case R16:
+    case R32:
+    case RG8:
+    case RG16:
+    {
+        int fmt = textures[texidx].fmt;
+
+		float3 n00 = TextureData_SampleNormalFromBump_texel(mydata, fmt, width, height, t0, s0);
+		float3 n01 = TextureData_SampleNormalFromBump_texel(mydata, fmt, width, height, t0, s1);
+		float3 n10 = TextureData_SampleNormalFromBump_texel(mydata, fmt, width, height, t1, s0);
+		float3 n11 = TextureData_SampleNormalFromBump_texel(mydata, fmt, width, height, t1, s1);
+
+		float3 n = lerp3(lerp3(n00, n01, wx), lerp3(n10, n11, wx), wy);
+
+		return 0.5f * normalize(n) + make_float3(0.5f, 0.5f, 0.5f);
+    }
+
     default:
     {
         return make_float3(0.f, 0.f, 0.f);
@@ -372,6 +675,12 @@ float3 Texture_SampleBump(float2 uv, TEXTURE_ARG_LIST_IDX(texidx))
     }
 }
 
+/// Sample 2D texture
+inline
+float3 Texture_SampleBump(float2 uv, TEXTURE_ARG_LIST_IDX(texidx))
+{
+    return Texture_SampleBumpFiltered(uv, 0.f, TEXTURE_ARGS_IDX(texidx));
+}
 
 
 #endif // TEXTURE_CL
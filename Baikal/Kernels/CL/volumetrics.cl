@@ -183,6 +183,10 @@ KERNEL void SampleVolume(
         if (!Path_IsAlive(path))
             return;
 
+        // Regenerated paths use their own bounce and sample index
+        bounce -= Path_GetStartPass(path);
+        frame += Path_GetStartPass(path);
+
         int volidx = Path_GetVolumeIdx(path);
 
         // Check if we are inside some volume
@@ -3,18 +3,101 @@
 #include "output.h"
 #include "CLW.h"
 
+#include <vector>
+
 namespace Baikal
 {
     class ClwOutput : public Output
     {
     public:
+        // Format of asynchronously read back data (values match ConvertOutputData kernel)
+        enum class ReadbackFormat
+        {
+            // Accumulated float4 values as stored on the device (sample count in w)
+            kFloat4 = 0,
+            // Resolved linear values as half4
+            kHalf4 = 1,
+            // Resolved and gamma corrected values as RGBA8
+            kRgba8 = 2
+        };
+
+        // Number of staging buffers in the readback ring
+        static std::uint32_t const kNumStagingBuffers = 2;
+
+        // Pending asynchronous readback
+        class Readback
+        {
+        public:
+            Readback() = default;
+
+            // Check if data has arrived without blocking
+            bool IsReady() const
+            {
+                cl_int status = CL_QUEUED;
+                clGetEventInfo(m_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+                return status == CL_COMPLETE;
+            }
+
+            // Block until data has arrived
+            void Wait() const
+            {
+                m_event.Wait();
+            }
+
+            // Get data, waits for completion. Data stays valid until
+            // kNumStagingBuffers newer readbacks are started.
+            void const* GetData() const
+            {
+                Wait();
+                return m_data;
+            }
+
+            std::size_t GetSizeInBytes() const { return m_size; }
+
+        private:
+            friend class ClwOutput;
+
+            mutable CLWEvent m_event;
+            void const* m_data = nullptr;
+            std::size_t m_size = 0;
+        };
+
         ClwOutput(CLWContext context, std::uint32_t w, std::uint32_t h)
         : Output(w, h)
         , m_context(context)
         , m_data(context.CreateBuffer<RadeonRays::float3>(w*h, CL_MEM_READ_WRITE))
+        , m_next_staging(0)
         {
         }
 
+        ~ClwOutput()
+        {
+            for (auto& staging : m_staging)
+            {
+                if (staging.mapped)
+                {
+                    m_context.UnmapBuffer(0, staging.buffer, staging.mapped).Wait();
+                }
+            }
+
+            if (m_profiler)
+            {
+                m_profiler->ReleaseAllocations(this);
+            }
+        }
+
+        // Set profiler for memory accounting, can be nullptr
+        void SetProfiler(std::shared_ptr<ClwProfiler> profiler)
+        {
+            if (m_profiler)
+            {
+                m_profiler->ReleaseAllocations(this);
+            }
+
+            m_profiler = profiler;
+            TrackMemory();
+        }
+
         void GetData(RadeonRays::float3* data) const override
         {
             m_context.ReadBuffer(0, m_data, data, m_data.GetElementCount()).Wait();
@@ -30,6 +113,81 @@ namespace Baikal
                 elems_count).Wait();
         }
 
+        /**
+         \brief Start copying output data to pinned host memory.
+
+         Data is copied into the next staging buffer of the ring on the device and the
+         buffer is mapped without blocking, so the caller can keep submitting work
+         while the transfer is in flight. Conversion to kHalf4 or kRgba8 is done on the
+         device by convert_kernel (see MonteCarloRenderer::GetConvertKernel), so only
+         converted data is transferred.
+
+         \param format Format of the data.
+         \param convert_kernel Conversion kernel, not used for kFloat4.
+         \param gamma Gamma used for kRgba8 conversion.
+         \return Pending readback.
+         */
+        Readback ReadDataAsync(ReadbackFormat format = ReadbackFormat::kFloat4, CLWKernel convert_kernel = CLWKernel(), float gamma = 2.2f)
+        {
+            auto num_elements = m_data.GetElementCount();
+
+            if (m_staging.empty())
+            {
+                m_staging.resize(kNumStagingBuffers);
+
+                for (auto& staging : m_staging)
+                {
+                    staging.buffer = m_context.CreateBuffer<RadeonRays::float3>(num_elements, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR);
+                }
+
+                TrackMemory();
+            }
+
+            auto& staging = m_staging[m_next_staging];
+            m_next_staging = (m_next_staging + 1) % kNumStagingBuffers;
+
+            // Previous data of this buffer is not needed anymore
+            if (staging.mapped)
+            {
+                m_context.UnmapBuffer(0, staging.buffer, staging.mapped);
+                staging.mapped = nullptr;
+            }
+
+            std::size_t size = 0;
+
+            if (format == ReadbackFormat::kFloat4)
+            {
+                size = num_elements * sizeof(RadeonRays::float3);
+                m_context.CopyBuffer(0, m_data, staging.buffer, 0, 0, num_elements);
+            }
+            else
+            {
+                size = num_elements * (format == ReadbackFormat::kHalf4 ? 4 * sizeof(std::uint16_t) : 4 * sizeof(std::uint8_t));
+
+                int argc = 0;
+                convert_kernel.SetArg(argc++, m_data);
+                convert_kernel.SetArg(argc++, static_cast<cl_int>(num_elements));
+                convert_kernel.SetArg(argc++, static_cast<cl_int>(format));
+                convert_kernel.SetArg(argc++, gamma);
+                convert_kernel.SetArg(argc++, staging.buffer);
+
+                m_context.Launch1D(0, ((num_elements + 63) / 64) * 64, 64, convert_kernel);
+            }
+
+            // Map only the part holding the data
+            auto num_mapped = (size + sizeof(RadeonRays::float3) - 1) / sizeof(RadeonRays::float3);
+
+            Readback readback;
+            readback.m_event = m_context.MapBuffer(0, staging.buffer, CL_MAP_READ, 0, num_mapped, &staging.mapped);
+            readback.m_data = staging.mapped;
+            readback.m_size = size;
+
+            // Start the transfer without waiting for it
+            m_context.Flush(0);
+
+            return readback;
+        }
+
         void Clear(RadeonRays::float3 const& val) override
         {
             m_context.FillBuffer(0, m_data, val, m_data.GetElementCount()).Wait();
@@ -38,7 +196,35 @@ namespace Baikal
         CLWBuffer<RadeonRays::float3> data() const { return m_data; }
 
     private:
+        // Pinned buffer of the readback ring
+        struct StagingBuffer
+        {
+            CLWBuffer<RadeonRays::float3> buffer;
+            RadeonRays::float3* mapped = nullptr;
+        };
+
+        // Report output and staging buffers to the profiler
+        void TrackMemory() const
+        {
+            if (!m_profiler)
+            {
+                return;
+            }
+
+            auto size = ClwProfiler::GetBufferSize(m_data);
+
+            for (auto const& staging : m_staging)
+            {
+                size += ClwProfiler::GetBufferSize(staging.buffer);
+            }
+
+            m_profiler->SetAllocation(this, ClwProfiler::MemoryCategory::kOutputs, size);
+        }
+
         CLWContext m_context;
         CLWBuffer<RadeonRays::float3> m_data;
+        std::vector<StagingBuffer> m_staging;
+        std::uint32_t m_next_staging;
+        std::shared_ptr<ClwProfiler> m_profiler;
     };
 }
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "output.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Baikal
+{
+    // Output stored in host memory, sample count is kept in w
+    class CpuOutput : public Output
+    {
+    public:
+        CpuOutput(std::uint32_t w, std::uint32_t h)
+        : Output(w, h)
+        , m_data(w * h)
+        {
+        }
+
+        void GetData(RadeonRays::float3* data) const override
+        {
+            std::copy(m_data.cbegin(), m_data.cend(), data);
+        }
+
+        void GetData(RadeonRays::float3* data, /* offset in elems */ size_t offset, /* read elems */size_t elems_count) const override
+        {
+            std::copy(m_data.cbegin() + offset, m_data.cbegin() + offset + elems_count, data);
+        }
+
+        void Clear(RadeonRays::float3 const& val) override
+        {
+            std::fill(m_data.begin(), m_data.end(), val);
+        }
+
+        std::vector<RadeonRays::float3>& data() { return m_data; }
+        std::vector<RadeonRays::float3> const& data() const { return m_data; }
+
+    private:
+        std::vector<RadeonRays::float3> m_data;
+    };
+}
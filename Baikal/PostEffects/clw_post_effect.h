@@ -40,6 +40,9 @@ namespace Baikal
     public:
         // Constructor, receives CLW context
         ClwPostEffect(const CLProgramManager *program_manager, CLWContext context, std::string const& file_name);
+
+        // Set profiler for kernel timings
+        using ClwClass::SetProfiler;
         //ClwPostEffect(const CLProgramManager *program_manager, CLWContext context, const char* data, const char* includes[], std::size_t inc_num);
     };
     
@@ -328,7 +328,7 @@ namespace Baikal
                 size_t gs[] = { static_cast<size_t>((output.width() + 7) / 8 * 8), static_cast<size_t>((output.height() + 7) / 8 * 8) };
                 size_t ls[] = { 8, 8 };
 
-                GetContext().Launch2D(0, gs, ls, copy_buffers_kernel);
+                Launch2D("CopyBuffers_main", gs, ls, copy_buffers_kernel);
             }
         }
 
@@ -351,7 +351,7 @@ namespace Baikal
                 size_t gs[] = { static_cast<size_t>((output.width() + 7) / 8 * 8), static_cast<size_t>((output.height() + 7) / 8 * 8) };
                 size_t ls[] = { 8, 8 };
 
-                GetContext().Launch2D(0, gs, ls, generate_motion_kernel);
+                Launch2D("WaveletGenerateMotionBuffer_main", gs, ls, generate_motion_kernel);
             }
         }
 
@@ -381,7 +381,7 @@ namespace Baikal
                 size_t gs[] = { static_cast<size_t>((output.width() + 7) / 8 * 8), static_cast<size_t>((output.height() + 7) / 8 * 8) };
                 size_t ls[] = { 8, 8 };
 
-                GetContext().Launch2D(0, gs, ls, accumulation_kernel);
+                Launch2D("TemporalAccumulation_main", gs, ls, accumulation_kernel);
             }
         }
 
@@ -401,7 +401,7 @@ namespace Baikal
                 size_t gs[] = { static_cast<size_t>((output.width() + 7) / 8 * 8), static_cast<size_t>((output.height() + 7) / 8 * 8) };
                 size_t ls[] = { 8, 8 };
 
-                GetContext().Launch2D(0, gs, ls, copy_buffer_kernel);
+                Launch2D("CopyBuffer_main", gs, ls, copy_buffer_kernel);
             }
         }
 
@@ -453,7 +453,7 @@ namespace Baikal
                     size_t gs[] = { static_cast<size_t>((output.width() + 7) / 8 * 8), static_cast<size_t>((output.height() + 7) / 8 * 8) };
                     size_t ls[] = { 8, 8 };
 
-                    GetContext().Launch2D(0, gs, ls, filter_kernel);
+                    Launch2D("WaveletFilter_main", gs, ls, filter_kernel);
                 }
 
                 argc = 0;
@@ -470,7 +470,7 @@ namespace Baikal
                     size_t gs[] = { static_cast<size_t>((output.width() + 7) / 8 * 8), static_cast<size_t>((output.height() + 7) / 8 * 8) };
                     size_t ls[] = { 8, 8 };
 
-                    GetContext().Launch2D(0, gs, ls, update_variance_kernel);
+                    Launch2D("UpdateVariance_main", gs, ls, update_variance_kernel);
                 }
             }
 
@@ -488,7 +488,7 @@ namespace Baikal
                 size_t gs[] = { static_cast<size_t>((output.width() + 7) / 8 * 8), static_cast<size_t>((output.height() + 7) / 8 * 8) };
                 size_t ls[] = { 8, 8 };
 
-                GetContext().Launch2D(0, gs, ls, edge_detection_kernel);
+                Launch2D("EdgeDetectionMLAA", gs, ls, edge_detection_kernel);
             }
 
             argc = 0;
@@ -505,7 +505,7 @@ namespace Baikal
                 size_t gs[] = { static_cast<size_t>((output.width() + 7) / 8 * 8), static_cast<size_t>((output.height() + 7) / 8 * 8) };
                 size_t ls[] = { 8, 8 };
 
-                GetContext().Launch2D(0, gs, ls, blending_weight_calclulation_kernel);
+                Launch2D("BlendingWeightCalculationMLAA", gs, ls, blending_weight_calclulation_kernel);
             }
 
             argc = 0;
@@ -522,7 +522,7 @@ namespace Baikal
                 size_t gs[] = { static_cast<size_t>((output.width() + 7) / 8 * 8), static_cast<size_t>((output.height() + 7) / 8 * 8) };
                 size_t ls[] = { 8, 8 };
 
-                GetContext().Launch2D(0, gs, ls, neighborhood_blending_kernel);
+                Launch2D("NeighborhoodBlendingMLAA", gs, ls, neighborhood_blending_kernel);
             }
         }
     }
@@ -26,50 +26,71 @@ namespace Baikal
         )
         , RadeonRays::IntersectionApi::Delete
     )
-    
+    , m_profiler(std::make_shared<ClwProfiler>())
     {
     }
 
     // Create a renderer of specified type
-    std::unique_ptr<Renderer> ClwRenderFactory::CreateRenderer(
+    std::unique_ptr<ClwRenderer> ClwRenderFactory::CreateRenderer(
                                                     RendererType type) const
     {
+        std::unique_ptr<MonteCarloRenderer> renderer;
+
         switch (type)
         {
             case RendererType::kUnidirectionalPathTracer:
-                return std::unique_ptr<Renderer>(
+                renderer.reset(
                     new MonteCarloRenderer(
                         m_context, 
                         &m_program_manager,
                         std::make_unique<PathTracingEstimator>(m_context, m_intersector, &m_program_manager)
                         ));
+                break;
+            case RendererType::kAdaptivePathTracer:
+                renderer.reset(
+                    new AdaptiveRenderer(
+                        m_context,
+                        &m_program_manager,
+                        std::make_unique<PathTracingEstimator>(m_context, m_intersector, &m_program_manager)
+                        ));
+                break;
             default:
                 throw std::runtime_error("Renderer not supported");
         }
+
+        renderer->SetProfiler(m_profiler);
+        return std::move(renderer);
     }
 
     std::unique_ptr<Output> ClwRenderFactory::CreateOutput(std::uint32_t w,
                                                            std::uint32_t h)
                                                            const
     {
-        return std::unique_ptr<Output>(new ClwOutput(m_context, w, h));
+        auto output = std::make_unique<ClwOutput>(m_context, w, h);
+        output->SetProfiler(m_profiler);
+        return std::move(output);
     }
 
     std::unique_ptr<PostEffect> ClwRenderFactory::CreatePostEffect(
                                                     PostEffectType type) const
     {
 #ifdef ENABLE_DENOISER
+        std::unique_ptr<ClwPostEffect> post_effect;
+
         switch (type)
         {
             case PostEffectType::kBilateralDenoiser:
-                return std::unique_ptr<PostEffect>(
-                                            new BilateralDenoiser(m_context, &m_program_manager));
+                post_effect.reset(new BilateralDenoiser(m_context, &m_program_manager));
+                break;
             case PostEffectType::kWaveletDenoiser:
-                return std::unique_ptr<PostEffect>(
-                                            new WaveletDenoiser(m_context, &m_program_manager));
+                post_effect.reset(new WaveletDenoiser(m_context, &m_program_manager));
+                break;
             default:
                 throw std::runtime_error("PostEffect is not supported");
         }
+
+        post_effect->SetProfiler(m_profiler);
+        return std::move(post_effect);
 #else
         throw std::runtime_error("PostEffect is not supported");
 #endif
@@ -77,6 +98,8 @@ namespace Baikal
 
     std::unique_ptr<SceneController<ClwScene>> ClwRenderFactory::CreateSceneController() const
     {
-        return std::make_unique<ClwSceneController>(m_context, m_intersector.get(), &m_program_manager);
+        auto controller = std::make_unique<ClwSceneController>(m_context, m_intersector.get(), &m_program_manager);
+        controller->SetProfiler(m_profiler);
+        return std::move(controller);
     }
 }
@@ -27,7 +27,9 @@
 #include "CLW.h"
 
 #include "SceneGraph/clwscene.h"
+#include "Renderers/renderer.h"
 #include "Utils/cl_program_manager.h"
+#include "Utils/clw_profiler.h"
 
 #include <memory>
 #include <string>
@@ -48,7 +50,7 @@ namespace Baikal
         ClwRenderFactory(CLWContext context, std::string const& cache_path="");
 
         // Create a renderer of specified type
-        std::unique_ptr<Renderer> 
+        std::unique_ptr<ClwRenderer> 
             CreateRenderer(RendererType type) const override;
         // Create an output of specified type
         std::unique_ptr<Output> 
@@ -60,6 +62,14 @@ namespace Baikal
         std::unique_ptr<SceneController<ClwScene>>
             CreateSceneController() const override;
 
+        // Profiler shared by all entities created via this factory:
+        // kernel timings (disabled by default) and device memory usage
+        ClwProfiler& GetProfiler() const { return *m_profiler; }
+
+        // Program manager shared by all entities created via this factory,
+        // can be used to compile their kernels ahead of time
+        CLProgramManager const& GetProgramManager() const { return m_program_manager; }
+
     private:
         CLWContext m_context;
         std::string m_cache_path;
@@ -68,5 +78,8 @@ namespace Baikal
         using RadeonRaysInstanceDelete = decltype(RadeonRays::IntersectionApi::Delete);
 
         std::shared_ptr<RadeonRays::IntersectionApi> m_intersector;
+
+        // Shared with created entities, so it outlives them regardless of destruction order
+        std::shared_ptr<ClwProfiler> m_profiler;
     };
 }
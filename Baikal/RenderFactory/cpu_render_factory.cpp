@@ -0,0 +1,48 @@
+#include "cpu_render_factory.h"
+
+#include "Output/cpuoutput.h"
+#include "Renderers/cpu_renderer.h"
+#include "Controllers/cpu_scene_controller.h"
+
+#include <memory>
+#include <stdexcept>
+
+namespace Baikal
+{
+    CpuRenderFactory::CpuRenderFactory(std::uint32_t num_threads)
+    : m_num_threads(num_threads)
+    {
+    }
+
+    // Create a renderer of specified type
+    std::unique_ptr<SceneRenderer<CpuScene>> CpuRenderFactory::CreateRenderer(
+                                                    RendererType type) const
+    {
+        switch (type)
+        {
+            case RendererType::kUnidirectionalPathTracer:
+                return std::unique_ptr<SceneRenderer<CpuScene>>(
+                    new CpuRenderer(m_num_threads));
+            default:
+                throw std::runtime_error("Renderer not supported");
+        }
+    }
+
+    std::unique_ptr<Output> CpuRenderFactory::CreateOutput(std::uint32_t w,
+                                                           std::uint32_t h)
+                                                           const
+    {
+        return std::unique_ptr<Output>(new CpuOutput(w, h));
+    }
+
+    std::unique_ptr<PostEffect> CpuRenderFactory::CreatePostEffect(
+                                                    PostEffectType type) const
+    {
+        throw std::runtime_error("PostEffect is not supported");
+    }
+
+    std::unique_ptr<SceneController<CpuScene>> CpuRenderFactory::CreateSceneController() const
+    {
+        return std::make_unique<CpuSceneController>();
+    }
+}
@@ -28,7 +28,7 @@
 
 namespace Baikal
 {
-    class Renderer;
+    template <typename CompiledScene> class SceneRenderer;
     class Output;
     class PostEffect;
     
@@ -45,7 +45,8 @@ namespace Baikal
     public:
         enum class RendererType
         {
-            kUnidirectionalPathTracer
+            kUnidirectionalPathTracer,
+            kAdaptivePathTracer
         };
         
         enum class PostEffectType
@@ -58,7 +59,7 @@ namespace Baikal
         virtual ~RenderFactory() = default;
 
         virtual 
-        std::unique_ptr<Renderer> CreateRenderer(RendererType type) const = 0;
+        std::unique_ptr<SceneRenderer<Scene>> CreateRenderer(RendererType type) const = 0;
 
         virtual 
         std::unique_ptr<Output> CreateOutput(std::uint32_t w, std::uint32_t h) const = 0;
@@ -1,17 +1,50 @@
 #include "adaptive_renderer.h"
 #include "Output/clwoutput.h"
 
+#include <limits>
+
 namespace Baikal
 {
-    
+    namespace
+    {
+        // Number of uniformly sampled frames before error estimates are used
+        std::uint32_t const kNumUniformFrames = 32u;
+        // Number of frames between error estimates
+        std::uint32_t const kErrorUpdateInterval = 32u;
+        // Min number of samples per pixel before it is considered converged
+        int const kMinSamplesPerPixel = 32;
+        // Default target relative error
+        float const kDefaultTargetError = 0.01f;
+    }
+
     AdaptiveRenderer::AdaptiveRenderer(
         CLWContext context,
         const CLProgramManager *program_manager,
         std::unique_ptr<Estimator> estimator
     ) : MonteCarloRenderer(context, program_manager, std::move(estimator))
+      , m_num_active_pixels_pending(false)
+      , m_num_active_pixels_value(0)
+      , m_target_error(kDefaultTargetError)
+      , m_converged(false)
     {
         auto samples_buffer_size = GetEstimator().GetWorkBufferSize();
         m_sample_buffer = GetContext().CreateBuffer<float3>(samples_buffer_size, CL_MEM_READ_WRITE);
+        m_num_samples = GetContext().CreateBuffer<int>(1, CL_MEM_READ_WRITE);
+        m_num_active_pixels = GetContext().CreateBuffer<int>(1, CL_MEM_READ_WRITE);
+    }
+
+    AdaptiveRenderer::~AdaptiveRenderer()
+    {
+        // Read back writes into this object
+        if (m_num_active_pixels_pending)
+        {
+            m_num_active_pixels_event.Wait();
+        }
+
+        if (GetProfiler())
+        {
+            GetProfiler()->ReleaseAllocations(this);
+        }
     }
 
     void AdaptiveRenderer::Clear(RadeonRays::float3 const& val,
@@ -19,7 +52,18 @@ namespace Baikal
     {
         MonteCarloRenderer::Clear(val, output);
 
-        GetContext().FillBuffer(0u, m_variance_buffer, 0.f, m_variance_buffer.GetElementCount()).Wait();
+        if (m_num_active_pixels_pending)
+        {
+            m_num_active_pixels_event.Wait();
+            m_num_active_pixels_pending = false;
+        }
+
+        m_converged = false;
+
+        GetContext().FillBuffer(0u, m_variance_buffer, 0.f, m_variance_buffer.GetElementCount());
+        GetContext().FillBuffer(0u, m_moment_buffer, 0.f, m_moment_buffer.GetElementCount());
+        // All pixels are active until their error is estimated
+        GetContext().FillBuffer(0u, m_pixel_error_buffer, std::numeric_limits<float>::max(), m_pixel_error_buffer.GetElementCount()).Wait();
     }
 
     // Render single tile
@@ -29,25 +73,37 @@ namespace Baikal
     {
         // Number of rays to generate
         auto output = static_cast<ClwOutput*>(GetOutput(OutputType::kColor));
-        auto width = output->width();
-        auto height = output->height();
 
-        GetContext().FillBuffer(0u, m_sample_buffer, float3(), m_sample_buffer.GetElementCount()).Wait();
+        UpdateConvergence();
 
-        if (output)
+        if (output && !m_converged)
         {
             auto num_rays = tile_size.x * tile_size.y;
-            auto output_size = int2(width, height);
+            auto output_size = int2(output->width(), output->height());
+
+            GetContext().FillBuffer(0u, m_sample_buffer, float3(), m_sample_buffer.GetElementCount());
 
-            if (m_sample_counter < 32)
+            if (m_sample_counter < kNumUniformFrames)
             {
                 MonteCarloRenderer::GenerateTileDomain(output_size, tile_origin, tile_size);
             }
             else
             {
+                // Build sampling distribution from the error of accumulated samples,
+                // once per frame
+                bool first_tile = tile_origin.x == 0 && tile_origin.y == 0;
+                if (first_tile && m_sample_counter % kErrorUpdateInterval == 0)
+                {
+                    EstimatePixelError(output->data(), output->width(), output->height());
+                    UpdateTileDistribution();
+                }
+
                 GenerateTileDomain(output_size, tile_origin, tile_size);
             }
 
+            // Estimator reuses ray count buffer for compaction, so keep the number of samples
+            GetContext().CopyBuffer(0u, m_estimator->GetRayCountBuffer(), m_num_samples, 0, 0, 1);
+
             GeneratePrimaryRays(scene, *output, tile_size);
 
             m_estimator->Estimate(
@@ -59,37 +115,21 @@ namespace Baikal
                 true
             );
 
-            AccumulateSamples(m_sample_buffer, output->data(), num_rays);
-
-            if (m_sample_counter > 0 && m_sample_counter % 32 == 0)
-            {
-                auto variance_buffer_size = m_variance_buffer.GetElementCount();
-                EstimateVariance(output->data(), output->width(), output->height());
-
-                std::vector<float> probabilities(variance_buffer_size);
-                GetContext().ReadBuffer(0u, m_variance_buffer, &probabilities[0], variance_buffer_size).Wait();
-
-                m_tile_distribution.Set(&probabilities[0],
-                                        (std::uint32_t)variance_buffer_size);
-
-                UpdateTileDistribution();
-            }
-
+            AccumulateSamples(m_sample_buffer, output->data(), m_num_samples);
         }
 
         // Check if we have other outputs, than color
         bool aov_pass_needed = (FindFirstNonZeroOutput(false) != nullptr);
         if (aov_pass_needed)
         {
-            FillAOVs(scene, tile_origin, tile_size);
-            GetContext().Flush(0);
+            UpdateAOVs(scene, tile_origin, tile_size);
         }
     }
 
     void AdaptiveRenderer::AccumulateSamples(
         CLWBuffer<float3> sample_buffer,
         CLWBuffer<float3> accumulation_buffer,
-        std::uint32_t num_elements
+        CLWBuffer<int> num_elements
     )
     {
         auto accumulate_kernel = GetKernel("AccumulateSingleSample");
@@ -99,32 +139,70 @@ namespace Baikal
         accumulate_kernel.SetArg(argc++, accumulation_buffer);
         accumulate_kernel.SetArg(argc++, m_estimator->GetOutputIndexBuffer());
         accumulate_kernel.SetArg(argc++, num_elements);
+        accumulate_kernel.SetArg(argc++, m_moment_buffer);
 
         {
-            GetContext().Launch1D(0, ((num_elements + 63) / 64) * 64, 64, accumulate_kernel);
+            auto size = sample_buffer.GetElementCount();
+            Launch1D("AccumulateSingleSample", ((size + 63) / 64) * 64, 64, accumulate_kernel);
         }
     }
 
-    void AdaptiveRenderer::EstimateVariance(
+    void AdaptiveRenderer::EstimatePixelError(
         CLWBuffer<float3> accumulation_buffer,
         std::uint32_t width,
         std::uint32_t height
     )
     {
-        auto estimate_kernel = GetKernel("EstimateVariance");
+        // Previous count has not been read yet, drop it
+        if (m_num_active_pixels_pending)
+        {
+            m_num_active_pixels_event.Wait();
+            m_num_active_pixels_pending = false;
+        }
+
+        GetContext().FillBuffer(0u, m_num_active_pixels, 0, 1);
+
+        auto estimate_kernel = GetKernel("EstimatePixelError");
 
         int argc = 0;
         estimate_kernel.SetArg(argc++, accumulation_buffer);
-        estimate_kernel.SetArg(argc++, m_variance_buffer);
+        estimate_kernel.SetArg(argc++, m_moment_buffer);
         estimate_kernel.SetArg(argc++, width);
         estimate_kernel.SetArg(argc++, height);
+        estimate_kernel.SetArg(argc++, m_target_error);
+        estimate_kernel.SetArg(argc++, kMinSamplesPerPixel);
+        estimate_kernel.SetArg(argc++, m_pixel_error_buffer);
+        estimate_kernel.SetArg(argc++, m_variance_buffer);
+        estimate_kernel.SetArg(argc++, m_num_active_pixels);
 
         // Run shading kernel
         {
-            size_t gs[] = { static_cast<size_t>((width + 15) / 16 * 16), static_cast<size_t>((width + 15) / 16 * 16) };
+            size_t gs[] = { static_cast<size_t>((width + 15) / 16 * 16), static_cast<size_t>((height + 15) / 16 * 16) };
             size_t ls[] = { 16, 16 };
 
-            GetContext().Launch2D(0, gs, ls, estimate_kernel);
+            Launch2D("EstimatePixelError", gs, ls, estimate_kernel);
+        }
+
+        // Read the number of unconverged pixels without waiting for it
+        m_num_active_pixels_event = GetContext().ReadBuffer(0u, m_num_active_pixels, &m_num_active_pixels_value, 1);
+        m_num_active_pixels_pending = true;
+        GetContext().Flush(0);
+    }
+
+    void AdaptiveRenderer::UpdateConvergence()
+    {
+        if (!m_num_active_pixels_pending)
+        {
+            return;
+        }
+
+        cl_int status = CL_QUEUED;
+        clGetEventInfo(m_num_active_pixels_event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+
+        if (status == CL_COMPLETE)
+        {
+            m_num_active_pixels_pending = false;
+            m_converged = (m_num_active_pixels_value == 0);
         }
     }
 
@@ -140,47 +218,70 @@ namespace Baikal
 
             auto variance_buffer_size = ((width + 15) / 16) * ((height + 15) / 16);
             m_variance_buffer = GetContext().CreateBuffer<float>(variance_buffer_size, CL_MEM_READ_WRITE);
+            m_moment_buffer = GetContext().CreateBuffer<float>(width * height, CL_MEM_READ_WRITE);
+            m_pixel_error_buffer = GetContext().CreateBuffer<float>(width * height, CL_MEM_READ_WRITE);
+
+            GetContext().FillBuffer(0u, m_variance_buffer, 1.f, variance_buffer_size);
+            GetContext().FillBuffer(0u, m_moment_buffer, 0.f, width * height);
+            GetContext().FillBuffer(0u, m_pixel_error_buffer, std::numeric_limits<float>::max(), width * height);
 
-            std::vector<float> probabilities(variance_buffer_size, 1.f);
-            m_tile_distribution.Set(&probabilities[0], variance_buffer_size);
+            m_converged = false;
 
             UpdateTileDistribution();
+            TrackWorkBuffers();
         }
     }
 
-    void AdaptiveRenderer::UpdateTileDistribution()
+    void AdaptiveRenderer::SetProfiler(std::shared_ptr<ClwProfiler> profiler)
     {
-        // Write distribution data
-        int* distribution_ptr = nullptr;
-        auto num_tiles = m_variance_buffer.GetElementCount();
-        auto required_size = (1 + 1 + num_tiles + num_tiles);
-        if (m_tile_distribution_buffer.GetElementCount() < required_size)
+        if (GetProfiler())
         {
-            m_tile_distribution_buffer = GetContext().CreateBuffer<int>(required_size, CL_MEM_READ_ONLY);
+            GetProfiler()->ReleaseAllocations(this);
         }
 
-        GetContext().MapBuffer(0, m_tile_distribution_buffer, CL_MAP_WRITE, &distribution_ptr).Wait();
-        auto current = distribution_ptr;
+        MonteCarloRenderer::SetProfiler(profiler);
+        TrackWorkBuffers();
+    }
 
-        // Write the number of segments first
-        *current++ = (int)m_tile_distribution.m_num_segments;
+    void AdaptiveRenderer::TrackWorkBuffers() const
+    {
+        auto profiler = GetProfiler();
 
-        // Then write num_segments  + 1 CDF values
-        auto values = reinterpret_cast<float*>(current);
-        for (auto i = 0u; i < m_tile_distribution.m_num_segments + 1; ++i)
+        if (!profiler)
         {
-            values[i] = m_tile_distribution.m_cdf[i];
+            return;
         }
 
-        // Then write num_segments PDF values
-        values += m_tile_distribution.m_num_segments + 1;
+        auto size =
+            ClwProfiler::GetBufferSize(m_sample_buffer) + ClwProfiler::GetBufferSize(m_variance_buffer) +
+            ClwProfiler::GetBufferSize(m_tile_distribution_buffer) + ClwProfiler::GetBufferSize(m_moment_buffer) +
+            ClwProfiler::GetBufferSize(m_pixel_error_buffer) + ClwProfiler::GetBufferSize(m_num_samples) +
+            ClwProfiler::GetBufferSize(m_num_active_pixels);
+
+        profiler->SetAllocation(this, ClwProfiler::MemoryCategory::kWorkBuffers, size);
+    }
 
-        for (auto i = 0u; i < m_tile_distribution.m_num_segments; ++i)
+    void AdaptiveRenderer::UpdateTileDistribution()
+    {
+        // Number of segments, num_segments + 1 CDF values, num_segments PDF values
+        auto num_tiles = m_variance_buffer.GetElementCount();
+        auto required_size = (1 + 1 + num_tiles + num_tiles);
+        if (m_tile_distribution_buffer.GetElementCount() < required_size)
         {
-            values[i] = m_tile_distribution.m_func_values[i] / m_tile_distribution.m_func_sum;
+            m_tile_distribution_buffer = GetContext().CreateBuffer<int>(required_size, CL_MEM_READ_WRITE);
         }
 
-        GetContext().UnmapBuffer(0, m_tile_distribution_buffer, distribution_ptr);
+        auto build_kernel = GetKernel("BuildTileDistribution");
+
+        int argc = 0;
+        build_kernel.SetArg(argc++, m_variance_buffer);
+        build_kernel.SetArg(argc++, (cl_int)num_tiles);
+        build_kernel.SetArg(argc++, m_tile_distribution_buffer);
+
+        // Single group scans the whole distribution
+        {
+            Launch1D("BuildTileDistribution", 256, 256, build_kernel);
+        }
     }
 
     void AdaptiveRenderer::GenerateTileDomain(
@@ -189,6 +290,9 @@ namespace Baikal
         int2 const& tile_size
     )
     {
+        // Generated pixels are counted by the kernel
+        GetContext().FillBuffer(0u, m_estimator->GetRayCountBuffer(), 0, 1);
+
         // Fetch kernel
         CLWKernel generate_kernel = GetKernel("GenerateTileDomain_Adaptive");
 
@@ -205,6 +309,7 @@ namespace Baikal
         generate_kernel.SetArg(argc++, m_estimator->GetRandomBuffer(Estimator::RandomBufferType::kRandomSeed));
         generate_kernel.SetArg(argc++, m_estimator->GetRandomBuffer(Estimator::RandomBufferType::kSobolLUT));
         generate_kernel.SetArg(argc++, m_tile_distribution_buffer);
+        generate_kernel.SetArg(argc++, m_pixel_error_buffer);
         generate_kernel.SetArg(argc++, m_estimator->GetOutputIndexBuffer());
         generate_kernel.SetArg(argc++, m_estimator->GetRayCountBuffer());
 
@@ -213,8 +318,8 @@ namespace Baikal
             size_t gs[] = { static_cast<size_t>((tile_size.x + 15) / 16 * 16), static_cast<size_t>((tile_size.y + 15) / 16 * 16) };
             size_t ls[] = { 16, 16 };
 
-            GetContext().Launch2D(0, gs, ls, generate_kernel);
+            Launch2D("GenerateTileDomain_Adaptive", gs, ls, generate_kernel);
         }
     }
-    
+
 }
@@ -24,7 +24,6 @@ THE SOFTWARE.
 #include "math/int2.h"
 #include "monte_carlo_renderer.h"
 #include "CLW.h"
-#include "Utils/distribution1d.h"
 
 #include <memory>
 
@@ -35,7 +34,14 @@ namespace Baikal
     class ClwOutput;
     struct ClwScene;
     
-    ///< Renderer implementation
+    /**
+    \brief Renderer distributing samples according to estimated per pixel error.
+
+    After a number of uniform frames, relative error of every pixel is estimated
+    on the device periodically and tiles are sampled proportionally to the error
+    of their pixels. Pixels reaching the target error are excluded from ray
+    generation, rendering stops once all pixels have converged.
+    */
     class AdaptiveRenderer : public MonteCarloRenderer
     {
     public:
@@ -45,7 +51,7 @@ namespace Baikal
             std::unique_ptr<Estimator> estimator
         );
 
-        ~AdaptiveRenderer() = default;
+        ~AdaptiveRenderer();
 
         // Renderer overrides
         void Clear(RadeonRays::float3 const& val,
@@ -59,16 +65,28 @@ namespace Baikal
         // Set output
         void SetOutput(OutputType type, Output* output) override;
 
+        // Set profiler, error estimation buffers are accounted as work buffers
+        void SetProfiler(std::shared_ptr<ClwProfiler> profiler) override;
+
+        // Set relative error (standard error of the mean over mean luminance) pixels should reach
+        void SetTargetError(float error) { m_target_error = error; }
+        float GetTargetError() const { return m_target_error; }
+
+        // Check if all pixels have reached target error. Convergence is read back
+        // asynchronously, so it is reported with a delay of an update interval.
+        bool IsConverged() const { return m_converged; }
+
         // DEBUG STUFF
         CLWBuffer<float> GetVarianceBuffer() const { return m_variance_buffer; }
+        CLWBuffer<float> GetPixelErrorBuffer() const { return m_pixel_error_buffer; }
     protected:
         void AccumulateSamples(
             CLWBuffer<float3> sample_buffer,
             CLWBuffer<float3> accumulation_buffer,
-            std::uint32_t num_elements
+            CLWBuffer<int> num_elements
         );
 
-        void EstimateVariance(
+        void EstimatePixelError(
             CLWBuffer<float3> accumulation_buffer,
             std::uint32_t width,
             std::uint32_t height
@@ -82,11 +100,29 @@ namespace Baikal
 
         void UpdateTileDistribution();
 
+        // Check if the last read back number of unconverged pixels has arrived
+        void UpdateConvergence();
+
+        // Report buffer memory to the profiler
+        void TrackWorkBuffers() const;
+
     private:
+        // Per tile sum of pixel errors used as tile distribution
         mutable CLWBuffer<float> m_variance_buffer;
         mutable CLWBuffer<float3> m_sample_buffer;
         CLWBuffer<int> m_tile_distribution_buffer;
-        Distribution1D m_tile_distribution;
+        // Per pixel accumulated squared luminance and error estimate
+        mutable CLWBuffer<float> m_moment_buffer;
+        mutable CLWBuffer<float> m_pixel_error_buffer;
+        // Number of samples generated in the current frame
+        CLWBuffer<int> m_num_samples;
+        // Number of unconverged pixels and its pending read back
+        CLWBuffer<int> m_num_active_pixels;
+        mutable CLWEvent m_num_active_pixels_event;
+        mutable bool m_num_active_pixels_pending;
+        int m_num_active_pixels_value;
+        float m_target_error;
+        mutable bool m_converged;
     };
     
 }
@@ -0,0 +1,767 @@
+#include "cpu_renderer.h"
+#include "Output/cpuoutput.h"
+
+#include "SceneGraph/inputmaps.h"
+#include "SceneGraph/uberv2material.h"
+#include "math/mathutils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Baikal
+{
+    using namespace RadeonRays;
+
+    namespace
+    {
+        // Tile size for splitting the work
+        int const kTileSizeX = 1920;
+        int const kTileSizeY = 1080;
+        // Number of paths processed by a single task
+        std::size_t const kPacketSize = 64;
+        // Default max number of bounces
+        std::uint32_t const kDefaultMaxBounces = 5;
+        // Bounce starting Russian roulette
+        std::uint32_t const kRussianRouletteBounce = 3;
+        // Offset of secondary rays origins
+        float const kRayEpsilon = 1e-4f;
+
+        // Random sample dimensions
+        enum SampleDimension
+        {
+            kCameraPixel = 0,
+            kCameraLens = 2,
+            kCameraNumDimensions = 4,
+            kBounceTransparency = 0,
+            kBounceLightSelect = 1,
+            kBounceBxdf = 2,
+            kBounceRussianRoulette = 4,
+            kBounceNumDimensions = 5
+        };
+
+        std::uint32_t WangHash(std::uint32_t seed)
+        {
+            seed = (seed ^ 61u) ^ (seed >> 16);
+            seed *= 9u;
+            seed = seed ^ (seed >> 4);
+            seed *= 0x27d4eb2du;
+            seed = seed ^ (seed >> 15);
+            return seed;
+        }
+
+        // Counter based random number in [0, 1)
+        float Random(std::uint32_t seed, std::uint32_t pixel, std::uint32_t frame, std::uint32_t dimension)
+        {
+            auto hash = WangHash(seed ^ WangHash(pixel ^ WangHash(frame ^ WangHash(dimension))));
+            return static_cast<float>(hash >> 8) * (1.f / 16777216.f);
+        }
+
+        float2 SampleDiskConcentric(float2 const& sample)
+        {
+            auto x = 2.f * sample.x - 1.f;
+            auto y = 2.f * sample.y - 1.f;
+
+            if (x == 0.f && y == 0.f)
+            {
+                return float2();
+            }
+
+            float r, theta;
+            if (std::fabs(x) > std::fabs(y))
+            {
+                r = x;
+                theta = PI / 4.f * (y / x);
+            }
+            else
+            {
+                r = y;
+                theta = PI / 2.f * (1.f - 0.5f * (x / y));
+            }
+
+            return float2(r * std::cos(theta), r * std::sin(theta));
+        }
+
+        // Cosine weighted direction around n
+        float3 SampleHemisphereCosine(float2 const& sample, float3 const& n)
+        {
+            auto u = std::fabs(n.x) > 0.1f ? float3(0.f, 1.f, 0.f) : float3(1.f, 0.f, 0.f);
+            u = normalize(cross(u, n));
+            auto v = cross(n, u);
+
+            auto phi = 2.f * PI * sample.x;
+            auto cos_theta = std::sqrt(1.f - sample.y);
+            auto sin_theta = std::sqrt(sample.y);
+
+            return normalize(u * (sin_theta * std::cos(phi)) + v * (sin_theta * std::sin(phi)) + n * cos_theta);
+        }
+
+        float Lerp(float a, float b, float t)
+        {
+            return a + (b - a) * t;
+        }
+
+        // Bilinear lookup matching Texture_Sample2D kernel
+        float4 SampleTexture(Texture const& texture, float2 uv)
+        {
+            auto width = texture.GetSize().x;
+            auto height = texture.GetSize().y;
+
+            auto u = uv.x - std::floor(uv.x);
+            auto v = 1.f - (uv.y - std::floor(uv.y));
+
+            auto x0 = std::min(std::max(static_cast<int>(std::floor(u * width)), 0), width - 1);
+            auto y0 = std::min(std::max(static_cast<int>(std::floor(v * height)), 0), height - 1);
+            auto x1 = std::min(x0 + 1, width - 1);
+            auto y1 = std::min(y0 + 1, height - 1);
+
+            auto wx = u * width - std::floor(u * width);
+            auto wy = v * height - std::floor(v * height);
+
+            auto val00 = texture.GetTexel(x0, y0);
+            auto val01 = texture.GetTexel(x1, y0);
+            auto val10 = texture.GetTexel(x0, y1);
+            auto val11 = texture.GetTexel(x1, y1);
+
+            float4 result;
+            for (auto c = 0; c < 4; ++c)
+            {
+                result[c] = Lerp(Lerp(val00[c], val01[c], wx), Lerp(val10[c], val11[c], wx), wy);
+            }
+
+            return result;
+        }
+
+        // Lat-long lookup matching Texture_SampleEnvMap kernel
+        float3 SampleEnvMap(Texture const& texture, float3 const& d, bool mirror_x)
+        {
+            auto r = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+            auto phi = std::atan2(d.x, d.z);
+            phi = phi >= 0.f ? phi : phi + 2.f * PI;
+            auto theta = std::acos(d.y / r);
+
+            float2 uv;
+            uv.x = mirror_x ? (1.f - phi / (2.f * PI)) : phi / (2.f * PI);
+            uv.y = 1.f - theta / PI;
+
+            auto value = SampleTexture(texture, uv);
+            return float3(value.x, value.y, value.z);
+        }
+
+        template <typename Func>
+        float4 Apply(float4 const& a, Func func)
+        {
+            return float4(func(a.x), func(a.y), func(a.z), func(a.w));
+        }
+
+        template <typename Func>
+        float4 Apply(float4 const& a, float4 const& b, Func func)
+        {
+            return float4(func(a.x, b.x), func(a.y, b.y), func(a.z, b.z), func(a.w, b.w));
+        }
+
+        // Evaluate input map tree at given uv, mirrors GPU input map semantics
+        float4 EvaluateInputMap(InputMap const& input_map, float2 const& uv)
+        {
+            using Type = InputMap::InputMapType;
+
+            auto one_arg = [&uv](InputMap const& map)
+            {
+                return EvaluateInputMap(*static_cast<InputMap_Sin const&>(map).GetArg(), uv);
+            };
+
+            auto arg_a = [&uv](InputMap const& map)
+            {
+                return EvaluateInputMap(*static_cast<InputMap_Add const&>(map).GetA(), uv);
+            };
+
+            auto arg_b = [&uv](InputMap const& map)
+            {
+                return EvaluateInputMap(*static_cast<InputMap_Add const&>(map).GetB(), uv);
+            };
+
+            switch (input_map.m_type)
+            {
+            case Type::kConstantFloat3:
+            {
+                auto value = static_cast<InputMap_ConstantFloat3 const&>(input_map).GetValue();
+                return float4(value.x, value.y, value.z, 0.f);
+            }
+            case Type::kConstantFloat:
+            {
+                auto value = static_cast<InputMap_ConstantFloat const&>(input_map).GetValue();
+                return float4(value, value, value, 0.f);
+            }
+            case Type::kSampler:
+            case Type::kSamplerBumpmap:
+            {
+                auto texture = static_cast<InputMap_Sampler const&>(input_map).GetTexture();
+                return texture ? SampleTexture(*texture, uv) : float4();
+            }
+            case Type::kAdd:
+                return arg_a(input_map) + arg_b(input_map);
+            case Type::kSub:
+                return arg_a(input_map) - arg_b(input_map);
+            case Type::kMul:
+                return arg_a(input_map) * arg_b(input_map);
+            case Type::kDiv:
+                return Apply(arg_a(input_map), arg_b(input_map), [](float a, float b) { return a / b; });
+            case Type::kMin:
+                return Apply(arg_a(input_map), arg_b(input_map), [](float a, float b) { return std::min(a, b); });
+            case Type::kMax:
+                return Apply(arg_a(input_map), arg_b(input_map), [](float a, float b) { return std::max(a, b); });
+            case Type::kMod:
+                return Apply(arg_a(input_map), arg_b(input_map), [](float a, float b) { return std::fmod(a, b); });
+            case Type::kPow:
+            {
+                auto b = arg_b(input_map).x;
+                return Apply(arg_a(input_map), [b](float a) { return std::pow(a, b); });
+            }
+            case Type::kDot3:
+            {
+                auto a = arg_a(input_map);
+                auto b = arg_b(input_map);
+                return float4(a.x * b.x + a.y * b.y + a.z * b.z, 0.f, 0.f, 0.f);
+            }
+            case Type::kDot4:
+            {
+                auto a = arg_a(input_map);
+                auto b = arg_b(input_map);
+                auto value = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+                return float4(value, 0.f, 0.f, 0.f);
+            }
+            case Type::kCross3:
+            case Type::kCross4:
+            {
+                auto value = cross(arg_a(input_map), arg_b(input_map));
+                return float4(value.x, value.y, value.z, 0.f);
+            }
+            case Type::kSin:
+                return Apply(one_arg(input_map), [](float a) { return std::sin(a); });
+            case Type::kCos:
+                return Apply(one_arg(input_map), [](float a) { return std::cos(a); });
+            case Type::kTan:
+                return Apply(one_arg(input_map), [](float a) { return std::tan(a); });
+            case Type::kAsin:
+                return Apply(one_arg(input_map), [](float a) { return std::asin(a); });
+            case Type::kAcos:
+                return Apply(one_arg(input_map), [](float a) { return std::acos(a); });
+            case Type::kAtan:
+                return Apply(one_arg(input_map), [](float a) { return std::atan(a); });
+            case Type::kFloor:
+                return Apply(one_arg(input_map), [](float a) { return std::floor(a); });
+            case Type::kAbs:
+                return Apply(one_arg(input_map), [](float a) { return std::fabs(a); });
+            case Type::kLength3:
+            {
+                auto a = one_arg(input_map);
+                return float4(std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z), 0.f, 0.f, 0.f);
+            }
+            case Type::kNormalize3:
+            {
+                auto a = normalize(one_arg(input_map));
+                return float4(a.x, a.y, a.z, 0.f);
+            }
+            case Type::kLerp:
+            {
+                auto const& lerp = static_cast<InputMap_Lerp const&>(input_map);
+                auto control = EvaluateInputMap(*lerp.GetControl(), uv);
+                auto a = arg_a(input_map);
+                auto b = arg_b(input_map);
+                return float4(Lerp(a.x, b.x, control.x), Lerp(a.y, b.y, control.y),
+                    Lerp(a.z, b.z, control.z), Lerp(a.w, b.w, control.w));
+            }
+            case Type::kSelect:
+            {
+                auto const& select = static_cast<InputMap_Select const&>(input_map);
+                auto value = one_arg(input_map)[static_cast<int>(select.GetSelection())];
+                return float4(value, value, value, value);
+            }
+            case Type::kShuffle:
+            {
+                auto mask = static_cast<InputMap_Shuffle const&>(input_map).GetMask();
+                auto a = one_arg(input_map);
+                return float4(a[mask[0] & 3], a[mask[1] & 3], a[mask[2] & 3], a[mask[3] & 3]);
+            }
+            case Type::kShuffle2:
+            {
+                auto mask = static_cast<InputMap_Shuffle2 const&>(input_map).GetMask();
+                auto a = arg_a(input_map);
+                auto b = arg_b(input_map);
+                float4 result;
+                for (auto c = 0; c < 4; ++c)
+                {
+                    auto idx = mask[c] & 7;
+                    result[c] = idx < 4 ? a[idx] : b[idx - 4];
+                }
+                return result;
+            }
+            case Type::kMatMul:
+            {
+                auto m = static_cast<InputMap_MatMul const&>(input_map).GetMatrix();
+                auto a = one_arg(input_map);
+                return float4(
+                    m.m00 * a.x + m.m01 * a.y + m.m02 * a.z + m.m03 * a.w,
+                    m.m10 * a.x + m.m11 * a.y + m.m12 * a.z + m.m13 * a.w,
+                    m.m20 * a.x + m.m21 * a.y + m.m22 * a.z + m.m23 * a.w,
+                    m.m30 * a.x + m.m31 * a.y + m.m32 * a.z + m.m33 * a.w);
+            }
+            case Type::kRemap:
+            {
+                auto const& remap = static_cast<InputMap_Remap const&>(input_map);
+                auto src = EvaluateInputMap(*remap.GetSourceRange(), uv);
+                auto dst = EvaluateInputMap(*remap.GetDestinationRange(), uv);
+                auto data = EvaluateInputMap(*remap.GetData(), uv);
+                return Apply(data, [&src, &dst](float a) { return Lerp(dst.x, dst.y, (a - src.x) / (src.y - src.x)); });
+            }
+            }
+
+            return float4();
+        }
+
+        float3 EvaluateColor(InputMap::Ptr const& input_map, float2 const& uv)
+        {
+            if (!input_map)
+            {
+                return float3();
+            }
+
+            auto value = EvaluateInputMap(*input_map, uv);
+            return float3(value.x, value.y, value.z);
+        }
+
+        float MaxComponent(float3 const& v)
+        {
+            return std::max(v.x, std::max(v.y, v.z));
+        }
+
+        // Delta light radiance arriving at p, sets direction and distance to the light
+        float3 SampleDeltaLight(CpuScene::Light const& light, float3 const& p, float3& wo, float& dist)
+        {
+            switch (light.type)
+            {
+            case CpuScene::LightType::kPoint:
+            {
+                auto d = light.p - p;
+                auto dist2 = d.sqnorm();
+                dist = std::sqrt(dist2);
+                wo = d * (1.f / dist);
+                return light.intensity * (1.f / dist2);
+            }
+            case CpuScene::LightType::kDirectional:
+            {
+                wo = -light.d;
+                dist = std::numeric_limits<float>::max();
+                return light.intensity;
+            }
+            case CpuScene::LightType::kSpot:
+            {
+                auto d = light.p - p;
+                auto dist2 = d.sqnorm();
+                dist = std::sqrt(dist2);
+                wo = d * (1.f / dist);
+
+                auto ddotwo = dot(-wo, light.d);
+                if (ddotwo <= light.oa)
+                {
+                    return float3();
+                }
+
+                auto intensity = light.intensity * (1.f / dist2);
+                return ddotwo > light.ia ? intensity : intensity * (1.f - (light.ia - ddotwo) / (light.ia - light.oa));
+            }
+            default:
+                return float3();
+            }
+        }
+    }
+
+    void CpuRenderer::Paths::Resize(std::size_t size)
+    {
+        origin.resize(size);
+        direction.resize(size);
+        tmax.resize(size);
+        throughput.resize(size);
+        pixel.resize(size);
+        alive.resize(size);
+    }
+
+    void CpuRenderer::ShadowRays::Resize(std::size_t size)
+    {
+        origin.resize(size);
+        direction.resize(size);
+        tmax.resize(size);
+        contribution.resize(size);
+    }
+
+    CpuRenderer::CpuRenderer(std::uint32_t num_threads)
+        : m_thread_pool(num_threads)
+        , m_max_bounces(kDefaultMaxBounces)
+        , m_seed(0xcafebabe)
+        , m_sample_counter(0)
+    {
+    }
+
+    void CpuRenderer::Clear(float3 const& val, Output& output) const
+    {
+        static_cast<CpuOutput&>(output).Clear(val);
+        m_sample_counter = 0u;
+    }
+
+    void CpuRenderer::SetRandomSeed(std::uint32_t seed)
+    {
+        m_seed = seed;
+    }
+
+    void CpuRenderer::SetMaxBounces(std::uint32_t max_bounces)
+    {
+        m_max_bounces = max_bounces;
+    }
+
+    void CpuRenderer::Render(CpuScene const& scene)
+    {
+        auto output = GetOutput(OutputType::kColor);
+
+        if (!output)
+        {
+            throw std::runtime_error("Color output is not set");
+        }
+
+        auto output_size = int2(output->width(), output->height());
+
+        auto num_tiles_x = (output_size.x + kTileSizeX - 1) / kTileSizeX;
+        auto num_tiles_y = (output_size.y + kTileSizeY - 1) / kTileSizeY;
+
+        for (auto x = 0; x < num_tiles_x; ++x)
+            for (auto y = 0; y < num_tiles_y; ++y)
+            {
+                auto tile_offset = int2(x * kTileSizeX, y * kTileSizeY);
+                auto tile_size = int2(std::min(kTileSizeX, output_size.x - tile_offset.x),
+                    std::min(kTileSizeY, output_size.y - tile_offset.y));
+
+                RenderTile(scene, tile_offset, tile_size);
+            }
+
+        ++m_sample_counter;
+    }
+
+    void CpuRenderer::RenderTile(CpuScene const& scene,
+        int2 const& tile_origin,
+        int2 const& tile_size)
+    {
+        auto output = static_cast<CpuOutput*>(GetOutput(OutputType::kColor));
+
+        // Only color output is supported
+        if (!output)
+        {
+            return;
+        }
+
+        auto output_size = int2(output->width(), output->height());
+        auto num_paths = static_cast<std::size_t>(tile_size.x * tile_size.y);
+
+        m_paths.Resize(num_paths);
+        m_shadow_rays.Resize(num_paths);
+        m_hits.resize(num_paths);
+        m_hit_found.resize(num_paths);
+        m_samples.assign(num_paths, float3());
+
+        GeneratePrimaryRays(scene, output_size, tile_origin, tile_size);
+
+        for (auto bounce = 0u; bounce <= m_max_bounces && num_paths > 0; ++bounce)
+        {
+            IntersectRays(scene, num_paths);
+            ShadePaths(scene, output_size, tile_origin, tile_size, num_paths, bounce);
+            TraceShadowRays(scene, num_paths);
+            num_paths = CompactPaths(num_paths);
+        }
+
+        // Accumulate, sample count goes into w
+        auto& data = output->data();
+        m_thread_pool.ParallelFor(m_samples.size(), kPacketSize, [&](std::size_t begin, std::size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto x = tile_origin.x + static_cast<int>(i) % tile_size.x;
+                auto y = tile_origin.y + static_cast<int>(i) / tile_size.x;
+                auto& value = data[y * output_size.x + x];
+                value += m_samples[i];
+                value.w += 1.f;
+            }
+        });
+    }
+
+    void CpuRenderer::GeneratePrimaryRays(CpuScene const& scene, int2 const& output_size,
+        int2 const& tile_origin, int2 const& tile_size)
+    {
+        auto const& camera = scene.camera;
+
+        m_thread_pool.ParallelFor(m_paths.origin.size(), kPacketSize, [&](std::size_t begin, std::size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto x = tile_origin.x + static_cast<int>(i) % tile_size.x;
+                auto y = tile_origin.y + static_cast<int>(i) / tile_size.x;
+                auto pixel = static_cast<std::uint32_t>(y * output_size.x + x);
+
+                auto sample0 = float2(Random(m_seed, pixel, m_sample_counter, kCameraPixel),
+                    Random(m_seed, pixel, m_sample_counter, kCameraPixel + 1));
+
+                // [-dim/2, dim/2] image plane sample
+                auto c_sample = float2(((x + sample0.x) / output_size.x - 0.5f) * camera.dim.x,
+                    ((y + sample0.y) / output_size.y - 0.5f) * camera.dim.y);
+
+                if (camera.orthographic)
+                {
+                    m_paths.direction[i] = normalize(camera.forward);
+                    m_paths.origin[i] = camera.p + camera.right * c_sample.x + camera.up * c_sample.y;
+                }
+                else if (camera.aperture > 0.f)
+                {
+                    auto sample1 = float2(Random(m_seed, pixel, m_sample_counter, kCameraLens),
+                        Random(m_seed, pixel, m_sample_counter, kCameraLens + 1));
+                    auto disk = SampleDiskConcentric(sample1);
+                    auto lens_sample = float2(camera.aperture * disk.x, camera.aperture * disk.y);
+                    auto scale = camera.focus_distance / camera.focal_length;
+                    auto camera_dir = float2(c_sample.x * scale - lens_sample.x, c_sample.y * scale - lens_sample.y);
+
+                    m_paths.direction[i] = normalize(camera.forward * camera.focus_distance + camera.right * camera_dir.x + camera.up * camera_dir.y);
+                    m_paths.origin[i] = camera.p + camera.right * lens_sample.x + camera.up * lens_sample.y;
+                }
+                else
+                {
+                    auto d = normalize(camera.forward * camera.focal_length + camera.right * c_sample.x + camera.up * c_sample.y);
+                    m_paths.direction[i] = d;
+                    m_paths.origin[i] = camera.p + d * camera.zcap.x;
+                }
+
+                m_paths.tmax[i] = camera.zcap.y - camera.zcap.x;
+                m_paths.throughput[i] = float3(1.f, 1.f, 1.f);
+                m_paths.pixel[i] = static_cast<int>(i);
+                m_paths.alive[i] = 1;
+            }
+        });
+    }
+
+    void CpuRenderer::IntersectRays(CpuScene const& scene, std::size_t num_paths)
+    {
+        m_thread_pool.ParallelFor(num_paths, kPacketSize, [&](std::size_t begin, std::size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                m_hit_found[i] = !scene.bvh.IsEmpty() &&
+                    scene.bvh.Intersect(m_paths.origin[i], m_paths.direction[i], m_paths.tmax[i], m_hits[i]);
+            }
+        });
+    }
+
+    void CpuRenderer::ShadePaths(CpuScene const& scene, int2 const& output_size,
+        int2 const& tile_origin, int2 const& tile_size,
+        std::size_t num_paths, std::uint32_t bounce)
+    {
+        // Lights sampled explicitly, IBL is accounted for on miss
+        auto num_delta_lights = static_cast<std::uint32_t>(scene.lights.size()) - (scene.envmapidx >= 0 ? 1u : 0u);
+
+        m_thread_pool.ParallelFor(num_paths, kPacketSize, [&](std::size_t begin, std::size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto tile_pixel = m_paths.pixel[i];
+                auto x = tile_origin.x + tile_pixel % tile_size.x;
+                auto y = tile_origin.y + tile_pixel / tile_size.x;
+                auto pixel = static_cast<std::uint32_t>(y * output_size.x + x);
+                auto dimension = kCameraNumDimensions + bounce * kBounceNumDimensions;
+                auto random = [&](std::uint32_t dim)
+                {
+                    return Random(m_seed, pixel, m_sample_counter, dimension + dim);
+                };
+
+                auto const& d = m_paths.direction[i];
+                auto throughput = m_paths.throughput[i];
+
+                m_shadow_rays.contribution[i] = float3();
+                m_paths.alive[i] = 0;
+
+                if (!m_hit_found[i])
+                {
+                    if (bounce == 0 && scene.background)
+                    {
+                        auto uv = float2((x + 0.5f) / output_size.x, (y + 0.5f) / output_size.y);
+                        auto value = SampleTexture(*scene.background, uv);
+                        m_samples[tile_pixel] += throughput * float3(value.x, value.y, value.z);
+                    }
+                    else if (scene.envmapidx >= 0)
+                    {
+                        auto const& ibl = scene.lights[scene.envmapidx];
+                        if (ibl.texture)
+                        {
+                            m_samples[tile_pixel] += throughput * SampleEnvMap(*ibl.texture, d, ibl.mirror_x) * ibl.multiplier;
+                        }
+                    }
+                    continue;
+                }
+
+                auto const& hit = m_hits[i];
+                auto prim = hit.prim;
+                auto const& material = scene.materials[scene.triangle_materials[prim]];
+
+                auto p = m_paths.origin[i] + d * hit.t;
+
+                auto const* v = &scene.vertices[3 * prim];
+                auto const* n = &scene.normals[3 * prim];
+                auto const* t = &scene.uvs[3 * prim];
+                auto w = 1.f - hit.u - hit.v;
+
+                auto ng = normalize(cross(v[1] - v[0], v[2] - v[0]));
+                auto ns = normalize(n[0] * w + n[1] * hit.u + n[2] * hit.v);
+                auto uv = float2(t[0].x * w + t[1].x * hit.u + t[2].x * hit.v,
+                    t[0].y * w + t[1].y * hit.u + t[2].y * hit.v);
+
+                auto front_face = dot(ng, d) < 0.f;
+
+                // Face normals towards the incoming ray
+                if (!front_face)
+                {
+                    ng = -ng;
+                }
+
+                if (dot(ns, ng) < 0.f)
+                {
+                    ns = -ns;
+                }
+
+                // Stochastic pass through transparent surfaces
+                if ((material.layers & UberV2Material::Layers::kTransparencyLayer) && material.transparency)
+                {
+                    auto transparency = EvaluateInputMap(*material.transparency, uv).x;
+                    if (random(kBounceTransparency) < transparency)
+                    {
+                        m_paths.origin[i] = p + d * kRayEpsilon;
+                        m_paths.tmax[i] = m_paths.tmax[i] - hit.t;
+                        m_paths.alive[i] = 1;
+                        continue;
+                    }
+                }
+
+                // Emissive surfaces terminate paths
+                if (material.layers & UberV2Material::Layers::kEmissionLayer)
+                {
+                    if (front_face)
+                    {
+                        m_samples[tile_pixel] += throughput * EvaluateColor(material.emission_color, uv);
+                    }
+                    continue;
+                }
+
+                // Only diffuse reflection is supported
+                if (!(material.layers & UberV2Material::Layers::kDiffuseLayer))
+                {
+                    continue;
+                }
+
+                auto albedo = EvaluateColor(material.diffuse_color, uv);
+                auto offset_p = p + ng * kRayEpsilon;
+
+                // Next event estimation with a single uniformly selected delta light
+                if (num_delta_lights > 0)
+                {
+                    auto light_idx = std::min(static_cast<std::uint32_t>(random(kBounceLightSelect) * num_delta_lights), num_delta_lights - 1);
+                    if (scene.envmapidx >= 0 && light_idx >= static_cast<std::uint32_t>(scene.envmapidx))
+                    {
+                        ++light_idx;
+                    }
+
+                    float3 wo;
+                    float dist = 0.f;
+                    auto le = SampleDeltaLight(scene.lights[light_idx], offset_p, wo, dist);
+                    auto ndotwo = dot(ns, wo);
+
+                    if (ndotwo > 0.f && dot(ng, wo) > 0.f && MaxComponent(le) > 0.f)
+                    {
+                        m_shadow_rays.origin[i] = offset_p;
+                        m_shadow_rays.direction[i] = wo;
+                        m_shadow_rays.tmax[i] = dist - 2.f * kRayEpsilon;
+                        m_shadow_rays.contribution[i] = throughput * albedo * le * (ndotwo * num_delta_lights / PI);
+                    }
+                }
+
+                // Cosine sampling cancels Lambertian BRDF and pdf
+                auto wi = SampleHemisphereCosine(float2(random(kBounceBxdf), random(kBounceBxdf + 1)), ns);
+                if (dot(wi, ng) <= 0.f)
+                {
+                    continue;
+                }
+
+                throughput = throughput * albedo;
+
+                if (bounce >= kRussianRouletteBounce)
+                {
+                    auto q = std::max(0.05f, 1.f - MaxComponent(throughput));
+                    if (random(kBounceRussianRoulette) < q)
+                    {
+                        continue;
+                    }
+                    throughput *= 1.f / (1.f - q);
+                }
+
+                if (MaxComponent(throughput) <= 0.f)
+                {
+                    continue;
+                }
+
+                m_paths.origin[i] = offset_p;
+                m_paths.direction[i] = wi;
+                m_paths.tmax[i] = std::numeric_limits<float>::max();
+                m_paths.throughput[i] = throughput;
+                m_paths.alive[i] = 1;
+            }
+        });
+    }
+
+    void CpuRenderer::TraceShadowRays(CpuScene const& scene, std::size_t num_paths)
+    {
+        m_thread_pool.ParallelFor(num_paths, kPacketSize, [&](std::size_t begin, std::size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto const& contribution = m_shadow_rays.contribution[i];
+                if (MaxComponent(contribution) <= 0.f)
+                {
+                    continue;
+                }
+
+                if (!scene.bvh.Occluded(m_shadow_rays.origin[i], m_shadow_rays.direction[i], m_shadow_rays.tmax[i]))
+                {
+                    m_samples[m_paths.pixel[i]] += contribution;
+                }
+            }
+        });
+    }
+
+    std::size_t CpuRenderer::CompactPaths(std::size_t num_paths)
+    {
+        // Serial stable compaction keeps the order of paths deterministic
+        std::size_t num_alive = 0;
+        for (std::size_t i = 0; i < num_paths; ++i)
+        {
+            if (!m_paths.alive[i])
+            {
+                continue;
+            }
+
+            if (num_alive != i)
+            {
+                m_paths.origin[num_alive] = m_paths.origin[i];
+                m_paths.direction[num_alive] = m_paths.direction[i];
+                m_paths.tmax[num_alive] = m_paths.tmax[i];
+                m_paths.throughput[num_alive] = m_paths.throughput[i];
+                m_paths.pixel[num_alive] = m_paths.pixel[i];
+                m_paths.alive[num_alive] = 1;
+            }
+
+            ++num_alive;
+        }
+
+        return num_alive;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "math/float3.h"
+#include "math/int2.h"
+#include "renderer.h"
+
+#include "SceneGraph/cpuscene.h"
+#include "Utils/cpu_bvh.h"
+#include "Utils/thread_pool.h"
+
+#include <vector>
+
+
+namespace Baikal
+{
+    ///< Reference path tracer running on the host.
+    ///< Paths of a tile are processed as a wavefront: every stage (intersection,
+    ///< shading, occlusion) runs over all active paths in packets distributed
+    ///< over a work stealing thread pool, terminated paths are compacted between
+    ///< bounces. Random numbers depend on seed, pixel, frame and bounce only,
+    ///< so the result does not depend on the number of threads.
+    class CpuRenderer : public SceneRenderer<CpuScene>
+    {
+    public:
+        // num_threads == 0 means hardware concurrency
+        explicit CpuRenderer(std::uint32_t num_threads = 0);
+
+        ~CpuRenderer() = default;
+
+        // Renderer overrides
+        void Clear(RadeonRays::float3 const& val,
+                   Output& output) const override;
+
+        // Render the scene into the output
+        void Render(CpuScene const& scene) override;
+
+        // Render single tile
+        void RenderTile(CpuScene const& scene,
+                        RadeonRays::int2 const& tile_origin,
+                        RadeonRays::int2 const& tile_size) override;
+
+        void SetRandomSeed(std::uint32_t seed) override;
+
+        // Set max number of bounces per path
+        void SetMaxBounces(std::uint32_t max_bounces);
+
+        std::uint32_t GetNumThreads() const { return m_thread_pool.GetNumThreads(); }
+
+    private:
+        // Path state stored as structure of arrays
+        struct Paths
+        {
+            std::vector<RadeonRays::float3> origin;
+            std::vector<RadeonRays::float3> direction;
+            std::vector<float> tmax;
+            std::vector<RadeonRays::float3> throughput;
+            // Pixel index within the tile
+            std::vector<int> pixel;
+            std::vector<char> alive;
+
+            void Resize(std::size_t size);
+        };
+
+        // Shadow rays, at most one per path
+        struct ShadowRays
+        {
+            std::vector<RadeonRays::float3> origin;
+            std::vector<RadeonRays::float3> direction;
+            std::vector<float> tmax;
+            // Contribution added if the ray is not occluded
+            std::vector<RadeonRays::float3> contribution;
+
+            void Resize(std::size_t size);
+        };
+
+        // Generate primary rays for the tile
+        void GeneratePrimaryRays(CpuScene const& scene, RadeonRays::int2 const& output_size,
+            RadeonRays::int2 const& tile_origin, RadeonRays::int2 const& tile_size);
+        // Find closest hits of active paths
+        void IntersectRays(CpuScene const& scene, std::size_t num_paths);
+        // Shade hits and misses, generate next and shadow rays
+        void ShadePaths(CpuScene const& scene, RadeonRays::int2 const& output_size,
+            RadeonRays::int2 const& tile_origin, RadeonRays::int2 const& tile_size,
+            std::size_t num_paths, std::uint32_t bounce);
+        // Add light contribution of unoccluded shadow rays
+        void TraceShadowRays(CpuScene const& scene, std::size_t num_paths);
+        // Move alive paths to the front, returns number of alive paths
+        std::size_t CompactPaths(std::size_t num_paths);
+
+        ThreadPool m_thread_pool;
+
+        Paths m_paths;
+        ShadowRays m_shadow_rays;
+        std::vector<CpuBvh::Hit> m_hits;
+        std::vector<char> m_hit_found;
+        // Radiance of current frame per pixel of the tile
+        std::vector<RadeonRays::float3> m_samples;
+
+        std::uint32_t m_max_bounces;
+        std::uint32_t m_seed;
+        mutable std::uint32_t m_sample_counter;
+    };
+}
@@ -64,14 +64,44 @@ namespace Baikal
         , m_estimator(std::move(estimator))
         , m_sample_counter(0u)
         , m_uberv2_kernels(context, program_manager, "../Baikal/Kernels/CL/fill_aovs_uberv2.cl", "")
+        , m_aov_scene_revision(0)
+        , m_aov_outputs_stale(true)
     {
         m_estimator->SetWorkBufferSize(kTileSizeX * kTileSizeY);
+
+        // Camera kernels generating samples at pixel centers for AOVs
+        AddProgramVariant("-D BAIKAL_GENERATE_SAMPLE_AT_PIXEL_CENTER ");
     }
 
     void MonteCarloRenderer::Clear(RadeonRays::float3 const& val, Output& output) const
     {
         static_cast<ClwOutput&>(output).Clear(val);
         m_sample_counter = 0u;
+
+        // Accumulated AOVs are gone
+        if (&output != GetOutput(OutputType::kColor))
+        {
+            InvalidateAOVs();
+        }
+    }
+
+    void MonteCarloRenderer::InvalidateAOVs() const
+    {
+        m_aov_tiles.clear();
+        m_aov_outputs_stale = true;
+    }
+
+    void MonteCarloRenderer::ClearAOVs() const
+    {
+        for (auto i = 1U; i < static_cast<std::uint32_t>(Renderer::OutputType::kVisibility); ++i)
+        {
+            if (auto aov = static_cast<ClwOutput*>(GetOutput(static_cast<Renderer::OutputType>(i))))
+            {
+                aov->Clear(RadeonRays::float3());
+            }
+        }
+
+        m_aov_outputs_stale = false;
     }
 
     void MonteCarloRenderer::Render(ClwScene const& scene)
@@ -92,6 +122,11 @@ namespace Baikal
 
         auto output_size = int2(output->width(), output->height());
 
+        if (GetProfiler())
+        {
+            GetProfiler()->BeginFrame();
+        }
+
         if (output_size.x > kTileSizeX || output_size.y > kTileSizeY)
         {
             auto num_tiles_x = (output_size.x + kTileSizeX - 1) / kTileSizeX;
@@ -147,7 +182,15 @@ namespace Baikal
                     scene,
                     num_rays,
                     Estimator::QualityLevel::kStandard,
-                    output->data());
+                    output->data(),
+                    true,
+                    false,
+                    nullptr,
+                    [this, &scene, output, num_rays](CLWBuffer<int> output_indices, CLWBuffer<int> num_pixels,
+                        std::uint32_t sample_index, CLWBuffer<ray> rays)
+                    {
+                        GeneratePrimaryRays(scene, *output, num_rays, output_indices, num_pixels, sample_index, rays);
+                    });
 
         }
 
@@ -155,8 +198,7 @@ namespace Baikal
         bool aov_pass_needed = (FindFirstNonZeroOutput(false) != nullptr);
         if (aov_pass_needed)
         {
-            FillAOVs(scene, tile_origin, tile_size);
-            GetContext().Flush(0);
+            UpdateAOVs(scene, tile_origin, tile_size);
         }
     }
 
@@ -189,7 +231,7 @@ namespace Baikal
             size_t gs[] = { static_cast<size_t>((tile_size.x + 15) / 16 * 16), static_cast<size_t>((tile_size.y + 15) / 16 * 16) };
             size_t ls[] = { 16, 16 };
 
-            GetContext().Launch2D(0, gs, ls, generate_kernel);
+            Launch2D("GenerateTileDomain", gs, ls, generate_kernel);
         }
     }
 
@@ -227,9 +269,39 @@ namespace Baikal
             m_estimator->SetIntermediateValueBuffer(Estimator::IntermediateValue::kVisibility, clw_output->data());
         }
 
+        // Newly attached AOVs have to be filled
+        if (type != OutputType::kColor && type != OutputType::kVisibility)
+        {
+            InvalidateAOVs();
+        }
+
         Renderer::SetOutput(type, output);
     }
 
+    void MonteCarloRenderer::UpdateAOVs(ClwScene const& scene, int2 const& tile_origin, int2 const& tile_size)
+    {
+        // Revisions are unique across scenes, so the scene address is not needed
+        if (scene.revision != m_aov_scene_revision)
+        {
+            InvalidateAOVs();
+            m_aov_scene_revision = scene.revision;
+        }
+
+        // AOVs are accumulated, so samples of the previous revision have to go
+        if (m_aov_outputs_stale)
+        {
+            ClearAOVs();
+        }
+
+        if (!m_aov_tiles.insert({ { tile_origin.x, tile_origin.y, tile_size.x, tile_size.y } }).second)
+        {
+            return;
+        }
+
+        FillAOVs(scene, tile_origin, tile_size);
+        GetContext().Flush(0);
+    }
+
 
     void MonteCarloRenderer::FillAOVs(ClwScene const& scene, int2 const& tile_origin, int2 const& tile_size)
     {
@@ -263,6 +335,7 @@ namespace Baikal
         fill_kernel.SetArg(argc++, scene.material_attributes);
         fill_kernel.SetArg(argc++, scene.textures);
         fill_kernel.SetArg(argc++, scene.texturedata);
+        fill_kernel.SetArg(argc++, scene.texture_feedback);
         fill_kernel.SetArg(argc++, scene.envmapidx);
         fill_kernel.SetArg(argc++, scene.lights);
         fill_kernel.SetArg(argc++, scene.num_lights);
@@ -289,7 +362,7 @@ namespace Baikal
         // Run AOV kernel
         {
             int globalsize = tile_size.x * tile_size.y;
-            GetContext().Launch1D(0, ((globalsize + 63) / 64) * 64, 64, fill_kernel);
+            Launch1D("FillAOVsUberV2", ((globalsize + 63) / 64) * 64, 64, fill_kernel);
         }
     }
     
@@ -314,6 +387,28 @@ namespace Baikal
         int2 const& tile_size,
         bool generate_at_pixel_center
     )
+    {
+        GeneratePrimaryRays(
+            scene,
+            output,
+            tile_size.x * tile_size.y,
+            m_estimator->GetOutputIndexBuffer(),
+            m_estimator->GetRayCountBuffer(),
+            m_sample_counter,
+            m_estimator->GetRayBuffer(),
+            generate_at_pixel_center);
+    }
+
+    void MonteCarloRenderer::GeneratePrimaryRays(
+        ClwScene const& scene,
+        Output const& output,
+        std::size_t max_rays,
+        CLWBuffer<int> output_indices,
+        CLWBuffer<int> num_rays,
+        std::uint32_t frame,
+        CLWBuffer<ray> rays,
+        bool generate_at_pixel_center
+    )
     {
         // Fetch kernel
         auto kernel_name = GetCameraKernelName(scene.camera_type);
@@ -324,17 +419,16 @@ namespace Baikal
         genkernel.SetArg(argc++, scene.camera);
         genkernel.SetArg(argc++, output.width());
         genkernel.SetArg(argc++, output.height());
-        genkernel.SetArg(argc++, m_estimator->GetOutputIndexBuffer());
-        genkernel.SetArg(argc++, m_estimator->GetRayCountBuffer());
+        genkernel.SetArg(argc++, output_indices);
+        genkernel.SetArg(argc++, num_rays);
         genkernel.SetArg(argc++, (int)rand_uint());
-        genkernel.SetArg(argc++, m_sample_counter);
-        genkernel.SetArg(argc++, m_estimator->GetRayBuffer());
+        genkernel.SetArg(argc++, frame);
+        genkernel.SetArg(argc++, rays);
         genkernel.SetArg(argc++, m_estimator->GetRandomBuffer(Estimator::RandomBufferType::kRandomSeed));
         genkernel.SetArg(argc++, m_estimator->GetRandomBuffer(Estimator::RandomBufferType::kSobolLUT));
 
         {
-            int globalsize = tile_size.x * tile_size.y;
-            GetContext().Launch1D(0, ((globalsize + 63) / 64) * 64, 64, genkernel);
+            Launch1D(kernel_name, ((max_rays + 63) / 64) * 64, 64, genkernel);
         }
     }
 
@@ -348,11 +442,22 @@ namespace Baikal
         return GetKernel("AccumulateData");
     }
 
+    CLWKernel MonteCarloRenderer::GetConvertKernel()
+    {
+        return GetKernel("ConvertOutputData");
+    }
+
     void MonteCarloRenderer::SetRandomSeed(std::uint32_t seed)
     {
         m_estimator->SetRandomSeed(seed);
     }
 
+    void MonteCarloRenderer::SetProfiler(std::shared_ptr<ClwProfiler> profiler)
+    {
+        ClwClass::SetProfiler(profiler);
+        m_estimator->SetProfiler(profiler);
+    }
+
     void MonteCarloRenderer::Benchmark(ClwScene const& scene, Estimator::RayTracingStats& stats)
     {
         auto output = static_cast<ClwOutput*>(GetOutput(OutputType::kColor));
@@ -390,10 +495,11 @@ namespace Baikal
         misskernel.SetArg(argc++, h);
         misskernel.SetArg(argc++, scene.textures);
         misskernel.SetArg(argc++, scene.texturedata);
+        misskernel.SetArg(argc++, scene.texture_feedback);
         misskernel.SetArg(argc++, output);
 
         {
-            GetContext().Launch1D(0, ((size + 63) / 64) * 64, 64, misskernel);
+            Launch1D("ShadeBackgroundImage", ((size + 63) / 64) * 64, 64, misskernel);
         }
     }
     
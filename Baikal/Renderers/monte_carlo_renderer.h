@@ -31,7 +31,9 @@ THE SOFTWARE.
 
 #include "CLW.h"
 
+#include <array>
 #include <memory>
+#include <set>
 
 
 namespace Baikal
@@ -41,7 +43,7 @@ namespace Baikal
     class CLProgramManager;
 
     ///< Renderer implementation
-    class MonteCarloRenderer : public Renderer, protected ClwClass
+    class MonteCarloRenderer : public ClwRenderer, protected ClwClass
     {
     public:
 
@@ -70,15 +72,25 @@ namespace Baikal
 
         void SetRandomSeed(std::uint32_t seed) override;
 
+        // Set profiler for kernel timings and memory accounting, passed to the estimator as well
+        void SetProfiler(std::shared_ptr<ClwProfiler> profiler) override;
+
         // Interop function
         CLWKernel GetCopyKernel();
         // Add function
         CLWKernel GetAccumulateKernel();
+        // Readback conversion function (see ClwOutput::ReadDataAsync)
+        CLWKernel GetConvertKernel();
         // Run render benchmark
         void Benchmark(ClwScene const& scene, Estimator::RayTracingStats& stats);
 
         // Set max number of light bounces
         void SetMaxBounces(std::uint32_t max_bounces);
+
+        // AOVs other than visibility are generated at pixel centers and do not change
+        // while the scene stays the same, so they are filled once per scene revision.
+        // Forces AOVs to be cleared and filled again on the next render.
+        void InvalidateAOVs() const;
         
     protected:
         void GeneratePrimaryRays(
@@ -88,12 +100,34 @@ namespace Baikal
             bool generate_at_pixel_center = false
         );
 
+        // Generate camera rays for a list of output indices into a ray buffer
+        void GeneratePrimaryRays(
+            ClwScene const& scene,
+            Output const& output,
+            std::size_t max_rays,
+            CLWBuffer<int> output_indices,
+            CLWBuffer<int> num_rays,
+            std::uint32_t frame,
+            CLWBuffer<ray> rays,
+            bool generate_at_pixel_center = false
+        );
+
         void FillAOVs(
             ClwScene const& scene, 
             int2 const& tile_origin,
             int2 const& tile_size
         );
 
+        // Clear all attached AOV outputs except visibility
+        void ClearAOVs() const;
+
+        // Fill AOVs of the tile unless they are up to date
+        void UpdateAOVs(
+            ClwScene const& scene,
+            int2 const& tile_origin,
+            int2 const& tile_size
+        );
+
         virtual void GenerateTileDomain(
             int2 const& output_size,
             int2 const& tile_origin,
@@ -116,6 +150,13 @@ namespace Baikal
 
     private:
         ClwClass m_uberv2_kernels;
+
+        // Scene revision AOVs have been filled for
+        std::uint64_t m_aov_scene_revision;
+        // Tiles (origin and size) with up to date AOVs
+        mutable std::set<std::array<int, 4>> m_aov_tiles;
+        // AOV outputs contain samples of an outdated revision
+        mutable bool m_aov_outputs_stale;
     };
 
 }
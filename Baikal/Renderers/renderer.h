@@ -44,7 +44,8 @@ namespace Baikal
      \brief Interface for the renderer.
 
      Renderer implemenation is taking the scene and producing its image into
-     an output surface.
+     an output surface. Scene dependent part of the interface is declared
+     by SceneRenderer.
      */
     class Renderer
     {
@@ -80,24 +81,6 @@ namespace Baikal
         virtual 
         void Clear(RadeonRays::float3 const& val, Output& output) const = 0;
 
-        /**
-         \brief Render single iteration.
-
-         \param scene Scene to render
-         */
-        virtual
-        void Render(ClwScene const& scene) = 0;
-
-        /**
-        \brief Render single iteration.
-
-        \param scene Scene to render
-        */
-        virtual
-        void RenderTile(ClwScene const& scene,
-            RadeonRays::int2 const& tile_origin,
-            RadeonRays::int2 const& tile_size) = 0;
-
         /**
          \brief Set the output for rendering.
 
@@ -131,6 +114,34 @@ namespace Baikal
             m_outputs;
     };
 
+    /**
+     \brief Renderer consuming scenes compiled by SceneController<CompiledScene>.
+     */
+    template <typename CompiledScene>
+    class SceneRenderer : public Renderer
+    {
+    public:
+        /**
+         \brief Render single iteration.
+
+         \param scene Scene to render
+         */
+        virtual
+        void Render(CompiledScene const& scene) = 0;
+
+        /**
+        \brief Render single iteration.
+
+        \param scene Scene to render
+        */
+        virtual
+        void RenderTile(CompiledScene const& scene,
+            RadeonRays::int2 const& tile_origin,
+            RadeonRays::int2 const& tile_size) = 0;
+    };
+
+    using ClwRenderer = SceneRenderer<ClwScene>;
+
     inline Renderer::Renderer()
     {
         std::fill(m_outputs.begin(), m_outputs.end(), nullptr);
@@ -1,154 +1,316 @@
 #include "collector.h"
-#include "SceneGraph/clwscene.h"
 #include "SceneGraph/iterator.h"
 #include <vector>
 #include <cassert>
-#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
 
 namespace Baikal
 {
-    struct IdCompare
+    /**
+     \brief Open addressing hash map from object ID to item index.
+
+     Linear probing over a power of two table, IDs are never removed
+     individually so no tombstones are needed.
+     */
+    class ItemIndexMap
     {
-        bool operator() (const SceneObject::Ptr& lhs, const SceneObject::Ptr& rhs) const
+    public:
+        static std::uint32_t constexpr kInvalidIndex = std::numeric_limits<std::uint32_t>::max();
+
+        // Remove all entries keeping the storage
+        void Clear()
         {
-            return lhs->GetId() < rhs->GetId();
+            std::fill(m_slots.begin(), m_slots.end(), Slot{ kEmptyId, kInvalidIndex });
+            m_size = 0;
+        }
+
+        // Make sure num_items entries fit without rehashing
+        void Reserve(std::size_t num_items)
+        {
+            // Keep load factor at or below 0.5
+            if (num_items * 2 > m_slots.size())
+            {
+                Rehash(num_items * 2);
+            }
         }
+
+        // Insert id -> index if id is not in the map, returns index stored for the id
+        std::uint32_t Insert(std::uint32_t id, std::uint32_t index)
+        {
+            Reserve(m_size + 1);
+
+            auto slot = FindSlot(id);
+            if (slot->id == kEmptyId)
+            {
+                slot->id = id;
+                slot->index = index;
+                ++m_size;
+            }
+
+            return slot->index;
+        }
+
+        // Find index of the id, kInvalidIndex if not found
+        std::uint32_t Find(std::uint32_t id) const
+        {
+            if (m_slots.empty())
+            {
+                return kInvalidIndex;
+            }
+
+            return FindSlot(id)->index;
+        }
+
+    private:
+        static std::uint32_t constexpr kEmptyId = std::numeric_limits<std::uint32_t>::max();
+
+        struct Slot
+        {
+            std::uint32_t id;
+            std::uint32_t index;
+        };
+
+        // Fibonacci hashing: high bits of the product depend on all bits of the id,
+        // so IDs with power of two strides do not pile up in the same slots
+        std::size_t Hash(std::uint32_t id) const
+        {
+            return static_cast<std::size_t>((id * 2654435769u) >> m_shift);
+        }
+
+        Slot const* FindSlot(std::uint32_t id) const
+        {
+            auto mask = m_slots.size() - 1;
+            auto pos = Hash(id);
+
+            while (m_slots[pos].id != id && m_slots[pos].id != kEmptyId)
+            {
+                pos = (pos + 1) & mask;
+            }
+
+            return &m_slots[pos];
+        }
+
+        Slot* FindSlot(std::uint32_t id)
+        {
+            return const_cast<Slot*>(static_cast<ItemIndexMap const*>(this)->FindSlot(id));
+        }
+
+        void Rehash(std::size_t min_size)
+        {
+            std::size_t size = 16;
+            std::uint32_t log2_size = 4;
+            while (size < min_size)
+            {
+                size <<= 1;
+                ++log2_size;
+            }
+
+            m_shift = 32 - log2_size;
+
+            std::vector<Slot> slots(size, Slot{ kEmptyId, kInvalidIndex });
+            std::swap(slots, m_slots);
+
+            for (auto const& slot : slots)
+            {
+                if (slot.id != kEmptyId)
+                {
+                    *FindSlot(slot.id) = slot;
+                }
+            }
+        }
+
+        std::vector<Slot> m_slots;
+        std::size_t m_size = 0;
+        // 32 - log2 of the table size
+        std::uint32_t m_shift = 32;
     };
-    using ItemMap = std::unordered_map<uint32_t, int>;
-    using ItemSet = std::set<SceneObject::Ptr, IdCompare>;
-    
+
+    using ItemArray = std::vector<SceneObject::Ptr>;
+
     class BundleImpl : public Bundle
     {
     public:
-        BundleImpl(ItemMap const& map, ItemSet const& set)
-        : m_map(map)
-        , m_set(set)
+        BundleImpl(ItemArray const& items)
         {
+            m_ids.reserve(items.size());
+            for (auto const& item : items)
+            {
+                m_ids.push_back(item->GetId());
+            }
         }
-        
-        ItemMap m_map;
-        ItemSet m_set;
+
+        // IDs of serialized objects in item index order
+        std::vector<std::uint32_t> m_ids;
     };
-    
+
     struct Collector::CollectorImpl
     {
-        ItemMap m_map;
-        ItemSet m_set;
+        ItemIndexMap m_map;
+        ItemArray m_items;
+        // Indices in the map are final only after Commit
+        bool m_committed = false;
     };
-    
+
     Collector::Collector()
     : m_impl (new CollectorImpl)
     {
     }
-    
+
     Collector::~Collector() = default;
-    
+
     void Collector::Clear()
     {
-        m_impl->m_map.clear();
-        m_impl->m_set.clear();
+        m_impl->m_map.Clear();
+        m_impl->m_items.clear();
+        m_impl->m_committed = false;
     }
-    
+
     std::unique_ptr<Iterator> Collector::CreateIterator() const
     {
         return std::unique_ptr<Iterator>(
-            new IteratorImpl<ItemSet::const_iterator>(m_impl->m_set.cbegin(),
-                                                      m_impl->m_set.cend()));
+            new IteratorImpl<ItemArray::const_iterator>(m_impl->m_items.cbegin(),
+                                                        m_impl->m_items.cend()));
     }
-    
+
     void Collector::Collect(Iterator& iter, ExpandFunc expand_func)
     {
         for(;iter.IsValid(); iter.Next())
         {
             // Expand current item
             auto cur_items = expand_func(iter.Item());
-            
+
             // Insert items
-            m_impl->m_set.insert(cur_items.cbegin(), cur_items.cend());
+            for (auto& item : cur_items)
+            {
+                Collect(item);
+            }
         }
     }
 
     void Collector::Collect(std::shared_ptr < Baikal::SceneObject > object)
     {
-        m_impl->m_set.insert(object);
+        auto index = static_cast<std::uint32_t>(m_impl->m_items.size());
+
+        if (m_impl->m_map.Insert(object->GetId(), index) == index)
+        {
+            m_impl->m_items.push_back(object);
+            m_impl->m_committed = false;
+        }
+    }
+
+    void Collector::Reserve(std::size_t num_items)
+    {
+        m_impl->m_map.Reserve(num_items);
+        m_impl->m_items.reserve(num_items);
     }
 
     void Collector::Commit()
     {
-        m_impl->m_map.clear();
-        
-        int idx = 0;
-        for (auto& i : m_impl->m_set)
+        auto& items = m_impl->m_items;
+
+        // Order by ID to get the same indices regardless of collection order
+        std::sort(items.begin(), items.end(), [](SceneObject::Ptr const& lhs, SceneObject::Ptr const& rhs)
         {
-            m_impl->m_map[i->GetId()] = idx++;
+            return lhs->GetId() < rhs->GetId();
+        });
+
+        m_impl->m_map.Clear();
+
+        for (auto i = 0u; i < items.size(); ++i)
+        {
+            m_impl->m_map.Insert(items[i]->GetId(), i);
         }
+
+        m_impl->m_committed = true;
     }
-    
+
     void Collector::Finalize(FinalizeFunc finalize_func)
     {
-        for (auto& i : m_impl->m_set)
+        for (auto& i : m_impl->m_items)
         {
             finalize_func(i);
         }
     }
-    
+
     bool Collector::NeedsUpdate(Bundle const* bundle, ChangedFunc changed_func) const
     {
         auto bundle_impl = static_cast<BundleImpl const*>(bundle);
-        
+        auto const& items = m_impl->m_items;
+
         // Check if:
-        // 0) bundle and our map sizes match.
+        // 0) bundle and our array sizes match.
         // 1) All the objects collector has are in the bundle.
         // 2) They have not changed.
-        if (bundle_impl->m_set.size() != m_impl->m_set.size())
+        if (bundle_impl->m_ids.size() != items.size())
         {
             return true;
         }
-        
-        for (auto& i : m_impl->m_set)
+
+        for (auto i = 0u; i < items.size(); ++i)
         {
-            if (changed_func(i))
+            // Both are ordered by ID, so same sets have same IDs at same positions
+            if (bundle_impl->m_ids[i] != items[i]->GetId() || changed_func(items[i]))
             {
-                // Case 2: we have the object which is changed.
                 return true;
             }
-            
-            auto iter = bundle_impl->m_set.find(i);
-            
-            if (iter == bundle_impl->m_set.cend())
+        }
+
+        return false;
+    }
+
+    bool Collector::NeedsUpdate(Bundle const* bundle) const
+    {
+        auto bundle_impl = static_cast<BundleImpl const*>(bundle);
+        auto const& items = m_impl->m_items;
+
+        if (bundle_impl->m_ids.size() != items.size())
+        {
+            return true;
+        }
+
+        for (auto i = 0u; i < items.size(); ++i)
+        {
+            if (bundle_impl->m_ids[i] != items[i]->GetId() || items[i]->IsDirty())
             {
-                // Case 1: we have an object which is not serialized as a part of bundle.
                 return true;
             }
-
-            // Here we know that bundle_impl->m_map[i] == m_impl->m_map[i]
-            // since it is defined by set traversal order.
         }
-        
+
         return false;
     }
-    
+
     std::size_t Collector::GetNumItems() const
     {
-        return m_impl->m_set.size();
+        return m_impl->m_items.size();
     }
-    
+
     Bundle* Collector::CreateBundle() const
     {
-        return new BundleImpl { m_impl->m_map, m_impl->m_set };
+        return new BundleImpl(m_impl->m_items);
     }
-    
+
     std::uint32_t Collector::GetItemIndex(SceneObject::Ptr item) const
     {
-        auto iter = m_impl->m_map.find(item->GetId());
-        
-        if (iter == m_impl->m_map.cend())
+        // Until Commit the map holds collection order, not final indices
+        if (!m_impl->m_committed)
+        {
+            throw std::runtime_error("Collector has not been committed");
+        }
+
+        auto index = m_impl->m_map.Find(item->GetId());
+
+        if (index == ItemIndexMap::kInvalidIndex)
         {
             throw std::runtime_error("No such item in the collector");
         }
-        
-        return iter->second;
+
+        return index;
+    }
+
+    bool Collector::Contains(SceneObject::Ptr item) const
+    {
+        return m_impl->m_map.Find(item->GetId()) != ItemIndexMap::kInvalidIndex;
     }
-    
-    
 }
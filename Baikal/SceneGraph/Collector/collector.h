@@ -33,6 +33,7 @@
 #include <functional>
 
 #include "../scene_object.h"
+#include "../iterator.h"
 
 
 namespace Baikal
@@ -56,6 +57,10 @@ namespace Baikal
 
      Collector iterates over collection of objects collecting objects and their dependecies into random access bundle.
      The engine uses collectors in order to resolve material-texture or shape-material dependecies for GPU serialization.
+
+     Objects are kept in a flat array indexed by an open addressing hash of object IDs. After Commit the array
+     is ordered by ID, which is the creation order of objects, so item indices do not depend on memory layout
+     and are the same from run to run.
      */
     class Collector
     {
@@ -75,20 +80,30 @@ namespace Baikal
         std::unique_ptr<Iterator> CreateIterator() const;
         // Collect objects and their dependencies
         void Collect(Iterator& iter, ExpandFunc expand_func);
+        // Collect objects and their dependencies: expand_func(item, collector) adds
+        // dependencies of the item using Collect(object), no intermediate sets are created
+        template <typename ExpandIntoFunc>
+        void CollectInto(Iterator& iter, ExpandIntoFunc expand_func);
         // Adds single object to collection
         void Collect(std::shared_ptr<Baikal::SceneObject> object);
+        // Reserve space for the given number of objects
+        void Reserve(std::size_t num_items);
         // Commit collected objects
         void Commit();
         // Commit collected objects with order based on object id.
         //void CommitOrderedById();
         // Given a budnle check if all collected objects are in the bundle and do not require update
         bool NeedsUpdate(Bundle const* bundle, ChangedFunc cahnged_func) const;
+        // Same as above using SceneObject::IsDirty as the change test
+        bool NeedsUpdate(Bundle const* bundle) const;
         // Get number of objects in the collection
         std::size_t GetNumItems() const;
         // Create serialised bundle (randomly accessible dump of objects)
         Bundle* CreateBundle() const;
         // Get item index within a collection
         std::uint32_t GetItemIndex(SceneObject::Ptr item) const;
+        // Check if the item is in the collection
+        bool Contains(SceneObject::Ptr item) const;
         // Finalization function
         void Finalize(FinalizeFunc finalize_func);
 
@@ -104,6 +119,15 @@ namespace Baikal
     inline Bundle::~Bundle()
     {
     }
+
+    template <typename ExpandIntoFunc>
+    inline void Collector::CollectInto(Iterator& iter, ExpandIntoFunc expand_func)
+    {
+        for (; iter.IsValid(); iter.Next())
+        {
+            expand_func(iter.Item(), *this);
+        }
+    }
 }
 
 
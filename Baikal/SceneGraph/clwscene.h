@@ -3,9 +3,13 @@
 #include "CLW.h"
 //#include "math/float3.h"
 #include "SceneGraph/scene1.h"
+#include "SceneGraph/texture.h"
 #include "radeon_rays.h"
 #include "SceneGraph/Collector/collector.h"
 
+#include <unordered_map>
+#include <vector>
+
 
 namespace Baikal
 {
@@ -54,7 +58,54 @@ namespace Baikal
         int camera_volume_index;
         CameraType camera_type;
 
+        // Set by SceneController to a unique value every time compiled data changes
+        std::uint64_t revision = 0;
+
         std::vector<RadeonRays::Shape*> isect_shapes;
         std::vector<RadeonRays::Shape*> visible_shapes;
+
+        // Host copies of the data last uploaded into GPU buffers,
+        // used to find and upload changed ranges only.
+        std::vector<Shape> shapes_host;
+        std::vector<std::int32_t> material_attributes_host;
+        std::vector<Light> lights_host;
+        std::vector<int> light_distributions_host;
+        std::vector<Texture> textures_host;
+        std::vector<InputMapInstruction> input_map_data_host;
+        // Serialized input map leafs and bytecode (empty if input maps are compiled into kernels),
+        // combined into input_map_data
+        std::vector<InputMapInstruction> input_map_leafs;
+        std::vector<InputMapInstruction> input_map_bytecode;
+        // Serialized environment map sampling distribution (appended to light_distributions)
+        // and ID of the texture it has been built from
+        std::vector<int> env_distribution;
+        std::uint32_t env_distribution_texture = ~0u;
+        // Texture ID -> offset in texturedata buffer
+        std::unordered_map<std::uint32_t, std::size_t> texturedata_offsets;
+
+        // Single tile of a mip level of tiled texture
+        struct TexturePage
+        {
+            // Index of the texture in textures buffer
+            int texture;
+            // Mip level and tile coordinates within the level
+            int level;
+            int x;
+            int y;
+            // Offset of page table entry in texturedata buffer
+            std::size_t entry_offset;
+            // Offset of tile data in texturedata buffer (-1 if not resident)
+            int data_offset;
+        };
+
+        // Tiled texture pool bookkeeping (empty for linear textures):
+        // kernels set feedback[page] for missing tiles, which are then streamed into the pool.
+        CLWBuffer<int> texture_feedback;
+        std::vector<TexturePage> texture_pages;
+        std::vector<Baikal::Texture::Ptr> texture_pool_textures;
+        // Range of texturedata buffer used for tiles
+        std::size_t texture_pool_begin = 0;
+        std::size_t texture_pool_end = 0;
+        std::size_t texture_pool_used = 0;
     };
 }
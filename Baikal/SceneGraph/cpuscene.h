@@ -0,0 +1,120 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#pragma once
+
+#include "math/float2.h"
+#include "math/float3.h"
+
+#include "SceneGraph/inputmap.h"
+#include "SceneGraph/texture.h"
+#include "SceneGraph/Collector/collector.h"
+#include "Utils/cpu_bvh.h"
+
+#include <memory>
+#include <vector>
+
+namespace Baikal
+{
+    /**
+     \brief Scene representation consumed by CPU backend.
+
+     Geometry is flattened into world space triangles, materials keep references
+     to input maps of the scene graph, which are evaluated at hit points.
+     */
+    struct CpuScene
+    {
+        enum class LightType
+        {
+            kPoint,
+            kDirectional,
+            kSpot,
+            kIbl
+        };
+
+        struct Light
+        {
+            LightType type;
+            RadeonRays::float3 p;
+            RadeonRays::float3 d;
+            RadeonRays::float3 intensity;
+            // Spot light cone (cosines of inner and outer angles)
+            float ia;
+            float oa;
+            // Image based light
+            Texture::Ptr texture;
+            float multiplier;
+            bool mirror_x;
+        };
+
+        // Supported subset of UberV2 material
+        struct Material
+        {
+            std::uint32_t layers;
+            InputMap::Ptr diffuse_color;
+            InputMap::Ptr emission_color;
+            InputMap::Ptr transparency;
+        };
+
+        struct Camera
+        {
+            RadeonRays::float3 forward;
+            RadeonRays::float3 up;
+            RadeonRays::float3 right;
+            RadeonRays::float3 p;
+            RadeonRays::float2 dim;
+            RadeonRays::float2 zcap;
+            float aspect_ratio;
+            float aperture;
+            float focal_length;
+            float focus_distance;
+            bool orthographic;
+        };
+
+        // World space triangles, 3 entries per triangle
+        std::vector<RadeonRays::float3> vertices;
+        std::vector<RadeonRays::float3> normals;
+        std::vector<RadeonRays::float2> uvs;
+        // Per triangle material index and shape ID
+        std::vector<int> triangle_materials;
+        std::vector<int> triangle_shape_ids;
+
+        CpuBvh bvh;
+
+        std::vector<Material> materials;
+        std::vector<Light> lights;
+        // Index of image based light in lights (-1 if none)
+        int envmapidx = -1;
+        // Background image override
+        Texture::Ptr background;
+
+        Camera camera;
+
+        // Set by SceneController to a unique value every time compiled data changes
+        std::uint64_t revision = 0;
+
+        std::unique_ptr<Bundle> material_bundle;
+        std::unique_ptr<Bundle> volume_bundle;
+        std::unique_ptr<Bundle> texture_bundle;
+        std::unique_ptr<Bundle> input_map_leafs_bundle;
+        std::unique_ptr<Bundle> input_map_bundle;
+    };
+}
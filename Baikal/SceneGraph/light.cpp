@@ -2,6 +2,10 @@
 #include "SceneGraph/scene1.h"
 #include "SceneGraph/texture.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 namespace Baikal
 {
     AreaLight::AreaLight(Shape::Ptr shape, std::size_t idx)
@@ -259,6 +263,105 @@ namespace Baikal
         return PI * GetEmittedRadiance() * area;
     }
     
+    EmissiveMeshLight::EmissiveMeshLight(Shape::Ptr shape)
+        : m_shape(shape)
+        , m_area(0.f)
+        , m_mesh_revision(0)
+    {
+    }
+
+    Shape::Ptr EmissiveMeshLight::GetShape() const
+    {
+        return m_shape;
+    }
+
+    Mesh::Ptr EmissiveMeshLight::GetMesh() const
+    {
+        auto instance = std::dynamic_pointer_cast<Instance>(m_shape);
+        return std::static_pointer_cast<Mesh>(instance ? instance->GetBaseShape() : m_shape);
+    }
+
+    bool EmissiveMeshLight::IsDirty() const
+    {
+        return Light::IsDirty() || m_shape->IsDirty() || GetMesh()->IsDirty();
+    }
+
+    Distribution1D const& EmissiveMeshLight::GetPrimitiveDistribution() const
+    {
+        UpdatePrimitiveDistribution();
+        return m_distribution;
+    }
+
+    float EmissiveMeshLight::GetArea() const
+    {
+        UpdatePrimitiveDistribution();
+        return m_area;
+    }
+
+    void EmissiveMeshLight::UpdatePrimitiveDistribution() const
+    {
+        auto mesh = GetMesh();
+        auto transform = m_shape->GetTransform();
+
+        if (mesh == m_mesh && mesh->GetRevision() == m_mesh_revision &&
+            std::memcmp(&transform, &m_transform, sizeof(transform)) == 0)
+        {
+            return;
+        }
+
+        auto indices = mesh->GetIndices();
+        auto vertices = mesh->GetVertices();
+        auto num_prims = mesh->GetNumIndices() / 3;
+
+        // Non-uniform scale changes relative triangle areas, so the
+        // distribution is built from world space edges. Kernels divide the
+        // selection probability by the world space area of the triangle.
+        auto transform_vector = [&transform](RadeonRays::float3 const& v)
+        {
+            return RadeonRays::float3(
+                transform.m00 * v.x + transform.m01 * v.y + transform.m02 * v.z,
+                transform.m10 * v.x + transform.m11 * v.y + transform.m12 * v.z,
+                transform.m20 * v.x + transform.m21 * v.y + transform.m22 * v.z);
+        };
+
+        std::vector<float> areas(num_prims);
+        m_area = 0.f;
+
+        for (std::size_t i = 0; i < num_prims; ++i)
+        {
+            auto v0 = vertices[indices[i * 3]];
+            auto v1 = vertices[indices[i * 3 + 1]];
+            auto v2 = vertices[indices[i * 3 + 2]];
+
+            areas[i] = 0.5f * std::sqrt(cross(transform_vector(v2 - v0), transform_vector(v1 - v0)).sqnorm());
+            m_area += areas[i];
+        }
+
+        // Fall back to uniform selection for degenerate meshes
+        if (!(m_area > 0.f))
+        {
+            std::fill(areas.begin(), areas.end(), 1.f);
+        }
+
+        if (num_prims > 0)
+        {
+            m_distribution.Set(&areas[0], static_cast<std::uint32_t>(num_prims));
+        }
+        else
+        {
+            m_distribution = Distribution1D();
+        }
+
+        m_mesh = mesh;
+        m_mesh_revision = mesh->GetRevision();
+        m_transform = transform;
+    }
+
+    RadeonRays::float3 EmissiveMeshLight::GetPower(Scene1 const& scene) const
+    {
+        return PI * GetEmittedRadiance() * GetArea();
+    }
+    
     namespace {
         struct PointLightConcrete : public PointLight {
         };
@@ -272,6 +375,10 @@ namespace Baikal
             AreaLightConcrete(Shape::Ptr shape, std::size_t idx) :
             AreaLight(shape, idx) {}
         };
+        struct EmissiveMeshLightConcrete: public EmissiveMeshLight {
+            EmissiveMeshLightConcrete(Shape::Ptr shape) :
+            EmissiveMeshLight(shape) {}
+        };
     }
     
     PointLight::Ptr PointLight::Create() {
@@ -293,4 +400,8 @@ namespace Baikal
     AreaLight::Ptr AreaLight::Create(Shape::Ptr shape, std::size_t idx) {
         return std::make_shared<AreaLightConcrete>(shape, idx);
     }
+
+    EmissiveMeshLight::Ptr EmissiveMeshLight::Create(Shape::Ptr shape) {
+        return std::make_shared<EmissiveMeshLightConcrete>(shape);
+    }
 }
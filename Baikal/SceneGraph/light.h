@@ -40,6 +40,7 @@
 #include "scene_object.h"
 #include "shape.h"
 #include "texture.h"
+#include "Utils/distribution1d.h"
 
 namespace Baikal
 {
@@ -245,4 +246,48 @@ namespace Baikal
         // Parent primitive index
         std::size_t m_prim_idx;
     };
+
+    /**
+     \brief Emissive mesh light source.
+
+     Represents all the triangles of an emissive shape as a single light,
+     triangles are sampled proportionally to their area.
+     */
+    class EmissiveMeshLight: public Light
+    {
+    public:
+        using Ptr = std::shared_ptr<EmissiveMeshLight>;
+        static Ptr Create(Shape::Ptr shape);
+
+        // Get emissive shape (mesh or instance)
+        Shape::Ptr GetShape() const;
+        // Get mesh holding geometry of the shape
+        Mesh::Ptr GetMesh() const;
+
+        // Get distribution of triangles proportional to their world space area,
+        // it is only rebuilt when the mesh or the shape transform has been changed
+        Distribution1D const& GetPrimitiveDistribution() const;
+        // Get world space area of the mesh
+        float GetArea() const;
+
+        // Light has to be updated when its shape has been changed
+        bool IsDirty() const override;
+
+        RadeonRays::float3 GetPower(Scene1 const& scene) const override;
+
+    protected:
+        EmissiveMeshLight(Shape::Ptr shape);
+
+    private:
+        void UpdatePrimitiveDistribution() const;
+
+        // Emissive shape
+        Shape::Ptr m_shape;
+        // Triangle area distribution and the mesh state it has been built for
+        mutable Distribution1D m_distribution;
+        mutable float m_area;
+        mutable Mesh::Ptr m_mesh;
+        mutable std::uint64_t m_mesh_revision;
+        mutable RadeonRays::matrix m_transform;
+    };
 }
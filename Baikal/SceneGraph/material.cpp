@@ -1,11 +1,24 @@
 #include "material.h"
 #include "iterator.h"
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
+#include <vector>
 
 namespace Baikal
 {
+    namespace
+    {
+        // Remove duplicates keeping the order std::set would have
+        template <typename T>
+        void SortUnique(std::vector<T>& items)
+        {
+            std::sort(items.begin(), items.end());
+            items.erase(std::unique(items.begin(), items.end()), items.end());
+        }
+    }
+
     Material::Material()
     : m_thin(false)
     {
@@ -50,7 +63,7 @@ namespace Baikal
     // Iterator of dependent materials (plugged as inputs)
     std::unique_ptr<Iterator> Material::CreateMaterialIterator() const
     {
-        std::set<Material::Ptr> materials;
+        std::vector<Material::Ptr> materials;
 
         std::for_each(m_inputs.cbegin(), m_inputs.cend(),
                       [&materials](std::pair<std::string, Input> const& map_entry)
@@ -58,12 +71,14 @@ namespace Baikal
                           if (map_entry.second.value.type == InputType::kMaterial &&
                               map_entry.second.value.mat_value != nullptr)
                           {
-                              materials.insert(map_entry.second.value.mat_value);
+                              materials.push_back(map_entry.second.value.mat_value);
                           }
                       }
                       );
 
-        return std::make_unique<ContainerIterator<std::set<Material::Ptr>>>(std::move(materials));
+        SortUnique(materials);
+
+        return std::make_unique<ContainerIterator<std::vector<Material::Ptr>>>(std::move(materials));
     }
 
     // Iterator of textures (plugged as inputs)
@@ -92,17 +107,19 @@ namespace Baikal
     // Iterator of InputMaps
     std::unique_ptr<Iterator> Material::CreateInputMapsIterator() const
     {
-        std::set<Baikal::InputMap::Ptr> input_maps;
+        std::vector<Baikal::InputMap::Ptr> input_maps;
 
         for (auto &input : m_inputs)
         {
             if (IsActive(input.second) && (input.second.value.type == InputType::kInputMap))
             {
-                input_maps.insert(input.second.value.input_map_value);
+                input_maps.push_back(input.second.value.input_map_value);
             }
         }
 
-        return std::make_unique<ContainerIterator<std::set<Baikal::InputMap::Ptr>>>(std::move(input_maps));
+        SortUnique(input_maps);
+
+        return std::make_unique<ContainerIterator<std::vector<Baikal::InputMap::Ptr>>>(std::move(input_maps));
     }
 
     // Iterator of InputMap leafs
@@ -1,3 +1,4 @@
 #include "scene_object.h"
 
-std::uint32_t Baikal::SceneObject::m_next_id = 0;
\ No newline at end of file
+std::uint32_t Baikal::SceneObject::m_next_id = 0;
+std::atomic<std::uint64_t> Baikal::SceneObject::m_global_revision(0);
\ No newline at end of file
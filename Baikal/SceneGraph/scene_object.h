@@ -28,6 +28,8 @@
  */
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <memory>
 #include <vector>
@@ -57,21 +59,31 @@ namespace Baikal
         inline std::uint32_t GetId() const
         { return m_id; }
 
+        // Number of times the object has been marked dirty
+        inline std::uint64_t GetRevision() const
+        { return m_revision; }
+
+        // Number of times any object has been marked dirty (change journal)
+        static std::uint64_t GetGlobalRevision()
+        { return m_global_revision; }
+
     protected:
         // Constructor
         SceneObject();
         
     private:
         mutable bool m_dirty;
+        mutable std::uint64_t m_revision;
 
         std::string m_name;
         std::uint32_t m_id;
         static std::uint32_t m_next_id;
+        static std::atomic<std::uint64_t> m_global_revision;
         
     };
 
     inline SceneObject::SceneObject()
-    : m_dirty(false), m_id(m_next_id++)
+    : m_dirty(false), m_revision(0), m_id(m_next_id++)
     {
     }
     
@@ -87,6 +99,12 @@ namespace Baikal
     inline void SceneObject::SetDirty(bool dirty) const
     {
         m_dirty = dirty;
+
+        if (dirty)
+        {
+            ++m_revision;
+            ++m_global_revision;
+        }
     }
     
     inline std::string SceneObject::GetName() const
@@ -14,26 +14,34 @@ namespace Baikal
         assert(num_indices != 0);
         
         // Resize internal array and copy data
-        m_indices.resize(num_indices);
+        auto& indices_array = m_indices.Own();
+        indices_array.resize(num_indices);
         
-        std::copy(indices, indices + num_indices, &m_indices[0]);
+        std::copy(indices, indices + num_indices, indices_array.begin());
         
         SetDirty(true);
     }
 
     void Mesh::SetIndices(std::vector<std::uint32_t>&& indices)
     {
-        m_indices = std::move(indices);
+        m_indices.Own() = std::move(indices);
+        SetDirty(true);
+    }
+
+    void Mesh::SetIndices(std::uint32_t const* indices, std::size_t num_indices, std::shared_ptr<void const> storage)
+    {
+        m_indices.Reference(indices, num_indices, std::move(storage));
+        SetDirty(true);
     }
 
     std::size_t Mesh::GetNumIndices() const
     {
-        return m_indices.size();
+        return m_indices.GetSize();
         
     }
     std::uint32_t const* Mesh::GetIndices() const
     {
-        return &m_indices[0];
+        return m_indices.Get();
     }
     
     void Mesh::SetVertices(RadeonRays::float3 const* vertices, std::size_t num_vertices)
@@ -42,9 +50,10 @@ namespace Baikal
         assert(num_vertices != 0);
         
         // Resize internal array and copy data
-        m_vertices.resize(num_vertices);
+        auto& vertices_array = m_vertices.Own();
+        vertices_array.resize(num_vertices);
 
-        std::copy(vertices, vertices + num_vertices, &m_vertices[0]);
+        std::copy(vertices, vertices + num_vertices, vertices_array.begin());
 
         SetDirty(true);
     }
@@ -55,14 +64,15 @@ namespace Baikal
         assert(num_vertices != 0);
         
         // Resize internal array and copy data
-        m_vertices.resize(num_vertices);
+        auto& vertices_array = m_vertices.Own();
+        vertices_array.resize(num_vertices);
         
         for (std::size_t i = 0; i < num_vertices; ++i)
         {
-            m_vertices[i].x = vertices[3 * i];
-            m_vertices[i].y = vertices[3 * i + 1];
-            m_vertices[i].z = vertices[3 * i + 2];
-            m_vertices[i].w = 1;
+            vertices_array[i].x = vertices[3 * i];
+            vertices_array[i].y = vertices[3 * i + 1];
+            vertices_array[i].z = vertices[3 * i + 2];
+            vertices_array[i].w = 1;
         }
 
         SetDirty(true);
@@ -70,18 +80,25 @@ namespace Baikal
 
     void Mesh::SetVertices(std::vector<RadeonRays::float3>&& vertices)
     {
-        m_vertices = std::move(vertices);
+        m_vertices.Own() = std::move(vertices);
+        SetDirty(true);
+    }
+
+    void Mesh::SetVertices(RadeonRays::float3 const* vertices, std::size_t num_vertices, std::shared_ptr<void const> storage)
+    {
+        m_vertices.Reference(vertices, num_vertices, std::move(storage));
+        SetDirty(true);
     }
 
     
     std::size_t Mesh::GetNumVertices() const
     {
-        return m_vertices.size();
+        return m_vertices.GetSize();
     }
     
     RadeonRays::float3 const* Mesh::GetVertices() const
     {
-        return &m_vertices[0];
+        return m_vertices.Get();
     }
     
     void Mesh::SetNormals(RadeonRays::float3 const* normals, std::size_t num_normals)
@@ -90,9 +107,10 @@ namespace Baikal
         assert(num_normals != 0);
         
         // Resize internal array and copy data
-        m_normals.resize(num_normals);
+        auto& normals_array = m_normals.Own();
+        normals_array.resize(num_normals);
 
-        std::copy(normals, normals + num_normals, &m_normals[0]);
+        std::copy(normals, normals + num_normals, normals_array.begin());
 
         SetDirty(true);
     }
@@ -103,14 +121,15 @@ namespace Baikal
         assert(num_normals != 0);
         
         // Resize internal array and copy data
-        m_normals.resize(num_normals);
+        auto& normals_array = m_normals.Own();
+        normals_array.resize(num_normals);
         
         for (std::size_t i = 0; i < num_normals; ++i)
         {
-            m_normals[i].x = normals[3 * i];
-            m_normals[i].y = normals[3 * i + 1];
-            m_normals[i].z = normals[3 * i + 2];
-            m_normals[i].w = 0;
+            normals_array[i].x = normals[3 * i];
+            normals_array[i].y = normals[3 * i + 1];
+            normals_array[i].z = normals[3 * i + 2];
+            normals_array[i].w = 0;
         }
 
         SetDirty(true);
@@ -118,18 +137,25 @@ namespace Baikal
 
     void Mesh::SetNormals(std::vector<RadeonRays::float3>&& normals)
     {
-        m_normals = std::move(normals);
+        m_normals.Own() = std::move(normals);
+        SetDirty(true);
+    }
+
+    void Mesh::SetNormals(RadeonRays::float3 const* normals, std::size_t num_normals, std::shared_ptr<void const> storage)
+    {
+        m_normals.Reference(normals, num_normals, std::move(storage));
+        SetDirty(true);
     }
 
     
     std::size_t Mesh::GetNumNormals() const
     {
-        return m_normals.size();
+        return m_normals.GetSize();
     }
 
     RadeonRays::float3 const* Mesh::GetNormals() const
     {
-        return &m_normals[0];
+        return m_normals.Get();
     }
 
     void Mesh::SetUVs(RadeonRays::float2 const* uvs, std::size_t num_uvs)
@@ -138,9 +164,10 @@ namespace Baikal
         assert(num_uvs != 0);
         
         // Resize internal array and copy data
-        m_uvs.resize(num_uvs);
+        auto& uvs_array = m_uvs.Own();
+        uvs_array.resize(num_uvs);
 
-        std::copy(uvs, uvs + num_uvs, &m_uvs[0]);
+        std::copy(uvs, uvs + num_uvs, uvs_array.begin());
 
         SetDirty(true);
     }
@@ -151,12 +178,13 @@ namespace Baikal
         assert(num_uvs != 0);
         
         // Resize internal array and copy data
-        m_uvs.resize(num_uvs);
+        auto& uvs_array = m_uvs.Own();
+        uvs_array.resize(num_uvs);
         
         for (std::size_t i = 0; i < num_uvs; ++i)
         {
-            m_uvs[i].x = uvs[2 * i];
-            m_uvs[i].y = uvs[2 * i + 1];
+            uvs_array[i].x = uvs[2 * i];
+            uvs_array[i].y = uvs[2 * i + 1];
         }
 
         SetDirty(true);
@@ -164,17 +192,24 @@ namespace Baikal
 
     void Mesh::SetUVs(std::vector<RadeonRays::float2>&& uvs)
     {
-        m_uvs = std::move(uvs);
+        m_uvs.Own() = std::move(uvs);
+        SetDirty(true);
+    }
+
+    void Mesh::SetUVs(RadeonRays::float2 const* uvs, std::size_t num_uvs, std::shared_ptr<void const> storage)
+    {
+        m_uvs.Reference(uvs, num_uvs, std::move(storage));
+        SetDirty(true);
     }
 
     std::size_t Mesh::GetNumUVs() const
     {
-        return m_uvs.size();
+        return m_uvs.GetSize();
     }
     
     RadeonRays::float2 const* Mesh::GetUVs() const
     {
-        return &m_uvs[0];
+        return m_uvs.Get();
     }
 
     RadeonRays::bbox Shape::GetWorldAABB() const
@@ -209,9 +244,11 @@ namespace Baikal
         if (!m_aabb_cached)
         {
             m_aabb = RadeonRays::bbox();
-            for (std::size_t i = 0; i < m_indices.size(); ++i)
+            auto vertices = m_vertices.Get();
+            auto indices = m_indices.Get();
+            for (std::size_t i = 0; i < m_indices.GetSize(); ++i)
             {
-                m_aabb.grow(m_vertices[m_indices[i]]);
+                m_aabb.grow(vertices[indices[i]]);
             }
             m_aabb_cached = true;
         }
@@ -129,6 +129,8 @@ namespace Baikal
         // Set and get index array
         void SetIndices(std::uint32_t const* indices, std::size_t num_indices);
         void SetIndices(std::vector<std::uint32_t>&& indices);
+        // Reference external array without copying, storage keeps the memory alive
+        void SetIndices(std::uint32_t const* indices, std::size_t num_indices, std::shared_ptr<void const> storage);
         std::size_t GetNumIndices() const;
         std::uint32_t const* GetIndices() const;
 
@@ -136,6 +138,7 @@ namespace Baikal
         void SetVertices(RadeonRays::float3 const* vertices, std::size_t num_vertices);
         void SetVertices(float const* vertices, std::size_t num_vertices);
         void SetVertices(std::vector<RadeonRays::float3>&& vertices);
+        void SetVertices(RadeonRays::float3 const* vertices, std::size_t num_vertices, std::shared_ptr<void const> storage);
 
         std::size_t GetNumVertices() const;
         RadeonRays::float3 const* GetVertices() const;
@@ -144,6 +147,7 @@ namespace Baikal
         void SetNormals(RadeonRays::float3 const* normals, std::size_t num_normals);
         void SetNormals(float const* normals, std::size_t num_normals);
         void SetNormals(std::vector<RadeonRays::float3>&& normals);
+        void SetNormals(RadeonRays::float3 const* normals, std::size_t num_normals, std::shared_ptr<void const> storage);
 
         std::size_t GetNumNormals() const;
         RadeonRays::float3 const* GetNormals() const;
@@ -152,6 +156,7 @@ namespace Baikal
         void SetUVs(RadeonRays::float2 const* uvs, std::size_t num_uvs);
         void SetUVs(float const* uvs, std::size_t num_uvs);
         void SetUVs(std::vector<RadeonRays::float2>&& uvs);
+        void SetUVs(RadeonRays::float2 const* uvs, std::size_t num_uvs, std::shared_ptr<void const> storage);
         std::size_t GetNumUVs() const;
         RadeonRays::float2 const* GetUVs() const;
 
@@ -170,10 +175,40 @@ namespace Baikal
         Mesh();
         
     private:
-        std::vector<RadeonRays::float3> m_vertices;
-        std::vector<RadeonRays::float3> m_normals;
-        std::vector<RadeonRays::float2> m_uvs;
-        std::vector<std::uint32_t> m_indices;
+        // Array either owning its data or referencing memory of external storage
+        // (e.g. memory mapped scene file)
+        template <typename T> struct Array
+        {
+            std::vector<T> owned;
+            T const* external = nullptr;
+            std::size_t external_size = 0;
+            std::shared_ptr<void const> storage;
+
+            // Drop external reference and return owned data for modification
+            std::vector<T>& Own()
+            {
+                storage.reset();
+                external = nullptr;
+                external_size = 0;
+                return owned;
+            }
+
+            void Reference(T const* data, std::size_t size, std::shared_ptr<void const> data_storage)
+            {
+                std::vector<T>().swap(owned);
+                external = data;
+                external_size = size;
+                storage = std::move(data_storage);
+            }
+
+            T const* Get() const { return storage ? external : owned.data(); }
+            std::size_t GetSize() const { return storage ? external_size : owned.size(); }
+        };
+
+        Array<RadeonRays::float3> m_vertices;
+        Array<RadeonRays::float3> m_normals;
+        Array<RadeonRays::float2> m_uvs;
+        Array<std::uint32_t> m_indices;
 
         mutable RadeonRays::bbox m_aabb;
         mutable bool m_aabb_cached;
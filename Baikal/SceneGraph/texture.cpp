@@ -1,75 +1,388 @@
 #include "texture.h"
 
 #include "Utils/half.h"
+#include "Utils/block_compression.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_USE_SSE
+#include <emmintrin.h>
+// Hardware half conversion, implied by AVX2 on MSVC which has no F16C macro
+#if defined(__F16C__) || defined(__AVX2__)
+#define TEXTURE_USE_F16C
+#include <immintrin.h>
+#endif
+#endif
 
 namespace Baikal
 {
-    RadeonRays::float3 Texture::ComputeAverageValue() const
+    namespace
     {
-        auto avg = RadeonRays::float3();
+        // Number of stored channels and size of a single channel in bytes
+        void GetLayout(Texture::Format format, int& num_channels, int& component_size)
+        {
+            switch (format)
+            {
+            case Texture::Format::kRgba8: num_channels = 4; component_size = 1; break;
+            case Texture::Format::kRgba16: num_channels = 4; component_size = 2; break;
+            case Texture::Format::kRgba32: num_channels = 4; component_size = 4; break;
+            case Texture::Format::kR8: num_channels = 1; component_size = 1; break;
+            case Texture::Format::kR16: num_channels = 1; component_size = 2; break;
+            case Texture::Format::kR32: num_channels = 1; component_size = 4; break;
+            case Texture::Format::kRg8: num_channels = 2; component_size = 1; break;
+            case Texture::Format::kRg16: num_channels = 2; component_size = 2; break;
+            default: num_channels = 0; component_size = 0; break;
+            }
+        }
+
+        // Load single texel and convert it to float
+        // (single channel is replicated to RGB, dual channel texels get zero blue, missing alpha is 1)
+        void LoadTexel(char const* data, int idx, Texture::Format format, float* texel)
+        {
+            int num_channels, component_size;
+            GetLayout(format, num_channels, component_size);
+
+            texel[0] = texel[1] = texel[2] = 0.f;
+            texel[3] = num_channels > 0 ? 1.f : 0.f;
+
+            for (auto c = 0; c < num_channels; ++c)
+            {
+                auto offset = num_channels * idx + c;
+
+                switch (component_size)
+                {
+                case 1:
+                    texel[c] = reinterpret_cast<std::uint8_t const*>(data)[offset] / 255.f;
+                    break;
+                case 2:
+                {
+                    half h;
+                    h.setBits(reinterpret_cast<std::uint16_t const*>(data)[offset]);
+                    texel[c] = h;
+                    break;
+                }
+                default:
+                    texel[c] = reinterpret_cast<float const*>(data)[offset];
+                    break;
+                }
+            }
+
+            if (num_channels == 1)
+            {
+                texel[1] = texel[2] = texel[0];
+            }
+        }
+
+        // Convert texel to specified format and store it
+        void StoreTexel(char* data, int idx, Texture::Format format, float const* texel)
+        {
+            int num_channels, component_size;
+            GetLayout(format, num_channels, component_size);
+
+            for (auto c = 0; c < num_channels; ++c)
+            {
+                auto offset = num_channels * idx + c;
+
+                switch (component_size)
+                {
+                case 1:
+                    reinterpret_cast<std::uint8_t*>(data)[offset] =
+                        static_cast<std::uint8_t>(std::min(std::max(texel[c], 0.f), 1.f) * 255.f + 0.5f);
+                    break;
+                case 2:
+                    reinterpret_cast<std::uint16_t*>(data)[offset] = half(texel[c]).bits();
+                    break;
+                default:
+                    reinterpret_cast<float*>(data)[offset] = texel[c];
+                    break;
+                }
+            }
+        }
+
+        // Texels are reduced in chunks of this size
+        std::size_t const kChunkTexels = 1 << 16;
+        // Textures smaller than this are reduced on the calling thread
+        std::size_t const kMinParallelTexels = 1 << 20;
+        // Number of texels accumulated in single precision before adding to chunk sum
+        std::size_t const kBlockTexels = 256;
 
-        switch (m_format) {
-        case Format::kRgba8:
+        // RGB sum and maximum of a range of texels
+        struct TexelSums
         {
-            auto data = reinterpret_cast<std::uint8_t*>(m_data.get());
-            auto num_elements = m_size.x * m_size.y * m_size.z;
+            double sum[3];
+            float max[3];
+        };
 
+#ifdef TEXTURE_USE_SSE
+        // Accumulate texels [begin, end) loaded as (r, g, b, a) vectors, scale is applied to the result
+        template <typename Load>
+        void Accumulate(std::size_t begin, std::size_t end, float scale, Load load, TexelSums& result)
+        {
+            double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+            auto max = _mm_set1_ps(-std::numeric_limits<float>::max());
 
-            for (auto i = 0; i < num_elements; ++i)
+            for (auto block = begin; block < end; block += kBlockTexels)
             {
-                float r = data[4 * i] / 255.f;
-                float g = data[4 * i + 1] / 255.f;
-                float b = data[4 * i + 2] / 255.f;
-                avg += RadeonRays::float3(r, g, b);
+                auto block_sum = _mm_setzero_ps();
+                auto block_end = std::min(end, block + kBlockTexels);
+
+                for (auto i = block; i < block_end; ++i)
+                {
+                    auto texel = load(i);
+                    block_sum = _mm_add_ps(block_sum, texel);
+                    max = _mm_max_ps(max, texel);
+                }
+
+                alignas(16) float values[4];
+                _mm_store_ps(values, block_sum);
+
+                for (auto c = 0; c < 4; ++c)
+                {
+                    sum[c] += values[c];
+                }
             }
 
-            avg *= (1.f / num_elements);
-            break;
+            alignas(16) float values[4];
+            _mm_store_ps(values, max);
+
+            for (auto c = 0; c < 3; ++c)
+            {
+                result.sum[c] = sum[c] * scale;
+                result.max[c] = values[c] * scale;
+            }
+        }
+
+        void ReduceTexels(Texture const& texture, std::size_t begin, std::size_t end, TexelSums& result)
+        {
+            auto data = texture.GetData();
+
+            switch (texture.GetFormat())
+            {
+            case Texture::Format::kRgba8:
+            {
+                auto zero = _mm_setzero_si128();
+                Accumulate(begin, end, 1.f / 255.f, [&](std::size_t i)
+                {
+                    std::int32_t bits;
+                    std::memcpy(&bits, data + 4 * i, sizeof(bits));
+                    auto texel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), zero), zero);
+                    return _mm_cvtepi32_ps(texel);
+                }, result);
+                break;
+            }
+            case Texture::Format::kRgba16:
+            {
+                auto halfs = reinterpret_cast<std::uint16_t const*>(data);
+                Accumulate(begin, end, 1.f, [&](std::size_t i)
+                {
+#ifdef TEXTURE_USE_F16C
+                    return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(halfs + 4 * i)));
+#else
+                    half h[4];
+                    for (auto c = 0; c < 4; ++c)
+                    {
+                        h[c].setBits(halfs[4 * i + c]);
+                    }
+                    return _mm_setr_ps(h[0], h[1], h[2], h[3]);
+#endif
+                }, result);
+                break;
+            }
+            case Texture::Format::kRgba32:
+            {
+                auto floats = reinterpret_cast<float const*>(data);
+                Accumulate(begin, end, 1.f, [&](std::size_t i)
+                {
+                    return _mm_loadu_ps(floats + 4 * i);
+                }, result);
+                break;
+            }
+            default:
+            {
+                // Compressed, single and dual channel formats
+                auto width = static_cast<std::size_t>(texture.GetSize().x);
+                Accumulate(begin, end, 1.f, [&](std::size_t i)
+                {
+                    auto texel = texture.GetTexel(static_cast<int>(i % width), static_cast<int>(i / width));
+                    return _mm_setr_ps(texel.x, texel.y, texel.z, texel.w);
+                }, result);
+                break;
+            }
+            }
         }
-        case Format::kRgba16:
+#else
+        void ReduceTexels(Texture const& texture, std::size_t begin, std::size_t end, TexelSums& result)
         {
-            auto data = reinterpret_cast<std::uint16_t*>(m_data.get());
-            auto num_elements = m_size.x * m_size.y * m_size.z;
+            auto width = static_cast<std::size_t>(texture.GetSize().x);
 
-            for (auto i = 0; i < num_elements; ++i)
+            for (auto c = 0; c < 3; ++c)
             {
-                auto r = data[4 * i];
-                auto g = data[4 * i + 1];
-                auto b = data[4 * i + 2];
+                result.sum[c] = 0.0;
+                result.max[c] = -std::numeric_limits<float>::max();
+            }
 
-                half hr, hg, hb;
-                hr.setBits(r);
-                hg.setBits(g);
-                hb.setBits(b);
+            for (auto i = begin; i < end; ++i)
+            {
+                auto texel = texture.GetTexel(static_cast<int>(i % width), static_cast<int>(i / width));
 
-                avg += RadeonRays::float3(hr, hg, hb);
+                for (auto c = 0; c < 3; ++c)
+                {
+                    result.sum[c] += texel[c];
+                    result.max[c] = std::max(result.max[c], texel[c]);
+                }
             }
+        }
+#endif
+    }
 
-            avg *= (1.f / num_elements);
-            break;
+    RadeonRays::float4 Texture::GetTexel(int x, int y) const
+    {
+        if (IsCompressed())
+        {
+            auto num_blocks_x = (m_size.x + 3) / 4;
+            auto block = m_data.get() + GetBlockSizeInBytes() * ((y / 4) * num_blocks_x + x / 4);
+            return DecodeBlockTexel(block, m_format, (y % 4) * 4 + x % 4);
         }
-        case Format::kRgba32:
+
+        float texel[4];
+        LoadTexel(m_data.get(), y * m_size.x + x, m_format, texel);
+        return RadeonRays::float4(texel[0], texel[1], texel[2], texel[3]);
+    }
+
+    char const* Texture::GetMipData(std::uint32_t level) const
+    {
+        assert(level < GetNumMipLevels());
+
+        if (level == 0)
+        {
+            return m_data.get();
+        }
+
+        if (m_mips.size() < level)
+        {
+            m_mips.resize(level);
+        }
+
+        if (!m_mips[level - 1])
         {
-            auto data = reinterpret_cast<float*>(m_data.get());
-            auto num_elements = m_size.x * m_size.y * m_size.z;
+            // Downsample previous level using 2x2 box filter
+            auto src = GetMipData(level - 1);
+            auto src_size = GetMipSize(level - 1);
+            auto dst_size = GetMipSize(level);
 
-            for (auto i = 0; i < num_elements; ++i)
+            std::unique_ptr<char[]> dst(new char[GetPixelSizeInBytes() * dst_size.x * dst_size.y]);
+
+            for (auto y = 0; y < dst_size.y; ++y)
             {
-                auto r = data[4 * i];
-                auto g = data[4 * i + 1];
-                auto b = data[4 * i + 2];
+                for (auto x = 0; x < dst_size.x; ++x)
+                {
+                    int x0 = std::min(2 * x, src_size.x - 1);
+                    int x1 = std::min(2 * x + 1, src_size.x - 1);
+                    int y0 = std::min(2 * y, src_size.y - 1);
+                    int y1 = std::min(2 * y + 1, src_size.y - 1);
+
+                    float value[4] = { 0.f, 0.f, 0.f, 0.f };
+                    float texel[4];
+
+                    for (auto idx : { y0 * src_size.x + x0, y0 * src_size.x + x1,
+                                      y1 * src_size.x + x0, y1 * src_size.x + x1 })
+                    {
+                        LoadTexel(src, idx, m_format, texel);
+
+                        for (auto c = 0; c < 4; ++c)
+                        {
+                            value[c] += 0.25f * texel[c];
+                        }
+                    }
+
+                    StoreTexel(dst.get(), y * dst_size.x + x, m_format, value);
+                }
+            }
+
+            m_mips[level - 1] = std::move(dst);
+        }
+
+        return m_mips[level - 1].get();
+    }
+
+    Texture::Statistics const& Texture::GetStatistics() const
+    {
+        if (m_statistics)
+        {
+            return *m_statistics;
+        }
+
+        auto num_texels = static_cast<std::size_t>(m_size.x) * m_size.y * m_size.z;
+        auto num_chunks = (num_texels + kChunkTexels - 1) / kChunkTexels;
 
-                avg += RadeonRays::float3(r, g, b);
+        // Chunks are reduced independently and summed in order,
+        // so the result does not depend on the number of threads
+        std::vector<TexelSums> partial(num_chunks);
+        std::atomic<std::size_t> next(0);
+
+        auto reduce = [&]()
+        {
+            for (auto chunk = next++; chunk < num_chunks; chunk = next++)
+            {
+                ReduceTexels(*this, chunk * kChunkTexels, std::min(num_texels, (chunk + 1) * kChunkTexels), partial[chunk]);
             }
+        };
+
+        auto num_threads = num_texels < kMinParallelTexels ? 1u :
+            static_cast<std::uint32_t>(std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), num_chunks));
+
+        std::vector<std::thread> threads;
+        for (auto i = 1u; i < num_threads; ++i)
+        {
+            threads.emplace_back(reduce);
+        }
+
+        reduce();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        double sum[3] = { 0.0, 0.0, 0.0 };
+        float max[3] = { 0.f, 0.f, 0.f };
 
-            avg *= (1.f / num_elements);
-            break;
+        if (num_chunks > 0)
+        {
+            std::copy(partial[0].max, partial[0].max + 3, max);
         }
-        default:
-            break;
+
+        for (auto const& chunk : partial)
+        {
+            for (auto c = 0; c < 3; ++c)
+            {
+                sum[c] += chunk.sum[c];
+                max[c] = std::max(max[c], chunk.max[c]);
+            }
         }
 
-        return avg;
+        std::unique_ptr<Statistics> statistics(new Statistics);
+
+        auto inv_num_texels = num_texels > 0 ? 1.0 / num_texels : 0.0;
+        statistics->average = RadeonRays::float3(
+            static_cast<float>(sum[0] * inv_num_texels),
+            static_cast<float>(sum[1] * inv_num_texels),
+            static_cast<float>(sum[2] * inv_num_texels));
+        statistics->max = RadeonRays::float3(max[0], max[1], max[2]);
+        statistics->luminance_sum = static_cast<float>(0.2126 * sum[0] + 0.7152 * sum[1] + 0.0722 * sum[2]);
+
+        m_statistics = std::move(statistics);
+        return *m_statistics;
+    }
+
+    RadeonRays::float3 Texture::ComputeAverageValue() const
+    {
+        return GetStatistics().average;
     }
 
     namespace {
@@ -31,8 +31,10 @@
 #include "math/float3.h"
 #include "math/float2.h"
 #include "math/int3.h"
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "scene_object.h"
 
@@ -52,7 +54,19 @@ namespace Baikal
         {
             kRgba8,
             kRgba16,
-            kRgba32
+            kRgba32,
+            // Block compressed formats (4x4 texel blocks)
+            kBc1,
+            kBc4,
+            kBc5,
+            kBc6h,
+            kBc7,
+            // Single and dual channel formats (R is replicated to RGB on sampling, RG -> (r, g, 0))
+            kR8,
+            kR16,
+            kR32,
+            kRg8,
+            kRg16
         };
 
         using Ptr = std::shared_ptr<Texture>;
@@ -73,6 +87,38 @@ namespace Baikal
         Format GetFormat() const;
         // Get data size in bytes
         std::size_t GetSizeInBytes() const;
+        // Get size of a single pixel in bytes (0 for compressed formats)
+        std::size_t GetPixelSizeInBytes() const;
+        // Get number of channels stored per pixel (4 for compressed formats)
+        std::uint32_t GetNumChannels() const;
+        // Check if texture uses block compressed format
+        bool IsCompressed() const;
+        // Get size of 4x4 block in bytes for compressed formats
+        std::size_t GetBlockSizeInBytes() const;
+
+        // Read single texel of level 0 (decodes compressed data, intended for offline processing)
+        RadeonRays::float4 GetTexel(int x, int y) const;
+
+        // Get number of mip levels in a full mip chain (1 for 3D and compressed textures)
+        std::uint32_t GetNumMipLevels() const;
+        // Get dimensions of specified mip level
+        RadeonRays::int3 GetMipSize(std::uint32_t level) const;
+        // Get data of specified mip level (generated on first request, level 0 is texture data)
+        char const* GetMipData(std::uint32_t level) const;
+
+        // Statistics of level 0 RGB values
+        struct Statistics
+        {
+            // Average value
+            RadeonRays::float3 average;
+            // Per channel maximum
+            RadeonRays::float3 max;
+            // Sum of texel luminances
+            float luminance_sum;
+        };
+
+        // Get texel statistics (computed on first request after data change)
+        Statistics const& GetStatistics() const;
 
         // Average normalized value
         RadeonRays::float3 ComputeAverageValue() const;
@@ -94,6 +140,10 @@ namespace Baikal
         RadeonRays::int3 m_size;
         // Format
         Format m_format;
+        // Lazily generated mip levels (starting from level 1)
+        mutable std::vector<std::unique_ptr<char[]>> m_mips;
+        // Lazily computed statistics
+        mutable std::unique_ptr<Statistics> m_statistics;
     };
 
     inline Texture::Texture()
@@ -122,6 +172,8 @@ namespace Baikal
     inline void Texture::SetData(char* data, RadeonRays::int3 size, Format format)
     {
         m_data.reset(data);
+        m_mips.clear();
+        m_statistics.reset();
         m_size = size;
 
         if (size.z == 0)
@@ -149,23 +201,94 @@ namespace Baikal
     }
 
     inline std::size_t Texture::GetSizeInBytes() const
+    {
+        if (IsCompressed())
+        {
+            return GetBlockSizeInBytes() * ((m_size.x + 3) / 4) * ((m_size.y + 3) / 4) * m_size.z;
+        }
+
+        return GetPixelSizeInBytes() * m_size.x * m_size.y * m_size.z;
+    }
+
+    inline bool Texture::IsCompressed() const
+    {
+        return GetBlockSizeInBytes() > 0;
+    }
+
+    inline std::size_t Texture::GetBlockSizeInBytes() const
+    {
+        switch (m_format) {
+        case Format::kBc1:
+        case Format::kBc4:
+            return 8;
+        case Format::kBc5:
+        case Format::kBc6h:
+        case Format::kBc7:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    inline std::uint32_t Texture::GetNumChannels() const
+    {
+        switch (m_format) {
+        case Format::kR8:
+        case Format::kR16:
+        case Format::kR32:
+            return 1;
+        case Format::kRg8:
+        case Format::kRg16:
+            return 2;
+        default:
+            return 4;
+        }
+    }
+
+    inline std::size_t Texture::GetPixelSizeInBytes() const
     {
         std::uint32_t component_size = 1;
 
         switch (m_format) {
         case Format::kRgba8:
+        case Format::kR8:
+        case Format::kRg8:
             component_size = 1;
             break;
         case Format::kRgba16:
+        case Format::kR16:
+        case Format::kRg16:
             component_size = 2;
             break;
         case Format::kRgba32:
+        case Format::kR32:
             component_size = 4;
             break;
         default:
-            break;
+            return 0;
+        }
+
+        return GetNumChannels() * component_size;
+    }
+
+    inline std::uint32_t Texture::GetNumMipLevels() const
+    {
+        if (m_size.z > 1 || IsCompressed())
+        {
+            return 1;
+        }
+
+        std::uint32_t num_levels = 1;
+        for (auto size = std::max(m_size.x, m_size.y); size > 1; size >>= 1)
+        {
+            ++num_levels;
         }
 
-        return 4 * component_size * m_size.x * m_size.y * m_size.z;
+        return num_levels;
+    }
+
+    inline RadeonRays::int3 Texture::GetMipSize(std::uint32_t level) const
+    {
+        return RadeonRays::int3(std::max(m_size.x >> level, 1), std::max(m_size.y >> level, 1), m_size.z);
     }
 }
@@ -0,0 +1,611 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#include "block_compression.h"
+
+#include "Utils/half.h"
+
+#include <cstdint>
+#include <utility>
+
+namespace Baikal
+{
+    namespace
+    {
+        // BC6H/BC7 interpolation weights for 2, 3 and 4-bit indices
+        int const kWeights2[4] = { 0, 21, 43, 64 };
+        int const kWeights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+        int const kWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        // BC6H/BC7 two subset partitions, bit i is the subset of texel i
+        std::uint16_t const kPartitions2[64] =
+        {
+            0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+            0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+            0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+            0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+            0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+            0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+            0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+            0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+        };
+
+        // BC7 three subset partitions, 2 bits per texel starting from texel 0
+        std::uint32_t const kPartitions3[64] =
+        {
+            0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+            0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+            0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+            0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+            0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+            0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+            0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+            0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
+        };
+
+        // Anchor texel of the second subset of two subset partitions
+        std::uint8_t const kAnchors2[64] =
+        {
+            15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+            15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+            15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+             6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+        };
+
+        // Anchor texels of the second and the third subsets of three subset partitions
+        std::uint8_t const kAnchors3Second[64] =
+        {
+             3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+             3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+             8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+             3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+        };
+
+        std::uint8_t const kAnchors3Third[64] =
+        {
+            15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+            15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+            15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+            15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+        };
+
+        // BC6H modes, numbered from 1 as in the format specification
+        struct Bc6hMode
+        {
+            // Endpoints other than the first one are stored as deltas
+            bool transformed;
+            int num_regions;
+            // Precision of the first endpoint and of the deltas per channel
+            int endpoint_bits;
+            int delta_bits[3];
+        };
+
+        Bc6hMode const kBc6hModes[14] =
+        {
+            { true, 2, 10, { 5, 5, 5 } },
+            { true, 2, 7, { 6, 6, 6 } },
+            { true, 2, 11, { 5, 4, 4 } },
+            { true, 2, 11, { 4, 5, 4 } },
+            { true, 2, 11, { 4, 4, 5 } },
+            { true, 2, 9, { 5, 5, 5 } },
+            { true, 2, 8, { 6, 5, 5 } },
+            { true, 2, 8, { 5, 6, 5 } },
+            { true, 2, 8, { 5, 5, 6 } },
+            { false, 2, 6, { 6, 6, 6 } },
+            { false, 1, 10, { 10, 10, 10 } },
+            { true, 1, 11, { 9, 9, 9 } },
+            { true, 1, 12, { 8, 8, 8 } },
+            { true, 1, 16, { 4, 4, 4 } }
+        };
+
+        // BC6H endpoint bit layouts following the mode bits. Each entry 0xFLC is a run of
+        // C bits of endpoint component F (endpoint * 3 + channel) starting from bit L.
+        std::uint16_t const kBc6hLayouts[] =
+        {
+            // Mode 1
+            0x741, 0x841, 0xB41, 0x00A, 0x10A, 0x20A, 0x305, 0xA41, 0x704, 0x405, 0xB01, 0xA04,
+            0x505, 0xB11, 0x804, 0x605, 0xB21, 0x905, 0xB31,
+            // Mode 2
+            0x751, 0xA41, 0xA51, 0x007, 0xB01, 0xB11, 0x841, 0x107, 0x851, 0xB21, 0x741, 0x207,
+            0xB31, 0xB51, 0xB41, 0x306, 0x704, 0x406, 0xA04, 0x506, 0x804, 0x606, 0x906,
+            // Mode 3
+            0x00A, 0x10A, 0x20A, 0x305, 0x0A1, 0x704, 0x404, 0x1A1, 0xB01, 0xA04, 0x504, 0x2A1,
+            0xB11, 0x804, 0x605, 0xB21, 0x905, 0xB31,
+            // Mode 4
+            0x00A, 0x10A, 0x20A, 0x304, 0x0A1, 0xA41, 0x704, 0x405, 0x1A1, 0xA04, 0x504, 0x2A1,
+            0xB11, 0x804, 0x604, 0xB01, 0xB21, 0x904, 0x741, 0xB31,
+            // Mode 5
+            0x00A, 0x10A, 0x20A, 0x304, 0x0A1, 0x841, 0x704, 0x404, 0x1A1, 0xB01, 0xA04, 0x505,
+            0x2A1, 0x804, 0x604, 0xB11, 0xB21, 0x904, 0xB41, 0xB31,
+            // Mode 6
+            0x009, 0x841, 0x109, 0x741, 0x209, 0xB41, 0x305, 0xA41, 0x704, 0x405, 0xB01, 0xA04,
+            0x505, 0xB11, 0x804, 0x605, 0xB21, 0x905, 0xB31,
+            // Mode 7
+            0x008, 0xA41, 0x841, 0x108, 0xB21, 0x741, 0x208, 0xB31, 0xB41, 0x306, 0x704, 0x405,
+            0xB01, 0xA04, 0x505, 0xB11, 0x804, 0x606, 0x906,
+            // Mode 8
+            0x008, 0xB01, 0x841, 0x108, 0x751, 0x741, 0x208, 0xA51, 0xB41, 0x305, 0xA41, 0x704,
+            0x406, 0xA04, 0x505, 0xB11, 0x804, 0x605, 0xB21, 0x905, 0xB31,
+            // Mode 9
+            0x008, 0xB11, 0x841, 0x108, 0x851, 0x741, 0x208, 0xB51, 0xB41, 0x305, 0xA41, 0x704,
+            0x405, 0xB01, 0xA04, 0x506, 0x804, 0x605, 0xB21, 0x905, 0xB31,
+            // Mode 10
+            0x006, 0xA41, 0xB01, 0xB11, 0x841, 0x106, 0x751, 0x851, 0xB21, 0x741, 0x206, 0xA51,
+            0xB31, 0xB51, 0xB41, 0x306, 0x704, 0x406, 0xA04, 0x506, 0x804, 0x606, 0x906,
+            // Mode 11
+            0x00A, 0x10A, 0x20A, 0x30A, 0x40A, 0x50A,
+            // Mode 12
+            0x00A, 0x10A, 0x20A, 0x309, 0x0A1, 0x409, 0x1A1, 0x509, 0x2A1,
+            // Mode 13
+            0x00A, 0x10A, 0x20A, 0x308, 0x0B1, 0x0A1, 0x408, 0x1B1, 0x1A1, 0x508, 0x2B1, 0x2A1,
+            // Mode 14
+            0x00A, 0x10A, 0x20A, 0x304, 0x0F1, 0x0E1, 0x0D1, 0x0C1, 0x0B1, 0x0A1, 0x404, 0x1F1,
+            0x1E1, 0x1D1, 0x1C1, 0x1B1, 0x1A1, 0x504, 0x2F1, 0x2E1, 0x2D1, 0x2C1, 0x2B1, 0x2A1
+        };
+
+        // Layout of mode i is [kBc6hLayoutOffsets[i], kBc6hLayoutOffsets[i + 1]) range of kBc6hLayouts
+        std::uint8_t const kBc6hLayoutOffsets[15] = { 0, 19, 42, 60, 80, 100, 119, 138, 159, 180, 203, 209, 218, 230, 254 };
+
+        // BC7 modes
+        struct Bc7Mode
+        {
+            int num_subsets;
+            int partition_bits;
+            int rotation_bits;
+            int index_selection_bits;
+            int color_bits;
+            int alpha_bits;
+            // P-bits are either unique for each endpoint or shared by endpoints of a subset
+            int endpoint_pbits;
+            int shared_pbits;
+            // Bits per index of the first and the second (separate alpha) index sets
+            int index_bits;
+            int index_bits2;
+        };
+
+        Bc7Mode const kBc7Modes[8] =
+        {
+            { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+            { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+            { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+            { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+            { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+            { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+            { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+            { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+        };
+
+        std::uint64_t LoadQword(std::uint8_t const* data)
+        {
+            std::uint64_t value = 0;
+
+            for (auto i = 0; i < 8; ++i)
+            {
+                value |= static_cast<std::uint64_t>(data[i]) << (8 * i);
+            }
+
+            return value;
+        }
+
+        // Extract count bits starting at start from 128-bit block
+        std::uint32_t GetBits(std::uint64_t lo, std::uint64_t hi, int start, int count)
+        {
+            std::uint64_t bits = start >= 64 ? (hi >> (start - 64)) :
+                (start + count <= 64 ? lo >> start : (lo >> start) | (hi << (64 - start)));
+            return static_cast<std::uint32_t>(bits & ((1ull << count) - 1));
+        }
+
+        // Index of a texel in a block with indices starting at bit start. Anchor texels (texel 0
+        // and anchors of other subsets, 16 if there is none) are stored with one bit less.
+        int GetIndex(std::uint64_t lo, std::uint64_t hi, int start, int bits, int texel, int anchor1, int anchor2)
+        {
+            int offset = start + texel * bits - (texel > 0 ? 1 : 0) - (texel > anchor1 ? 1 : 0) - (texel > anchor2 ? 1 : 0);
+            bool anchor = texel == 0 || texel == anchor1 || texel == anchor2;
+            return static_cast<int>(GetBits(lo, hi, offset, anchor ? bits - 1 : bits));
+        }
+
+        int Interpolate(int e0, int e1, int bits, int index)
+        {
+            int w = bits == 2 ? kWeights2[index] : (bits == 3 ? kWeights3[index] : kWeights4[index]);
+            return ((64 - w) * e0 + w * e1 + 32) >> 6;
+        }
+
+        // BC6H mode index (0-13) from the first 5 bits of the block, -1 for reserved modes
+        int GetBc6hMode(std::uint64_t lo)
+        {
+            int bits = static_cast<int>(lo & 0x1F);
+
+            // Modes 1 and 2 use 2 mode bits
+            if ((bits & 0x2) == 0)
+            {
+                return bits & 0x1;
+            }
+
+            if ((bits & 0x3) == 0x2)
+            {
+                return 2 + (bits >> 2);
+            }
+
+            return (bits >> 2) < 4 ? 10 + (bits >> 2) : -1;
+        }
+
+        // Unquantize unsigned BC6H endpoint to 16 bits
+        int UnquantizeBc6h(int value, int bits)
+        {
+            if (bits >= 15) return value;
+            if (value == 0) return 0;
+            if (value == (1 << bits) - 1) return 0xFFFF;
+            return ((value << 16) + 0x8000) >> bits;
+        }
+
+        int SignExtend(int value, int bits)
+        {
+            return value >= (1 << (bits - 1)) ? value - (1 << bits) : value;
+        }
+
+        RadeonRays::float4 DecodeBc1(std::uint8_t const* block, int texel)
+        {
+            std::uint32_t c0 = block[0] | (block[1] << 8);
+            std::uint32_t c1 = block[2] | (block[3] << 8);
+            std::uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<std::uint32_t>(block[7]) << 24);
+            std::uint32_t index = (indices >> (2 * texel)) & 0x3;
+
+            // Expand 565 endpoints to 8 bits
+            int e0[3] = { static_cast<int>(((c0 >> 11) << 3) | (c0 >> 13)),
+                          static_cast<int>((((c0 >> 5) & 0x3F) << 2) | ((c0 >> 9) & 0x3)),
+                          static_cast<int>(((c0 & 0x1F) << 3) | ((c0 >> 2) & 0x7)) };
+            int e1[3] = { static_cast<int>(((c1 >> 11) << 3) | (c1 >> 13)),
+                          static_cast<int>((((c1 >> 5) & 0x3F) << 2) | ((c1 >> 9) & 0x3)),
+                          static_cast<int>(((c1 & 0x1F) << 3) | ((c1 >> 2) & 0x7)) };
+
+            // Transparent black in 3 color mode
+            if (c0 <= c1 && index == 3)
+            {
+                return RadeonRays::float4(0.f, 0.f, 0.f, 0.f);
+            }
+
+            int c[3];
+
+            for (auto i = 0; i < 3; ++i)
+            {
+                switch (index)
+                {
+                case 0: c[i] = e0[i]; break;
+                case 1: c[i] = e1[i]; break;
+                case 2: c[i] = c0 > c1 ? (2 * e0[i] + e1[i] + 1) / 3 : (e0[i] + e1[i] + 1) / 2; break;
+                default: c[i] = (e0[i] + 2 * e1[i] + 1) / 3; break;
+                }
+            }
+
+            return RadeonRays::float4(c[0] / 255.f, c[1] / 255.f, c[2] / 255.f, 1.f);
+        }
+
+        int DecodeBc4Channel(std::uint8_t const* block, int texel)
+        {
+            int r0 = block[0];
+            int r1 = block[1];
+            std::uint64_t bits = LoadQword(block) >> 16;
+            int index = static_cast<int>((bits >> (3 * texel)) & 0x7);
+
+            if (index == 0) return r0;
+            if (index == 1) return r1;
+
+            // 8 value mode
+            if (r0 > r1)
+            {
+                return ((8 - index) * r0 + (index - 1) * r1 + 3) / 7;
+            }
+
+            // 6 value mode with explicit 0 and 255
+            if (index == 6) return 0;
+            if (index == 7) return 255;
+
+            return ((6 - index) * r0 + (index - 1) * r1 + 2) / 5;
+        }
+
+        RadeonRays::float4 DecodeBc6h(std::uint8_t const* block, int texel)
+        {
+            auto lo = LoadQword(block);
+            auto hi = LoadQword(block + 8);
+
+            // Reserved modes decode to zero
+            int mode_index = GetBc6hMode(lo);
+
+            if (mode_index < 0)
+            {
+                return RadeonRays::float4(0.f, 0.f, 0.f, 0.f);
+            }
+
+            auto const& mode = kBc6hModes[mode_index];
+
+            // Gather endpoint components scattered over the block
+            int components[12] = { 0 };
+            int pos = mode_index < 2 ? 2 : 5;
+
+            for (auto i = kBc6hLayoutOffsets[mode_index]; i < kBc6hLayoutOffsets[mode_index + 1]; ++i)
+            {
+                int run = kBc6hLayouts[i];
+                int count = run & 0xF;
+                components[run >> 8] |= static_cast<int>(GetBits(lo, hi, pos, count)) << ((run >> 4) & 0xF);
+                pos += count;
+            }
+
+            // Region of the texel and its index
+            int region = 0;
+            int index_bits = 4;
+            int index = 0;
+
+            if (mode.num_regions == 2)
+            {
+                int partition = static_cast<int>(GetBits(lo, hi, 77, 5));
+                region = (kPartitions2[partition] >> texel) & 0x1;
+                index_bits = 3;
+                index = GetIndex(lo, hi, 82, 3, texel, kAnchors2[partition], 16);
+            }
+            else
+            {
+                index = GetIndex(lo, hi, 65, 4, texel, 16, 16);
+            }
+
+            float c[3];
+
+            for (auto i = 0; i < 3; ++i)
+            {
+                int e0 = components[6 * region + i];
+                int e1 = components[6 * region + 3 + i];
+
+                // Deltas are relative to the first endpoint and wrap around
+                if (mode.transformed)
+                {
+                    int mask = (1 << mode.endpoint_bits) - 1;
+                    int base = components[i];
+
+                    if (region > 0)
+                    {
+                        e0 = (base + SignExtend(e0, mode.delta_bits[i])) & mask;
+                    }
+
+                    e1 = (base + SignExtend(e1, mode.delta_bits[i])) & mask;
+                }
+
+                e0 = UnquantizeBc6h(e0, mode.endpoint_bits);
+                e1 = UnquantizeBc6h(e1, mode.endpoint_bits);
+
+                half h;
+                h.setBits(static_cast<unsigned short>((Interpolate(e0, e1, index_bits, index) * 31) >> 6));
+                c[i] = h;
+            }
+
+            return RadeonRays::float4(c[0], c[1], c[2], 1.f);
+        }
+
+        RadeonRays::float4 DecodeBc7(std::uint8_t const* block, int texel)
+        {
+            auto lo = LoadQword(block);
+            auto hi = LoadQword(block + 8);
+
+            // Mode is the number of zero bits before the first set one, reserved mode decodes to zero
+            int mode_index = 0;
+
+            while (mode_index < 8 && ((lo >> mode_index) & 0x1) == 0)
+            {
+                ++mode_index;
+            }
+
+            if (mode_index == 8)
+            {
+                return RadeonRays::float4(0.f, 0.f, 0.f, 0.f);
+            }
+
+            auto const& mode = kBc7Modes[mode_index];
+            int pos = mode_index + 1;
+
+            int partition = static_cast<int>(GetBits(lo, hi, pos, mode.partition_bits));
+            pos += mode.partition_bits;
+            int rotation = static_cast<int>(GetBits(lo, hi, pos, mode.rotation_bits));
+            pos += mode.rotation_bits;
+            int index_selection = static_cast<int>(GetBits(lo, hi, pos, mode.index_selection_bits));
+            pos += mode.index_selection_bits;
+
+            // Endpoints are stored channel by channel, 2 per subset
+            int num_endpoints = 2 * mode.num_subsets;
+            int endpoints[6][4];
+
+            for (auto i = 0; i < 4; ++i)
+            {
+                int bits = i < 3 ? mode.color_bits : mode.alpha_bits;
+
+                for (auto e = 0; e < num_endpoints; ++e)
+                {
+                    endpoints[e][i] = static_cast<int>(GetBits(lo, hi, pos, bits));
+                    pos += bits;
+                }
+            }
+
+            // P-bits add the least significant bit to all channels of an endpoint
+            int color_bits = mode.color_bits;
+            int alpha_bits = mode.alpha_bits;
+
+            if (mode.endpoint_pbits || mode.shared_pbits)
+            {
+                for (auto e = 0; e < num_endpoints; ++e)
+                {
+                    int pbit = static_cast<int>(GetBits(lo, hi, pos + (mode.endpoint_pbits ? e : e / 2), 1));
+
+                    for (auto i = 0; i < 4; ++i)
+                    {
+                        endpoints[e][i] = (endpoints[e][i] << 1) | pbit;
+                    }
+                }
+
+                pos += mode.endpoint_pbits ? num_endpoints : mode.num_subsets;
+                ++color_bits;
+                alpha_bits = alpha_bits ? alpha_bits + 1 : 0;
+            }
+
+            // Expand endpoints to 8 bits by replicating high bits, alpha is opaque if not stored
+            for (auto e = 0; e < num_endpoints; ++e)
+            {
+                for (auto i = 0; i < 4; ++i)
+                {
+                    int bits = i < 3 ? color_bits : alpha_bits;
+                    int v = endpoints[e][i] << (8 - bits);
+                    endpoints[e][i] = bits ? v | (v >> bits) : 255;
+                }
+            }
+
+            // Subset of the texel and anchors of the subsets
+            int subset = 0;
+            int anchor1 = 16;
+            int anchor2 = 16;
+
+            if (mode.num_subsets == 2)
+            {
+                subset = (kPartitions2[partition] >> texel) & 0x1;
+                anchor1 = kAnchors2[partition];
+            }
+            else if (mode.num_subsets == 3)
+            {
+                subset = (kPartitions3[partition] >> (2 * texel)) & 0x3;
+                anchor1 = kAnchors3Second[partition];
+                anchor2 = kAnchors3Third[partition];
+            }
+
+            int color_index_bits = mode.index_bits;
+            int color_index = GetIndex(lo, hi, pos, mode.index_bits, texel, anchor1, anchor2);
+            int alpha_index_bits = color_index_bits;
+            int alpha_index = color_index;
+
+            // Modes 4 and 5 have separate alpha indices, index selection bit swaps the sets
+            if (mode.index_bits2)
+            {
+                int index2 = GetIndex(lo, hi, pos + 16 * mode.index_bits - 1, mode.index_bits2, texel, 16, 16);
+
+                if (index_selection)
+                {
+                    color_index_bits = mode.index_bits2;
+                    color_index = index2;
+                }
+                else
+                {
+                    alpha_index_bits = mode.index_bits2;
+                    alpha_index = index2;
+                }
+            }
+
+            int c[4];
+
+            for (auto i = 0; i < 4; ++i)
+            {
+                c[i] = i < 3 ?
+                    Interpolate(endpoints[2 * subset][i], endpoints[2 * subset + 1][i], color_index_bits, color_index) :
+                    Interpolate(endpoints[2 * subset][i], endpoints[2 * subset + 1][i], alpha_index_bits, alpha_index);
+            }
+
+            // Rotation swaps alpha with one of color channels
+            if (rotation > 0)
+            {
+                std::swap(c[3], c[rotation - 1]);
+            }
+
+            return RadeonRays::float4(c[0] / 255.f, c[1] / 255.f, c[2] / 255.f, c[3] / 255.f);
+        }
+    }
+
+    RadeonRays::float4 DecodeBlockTexel(char const* block, Texture::Format format, int texel)
+    {
+        auto data = reinterpret_cast<std::uint8_t const*>(block);
+
+        switch (format)
+        {
+        case Texture::Format::kBc1:
+            return DecodeBc1(data, texel);
+        case Texture::Format::kBc4:
+        {
+            float r = DecodeBc4Channel(data, texel) / 255.f;
+            return RadeonRays::float4(r, r, r, 1.f);
+        }
+        case Texture::Format::kBc5:
+            return RadeonRays::float4(DecodeBc4Channel(data, texel) / 255.f, DecodeBc4Channel(data + 8, texel) / 255.f, 0.f, 1.f);
+        case Texture::Format::kBc6h:
+            return DecodeBc6h(data, texel);
+        case Texture::Format::kBc7:
+            return DecodeBc7(data, texel);
+        default:
+            return RadeonRays::float4(0.f, 0.f, 0.f, 0.f);
+        }
+    }
+
+    void DecodeBlock(char const* block, Texture::Format format, RadeonRays::float4* texels)
+    {
+        for (auto i = 0; i < kBlockTexels; ++i)
+        {
+            texels[i] = DecodeBlockTexel(block, format, i);
+        }
+    }
+
+    bool IsCompressedDataValid(Texture const& texture)
+    {
+        auto format = texture.GetFormat();
+
+        if (format != Texture::Format::kBc6h && format != Texture::Format::kBc7)
+        {
+            return true;
+        }
+
+        auto data = reinterpret_cast<std::uint8_t const*>(texture.GetData());
+        auto block_size = texture.GetBlockSizeInBytes();
+        auto num_blocks = texture.GetSizeInBytes() / block_size;
+
+        for (std::size_t i = 0; i < num_blocks; ++i)
+        {
+            auto block = data + i * block_size;
+
+            if (format == Texture::Format::kBc6h ? GetBc6hMode(LoadQword(block)) < 0 : block[0] == 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    Texture::Ptr DecompressTexture(Texture const& texture)
+    {
+        auto size = texture.GetSize();
+        auto data = new char[sizeof(float) * 4 * size.x * size.y * size.z];
+        auto texels = reinterpret_cast<float*>(data);
+
+        for (auto y = 0; y < size.y * size.z; ++y)
+        {
+            for (auto x = 0; x < size.x; ++x)
+            {
+                auto texel = texture.GetTexel(x, y);
+                texels[4 * (y * size.x + x)] = texel.x;
+                texels[4 * (y * size.x + x) + 1] = texel.y;
+                texels[4 * (y * size.x + x) + 2] = texel.z;
+                texels[4 * (y * size.x + x) + 3] = texel.w;
+            }
+        }
+
+        return Texture::Create(data, size, Texture::Format::kRgba32);
+    }
+}
@@ -0,0 +1,55 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+
+/**
+ \file block_compression.h
+ \version 1.0
+ \brief Reference decoder for block compressed texture formats.
+
+ Decoding follows Kernels/CL/texture_bc.cl bit to bit, so it can be used
+ to verify GPU results. Supported subset:
+    BC1 - both 4 and 3 color modes
+    BC4, BC5 - unsigned variants
+    BC6H - unsigned, all 14 modes (reserved modes decode to 0)
+    BC7 - all 8 modes (reserved mode decodes to 0)
+ */
+#pragma once
+
+#include "SceneGraph/texture.h"
+
+namespace Baikal
+{
+    // Number of texels in a block
+    static int const kBlockTexels = 16;
+
+    // Decode single 4x4 block into 16 RGBA texels stored row by row
+    void DecodeBlock(char const* block, Texture::Format format, RadeonRays::float4* texels);
+
+    // Decode single texel of a block (texel = row * 4 + column)
+    RadeonRays::float4 DecodeBlockTexel(char const* block, Texture::Format format, int texel);
+
+    // Check that all blocks of BC6H and BC7 textures use valid (not reserved) modes
+    bool IsCompressedDataValid(Texture const& texture);
+
+    // Decompress texture into RGBA32 texture
+    Texture::Ptr DecompressTexture(Texture const& texture);
+}
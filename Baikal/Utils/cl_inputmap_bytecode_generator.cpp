@@ -0,0 +1,231 @@
+/**********************************************************************
+Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include <assert.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+
+#include "cl_inputmap_bytecode_generator.h"
+#include "SceneGraph/inputmaps.h"
+
+
+using namespace Baikal;
+
+static_assert(sizeof(ClwScene::InputMapInstruction) == sizeof(ClwScene::InputMapData),
+    "Input map instructions should share storage with input map data");
+static_assert(ClwScene::kInputMapOpRemap == static_cast<int>(InputMap::InputMapType::kRemap) &&
+    ClwScene::kInputMapOpSamplerBumpmap == static_cast<int>(InputMap::InputMapType::kSamplerBumpmap),
+    "Input map operations should match input map types");
+
+namespace
+{
+    template <typename T>
+    std::vector<InputMap::Ptr> GetTwoArgs(InputMap const& input)
+    {
+        T const& i = static_cast<T const&>(input);
+        return { i.GetA(), i.GetB() };
+    }
+
+    template <typename T>
+    std::vector<InputMap::Ptr> GetOneArg(InputMap const& input)
+    {
+        T const& i = static_cast<T const&>(input);
+        return { i.GetArg() };
+    }
+
+    // Pack shuffle mask into bytes of single int
+    int PackMask(std::array<uint32_t, 4> const& mask)
+    {
+        return static_cast<int>(mask[0] | (mask[1] << 8) | (mask[2] << 16) | (mask[3] << 24));
+    }
+}
+
+const std::string evaluator_source =
+    "#ifndef INPUTMAPS_CL\n#define INPUTMAPS_CL\n\n"
+    "float4 GetInputMapFloat4(uint input_id, DifferentialGeometry const* dg, GLOBAL InputMapData const* restrict input_map_values, TEXTURE_ARG_LIST)\n{\n"
+    "\treturn InputMap_Evaluate(input_id, dg, input_map_values, TEXTURE_ARGS);\n"
+    "}\n"
+    "float GetInputMapFloat(uint input_id, DifferentialGeometry const* dg, GLOBAL InputMapData const* restrict input_map_values, TEXTURE_ARG_LIST)\n{\n"
+    "\treturn GetInputMapFloat4(input_id, dg, input_map_values, TEXTURE_ARGS).x;\n"
+    "}\n"
+    "#endif\n\n";
+
+const std::string& CLInputMapBytecodeGenerator::GetEvaluatorSource()
+{
+    return evaluator_source;
+}
+
+bool CLInputMapBytecodeGenerator::Generate(const Collector& input_map_collector, const Collector& input_map_leaf_collector)
+{
+    m_bytecode.clear();
+    m_max_stack_depth = 0;
+
+    // Directory has to be sorted by id
+    std::map <uint32_t, InputMap::Ptr> inputs;
+
+    auto input_iter = input_map_collector.CreateIterator();
+    for (; input_iter->IsValid(); input_iter->Next())
+    {
+        auto input = input_iter->ItemAs<InputMap>();
+        inputs.insert(std::make_pair(input->GetId(), input));
+    }
+
+    // Number of directory entries followed by the entries, program offsets are filled below
+    m_bytecode.push_back({ 0, { static_cast<int>(inputs.size()), 0, 0 } });
+
+    for (auto &input : inputs)
+    {
+        m_bytecode.push_back({ static_cast<int>(input.first), { 0, 0, 0 } });
+    }
+
+    auto entry = 1u;
+    for (auto &input : inputs)
+    {
+        m_bytecode[entry++].args[0] = static_cast<int>(m_bytecode.size());
+
+        m_stack_depth = 0;
+        GenerateInputBytecode(input.second, input_map_leaf_collector);
+        assert(m_stack_depth == 1);
+
+        m_bytecode.push_back({ ClwScene::kInputMapOpReturn, { 0, 0, 0 } });
+    }
+
+    return m_max_stack_depth <= kMaxStackDepth;
+}
+
+void CLInputMapBytecodeGenerator::AddInstruction(InputMap::InputMapType type, std::uint32_t num_args, int arg)
+{
+    m_bytecode.push_back({ static_cast<int>(type), { arg, 0, 0 } });
+
+    assert(m_stack_depth >= num_args);
+    m_stack_depth = m_stack_depth - num_args + 1;
+    m_max_stack_depth = std::max(m_max_stack_depth, m_stack_depth);
+}
+
+void CLInputMapBytecodeGenerator::GenerateInputBytecode(std::shared_ptr<Baikal::InputMap> input, const Collector& input_map_leaf_collector)
+{
+    // Arguments are evaluated in order, then the operation replaces them with the result
+    std::vector<InputMap::Ptr> args;
+    int arg = 0;
+
+    switch (input->m_type)
+    {
+        case InputMap::InputMapType::kConstantFloat:
+        case InputMap::InputMapType::kConstantFloat3:
+        case InputMap::InputMapType::kSampler:
+        case InputMap::InputMapType::kSamplerBumpmap:
+            arg = static_cast<int>(input_map_leaf_collector.GetItemIndex(input));
+            break;
+        // Two inputs
+        case InputMap::InputMapType::kAdd: args = GetTwoArgs<InputMap_Add>(*input); break;
+        case InputMap::InputMapType::kSub: args = GetTwoArgs<InputMap_Sub>(*input); break;
+        case InputMap::InputMapType::kMul: args = GetTwoArgs<InputMap_Mul>(*input); break;
+        case InputMap::InputMapType::kDiv: args = GetTwoArgs<InputMap_Div>(*input); break;
+        case InputMap::InputMapType::kMin: args = GetTwoArgs<InputMap_Min>(*input); break;
+        case InputMap::InputMapType::kMax: args = GetTwoArgs<InputMap_Max>(*input); break;
+        case InputMap::InputMapType::kDot3: args = GetTwoArgs<InputMap_Dot3>(*input); break;
+        case InputMap::InputMapType::kDot4: args = GetTwoArgs<InputMap_Dot4>(*input); break;
+        case InputMap::InputMapType::kCross3: args = GetTwoArgs<InputMap_Cross3>(*input); break;
+        case InputMap::InputMapType::kCross4: args = GetTwoArgs<InputMap_Cross4>(*input); break;
+        case InputMap::InputMapType::kPow: args = GetTwoArgs<InputMap_Pow>(*input); break;
+        case InputMap::InputMapType::kMod: args = GetTwoArgs<InputMap_Mod>(*input); break;
+        // Single input
+        case InputMap::InputMapType::kSin: args = GetOneArg<InputMap_Sin>(*input); break;
+        case InputMap::InputMapType::kCos: args = GetOneArg<InputMap_Cos>(*input); break;
+        case InputMap::InputMapType::kTan: args = GetOneArg<InputMap_Tan>(*input); break;
+        case InputMap::InputMapType::kAsin: args = GetOneArg<InputMap_Asin>(*input); break;
+        case InputMap::InputMapType::kAcos: args = GetOneArg<InputMap_Acos>(*input); break;
+        case InputMap::InputMapType::kAtan: args = GetOneArg<InputMap_Atan>(*input); break;
+        case InputMap::InputMapType::kLength3: args = GetOneArg<InputMap_Length3>(*input); break;
+        case InputMap::InputMapType::kNormalize3: args = GetOneArg<InputMap_Normalize3>(*input); break;
+        case InputMap::InputMapType::kFloor: args = GetOneArg<InputMap_Floor>(*input); break;
+        case InputMap::InputMapType::kAbs: args = GetOneArg<InputMap_Abs>(*input); break;
+        // Specials
+        case InputMap::InputMapType::kLerp:
+        {
+            InputMap_Lerp *i = static_cast<InputMap_Lerp*>(input.get());
+            args = { i->GetA(), i->GetB(), i->GetControl() };
+            break;
+        }
+        case InputMap::InputMapType::kSelect:
+        {
+            InputMap_Select *i = static_cast<InputMap_Select*>(input.get());
+            assert(static_cast<uint32_t>(i->GetSelection()) < 4);
+            args = { i->GetArg() };
+            arg = static_cast<int>(i->GetSelection());
+            break;
+        }
+        case InputMap::InputMapType::kShuffle:
+        {
+            InputMap_Shuffle *i = static_cast<InputMap_Shuffle*>(input.get());
+            args = { i->GetArg() };
+            arg = PackMask(i->GetMask());
+            break;
+        }
+        case InputMap::InputMapType::kShuffle2:
+        {
+            InputMap_Shuffle2 *i = static_cast<InputMap_Shuffle2*>(input.get());
+            args = { i->GetA(), i->GetB() };
+            arg = PackMask(i->GetMask());
+            break;
+        }
+        case InputMap::InputMapType::kMatMul:
+            args = GetOneArg<InputMap_MatMul>(*input);
+            break;
+        case InputMap::InputMapType::kRemap:
+        {
+            InputMap_Remap *i = static_cast<InputMap_Remap*>(input.get());
+            args = { i->GetDestinationRange(), i->GetSourceRange(), i->GetData() };
+            break;
+        }
+    }
+
+    for (auto& a : args)
+    {
+        GenerateInputBytecode(a, input_map_leaf_collector);
+    }
+
+    AddInstruction(input->m_type, static_cast<std::uint32_t>(args.size()), arg);
+
+    if (input->m_type == InputMap::InputMapType::kMatMul)
+    {
+        // Matrix rows follow the instruction
+        auto mat4 = static_cast<InputMap_MatMul*>(input.get())->GetMatrix();
+        float rows[4][4] =
+        {
+            { mat4.m00, mat4.m01, mat4.m02, mat4.m03 },
+            { mat4.m10, mat4.m11, mat4.m12, mat4.m13 },
+            { mat4.m20, mat4.m21, mat4.m22, mat4.m23 },
+            { mat4.m30, mat4.m31, mat4.m32, mat4.m33 }
+        };
+
+        for (auto const& row : rows)
+        {
+            ClwScene::InputMapInstruction instruction;
+            std::memcpy(&instruction, row, sizeof(instruction));
+            m_bytecode.push_back(instruction);
+        }
+    }
+}
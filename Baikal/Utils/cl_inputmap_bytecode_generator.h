@@ -0,0 +1,77 @@
+/**********************************************************************
+Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SceneGraph/scene1.h"
+#include "SceneGraph/Collector/collector.h"
+#include "SceneGraph/clwscene.h"
+#include "SceneGraph/inputmap.h"
+
+namespace Baikal
+{
+    class CLInputMapBytecodeGenerator
+    {
+    public:
+        // Max depth of evaluation stack, has to match INPUTMAP_STACK_SIZE in inputmap_evaluator.cl
+        static std::uint32_t constexpr kMaxStackDepth = 8;
+
+        /**
+        * @brief Encodes input maps into bytecode evaluated by kernels at runtime.
+        *
+        * Each input map becomes a postfix program for the stack machine in
+        * inputmap_evaluator.cl. Programs are preceded by a directory sorted by input map id,
+        * all offsets are relative to the beginning of the bytecode and leafs are referenced
+        * by their indices in leaf collector, so bytecode can be placed anywhere after leafs.
+        *
+        * @param input_map_collector set of input maps for generation
+        * @param input_map_leaf_collector list of leaf nodes that holds values
+        * @return false if some input map needs deeper stack than the evaluator has
+        */
+        bool Generate(const Collector& input_map_collector, const Collector& input_map_leaf_collector);
+
+        // Returns generated bytecode
+        const std::vector<ClwScene::InputMapInstruction>& GetBytecode() const
+        {
+            return m_bytecode;
+        }
+
+        // Returns inputmaps.cl source redirecting input map lookups to the evaluator,
+        // it does not depend on input maps so graph changes do not invalidate programs
+        static const std::string& GetEvaluatorSource();
+
+    private:
+        // Writes program of single input map. Called recursively.
+        void GenerateInputBytecode(std::shared_ptr<Baikal::InputMap> input, const Collector& input_map_leaf_collector);
+        // Appends instruction consuming num_args stack values and pushing the result
+        void AddInstruction(InputMap::InputMapType type, std::uint32_t num_args, int arg = 0);
+
+        std::vector<ClwScene::InputMapInstruction> m_bytecode;
+        std::uint32_t m_stack_depth = 0;
+        std::uint32_t m_max_stack_depth = 0;
+    };
+}
@@ -28,86 +28,19 @@ THE SOFTWARE.
 #include <algorithm>
 #include <fstream>
 #include <sstream>
-#include <regex>
 
 #include "cl_program_manager.h"
+#include "program_cache.h"
 #include "version.h"
-#include "Utils/mkpath.h"
 
 //#define DUMP_PROGRAM_SOURCE 1
 
 using namespace Baikal;
 
-inline std::uint32_t jenkins_one_at_a_time_hash(char const *key, size_t len)
-{
-    std::uint32_t hash, i;
-    for (hash = i = 0; i < len; ++i)
-    {
-        hash += key[i];
-        hash += (hash << 10);
-        hash ^= (hash >> 6);
-    }
-    hash += (hash << 3);
-    hash ^= (hash >> 11);
-    hash += (hash << 15);
-    return hash;
-}
-
-// Computting check sum algo
-// Copy from here: https://codereview.stackexchange.com/questions/104948/32-bit-checksum-of-a-file
-inline std::uint32_t CheckSum(const std::string &source)
-{
-    std::uint32_t check_sum = 0;
-    unsigned shift = 0;
-    for (uint32_t ch : source)
-    {
-        check_sum += (ch << shift);
-        shift += 8;
-        if (shift == 32) {
-            shift = 0;
-        }
-    }
-    return check_sum;
-}
-
-inline bool LoadBinaries(std::string const& name, std::vector<std::uint8_t>& data)
-{
-    std::ifstream in(name, std::ios::in | std::ios::binary);
-    if (in)
-    {
-        data.clear();
-        std::streamoff beg = in.tellg();
-        in.seekg(0, std::ios::end);
-        std::streamoff fileSize = in.tellg() - beg;
-        in.seekg(0, std::ios::beg);
-        data.resize(static_cast<unsigned>(fileSize));
-        in.read((char*)&data[0], fileSize);
-        return true;
-    }
-    else
-    {
-        return false;
-    }
-}
-
-inline void SaveBinaries(std::string const& name, std::vector<std::uint8_t>& data)
-{
-    mkfilepath(name);
-
-    std::ofstream out(name, std::ios::out | std::ios::binary);
-
-    if (out)
-    {
-        out.write((char*)&data[0], data.size());
-    }
-}
-
-
 CLProgram::CLProgram(const CLProgramManager *program_manager, uint32_t id, CLWContext context,
-                     const std::string &program_name, const std::string &cache_path) :
+                     const std::string &program_name) :
     m_program_manager(program_manager),
     m_program_name(program_name),
-    m_cache_path(cache_path),
     m_id(id),
     m_context(context)
 {
@@ -175,6 +108,13 @@ void CLProgram::BuildSource(const std::string &source)
 }
 
 CLWProgram CLProgram::Compile(const std::string &opts)
+{
+    auto compiled_program = CompileSource(m_compiled_source, opts);
+    m_is_dirty = false;
+    return compiled_program;
+}
+
+CLWProgram CLProgram::CompileSource(const std::string &source, const std::string &opts) const
 {
     std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
     start = std::chrono::high_resolution_clock::now();
@@ -182,14 +122,14 @@ CLWProgram CLProgram::Compile(const std::string &opts)
     CLWProgram compiled_program;
     try
     {
-        compiled_program = CLWProgram::CreateFromSource(m_compiled_source.c_str(), m_compiled_source.size(), opts.c_str(), m_context);
+        compiled_program = CLWProgram::CreateFromSource(source.c_str(), source.size(), opts.c_str(), m_context);
         /*
          * Code below usable for cache debugging
          */
 #ifdef DUMP_PROGRAM_SOURCE
         auto e = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
         std::ofstream file(m_program_name + std::to_string(e) + ".cl");
-        file << m_compiled_source;
+        file << source;
         file.close();
 #endif
     }
@@ -199,7 +139,7 @@ CLWProgram CLProgram::Compile(const std::string &opts)
         std::cerr << "Dumping source to file:" << m_program_name << ".cl.failed" << std::endl;
         std::string fname = m_program_name + ".cl.failed";
         std::ofstream file(fname);
-        file << m_compiled_source;
+        file << source;
         file.close();
         throw;
     }
@@ -207,8 +147,8 @@ CLWProgram CLProgram::Compile(const std::string &opts)
     end = std::chrono::high_resolution_clock::now();
     int elapsed_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
     std::cerr << "Program compilation time: " << elapsed_ms << " ms" << std::endl;
+    m_program_manager->AddCompileTime(elapsed_ms);
 
-    m_is_dirty = false;
     return compiled_program;
 }
 
@@ -217,7 +157,7 @@ bool CLProgram::IsHeaderNeeded(const std::string &header_name) const
     return (m_required_headers.find(header_name) != m_required_headers.end());
 }
 
-CLWProgram CLProgram::GetCLWProgram(const std::string &opts)
+void CLProgram::UpdateSource()
 {
     // global dirty flag
     if (m_is_dirty)
@@ -226,7 +166,14 @@ CLWProgram CLProgram::GetCLWProgram(const std::string &opts)
         m_compiled_source.clear();
         m_included_headers.clear();
         BuildSource(m_program_source);
+        ++m_revision;
+        m_is_dirty = false;
     }
+}
+
+CLWProgram CLProgram::GetCLWProgram(const std::string &opts)
+{
+    UpdateSource();
 
     auto it = m_programs.find(opts);
     if (it != m_programs.end())
@@ -234,72 +181,82 @@ CLWProgram CLProgram::GetCLWProgram(const std::string &opts)
         return it->second;
     }
 
-    CLWProgram result;
-    //check if we can get it from cache
-    if (!m_cache_path.empty())
+    auto result = Build(m_compiled_source, opts);
+    m_programs[opts] = result;
+    return result;
+}
+
+void CLProgram::AddCLWProgram(const std::string &opts, uint32_t revision, CLWProgram program)
+{
+    if (!m_is_dirty && revision == m_revision)
     {
-        std::string filename = GetFilenameHash(opts);
+        m_programs[opts] = program;
+    }
+}
+
+CLWProgram CLProgram::Build(const std::string &source, const std::string &opts) const
+{
+    CLWProgram result;
+    bool cache_enabled = m_program_manager->IsProgramCacheEnabled();
 
-        auto cached_program_path = m_cache_path;
-        cached_program_path.append("/");
-        cached_program_path.append(filename);
-        cached_program_path.append(".bin");
+    // Check if we can get it from cache
+    std::vector<std::uint8_t> binary;
+    auto key = cache_enabled ? GetCacheKey(source, opts) : std::string();
 
-        std::vector<std::uint8_t> binary;
-        if (LoadBinaries(cached_program_path, binary))
+    if (cache_enabled && m_program_manager->LoadProgramBinary(key, binary))
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        try
         {
             // Create from binary
             std::size_t size = binary.size();
             auto binaries = &binary[0];
             result = CLWProgram::CreateFromBinary(&binaries, &size, m_context);
-            m_programs[opts] = result;
         }
-        else
+        catch (CLWException&)
         {
-            result = Compile(opts);
-            m_programs[opts] = result;
+            // Driver rejected the binary, rebuild it from source and replace cache entry
+            binary.clear();
+        }
 
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        m_program_manager->AddLoadTime((std::uint32_t)elapsed_ms);
+    }
+
+    if (binary.empty())
+    {
+        result = CompileSource(source, opts);
+
+        if (cache_enabled)
+        {
             // Save binaries
             result.GetBinaries(0, binary);
-            SaveBinaries(cached_program_path, binary);
+            m_program_manager->StoreProgramBinary(key, binary);
         }
     }
 
-    m_is_dirty = false;
     return result;
 }
 
-std::string CLProgram::GetFilenameHash(std::string const& opts) const
+std::string CLProgram::GetCacheKey(std::string const& source, std::string const& opts) const
 {
-    auto name = m_program_name;
-    auto device_name = m_context.GetDevice(0).GetName();
-
-    std::regex forbidden("(\\\\)|[\\./:<>\\\"\\|\\?\\*]");
-
-    device_name = std::regex_replace(device_name, forbidden, "_");
-    device_name.erase(
-        std::remove_if(device_name.begin(), device_name.end(), isspace),
-                      device_name.end());
-
-    name.append("_");
-    name.append(device_name);
-
-    auto extra = m_context.GetDevice(0).GetVersion();
-    extra.append(opts);
-
-    std::ostringstream oss;
-    oss << jenkins_one_at_a_time_hash(extra.c_str(), extra.size());
-
-    name.append("_");
-    name.append(oss.str());
-
-
-    std::uint32_t file_hash = CheckSum(m_compiled_source);
-
-    name.append("_");
-    name.append(std::to_string(file_hash));
-
-    name.append(BAIKAL_VERSION);
-
-    return name;
+    auto device = m_context.GetDevice(0);
+
+    // Driver updates change generated code, so driver version goes into the key as well
+    char driver_version[256] = {};
+    clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(driver_version) - 1, driver_version, nullptr);
+
+    auto hash = ProgramCache::ComputeKey({
+        source,
+        opts,
+        device.GetName(),
+        device.GetVersion(),
+        driver_version,
+        BAIKAL_VERSION
+    });
+
+    // Keep program name for readability of cache folder
+    return m_program_name + "_" + hash;
 }
@@ -38,7 +38,7 @@ namespace Baikal
     public:
         CLProgram() = default;
         // Constructs CLProgram empty object
-        CLProgram(const CLProgramManager *program_manager, uint32_t id, CLWContext context, const std::string &program_name, const std::string &cache_path);
+        CLProgram(const CLProgramManager *program_manager, uint32_t id, CLWContext context, const std::string &program_name);
         // Check if program should be recompiled
         bool IsDirty() const { return m_is_dirty; }
         // Sets dirty flag on program
@@ -59,7 +59,7 @@ namespace Baikal
          * This function will build program and compile it if it's durty.
          * This function respronsible for shader cache handling. If required program
          * already exists in disk or in-memory cache returns it.
-         * For caching uses simple uint32 crc of source code.
+         * Disk cache is keyed by SHA-256 of expanded source, options and device/driver versions.
          */
         CLWProgram GetCLWProgram(const std::string &opts);
 
@@ -69,6 +69,23 @@ namespace Baikal
         // Compiles program. In case of error dumps source into current folder
         CLWProgram Compile(const std::string &opts);
 
+        // Rebuilds full source if program is dirty, compiled variants are dropped in this case
+        void UpdateSource();
+        // Full program source and its revision, which changes every time the source is rebuilt
+        const std::string& GetCompiledSource() const { return m_compiled_source; }
+        uint32_t GetRevision() const { return m_revision; }
+        // Checks if variant is in in-memory cache
+        bool HasCLWProgram(const std::string &opts) const { return m_programs.find(opts) != m_programs.end(); }
+        // Adds variant built from the source of specified revision, ignored if the source has changed since
+        void AddCLWProgram(const std::string &opts, uint32_t revision, CLWProgram program);
+        /**
+         * @brief Loads program from disk cache or compiles it from source
+         *
+         * Does not modify program state, so it may be called from several threads
+         * at once with a copy of the source.
+         */
+        CLWProgram Build(const std::string &source, const std::string &opts) const;
+
     private:
         // Parses source
         void ParseSource(const std::string &source);
@@ -78,12 +95,13 @@ namespace Baikal
          * Duplicate includes removed.
          */
         void BuildSource(const std::string &source);
-        // Returns hash for file name
-        std::string GetFilenameHash(std::string const& opts) const;
+        // Compiles source, does not modify program state
+        CLWProgram CompileSource(const std::string &source, const std::string &opts) const;
+        // Returns program cache key
+        std::string GetCacheKey(std::string const& source, std::string const& opts) const;
 
         const CLProgramManager *m_program_manager;
         std::string m_program_name;    ///< Program name
-        std::string m_cache_path;      ///< Cache folder path
         std::string m_compiled_source; ///< Final program source with all headers
         std::string m_program_source;  ///< Program source code without modifications
         std::unordered_set<std::string> m_required_headers; ///< Set of required headers
@@ -91,6 +109,7 @@ namespace Baikal
         std::unordered_map<std::string, CLWProgram> m_programs; ///< In-memory cache for compiled programs
 
         bool m_is_dirty = true;
+        uint32_t m_revision = 0;
         uint32_t m_id;
         CLWContext m_context;
         std::set<std::string> m_included_headers; ///< Set of included headers
@@ -21,6 +21,7 @@ THE SOFTWARE.
 ********************************************************************/
 
 #include "cl_program_manager.h"
+#include "thread_pool.h"
 
 #include <fstream>
 #include <regex>
@@ -46,12 +47,18 @@ std::string ReadFile(const std::string &fname)
     str.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
     return str;
 }
-CLProgramManager::CLProgramManager(const std::string &cache_path) :
-    m_cache_path(cache_path)
+CLProgramManager::CLProgramManager(const std::string &cache_path, std::uint64_t max_cache_size) :
+    m_cache_path(cache_path),
+    m_program_cache(cache_path, max_cache_size)
 {
 
 }
 
+CLProgramManager::~CLProgramManager()
+{
+    WaitForWarmup();
+}
+
 uint32_t CLProgramManager::CreateProgram(CLWContext context, const std::string &fname) const
 {
     std::regex delimiter("\\\\");
@@ -71,8 +78,9 @@ uint32_t CLProgramManager::CreateProgram(CLWContext context, const std::string &
 
     auto name = fullpath.substr(filename_start, filename_end - filename_start);
 
+    std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
 
-    CLProgram prg(this, m_next_program_id++, context, name, m_cache_path);
+    CLProgram prg(this, m_next_program_id++, context, name);
     prg.SetSource(ReadFile(fname));
     m_programs.insert(std::make_pair(prg.GetId(), prg));
     return prg.GetId();
@@ -80,6 +88,7 @@ uint32_t CLProgramManager::CreateProgram(CLWContext context, const std::string &
 
 void CLProgramManager::AddHeader(const std::string &header, const std::string &source) const
 {
+    std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
     std::string currect_header_code = m_headers[header];
     if (currect_header_code != source)
     {
@@ -103,17 +112,224 @@ void CLProgramManager::LoadHeader(const std::string &header) const
 
 const std::string& CLProgramManager::ReadHeader(const std::string &header) const
 {
+    std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
     return m_headers[header];
 }
 
 CLWProgram CLProgramManager::GetProgram(uint32_t id, const std::string &opts) const
 {
-    CLProgram &program = m_programs[id];
-    return program.GetCLWProgram(opts);
+    CLProgram *program = nullptr;
+    std::string source;
+    uint32_t revision = 0;
+
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_programs_mutex);
+
+        // Variant might be compiled in background right now
+        auto variant = std::make_pair(id, opts);
+        m_variant_ready.wait(lock, [this, &variant]()
+        {
+            return m_pending_variants.find(variant) == m_pending_variants.end();
+        });
+
+        program = &m_programs[id];
+        program->UpdateSource();
+
+        if (program->HasCLWProgram(opts))
+        {
+            return program->GetCLWProgram(opts);
+        }
+
+        source = program->GetCompiledSource();
+        revision = program->GetRevision();
+    }
+
+    // Build without holding the lock, so other programs are not blocked by the compiler
+    auto compiled_program = program->Build(source, opts);
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
+        program->AddCLWProgram(opts, revision, compiled_program);
+    }
+
+    return compiled_program;
 }
 
 void CLProgramManager::CompileProgram(uint32_t id, const std::string &opts) const
 {
+    std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
     CLProgram &program = m_programs[id];
     program.Compile(opts);
 }
+
+CLProgramManager::CacheStats CLProgramManager::GetCacheStats() const
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+
+    CacheStats stats;
+    stats.cache_hits = m_program_cache.GetStats().hits;
+    stats.cache_misses = m_program_cache.GetStats().misses;
+    stats.cache_evictions = m_program_cache.GetStats().evictions;
+    stats.num_compiled = m_num_compiled;
+    stats.compile_time_ms = m_compile_time_ms;
+    stats.load_time_ms = m_load_time_ms;
+    return stats;
+}
+
+void CLProgramManager::AddCompileTime(std::uint32_t time_ms) const
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    ++m_num_compiled;
+    m_compile_time_ms += time_ms;
+}
+
+void CLProgramManager::AddLoadTime(std::uint32_t time_ms) const
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    m_load_time_ms += time_ms;
+}
+
+bool CLProgramManager::LoadProgramBinary(const std::string &key, std::vector<std::uint8_t> &binary) const
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    return m_program_cache.Load(key, binary);
+}
+
+void CLProgramManager::StoreProgramBinary(const std::string &key, const std::vector<std::uint8_t> &binary) const
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    m_program_cache.Store(key, binary);
+}
+
+void CLProgramManager::AddProgramVariant(uint32_t id, const std::string &opts) const
+{
+    std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
+    m_variants.insert(std::make_pair(id, opts));
+}
+
+std::vector<CLProgramManager::ProgramVariant> CLProgramManager::GetProgramVariants() const
+{
+    std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
+
+    std::vector<ProgramVariant> variants;
+    for (auto const& variant : m_variants)
+    {
+        variants.push_back({ variant.first, variant.second });
+    }
+
+    return variants;
+}
+
+void CLProgramManager::CompileProgramsAsync(const std::vector<ProgramVariant> &variants, std::uint32_t num_threads) const
+{
+    // Only one warm-up at a time
+    WaitForWarmup();
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
+
+        for (auto const& variant : variants)
+        {
+            m_pending_variants.insert(std::make_pair(variant.id, variant.opts));
+        }
+
+        m_warmup_num_variants = static_cast<std::uint32_t>(variants.size());
+        m_warmup_num_ready = 0;
+        m_warmup_time_ms = 0;
+        m_warmup_start = std::chrono::high_resolution_clock::now();
+    }
+
+    m_warmup_thread = std::thread([this, variants, num_threads]()
+    {
+        // Warm-up thread takes part in compilation as well
+        ThreadPool pool(num_threads);
+
+        pool.ParallelFor(variants.size(), 1, [this, &variants](std::size_t begin, std::size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                CompileVariant(variants[i]);
+            }
+        });
+    });
+}
+
+void CLProgramManager::CompileVariant(const ProgramVariant &variant) const
+{
+    CLProgram *program = nullptr;
+    std::string source;
+    uint32_t revision = 0;
+    CLWProgram compiled_program;
+    bool compiled = false;
+
+    try
+    {
+        {
+            std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
+
+            auto it = m_programs.find(variant.id);
+
+            if (it != m_programs.end())
+            {
+                it->second.UpdateSource();
+
+                if (!it->second.HasCLWProgram(variant.opts))
+                {
+                    program = &it->second;
+                    source = program->GetCompiledSource();
+                    revision = program->GetRevision();
+                }
+            }
+        }
+
+        if (program)
+        {
+            // Programs are never removed, so it is safe to build without holding the lock
+            compiled_program = program->Build(source, variant.opts);
+            compiled = true;
+        }
+    }
+    catch (...)
+    {
+        // GetProgram compiles the variant again and reports the error to the caller
+    }
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
+
+        if (compiled)
+        {
+            program->AddCLWProgram(variant.opts, revision, compiled_program);
+        }
+
+        // Waiters have to be released whatever happened to the variant
+        m_pending_variants.erase(std::make_pair(variant.id, variant.opts));
+        ++m_warmup_num_ready;
+        m_warmup_time_ms = static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - m_warmup_start).count());
+    }
+
+    m_variant_ready.notify_all();
+}
+
+CLProgramManager::WarmupStatus CLProgramManager::GetWarmupStatus() const
+{
+    std::lock_guard<std::recursive_mutex> lock(m_programs_mutex);
+
+    WarmupStatus status;
+    status.num_variants = m_warmup_num_variants;
+    status.num_ready = m_warmup_num_ready;
+    status.done = m_warmup_num_ready == m_warmup_num_variants;
+    status.elapsed_ms = status.done ? m_warmup_time_ms :
+        static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - m_warmup_start).count());
+    return status;
+}
+
+void CLProgramManager::WaitForWarmup() const
+{
+    if (m_warmup_thread.joinable())
+    {
+        m_warmup_thread.join();
+    }
+}
@@ -24,12 +24,18 @@ THE SOFTWARE.
 
 #include <string>
 #include <stdint.h>
+#include <chrono>
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <vector>
 
 #include "CLWProgram.h"
 #include "CLWContext.h"
 #include "cl_program.h"
+#include "program_cache.h"
 
 
 namespace Baikal
@@ -37,8 +43,38 @@ namespace Baikal
     class CLProgramManager
     {
     public:
+        // Program cache and compilation statistics
+        struct CacheStats
+        {
+            std::uint32_t cache_hits = 0;
+            std::uint32_t cache_misses = 0;
+            std::uint32_t cache_evictions = 0;
+            std::uint32_t num_compiled = 0;
+            std::uint32_t compile_time_ms = 0;
+            std::uint32_t load_time_ms = 0;
+        };
+
+        // Program and build options to compile ahead of time
+        struct ProgramVariant
+        {
+            uint32_t id;
+            std::string opts;
+        };
+
+        // Background compilation progress
+        struct WarmupStatus
+        {
+            std::uint32_t num_variants = 0;
+            std::uint32_t num_ready = 0;
+            // Time since the start or total time once done
+            std::uint32_t elapsed_ms = 0;
+            bool done = true;
+        };
+
         // Constructor
-        explicit CLProgramManager(const std::string &cache_path);
+        explicit CLProgramManager(const std::string &cache_path, std::uint64_t max_cache_size = ProgramCache::kDefaultMaxSize);
+        // Waits for background compilation
+        ~CLProgramManager();
         // Creates program from file and returns its id
         uint32_t CreateProgram(CLWContext context, const std::string &fname) const;
         // Loads header from file into map of headers
@@ -51,11 +87,63 @@ namespace Baikal
         CLWProgram GetProgram(uint32_t id, const std::string &opts) const;
         // Compiles program
         void CompileProgram(uint32_t id, const std::string &opts) const;
+        // Returns program cache and compilation statistics
+        CacheStats GetCacheStats() const;
+
+        // Registers build options program is going to be used with
+        void AddProgramVariant(uint32_t id, const std::string &opts) const;
+        // Returns all registered variants
+        std::vector<ProgramVariant> GetProgramVariants() const;
+        /**
+         * @brief Compiles variants on a pool of background threads
+         *
+         * Returns immediately. GetProgram called for a variant which is still being compiled
+         * waits for that variant only, other variants are compiled synchronously as usual.
+         * Variants built before one of their headers changed are discarded.
+         * num_threads == 0 means hardware concurrency.
+         */
+        void CompileProgramsAsync(const std::vector<ProgramVariant> &variants, std::uint32_t num_threads = 0) const;
+        // Returns background compilation progress
+        WarmupStatus GetWarmupStatus() const;
+        // Waits until all variants passed to CompileProgramsAsync are compiled
+        void WaitForWarmup() const;
+
+        CLProgramManager(CLProgramManager const&) = delete;
+        CLProgramManager& operator = (CLProgramManager const&) = delete;
 
     private:
+        friend class CLProgram;
+
+        // Program binary cache shared by all programs, safe to call from several threads
+        bool IsProgramCacheEnabled() const { return m_program_cache.IsEnabled(); }
+        bool LoadProgramBinary(const std::string &key, std::vector<std::uint8_t> &binary) const;
+        void StoreProgramBinary(const std::string &key, const std::vector<std::uint8_t> &binary) const;
+        // Accounts program compilation or load from cache
+        void AddCompileTime(std::uint32_t time_ms) const;
+        void AddLoadTime(std::uint32_t time_ms) const;
+        // Compiles a single variant on a background thread
+        void CompileVariant(const ProgramVariant &variant) const;
+
         mutable std::string m_cache_path; ///< Path to cache folder
+        mutable ProgramCache m_program_cache; ///< On-disk cache of program binaries
+        mutable std::uint32_t m_num_compiled = 0; ///< Number of programs compiled from source
+        mutable std::uint32_t m_compile_time_ms = 0; ///< Total compilation time
+        mutable std::uint32_t m_load_time_ms = 0; ///< Total time of program creation from cached binaries
         mutable std::map<uint32_t, CLProgram> m_programs; ///< Cache of programs by id
         mutable std::map<std::string, std::string> m_headers; ///< Headers map
+        mutable std::set<std::pair<uint32_t, std::string>> m_variants; ///< Registered program variants
+
+        mutable std::mutex m_cache_mutex; ///< Protects program cache and statistics
+        /// Protects programs, headers and warm-up state. Recursive since programs
+        /// load headers while being created.
+        mutable std::recursive_mutex m_programs_mutex;
+        mutable std::condition_variable_any m_variant_ready; ///< Signaled when background variant is done
+        mutable std::set<std::pair<uint32_t, std::string>> m_pending_variants; ///< Variants compiled in background
+        mutable std::thread m_warmup_thread; ///< Thread running background compilation
+        mutable std::uint32_t m_warmup_num_variants = 0;
+        mutable std::uint32_t m_warmup_num_ready = 0;
+        mutable std::uint32_t m_warmup_time_ms = 0;
+        mutable std::chrono::high_resolution_clock::time_point m_warmup_start;
         static uint32_t m_next_program_id;
     };
 }
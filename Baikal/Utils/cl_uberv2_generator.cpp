@@ -504,7 +504,7 @@ std::string Baikal::CLUberV2Generator::BuildSource()
     source.reserve(10240); //10k should be enought
 
     // Merge all per-material sources
-    for(auto material : m_materials)
+    for (auto const& material : m_materials)
     {
         source += material.second.m_get_bxdf_type + "\n";
         source += material.second.m_evaluate + "\n";
@@ -530,11 +530,19 @@ std::string Baikal::CLUberV2Generator::GenerateEvaluateDispatcher()
         "(DifferentialGeometry const* dg, float3 wi, float3 wo, TEXTURE_ARG_LIST, UberV2ShaderData const* shader_data)\n"
         "{\n"
         "\tfloat3 wi_t = matrix_mul_vector3(dg->world_to_tangent, wi);\n"
-        "\tfloat3 wo_t = matrix_mul_vector3(dg->world_to_tangent, wo);\n"
-        "\tswitch (dg->mat.layers)\n"
+        "\tfloat3 wo_t = matrix_mul_vector3(dg->world_to_tangent, wo);\n";
+
+    // Single material type in the scene: call it directly, no need to branch on layers
+    if (m_materials.size() == 1)
+    {
+        source += "\treturn UberV2_Evaluate" + std::to_string(m_materials.begin()->first) + "(dg, wi_t, wo_t, TEXTURE_ARGS, shader_data);\n}\n";
+        return source;
+    }
+
+    source += "\tswitch (dg->mat.layers)\n"
         "\t{\n";
 
-    for(auto material : m_materials)
+    for (auto const& material : m_materials)
     {
         source += "\t\tcase " + std::to_string(material.first) + ":\n" +
             "\t\t\treturn UberV2_Evaluate" + std::to_string(material.first) + "(dg, wi_t, wo_t, TEXTURE_ARGS, shader_data);\n";
@@ -554,11 +562,18 @@ std::string Baikal::CLUberV2Generator::GenerateGetPdfDispatcher()
         "(DifferentialGeometry const* dg, float3 wi, float3 wo, TEXTURE_ARG_LIST, UberV2ShaderData const* shader_data)\n"
         "{\n"
         "\tfloat3 wi_t = matrix_mul_vector3(dg->world_to_tangent, wi);\n"
-        "\tfloat3 wo_t = matrix_mul_vector3(dg->world_to_tangent, wo);\n"
-        "\tswitch (dg->mat.layers)\n"
+        "\tfloat3 wo_t = matrix_mul_vector3(dg->world_to_tangent, wo);\n";
+
+    if (m_materials.size() == 1)
+    {
+        source += "\treturn UberV2_GetPdf" + std::to_string(m_materials.begin()->first) + "(dg, wi_t, wo_t, TEXTURE_ARGS, shader_data);\n}\n";
+        return source;
+    }
+
+    source += "\tswitch (dg->mat.layers)\n"
         "\t{\n";
 
-    for(auto material : m_materials)
+    for (auto const& material : m_materials)
     {
         source += "\t\tcase " + std::to_string(material.first) + ":\n" +
             "\t\t\treturn UberV2_GetPdf" + std::to_string(material.first) + "(dg, wi_t, wo_t, TEXTURE_ARGS, shader_data);\n";
@@ -580,18 +595,28 @@ std::string Baikal::CLUberV2Generator::GenerateSampleDispatcher()
         "{\n"
         "\tfloat3 wi_t = matrix_mul_vector3(dg->world_to_tangent, wi);\n"
         "\tfloat3 wo_t;\n"
-        "\tfloat3 res = 0.f;\n"
-        "\tswitch (dg->mat.layers)\n"
-        "\t{\n";
+        "\tfloat3 res = 0.f;\n";
 
-    for(auto material : m_materials)
+    if (m_materials.size() == 1)
     {
-        source += "\t\tcase " + std::to_string(material.first) + ":\n" +
-            "\t\t\tres = UberV2_Sample" + std::to_string(material.first) + "(dg, wi_t, TEXTURE_ARGS, sample, &wo_t, pdf, shader_data);\n"
-            "\t\t\tbreak;\n";
+        source += "\tres = UberV2_Sample" + std::to_string(m_materials.begin()->first) + "(dg, wi_t, TEXTURE_ARGS, sample, &wo_t, pdf, shader_data);\n";
     }
+    else
+    {
+        source += "\tswitch (dg->mat.layers)\n"
+            "\t{\n";
 
-    source += "\t}\n"
+        for (auto const& material : m_materials)
+        {
+            source += "\t\tcase " + std::to_string(material.first) + ":\n" +
+                "\t\t\tres = UberV2_Sample" + std::to_string(material.first) + "(dg, wi_t, TEXTURE_ARGS, sample, &wo_t, pdf, shader_data);\n"
+                "\t\t\tbreak;\n";
+        }
+
+        source += "\t}\n";
+    }
+
+    source +=
         "\t*wo = matrix_mul_vector3(dg->tangent_to_world, wo_t);"
         "\treturn res;\n"
         "}\n";
@@ -605,11 +630,18 @@ std::string Baikal::CLUberV2Generator::GeneratePrepareInputsDispatcher()
         "void UberV2PrepareInputs("
         "DifferentialGeometry const* dg, GLOBAL InputMapData const* restrict input_map_values,"
         "GLOBAL int const* restrict material_attributes, TEXTURE_ARG_LIST, UberV2ShaderData *shader_data)\n"
-        "{\n"
-        "\tswitch(dg->mat.layers)\n"
+        "{\n";
+
+    if (m_materials.size() == 1)
+    {
+        source += "\tUberV2PrepareInputs" + std::to_string(m_materials.begin()->first) + "(dg, input_map_values, material_attributes, TEXTURE_ARGS, shader_data);\n}\n";
+        return source;
+    }
+
+    source += "\tswitch(dg->mat.layers)\n"
         "\t{\n";
 
-    for(auto material : m_materials)
+    for (auto const& material : m_materials)
     {
         source += "\t\tcase " + std::to_string(material.first) + ":\n" +
             "\t\t\treturn UberV2PrepareInputs" + std::to_string(material.first) + "(dg, input_map_values, material_attributes, TEXTURE_ARGS, shader_data);\n";
@@ -627,11 +659,18 @@ std::string Baikal::CLUberV2Generator::GenerateGetBxDFTypeDispatcher()
     std::string source =
         "void GetMaterialBxDFType("
         "float3 wi, Sampler* sampler, SAMPLER_ARG_LIST, DifferentialGeometry* dg, UberV2ShaderData const* shader_data)"
-        "{\n"
-        "\tswitch(dg->mat.layers)\n"
+        "{\n";
+
+    if (m_materials.size() == 1)
+    {
+        source += "\tGetMaterialBxDFType" + std::to_string(m_materials.begin()->first) + "(wi, sampler, SAMPLER_ARGS, dg, shader_data);\n}\n";
+        return source;
+    }
+
+    source += "\tswitch(dg->mat.layers)\n"
         "\t{\n";
 
-    for(auto material : m_materials)
+    for (auto const& material : m_materials)
     {
         source += "\t\tcase " + std::to_string(material.first) + ":\n" +
             "\t\t\treturn GetMaterialBxDFType" + std::to_string(material.first) + "(wi, sampler, SAMPLER_ARGS, dg, shader_data);\n"
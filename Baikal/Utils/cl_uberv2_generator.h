@@ -48,6 +48,9 @@ namespace Baikal
          *  - All per-material type functions
          *  - All selectors for per-material type functions
          *
+         * If only one layer combination was added selectors call its functions directly,
+         * so shading kernels do not branch on material type at all.
+         *
          * @return generated source
          */
         std::string BuildSource();
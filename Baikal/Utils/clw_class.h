@@ -7,10 +7,12 @@
 #include <regex>
 #include <sstream>
 #include <unordered_map>
+#include <memory>
 
 #include "CLW.h"
 #include "version.h"
 #include "cl_program_manager.h"
+#include "clw_profiler.h"
 
 namespace Baikal
 {
@@ -31,6 +33,19 @@ namespace Baikal
         std::string GetDefaultBuildOpts() const { return m_default_opts; }
         std::string GetFullBuildOpts() const;
 
+        // Set profiler for kernel timings and memory accounting, can be nullptr
+        virtual void SetProfiler(std::shared_ptr<ClwProfiler> profiler) { m_profiler = profiler; }
+        ClwProfiler* GetProfiler() const { return m_profiler.get(); }
+
+    protected:
+        // Register build options kernels are going to be fetched with,
+        // so the program can be compiled ahead of time (see CLProgramManager::CompileProgramsAsync)
+        void AddProgramVariant(std::string const& opts);
+
+        // Launch named kernel on the first queue, timed if profiler is set
+        CLWEvent Launch1D(std::string const& name, std::size_t global_size, std::size_t local_size, CLWKernel kernel) const;
+        CLWEvent Launch2D(std::string const& name, std::size_t* global_size, std::size_t* local_size, CLWKernel kernel) const;
+
     private:
         void AddCommonOptions(std::string& opts) const;
 
@@ -42,6 +57,8 @@ namespace Baikal
         uint32_t m_program_id;
         // Default build options
         std::string m_default_opts;
+        // Profiler
+        std::shared_ptr<ClwProfiler> m_profiler;
     };
 
     inline ClwClass::ClwClass(
@@ -56,6 +73,7 @@ namespace Baikal
         AddCommonOptions(options);
 
         m_program_id = m_program_manager->CreateProgram(context, cl_file);
+        AddProgramVariant(m_default_opts);
     }
 
     inline CLWKernel ClwClass::GetKernel(std::string const& name, std::string const& opts)
@@ -91,8 +109,33 @@ namespace Baikal
         return options;
     }
 
+    inline CLWEvent ClwClass::Launch1D(std::string const& name, std::size_t global_size, std::size_t local_size, CLWKernel kernel) const
+    {
+        return m_profiler ?
+            m_profiler->Launch1D(GetContext(), name, global_size, local_size, kernel) :
+            GetContext().Launch1D(0, global_size, local_size, kernel);
+    }
+
+    inline CLWEvent ClwClass::Launch2D(std::string const& name, std::size_t* global_size, std::size_t* local_size, CLWKernel kernel) const
+    {
+        return m_profiler ?
+            m_profiler->Launch2D(GetContext(), name, global_size, local_size, kernel) :
+            GetContext().Launch2D(0, global_size, local_size, kernel);
+    }
+
+    inline void ClwClass::AddProgramVariant(std::string const& opts)
+    {
+        std::string options = opts.empty() ? m_default_opts : opts;
+        AddCommonOptions(options);
+        m_program_manager->AddProgramVariant(m_program_id, options);
+    }
+
     inline void ClwClass::SetDefaultBuildOptions(std::string const& opts)
     {
-        m_default_opts = opts;
+        if (m_default_opts != opts)
+        {
+            m_default_opts = opts;
+            AddProgramVariant(m_default_opts);
+        }
     }
 }
@@ -0,0 +1,321 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#include "clw_profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace Baikal
+{
+    namespace
+    {
+        char const* const kMemoryCategoryNames[] =
+        {
+            "geometry",
+            "textures",
+            "scene",
+            "work_buffers",
+            "outputs"
+        };
+
+        static_assert(sizeof(kMemoryCategoryNames) / sizeof(kMemoryCategoryNames[0]) ==
+            static_cast<std::size_t>(ClwProfiler::MemoryCategory::kMax), "Memory category name is missing");
+
+        // Write string as JSON string literal
+        void WriteJsonString(std::ostream& stream, std::string const& str)
+        {
+            stream << '"';
+
+            for (auto c : str)
+            {
+                switch (c)
+                {
+                case '"': stream << "\\\""; break;
+                case '\\': stream << "\\\\"; break;
+                case '\n': stream << "\\n"; break;
+                case '\t': stream << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+                    }
+                    else
+                    {
+                        stream << c;
+                    }
+                }
+            }
+
+            stream << '"';
+        }
+    }
+
+    ClwProfiler::ClwProfiler()
+        : m_timing_enabled(false)
+        , m_bounce(-1)
+        , m_frame(0)
+    {
+    }
+
+    void ClwProfiler::BeginFrame()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        ++m_frame;
+
+        // Collect whatever is done, so pending list does not grow over frames
+        Resolve(false);
+    }
+
+    CLWEvent ClwProfiler::Launch1D(CLWContext context, std::string const& name, std::size_t global_size, std::size_t local_size, CLWKernel kernel)
+    {
+        auto event = context.Launch1D(0, global_size, local_size, kernel);
+
+        if (m_timing_enabled)
+        {
+            Record(name, event);
+        }
+
+        return event;
+    }
+
+    CLWEvent ClwProfiler::Launch2D(CLWContext context, std::string const& name, std::size_t* global_size, std::size_t* local_size, CLWKernel kernel)
+    {
+        auto event = context.Launch2D(0, global_size, local_size, kernel);
+
+        if (m_timing_enabled)
+        {
+            Record(name, event);
+        }
+
+        return event;
+    }
+
+    void ClwProfiler::Record(std::string const& name, CLWEvent event)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_pending.push_back(PendingLaunch{ name, m_bounce, m_frame, event });
+
+        // Keep the number of events held bounded if nobody asks for the results
+        if (m_pending.size() > kMaxTraceEvents)
+        {
+            Resolve(false);
+
+            while (m_pending.size() > kMaxTraceEvents)
+            {
+                m_pending.pop_front();
+            }
+        }
+    }
+
+    void ClwProfiler::Resolve(bool wait)
+    {
+        while (!m_pending.empty())
+        {
+            auto& launch = m_pending.front();
+
+            if (wait)
+            {
+                launch.event.Wait();
+            }
+            else
+            {
+                cl_int status = CL_QUEUED;
+                clGetEventInfo(launch.event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+
+                // Queue is in-order, so later launches are not done either
+                if (status != CL_COMPLETE)
+                {
+                    break;
+                }
+            }
+
+            cl_ulong start = 0;
+            cl_ulong end = 0;
+
+            // Fails if the queue has been created without profiling enabled
+            if (clGetEventProfilingInfo(launch.event, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr) == CL_SUCCESS &&
+                clGetEventProfilingInfo(launch.event, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr) == CL_SUCCESS)
+            {
+                auto time_ms = (end - start) * 1e-6;
+
+                auto& stats = m_kernel_stats[std::make_pair(launch.name, launch.bounce)];
+
+                if (stats.num_launches == 0)
+                {
+                    stats.name = launch.name;
+                    stats.bounce = launch.bounce;
+                    stats.min_time_ms = time_ms;
+                    stats.max_time_ms = time_ms;
+                }
+
+                ++stats.num_launches;
+                stats.total_time_ms += time_ms;
+                stats.min_time_ms = std::min(stats.min_time_ms, time_ms);
+                stats.max_time_ms = std::max(stats.max_time_ms, time_ms);
+
+                m_trace.push_back(TraceEvent{ std::move(launch.name), launch.bounce, launch.frame, start, end });
+
+                if (m_trace.size() > kMaxTraceEvents)
+                {
+                    m_trace.pop_front();
+                }
+            }
+
+            m_pending.pop_front();
+        }
+    }
+
+    void ClwProfiler::SetAllocation(void const* owner, MemoryCategory category, std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto& category_bytes = m_memory_stats.category_bytes[static_cast<std::size_t>(category)];
+        auto iter = m_allocations.find(std::make_pair(owner, category));
+        auto current = iter != m_allocations.end() ? iter->second : 0u;
+
+        category_bytes = category_bytes - current + bytes;
+        m_memory_stats.total_bytes = m_memory_stats.total_bytes - current + bytes;
+        m_memory_stats.peak_bytes = std::max(m_memory_stats.peak_bytes, m_memory_stats.total_bytes);
+
+        if (bytes == 0)
+        {
+            if (iter != m_allocations.end())
+            {
+                m_allocations.erase(iter);
+            }
+        }
+        else if (iter != m_allocations.end())
+        {
+            iter->second = bytes;
+        }
+        else
+        {
+            m_allocations.emplace(std::make_pair(owner, category), bytes);
+        }
+    }
+
+    void ClwProfiler::ReleaseAllocations(void const* owner)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Entries are ordered by owner first
+        auto iter = m_allocations.lower_bound(std::make_pair(owner, static_cast<MemoryCategory>(0)));
+
+        while (iter != m_allocations.end() && iter->first.first == owner)
+        {
+            m_memory_stats.category_bytes[static_cast<std::size_t>(iter->first.second)] -= iter->second;
+            m_memory_stats.total_bytes -= iter->second;
+            iter = m_allocations.erase(iter);
+        }
+    }
+
+    ClwProfiler::MemoryStatistics ClwProfiler::GetMemoryStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_memory_stats;
+    }
+
+    std::vector<ClwProfiler::KernelStatistics> ClwProfiler::GetKernelStatistics()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        Resolve(true);
+
+        std::vector<KernelStatistics> stats;
+        stats.reserve(m_kernel_stats.size());
+
+        for (auto const& entry : m_kernel_stats)
+        {
+            stats.push_back(entry.second);
+        }
+
+        return stats;
+    }
+
+    void ClwProfiler::ResetTimings()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_pending.clear();
+        m_trace.clear();
+        m_kernel_stats.clear();
+    }
+
+    void ClwProfiler::WriteChromeTrace(std::ostream& stream)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        Resolve(true);
+
+        // Device timestamps are in ns, trace expects us relative to any origin
+        cl_ulong origin = m_trace.empty() ? 0 : m_trace.front().start;
+        cl_ulong last = origin;
+
+        auto flags = stream.flags();
+        auto precision = stream.precision();
+        stream << std::fixed << std::setprecision(3);
+
+        stream << "{\"traceEvents\":[\n";
+        stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"Baikal\"}},\n";
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"OpenCL queue 0\"}}";
+
+        for (auto const& event : m_trace)
+        {
+            stream << ",\n{\"name\":";
+            WriteJsonString(stream, event.name);
+            stream << ",\"cat\":\"kernel\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+                << ",\"ts\":" << (event.start - origin) * 1e-3
+                << ",\"dur\":" << (event.end - event.start) * 1e-3
+                << ",\"args\":{\"frame\":" << event.frame << ",\"bounce\":" << event.bounce << "}}";
+
+            last = std::max(last, event.end);
+        }
+
+        stream << ",\n{\"name\":\"Device memory\",\"ph\":\"C\",\"pid\":0,\"tid\":0,\"ts\":" << (last - origin) * 1e-3 << ",\"args\":{";
+
+        for (auto i = 0u; i < static_cast<std::size_t>(MemoryCategory::kMax); ++i)
+        {
+            stream << (i > 0 ? "," : "") << '"' << kMemoryCategoryNames[i] << "\":" << m_memory_stats.category_bytes[i];
+        }
+
+        stream << "}}\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        stream.flags(flags);
+        stream.precision(precision);
+    }
+
+    void ClwProfiler::SaveChromeTrace(std::string const& path)
+    {
+        std::ofstream stream(path);
+
+        if (!stream)
+        {
+            throw std::runtime_error("Can't open trace file " + path);
+        }
+
+        WriteChromeTrace(stream);
+    }
+}
@@ -0,0 +1,178 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+/**
+ \file clw_profiler.h
+ \version 1.0
+ \brief Kernel timings and device memory accounting for OpenCL backend.
+
+ Kernels are launched through the profiler with a name, when timings are enabled
+ the profiler keeps launch events and resolves them into per kernel (and per bounce)
+ statistics once the device is done with them. Timings rely on OpenCL profiling
+ events, so the command queue has to be created with CL_QUEUE_PROFILING_ENABLE,
+ otherwise launches are silently dropped.
+
+ Device memory is accounted per owner object and category, owners report the
+ total size of their buffers every time they reallocate and release it on destruction.
+ */
+#pragma once
+
+#include "CLW.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Baikal
+{
+    class ClwProfiler
+    {
+    public:
+        // Device memory categories
+        enum class MemoryCategory
+        {
+            // Vertex, index and shape data
+            kGeometry,
+            // Texture headers and texel data
+            kTextures,
+            // Materials, lights, volumes, camera and input maps
+            kScene,
+            // Estimator and renderer intermediate buffers
+            kWorkBuffers,
+            // Render outputs and readback buffers
+            kOutputs,
+            kMax
+        };
+
+        struct MemoryStatistics
+        {
+            // Currently allocated bytes per category
+            std::size_t category_bytes[static_cast<std::size_t>(MemoryCategory::kMax)] = {};
+            // Currently allocated bytes in total
+            std::size_t total_bytes = 0;
+            // Max of total_bytes since creation
+            std::size_t peak_bytes = 0;
+        };
+
+        struct KernelStatistics
+        {
+            std::string name;
+            // Bounce the kernel was launched for, -1 for launches outside of bounce loop
+            int bounce = -1;
+            std::uint32_t num_launches = 0;
+            double total_time_ms = 0.0;
+            double min_time_ms = 0.0;
+            double max_time_ms = 0.0;
+        };
+
+        ClwProfiler();
+
+        // Enable or disable kernel timings, memory is accounted regardless
+        void SetTimingEnabled(bool enabled) { m_timing_enabled = enabled; }
+        bool IsTimingEnabled() const { return m_timing_enabled; }
+
+        // Mark the start of a new frame
+        void BeginFrame();
+        // Set bounce subsequent launches belong to, -1 means none
+        void SetBounce(int bounce) { m_bounce = bounce; }
+
+        // Launch a kernel on the first queue of the context
+        CLWEvent Launch1D(CLWContext context, std::string const& name, std::size_t global_size, std::size_t local_size, CLWKernel kernel);
+        CLWEvent Launch2D(CLWContext context, std::string const& name, std::size_t* global_size, std::size_t* local_size, CLWKernel kernel);
+
+        // Set the amount of memory owner currently holds in the category
+        void SetAllocation(void const* owner, MemoryCategory category, std::size_t bytes);
+        // Release all memory held by the owner
+        void ReleaseAllocations(void const* owner);
+        MemoryStatistics GetMemoryStatistics() const;
+
+        // Wait for pending launches and get statistics ordered by name and bounce
+        std::vector<KernelStatistics> GetKernelStatistics();
+        // Drop collected timings
+        void ResetTimings();
+
+        /**
+         \brief Write collected launches in Chrome trace event format.
+
+         The output can be loaded into chrome://tracing or Perfetto. Every kernel launch is a
+         complete event on the device timeline with frame and bounce as arguments, current
+         device memory usage is appended as a counter event. Only the last kMaxTraceEvents
+         launches are kept.
+         */
+        void WriteChromeTrace(std::ostream& stream);
+        // Write Chrome trace into a file, throws if the file can't be opened
+        void SaveChromeTrace(std::string const& path);
+
+        // Size of buffer data in bytes
+        template <typename T>
+        static std::size_t GetBufferSize(CLWBuffer<T> const& buffer)
+        {
+            return buffer.GetElementCount() * sizeof(T);
+        }
+
+        // Max number of launches kept for the trace
+        static std::size_t const kMaxTraceEvents = 1u << 16;
+
+        ClwProfiler(ClwProfiler const&) = delete;
+        ClwProfiler& operator = (ClwProfiler const&) = delete;
+
+    private:
+        struct PendingLaunch
+        {
+            std::string name;
+            int bounce;
+            std::uint32_t frame;
+            CLWEvent event;
+        };
+
+        struct TraceEvent
+        {
+            std::string name;
+            int bounce;
+            std::uint32_t frame;
+            cl_ulong start;
+            cl_ulong end;
+        };
+
+        void Record(std::string const& name, CLWEvent event);
+        // Move finished launches to statistics, blocks until all are done if wait is set.
+        // Expects m_mutex to be locked.
+        void Resolve(bool wait);
+
+        mutable std::mutex m_mutex;
+        std::atomic<bool> m_timing_enabled;
+        std::atomic<int> m_bounce;
+        std::uint32_t m_frame;
+
+        std::deque<PendingLaunch> m_pending;
+        std::deque<TraceEvent> m_trace;
+        std::map<std::pair<std::string, int>, KernelStatistics> m_kernel_stats;
+
+        std::map<std::pair<void const*, MemoryCategory>, std::size_t> m_allocations;
+        MemoryStatistics m_memory_stats;
+    };
+}
@@ -0,0 +1,356 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#include "cpu_bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Baikal
+{
+    using namespace RadeonRays;
+
+    namespace
+    {
+        float SurfaceArea(float3 const& pmin, float3 const& pmax)
+        {
+            auto extents = pmax - pmin;
+            return 2.f * (extents.x * extents.y + extents.y * extents.z + extents.z * extents.x);
+        }
+
+        float GetComponent(float3 const& v, int axis)
+        {
+            return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+        }
+
+        // Ray vs box slab test, returns entry distance or infinity on miss
+        float IntersectBox(float3 const& pmin, float3 const& pmax, float3 const& o, float3 const& inv_d, float t_max)
+        {
+            auto t0 = (pmin - o) * inv_d;
+            auto t1 = (pmax - o) * inv_d;
+            auto tmin = vmin(t0, t1);
+            auto tmax = vmax(t0, t1);
+
+            auto t_enter = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.f));
+            auto t_exit = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, t_max));
+
+            return t_enter <= t_exit ? t_enter : std::numeric_limits<float>::infinity();
+        }
+
+        // Safe reciprocal of direction component, keeps slab test NaN free
+        float SafeReciprocal(float x)
+        {
+            auto const kMinValue = 1e-20f;
+            return 1.f / (std::fabs(x) > kMinValue ? x : std::copysign(kMinValue, x));
+        }
+    }
+
+    void CpuBvh::Build(float3 const* vertices, std::size_t num_triangles)
+    {
+        m_nodes.clear();
+        m_v0.clear();
+        m_e1.clear();
+        m_e2.clear();
+        m_prim_indices.clear();
+
+        if (!num_triangles)
+        {
+            return;
+        }
+
+        std::vector<BuildPrimitive> prims(num_triangles);
+        for (auto i = 0u; i < num_triangles; ++i)
+        {
+            auto const* v = vertices + 3 * i;
+            auto& prim = prims[i];
+            prim.pmin = vmin(v[0], vmin(v[1], v[2]));
+            prim.pmax = vmax(v[0], vmax(v[1], v[2]));
+            prim.center = (prim.pmin + prim.pmax) * 0.5f;
+            prim.index = i;
+        }
+
+        m_vertices = vertices;
+        m_nodes.reserve(2 * num_triangles);
+        m_v0.reserve(num_triangles);
+        m_e1.reserve(num_triangles);
+        m_e2.reserve(num_triangles);
+        m_prim_indices.reserve(num_triangles);
+
+        BuildNode(prims, 0, num_triangles, 0);
+
+        m_vertices = nullptr;
+    }
+
+    std::uint32_t CpuBvh::BuildNode(std::vector<BuildPrimitive>& prims, std::size_t begin, std::size_t end, std::uint32_t depth)
+    {
+        auto node_idx = static_cast<std::uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+
+        auto pmin = prims[begin].pmin;
+        auto pmax = prims[begin].pmax;
+        auto cmin = prims[begin].center;
+        auto cmax = prims[begin].center;
+
+        for (auto i = begin + 1; i < end; ++i)
+        {
+            pmin = vmin(pmin, prims[i].pmin);
+            pmax = vmax(pmax, prims[i].pmax);
+            cmin = vmin(cmin, prims[i].center);
+            cmax = vmax(cmax, prims[i].center);
+        }
+
+        auto count = end - begin;
+
+        if (count <= kMaxLeafSize || depth + 1 >= kMaxDepth)
+        {
+            auto& node = m_nodes[node_idx];
+            node.pmin = pmin;
+            node.pmax = pmax;
+            node.offset = static_cast<std::uint32_t>(m_prim_indices.size());
+            node.count = static_cast<std::uint32_t>(count);
+
+            for (auto i = begin; i < end; ++i)
+            {
+                auto const* v = m_vertices + 3 * prims[i].index;
+                m_v0.push_back(v[0]);
+                m_e1.push_back(v[1] - v[0]);
+                m_e2.push_back(v[2] - v[0]);
+                m_prim_indices.push_back(prims[i].index);
+            }
+
+            return node_idx;
+        }
+
+        // Split along the largest extent of centers
+        auto extents = cmax - cmin;
+        auto axis = extents.x > extents.y ? (extents.x > extents.z ? 0 : 2) : (extents.y > extents.z ? 1 : 2);
+        auto axis_min = GetComponent(cmin, axis);
+        auto axis_extent = GetComponent(extents, axis);
+
+        auto mid = begin;
+
+        if (axis_extent > 0.f)
+        {
+            struct Bin
+            {
+                float3 pmin = float3(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+                float3 pmax = float3(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+                std::size_t count = 0;
+            };
+
+            Bin bins[kNumBins];
+
+            auto get_bin = [&](BuildPrimitive const& prim)
+            {
+                auto bin = static_cast<std::uint32_t>(kNumBins * (GetComponent(prim.center, axis) - axis_min) / axis_extent);
+                return std::min(bin, kNumBins - 1);
+            };
+
+            for (auto i = begin; i < end; ++i)
+            {
+                auto& bin = bins[get_bin(prims[i])];
+                bin.pmin = vmin(bin.pmin, prims[i].pmin);
+                bin.pmax = vmax(bin.pmax, prims[i].pmax);
+                ++bin.count;
+            }
+
+            // Cost of the right side of every split plane
+            float right_cost[kNumBins];
+            {
+                Bin right;
+                for (auto i = kNumBins - 1; i > 0; --i)
+                {
+                    right.pmin = vmin(right.pmin, bins[i].pmin);
+                    right.pmax = vmax(right.pmax, bins[i].pmax);
+                    right.count += bins[i].count;
+                    right_cost[i] = right.count ? right.count * SurfaceArea(right.pmin, right.pmax) : 0.f;
+                }
+            }
+
+            auto best_cost = std::numeric_limits<float>::max();
+            auto best_split = 0u;
+            {
+                Bin left;
+                for (auto i = 0u; i < kNumBins - 1; ++i)
+                {
+                    left.pmin = vmin(left.pmin, bins[i].pmin);
+                    left.pmax = vmax(left.pmax, bins[i].pmax);
+                    left.count += bins[i].count;
+
+                    auto cost = (left.count ? left.count * SurfaceArea(left.pmin, left.pmax) : 0.f) + right_cost[i + 1];
+                    if (left.count && left.count < count && cost < best_cost)
+                    {
+                        best_cost = cost;
+                        best_split = i;
+                    }
+                }
+            }
+
+            auto iter = std::partition(prims.begin() + begin, prims.begin() + end,
+                [&](BuildPrimitive const& prim) { return get_bin(prim) <= best_split; });
+            mid = static_cast<std::size_t>(iter - prims.begin());
+        }
+
+        // Fall back to median split if SAH could not separate primitives
+        if (mid == begin || mid == end)
+        {
+            mid = begin + count / 2;
+            std::nth_element(prims.begin() + begin, prims.begin() + mid, prims.begin() + end,
+                [axis](BuildPrimitive const& a, BuildPrimitive const& b)
+                {
+                    return GetComponent(a.center, axis) < GetComponent(b.center, axis);
+                });
+        }
+
+        BuildNode(prims, begin, mid, depth + 1);
+        auto right = BuildNode(prims, mid, end, depth + 1);
+
+        auto& node = m_nodes[node_idx];
+        node.pmin = pmin;
+        node.pmax = pmax;
+        node.offset = right;
+        node.count = 0;
+
+        return node_idx;
+    }
+
+    bool CpuBvh::Intersect(float3 const& o, float3 const& d, float t_max, Hit& hit) const
+    {
+        return Traverse<false>(o, d, t_max, hit);
+    }
+
+    bool CpuBvh::Occluded(float3 const& o, float3 const& d, float t_max) const
+    {
+        Hit hit;
+        return Traverse<true>(o, d, t_max, hit);
+    }
+
+    template <bool any_hit>
+    bool CpuBvh::Traverse(float3 const& o, float3 const& d, float t_max, Hit& hit) const
+    {
+        if (m_nodes.empty())
+        {
+            return false;
+        }
+
+        auto inv_d = float3(SafeReciprocal(d.x), SafeReciprocal(d.y), SafeReciprocal(d.z));
+
+        std::uint32_t stack[kMaxDepth];
+        auto stack_size = 0u;
+        auto node_idx = 0u;
+        auto found = false;
+
+        if (IntersectBox(m_nodes[0].pmin, m_nodes[0].pmax, o, inv_d, t_max) == std::numeric_limits<float>::infinity())
+        {
+            return false;
+        }
+
+        for (;;)
+        {
+            auto const& node = m_nodes[node_idx];
+
+            if (node.count)
+            {
+                for (auto i = node.offset; i < node.offset + node.count; ++i)
+                {
+                    // Moller-Trumbore test
+                    auto p = cross(d, m_e2[i]);
+                    auto det = dot(m_e1[i], p);
+
+                    if (det == 0.f)
+                    {
+                        continue;
+                    }
+
+                    auto inv_det = 1.f / det;
+                    auto s = o - m_v0[i];
+                    auto u = dot(s, p) * inv_det;
+
+                    if (u < 0.f || u > 1.f)
+                    {
+                        continue;
+                    }
+
+                    auto q = cross(s, m_e1[i]);
+                    auto v = dot(d, q) * inv_det;
+
+                    if (v < 0.f || u + v > 1.f)
+                    {
+                        continue;
+                    }
+
+                    auto t = dot(m_e2[i], q) * inv_det;
+
+                    if (t > 0.f && t < t_max)
+                    {
+                        if (any_hit)
+                        {
+                            return true;
+                        }
+
+                        t_max = t;
+                        hit.prim = m_prim_indices[i];
+                        hit.t = t;
+                        hit.u = u;
+                        hit.v = v;
+                        found = true;
+                    }
+                }
+            }
+            else
+            {
+                auto left = node_idx + 1;
+                auto right = node.offset;
+                auto t_left = IntersectBox(m_nodes[left].pmin, m_nodes[left].pmax, o, inv_d, t_max);
+                auto t_right = IntersectBox(m_nodes[right].pmin, m_nodes[right].pmax, o, inv_d, t_max);
+                auto const kMiss = std::numeric_limits<float>::infinity();
+
+                if (t_left != kMiss && t_right != kMiss)
+                {
+                    // Visit the closer child first
+                    node_idx = t_left <= t_right ? left : right;
+                    stack[stack_size++] = t_left <= t_right ? right : left;
+                    continue;
+                }
+                else if (t_left != kMiss)
+                {
+                    node_idx = left;
+                    continue;
+                }
+                else if (t_right != kMiss)
+                {
+                    node_idx = right;
+                    continue;
+                }
+            }
+
+            if (!stack_size)
+            {
+                break;
+            }
+
+            node_idx = stack[--stack_size];
+        }
+
+        return found;
+    }
+}
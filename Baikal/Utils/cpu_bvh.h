@@ -0,0 +1,106 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+
+/**
+ \file cpu_bvh.h
+ \version 1.0
+ \brief Triangle BVH used by CPU backend.
+
+ Binned SAH builder producing depth first node layout: the first child of an
+ interior node immediately follows it, the second one is referenced by index.
+ Triangles are reordered to match leaves and stored as vertex plus two edges,
+ which is what the intersection test needs.
+ */
+#pragma once
+
+#include "math/float3.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Baikal
+{
+    class CpuBvh
+    {
+    public:
+        // Number of SAH bins per axis
+        static std::uint32_t const kNumBins = 16;
+        // Max number of triangles in a leaf
+        static std::uint32_t const kMaxLeafSize = 4;
+        // Max depth of the tree (and traversal stack size)
+        static std::uint32_t const kMaxDepth = 64;
+
+        struct Node
+        {
+            RadeonRays::float3 pmin;
+            RadeonRays::float3 pmax;
+            // Second child for interior nodes, first triangle for leaves
+            std::uint32_t offset;
+            // Number of triangles, 0 for interior nodes
+            std::uint32_t count;
+        };
+
+        struct Hit
+        {
+            // Index of the triangle passed to Build
+            std::uint32_t prim;
+            // Distance and barycentrics of the hit
+            float t;
+            float u;
+            float v;
+        };
+
+        // Build the tree for num_triangles triangles given by 3 vertices each
+        void Build(RadeonRays::float3 const* vertices, std::size_t num_triangles);
+
+        // Find the closest hit in (0, t_max), returns false on miss
+        bool Intersect(RadeonRays::float3 const& o, RadeonRays::float3 const& d, float t_max, Hit& hit) const;
+        // Check if there is any hit in (0, t_max)
+        bool Occluded(RadeonRays::float3 const& o, RadeonRays::float3 const& d, float t_max) const;
+
+        bool IsEmpty() const { return m_nodes.empty(); }
+        std::vector<Node> const& GetNodes() const { return m_nodes; }
+
+    private:
+        struct BuildPrimitive
+        {
+            RadeonRays::float3 pmin;
+            RadeonRays::float3 pmax;
+            RadeonRays::float3 center;
+            std::uint32_t index;
+        };
+
+        std::uint32_t BuildNode(std::vector<BuildPrimitive>& prims, std::size_t begin, std::size_t end, std::uint32_t depth);
+
+        template <bool any_hit>
+        bool Traverse(RadeonRays::float3 const& o, RadeonRays::float3 const& d, float t_max, Hit& hit) const;
+
+        std::vector<Node> m_nodes;
+        // Reordered triangles
+        std::vector<RadeonRays::float3> m_v0;
+        std::vector<RadeonRays::float3> m_e1;
+        std::vector<RadeonRays::float3> m_e2;
+        std::vector<std::uint32_t> m_prim_indices;
+        // Source vertices during build
+        RadeonRays::float3 const* m_vertices = nullptr;
+    };
+}
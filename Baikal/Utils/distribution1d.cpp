@@ -78,4 +78,56 @@ namespace Baikal
         // Calc pdf
         return m_func_values[segment_idx - 1] / m_func_sum;
     }
-}
\ No newline at end of file
+
+    Distribution2D::Distribution2D()
+    {
+    }
+
+    Distribution2D::Distribution2D(float const* values, std::uint32_t num_u, std::uint32_t num_v)
+    {
+        Set(values, num_u, num_v);
+    }
+
+    void Distribution2D::Set(float const* values, std::uint32_t num_u, std::uint32_t num_v)
+    {
+        assert(num_u > 0 && num_v > 0);
+        m_conditional.resize(num_v);
+
+        std::vector<float> row_sums(num_v);
+
+        // Build conditional distribution for each row and
+        // use their integrals as marginal function values
+        for (auto i = 0u; i < num_v; ++i)
+        {
+            m_conditional[i].Set(values + i * num_u, num_u);
+            row_sums[i] = m_conditional[i].m_func_sum;
+        }
+
+        m_marginal.Set(&row_sums[0], num_v);
+    }
+
+    void Distribution2D::Sample2D(float su, float sv, float& u, float& v, float& pdf) const
+    {
+        float pdf_u = 0.f;
+        float pdf_v = 0.f;
+
+        v = m_marginal.Sample1D(sv, pdf_v);
+
+        auto row = std::min((std::uint32_t)(v * m_marginal.m_num_segments), m_marginal.m_num_segments - 1);
+        u = m_conditional[row].Sample1D(su, pdf_u);
+
+        pdf = pdf_u * pdf_v;
+    }
+
+    float Distribution2D::pdf(float u, float v) const
+    {
+        auto num_u = m_conditional[0].m_num_segments;
+        auto num_v = m_marginal.m_num_segments;
+
+        // Find the cell directly as function is constant within a cell
+        auto row = std::min((std::uint32_t)(std::max(v, 0.f) * num_v), num_v - 1);
+        auto column = std::min((std::uint32_t)(std::max(u, 0.f) * num_u), num_u - 1);
+
+        return m_conditional[row].m_func_values[column] / m_marginal.m_func_sum;
+    }
+}
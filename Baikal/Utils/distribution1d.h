@@ -55,4 +55,30 @@ namespace Baikal
         // Integral of the function over the whole range (normalizer)
         float m_func_sum;
     };
+
+    ///< The class represents 2D piecewise constant distribution over [0,1]x[0,1].
+    ///< Sampling is done using marginal distribution over rows (v) and
+    ///< conditional distributions over columns (u) within each row.
+    ///<
+    struct Distribution2D
+    {
+    public:
+        // values are function values of num_u x num_v grid stored row by row
+        Distribution2D();
+        Distribution2D(float const* values, std::uint32_t num_u, std::uint32_t num_v);
+
+        void Set(float const* values, std::uint32_t num_u, std::uint32_t num_v);
+
+        // Sample (u, v) pair using this distribution
+        // su and sv are uniformely distributed random vars
+        void Sample2D(float su, float sv, float& u, float& v, float& pdf) const;
+
+        // PDF
+        float pdf(float u, float v) const;
+
+        // Conditional distributions over u (one per row)
+        std::vector<Distribution1D> m_conditional;
+        // Marginal distribution over v
+        Distribution1D m_marginal;
+    };
 }
\ No newline at end of file
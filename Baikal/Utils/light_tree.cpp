@@ -0,0 +1,323 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#include "light_tree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace Baikal
+{
+    namespace
+    {
+        float const kPi = 3.14159265358979323846f;
+
+        float SafeSqrt(float v)
+        {
+            return std::sqrt(std::max(v, 0.f));
+        }
+
+        float SafeAcos(float v)
+        {
+            return std::acos(std::min(std::max(v, -1.f), 1.f));
+        }
+
+        // cos(max(0, a - b)) given sines and cosines of a and b
+        float CosSubClamped(float sin_a, float cos_a, float sin_b, float cos_b)
+        {
+            return cos_a > cos_b ? 1.f : cos_a * cos_b + sin_a * sin_b;
+        }
+
+        // sin(max(0, a - b)) given sines and cosines of a and b
+        float SinSubClamped(float sin_a, float cos_a, float sin_b, float cos_b)
+        {
+            return cos_a > cos_b ? 0.f : sin_a * cos_b - cos_a * sin_b;
+        }
+
+        // Rotate v around unit axis by angle
+        RadeonRays::float3 Rotate(RadeonRays::float3 const& v, RadeonRays::float3 const& axis, float angle)
+        {
+            auto c = std::cos(angle);
+            auto s = std::sin(angle);
+            return v * c + cross(axis, v) * s + axis * (dot(axis, v) * (1.f - c));
+        }
+    }
+
+    int const LightTree::kNodeSize;
+    std::uint32_t const LightTree::kInvalidTrail;
+
+    float GetLightImportance(LightBounds const& bounds, RadeonRays::float3 const& p)
+    {
+        if (bounds.power <= 0.f)
+        {
+            return 0.f;
+        }
+
+        auto center = 0.5f * (bounds.pmin + bounds.pmax);
+        auto d = p - center;
+        auto radius2 = 0.25f * (bounds.pmax - bounds.pmin).sqnorm();
+
+        // Avoid singularity when the point is close to the lights
+        auto dist2 = std::max(std::max(d.sqnorm(), std::sqrt(radius2)), 1e-6f);
+        auto wi = d.sqnorm() > 0.f ? normalize(d) : RadeonRays::float3(0.f, 0.f, 1.f);
+
+        // Angle between cone axis and direction to the point
+        auto cos_theta_w = dot(bounds.axis, wi);
+        if (bounds.two_sided)
+        {
+            cos_theta_w = std::fabs(cos_theta_w);
+        }
+        auto sin_theta_w = SafeSqrt(1.f - cos_theta_w * cos_theta_w);
+
+        // Angle subtended by the bounds as seen from the point
+        auto cos_theta_b = d.sqnorm() > radius2 ? SafeSqrt(1.f - radius2 / d.sqnorm()) : -1.f;
+        auto sin_theta_b = SafeSqrt(1.f - cos_theta_b * cos_theta_b);
+
+        // Minimal angle between emitter normals and direction to any point of the bounds
+        auto sin_theta_o = SafeSqrt(1.f - bounds.cos_theta_o * bounds.cos_theta_o);
+        auto cos_theta_x = CosSubClamped(sin_theta_w, cos_theta_w, sin_theta_o, bounds.cos_theta_o);
+        auto sin_theta_x = SinSubClamped(sin_theta_w, cos_theta_w, sin_theta_o, bounds.cos_theta_o);
+        auto cos_theta_p = CosSubClamped(sin_theta_x, cos_theta_x, sin_theta_b, cos_theta_b);
+
+        if (cos_theta_p <= bounds.cos_theta_e)
+        {
+            return 0.f;
+        }
+
+        return bounds.power * cos_theta_p / dist2;
+    }
+
+    LightBounds UnionLightBounds(LightBounds const& a, LightBounds const& b)
+    {
+        if (a.power <= 0.f) return b;
+        if (b.power <= 0.f) return a;
+
+        LightBounds result;
+        result.pmin = vmin(a.pmin, b.pmin);
+        result.pmax = vmax(a.pmax, b.pmax);
+        result.cos_theta_e = std::min(a.cos_theta_e, b.cos_theta_e);
+        result.power = a.power + b.power;
+        result.two_sided = a.two_sided || b.two_sided;
+
+        // Merge direction cones
+        auto theta_a = SafeAcos(a.cos_theta_o);
+        auto theta_b = SafeAcos(b.cos_theta_o);
+        auto theta_d = SafeAcos(dot(a.axis, b.axis));
+
+        if (std::min(theta_d + theta_b, kPi) <= theta_a)
+        {
+            result.axis = a.axis;
+            result.cos_theta_o = a.cos_theta_o;
+            return result;
+        }
+
+        if (std::min(theta_d + theta_a, kPi) <= theta_b)
+        {
+            result.axis = b.axis;
+            result.cos_theta_o = b.cos_theta_o;
+            return result;
+        }
+
+        auto theta_o = 0.5f * (theta_a + theta_d + theta_b);
+        auto rotation_axis = cross(a.axis, b.axis);
+
+        if (theta_o >= kPi || rotation_axis.sqnorm() == 0.f)
+        {
+            // Whole sphere of directions
+            result.axis = a.axis;
+            result.cos_theta_o = -1.f;
+            return result;
+        }
+
+        result.axis = normalize(Rotate(a.axis, normalize(rotation_axis), theta_o - theta_a));
+        result.cos_theta_o = std::cos(theta_o);
+        return result;
+    }
+
+    void LightTree::Build(std::vector<LightBounds> const& lights)
+    {
+        m_nodes.clear();
+        m_bit_trails.assign(lights.size(), kInvalidTrail);
+
+        std::vector<int> indices;
+        for (auto i = 0u; i < lights.size(); ++i)
+        {
+            if (lights[i].power > 0.f)
+            {
+                indices.push_back(static_cast<int>(i));
+            }
+        }
+
+        if (!indices.empty())
+        {
+            m_nodes.reserve(2 * indices.size() - 1);
+            BuildNode(lights, indices, 0, indices.size(), 0u, 0);
+        }
+    }
+
+    int LightTree::BuildNode(std::vector<LightBounds> const& lights, std::vector<int>& indices,
+                             std::size_t begin, std::size_t end, std::uint32_t bit_trail, int depth)
+    {
+        auto node_idx = static_cast<int>(m_nodes.size());
+        m_nodes.emplace_back();
+
+        if (end - begin == 1)
+        {
+            auto light = indices[begin];
+            m_nodes[node_idx].bounds = lights[light];
+            m_nodes[node_idx].child = light;
+            m_nodes[node_idx].leaf = true;
+            m_bit_trails[light] = bit_trail;
+            return node_idx;
+        }
+
+        // Median split along the largest extent of light centers
+        // keeps the tree balanced, so bit trails always fit 32 bits
+        auto cmin = RadeonRays::float3(1e30f, 1e30f, 1e30f);
+        auto cmax = RadeonRays::float3(-1e30f, -1e30f, -1e30f);
+        for (auto i = begin; i < end; ++i)
+        {
+            auto center = 0.5f * (lights[indices[i]].pmin + lights[indices[i]].pmax);
+            cmin = vmin(cmin, center);
+            cmax = vmax(cmax, center);
+        }
+
+        auto extent = cmax - cmin;
+        auto axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        auto middle = begin + (end - begin) / 2;
+
+        std::nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end,
+            [&lights, axis](int a, int b)
+        {
+            return lights[a].pmin[axis] + lights[a].pmax[axis] < lights[b].pmin[axis] + lights[b].pmax[axis];
+        });
+
+        assert(depth < 32);
+        BuildNode(lights, indices, begin, middle, bit_trail, depth + 1);
+        auto second = BuildNode(lights, indices, middle, end, bit_trail | (1u << depth), depth + 1);
+
+        m_nodes[node_idx].bounds = UnionLightBounds(m_nodes[node_idx + 1].bounds, m_nodes[second].bounds);
+        m_nodes[node_idx].child = second;
+        m_nodes[node_idx].leaf = false;
+        return node_idx;
+    }
+
+    void LightTree::Write(std::vector<int>& out) const
+    {
+        auto offset = out.size();
+        out.resize(offset + kNodeSize * m_nodes.size(), 0);
+
+        for (auto const& node : m_nodes)
+        {
+            auto const& b = node.bounds;
+            float values[12] = { b.pmin.x, b.pmin.y, b.pmin.z, b.pmax.x, b.pmax.y, b.pmax.z,
+                                 b.axis.x, b.axis.y, b.axis.z, b.cos_theta_o, b.cos_theta_e, b.power };
+
+            std::memcpy(&out[offset], values, sizeof(values));
+            out[offset + 12] = node.child;
+            out[offset + 13] = (node.leaf ? 1 : 0) | (b.two_sided ? 2 : 0);
+            offset += kNodeSize;
+        }
+    }
+
+    int LightTree::Sample(RadeonRays::float3 const& p, float u, float& pdf) const
+    {
+        pdf = 0.f;
+
+        if (m_nodes.empty() || GetLightImportance(m_nodes[0].bounds, p) <= 0.f)
+        {
+            return -1;
+        }
+
+        auto node = 0;
+        auto node_pdf = 1.f;
+
+        while (!m_nodes[node].leaf)
+        {
+            auto i0 = GetLightImportance(m_nodes[node + 1].bounds, p);
+            auto i1 = GetLightImportance(m_nodes[m_nodes[node].child].bounds, p);
+
+            if (i0 + i1 <= 0.f)
+            {
+                return -1;
+            }
+
+            auto p0 = i0 / (i0 + i1);
+
+            if (u < p0)
+            {
+                u = std::min(u / p0, 0.99999994f);
+                node_pdf *= p0;
+                node = node + 1;
+            }
+            else
+            {
+                u = std::min((u - p0) / (1.f - p0), 0.99999994f);
+                node_pdf *= 1.f - p0;
+                node = m_nodes[node].child;
+            }
+        }
+
+        pdf = node_pdf;
+        return m_nodes[node].child;
+    }
+
+    float LightTree::GetPdf(RadeonRays::float3 const& p, int light) const
+    {
+        auto bit_trail = m_bit_trails[light];
+
+        if (bit_trail == kInvalidTrail || GetLightImportance(m_nodes[0].bounds, p) <= 0.f)
+        {
+            return 0.f;
+        }
+
+        auto node = 0;
+        auto pdf = 1.f;
+
+        while (!m_nodes[node].leaf)
+        {
+            auto i0 = GetLightImportance(m_nodes[node + 1].bounds, p);
+            auto i1 = GetLightImportance(m_nodes[m_nodes[node].child].bounds, p);
+
+            if (i0 + i1 <= 0.f)
+            {
+                return 0.f;
+            }
+
+            if (bit_trail & 1u)
+            {
+                pdf *= i1 / (i0 + i1);
+                node = m_nodes[node].child;
+            }
+            else
+            {
+                pdf *= i0 / (i0 + i1);
+                node = node + 1;
+            }
+
+            bit_trail >>= 1;
+        }
+
+        return pdf;
+    }
+}
@@ -0,0 +1,103 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+
+/**
+ \file light_tree.h
+ \version 1.0
+ \brief Light BVH for spatially aware many-light sampling.
+
+ Each node stores spatial bounds, a cone bounding emission directions and total
+ power of the lights below it. Traversal picks a child proportionally to its
+ importance as seen from the shading point, so the probability of selecting
+ a light can be recomputed from its path in the tree (bit trail) for MIS.
+ Sampling and PDF evaluation follow Kernels/CL/light_tree.cl.
+ */
+#pragma once
+
+#include "math/float3.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Baikal
+{
+    // Spatial and directional bounds of emission of a light (or a group of lights)
+    struct LightBounds
+    {
+        // Spatial bounds
+        RadeonRays::float3 pmin;
+        RadeonRays::float3 pmax;
+        // Cone of emitter normals: axis and cosine of its half angle
+        RadeonRays::float3 axis;
+        float cos_theta_o;
+        // Cosine of emission spread around each normal
+        float cos_theta_e;
+        // Emitted power (luminance)
+        float power;
+        // Emission on both sides of the normal
+        bool two_sided;
+    };
+
+    // Importance of a group of lights as seen from point p
+    float GetLightImportance(LightBounds const& bounds, RadeonRays::float3 const& p);
+
+    // Bounds enclosing both a and b
+    LightBounds UnionLightBounds(LightBounds const& a, LightBounds const& b);
+
+    class LightTree
+    {
+    public:
+        // Number of ints per serialized node
+        static int const kNodeSize = 16;
+        // Bit trail of lights not present in the tree
+        static std::uint32_t const kInvalidTrail = ~0u;
+
+        struct Node
+        {
+            LightBounds bounds;
+            // Second child for interior nodes (first one immediately follows the node),
+            // light index for leaves
+            int child;
+            bool leaf;
+        };
+
+        // Build the tree over lights, lights with zero power are skipped
+        void Build(std::vector<LightBounds> const& lights);
+
+        // Append nodes in the layout expected by LightTree_* kernel functions
+        void Write(std::vector<int>& out) const;
+
+        // Sample light index given point p, returns -1 if nothing can be sampled
+        int Sample(RadeonRays::float3 const& p, float u, float& pdf) const;
+
+        // Probability of selecting a light given point p
+        float GetPdf(RadeonRays::float3 const& p, int light) const;
+
+        std::vector<Node> m_nodes;
+        // Path from the root to the leaf of each light (bit i selects child at depth i)
+        std::vector<std::uint32_t> m_bit_trails;
+
+    private:
+        int BuildNode(std::vector<LightBounds> const& lights, std::vector<int>& indices,
+                      std::size_t begin, std::size_t end, std::uint32_t bit_trail, int depth);
+    };
+}
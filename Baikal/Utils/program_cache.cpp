@@ -0,0 +1,534 @@
+/**********************************************************************
+Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include "program_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#include "Utils/mkpath.h"
+
+namespace Baikal
+{
+    namespace
+    {
+        std::uint32_t const kEntryMagic = 0x43504b42; // "BKPC"
+        std::uint32_t const kEntryVersion = 1;
+        // Temporary files of crashed writers older than this are removed on eviction
+        std::time_t const kStaleTempFileAge = 60 * 60;
+
+        char const kEntryExtension[] = ".bin";
+        char const kTempExtension[] = ".tmp";
+
+        struct EntryHeader
+        {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint64_t size;
+            std::uint64_t checksum;
+        };
+
+        struct FileInfo
+        {
+            std::string path;
+            std::uint64_t size;
+            std::time_t access_time;
+            bool temporary;
+        };
+
+        std::uint64_t Fnv1a64(std::uint8_t const* data, std::size_t size)
+        {
+            std::uint64_t hash = 14695981039346656037ull;
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                hash ^= data[i];
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        bool EndsWith(std::string const& str, char const* suffix)
+        {
+            auto len = std::strlen(suffix);
+            return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+        }
+
+        // SHA-256 as described in FIPS 180-4
+        class Sha256
+        {
+        public:
+            Sha256()
+                : m_state{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }
+                , m_length(0)
+                , m_buffer_size(0)
+            {
+            }
+
+            void Update(std::uint8_t const* data, std::size_t size)
+            {
+                m_length += size;
+
+                while (size > 0)
+                {
+                    auto count = std::min(size, sizeof(m_buffer) - m_buffer_size);
+                    std::memcpy(m_buffer + m_buffer_size, data, count);
+                    m_buffer_size += count;
+                    data += count;
+                    size -= count;
+
+                    if (m_buffer_size == sizeof(m_buffer))
+                    {
+                        Transform(m_buffer);
+                        m_buffer_size = 0;
+                    }
+                }
+            }
+
+            std::string Finalize()
+            {
+                std::uint64_t bit_length = m_length * 8;
+
+                std::uint8_t padding[72] = { 0x80 };
+                auto padding_size = (m_buffer_size < 56 ? 56 : 120) - m_buffer_size;
+
+                for (auto i = 0; i < 8; ++i)
+                {
+                    padding[padding_size + i] = (std::uint8_t)(bit_length >> (56 - 8 * i));
+                }
+
+                Update(padding, padding_size + 8);
+
+                std::ostringstream oss;
+                oss << std::hex << std::setfill('0');
+                for (auto word : m_state)
+                {
+                    oss << std::setw(8) << word;
+                }
+                return oss.str();
+            }
+
+        private:
+            static std::uint32_t Rotr(std::uint32_t x, int n)
+            {
+                return (x >> n) | (x << (32 - n));
+            }
+
+            void Transform(std::uint8_t const* block)
+            {
+                static std::uint32_t const k[64] =
+                {
+                    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+                };
+
+                std::uint32_t w[64];
+                for (auto i = 0; i < 16; ++i)
+                {
+                    w[i] = ((std::uint32_t)block[4 * i] << 24) | ((std::uint32_t)block[4 * i + 1] << 16) |
+                        ((std::uint32_t)block[4 * i + 2] << 8) | (std::uint32_t)block[4 * i + 3];
+                }
+
+                for (auto i = 16; i < 64; ++i)
+                {
+                    auto s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    auto s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                auto a = m_state[0];
+                auto b = m_state[1];
+                auto c = m_state[2];
+                auto d = m_state[3];
+                auto e = m_state[4];
+                auto f = m_state[5];
+                auto g = m_state[6];
+                auto h = m_state[7];
+
+                for (auto i = 0; i < 64; ++i)
+                {
+                    auto s1 = Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25);
+                    auto ch = (e & f) ^ (~e & g);
+                    auto t1 = h + s1 + ch + k[i] + w[i];
+                    auto s0 = Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22);
+                    auto maj = (a & b) ^ (a & c) ^ (b & c);
+                    auto t2 = s0 + maj;
+
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+
+                m_state[0] += a;
+                m_state[1] += b;
+                m_state[2] += c;
+                m_state[3] += d;
+                m_state[4] += e;
+                m_state[5] += f;
+                m_state[6] += g;
+                m_state[7] += h;
+            }
+
+            std::uint32_t m_state[8];
+            std::uint64_t m_length;
+            std::uint8_t m_buffer[64];
+            std::size_t m_buffer_size;
+        };
+
+        int GetProcessId()
+        {
+#ifdef _WIN32
+            return _getpid();
+#else
+            return (int)getpid();
+#endif
+        }
+
+        void Touch(std::string const& path)
+        {
+#ifdef _WIN32
+            _utime(path.c_str(), nullptr);
+#else
+            utime(path.c_str(), nullptr);
+#endif
+        }
+
+        bool Rename(std::string const& from, std::string const& to)
+        {
+#ifdef _WIN32
+            return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+            return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+        }
+
+        std::vector<FileInfo> ListFiles(std::string const& folder)
+        {
+            std::vector<FileInfo> files;
+
+#ifdef _WIN32
+            WIN32_FIND_DATAA find_data;
+            auto handle = FindFirstFileA((folder + "/*").c_str(), &find_data);
+
+            if (handle == INVALID_HANDLE_VALUE)
+            {
+                return files;
+            }
+
+            do
+            {
+                if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                {
+                    continue;
+                }
+
+                std::string name = find_data.cFileName;
+                ULARGE_INTEGER time;
+                time.LowPart = find_data.ftLastWriteTime.dwLowDateTime;
+                time.HighPart = find_data.ftLastWriteTime.dwHighDateTime;
+
+                FileInfo info;
+                info.path = folder + "/" + name;
+                info.size = ((std::uint64_t)find_data.nFileSizeHigh << 32) | find_data.nFileSizeLow;
+                // FILETIME is in 100ns intervals since 1601
+                info.access_time = (std::time_t)(time.QuadPart / 10000000ull - 11644473600ull);
+                info.temporary = EndsWith(name, kTempExtension);
+
+                if (info.temporary || EndsWith(name, kEntryExtension))
+                {
+                    files.push_back(info);
+                }
+            } while (FindNextFileA(handle, &find_data));
+
+            FindClose(handle);
+#else
+            auto dir = opendir(folder.c_str());
+
+            if (!dir)
+            {
+                return files;
+            }
+
+            while (auto entry = readdir(dir))
+            {
+                std::string name = entry->d_name;
+                bool temporary = EndsWith(name, kTempExtension);
+
+                if (!temporary && !EndsWith(name, kEntryExtension))
+                {
+                    continue;
+                }
+
+                FileInfo info;
+                info.path = folder + "/" + name;
+
+                struct stat st;
+                if (stat(info.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+                {
+                    continue;
+                }
+
+                info.size = (std::uint64_t)st.st_size;
+                info.access_time = st.st_mtime;
+                info.temporary = temporary;
+                files.push_back(info);
+            }
+
+            closedir(dir);
+#endif
+
+            return files;
+        }
+    }
+
+    const std::uint64_t ProgramCache::kDefaultMaxSize = 512ull * 1024ull * 1024ull;
+
+    ProgramCache::ProgramCache(const std::string &path, std::uint64_t max_size)
+        : m_path(path)
+        , m_max_size(max_size)
+    {
+    }
+
+    std::string ProgramCache::ComputeHash(const std::string &data)
+    {
+        Sha256 sha;
+        sha.Update(reinterpret_cast<std::uint8_t const*>(data.data()), data.size());
+        return sha.Finalize();
+    }
+
+    std::string ProgramCache::ComputeKey(const std::vector<std::string> &parts)
+    {
+        Sha256 sha;
+
+        for (auto const& part : parts)
+        {
+            // Prefix each part with its length so different splits never collide
+            std::uint64_t size = part.size();
+            std::uint8_t size_bytes[8];
+            for (auto i = 0; i < 8; ++i)
+            {
+                size_bytes[i] = (std::uint8_t)(size >> (8 * i));
+            }
+
+            sha.Update(size_bytes, sizeof(size_bytes));
+            sha.Update(reinterpret_cast<std::uint8_t const*>(part.data()), part.size());
+        }
+
+        return sha.Finalize();
+    }
+
+    std::string ProgramCache::GetEntryPath(const std::string &key) const
+    {
+        return m_path + "/" + key + kEntryExtension;
+    }
+
+    bool ProgramCache::Load(const std::string &key, std::vector<std::uint8_t> &data)
+    {
+        if (!IsEnabled())
+        {
+            return false;
+        }
+
+        auto path = GetEntryPath(key);
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+
+        if (!in)
+        {
+            ++m_stats.misses;
+            return false;
+        }
+
+        EntryHeader header;
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        bool valid = in && header.magic == kEntryMagic && header.version == kEntryVersion;
+
+        if (valid)
+        {
+            // Do not trust the stored size before allocating
+            auto data_start = in.tellg();
+            in.seekg(0, std::ios::end);
+            auto remaining = static_cast<std::uint64_t>(in.tellg() - data_start);
+            in.seekg(data_start);
+
+            valid = in && header.size == remaining;
+        }
+
+        if (valid)
+        {
+            data.resize(static_cast<std::size_t>(header.size));
+            in.read(reinterpret_cast<char*>(data.data()), data.size());
+            valid = in && (in.peek() == std::char_traits<char>::eof()) &&
+                Fnv1a64(data.data(), data.size()) == header.checksum;
+        }
+
+        in.close();
+
+        if (!valid)
+        {
+            // Corrupted or outdated entry, it will be replaced on store
+            data.clear();
+            std::remove(path.c_str());
+            ++m_stats.misses;
+            return false;
+        }
+
+        // Update access time for LRU eviction
+        Touch(path);
+
+        ++m_stats.hits;
+        return true;
+    }
+
+    void ProgramCache::Store(const std::string &key, const std::vector<std::uint8_t> &data)
+    {
+        if (!IsEnabled() || data.empty())
+        {
+            return;
+        }
+
+        mkpath(m_path);
+
+        static std::atomic<std::uint32_t> temp_counter(0);
+
+        auto path = GetEntryPath(key);
+        auto temp_path = path + "." + std::to_string(GetProcessId()) + "." +
+            std::to_string(temp_counter++) + kTempExtension;
+
+        EntryHeader header;
+        header.magic = kEntryMagic;
+        header.version = kEntryVersion;
+        header.size = data.size();
+        header.checksum = Fnv1a64(data.data(), data.size());
+
+        {
+            std::ofstream out(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+            if (!out)
+            {
+                return;
+            }
+
+            out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+            out.write(reinterpret_cast<char const*>(data.data()), data.size());
+            out.close();
+
+            if (!out)
+            {
+                std::remove(temp_path.c_str());
+                return;
+            }
+        }
+
+        // Entries are content addressed: if another process won the race it stored the same data
+        if (!Rename(temp_path, path))
+        {
+            std::remove(temp_path.c_str());
+            return;
+        }
+
+        ++m_stats.stores;
+
+        Evict(key);
+    }
+
+    void ProgramCache::Evict(const std::string &keep_key)
+    {
+        if (!IsEnabled())
+        {
+            return;
+        }
+
+        auto files = ListFiles(m_path);
+        auto keep_path = keep_key.empty() ? std::string() : GetEntryPath(keep_key);
+        auto now = std::time(nullptr);
+
+        std::uint64_t total_size = 0;
+        for (auto const& file : files)
+        {
+            total_size += file.size;
+        }
+
+        // Oldest first
+        std::sort(files.begin(), files.end(), [](FileInfo const& lhs, FileInfo const& rhs)
+        {
+            return lhs.access_time < rhs.access_time;
+        });
+
+        for (auto const& file : files)
+        {
+            if (file.temporary)
+            {
+                // Might be written right now by another process
+                if (now - file.access_time > kStaleTempFileAge && std::remove(file.path.c_str()) == 0)
+                {
+                    total_size -= file.size;
+                }
+                continue;
+            }
+
+            if (total_size <= m_max_size)
+            {
+                break;
+            }
+
+            if (file.path == keep_path)
+            {
+                continue;
+            }
+
+            if (std::remove(file.path.c_str()) == 0)
+            {
+                total_size -= file.size;
+                ++m_stats.evictions;
+            }
+        }
+    }
+}
@@ -0,0 +1,81 @@
+/**********************************************************************
+Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Baikal
+{
+    /**
+     * @brief Persistent content-addressed cache of compiled program binaries
+     *
+     * Each entry is a file in the cache folder named by its key. Entries are written
+     * into a temporary file first and then renamed, so processes sharing the same
+     * folder never observe partially written data. Every entry carries a header with
+     * size and checksum of the payload which is validated on load. Total size of the
+     * folder is bounded: least recently used entries are evicted first.
+     */
+    class ProgramCache
+    {
+    public:
+        struct Stats
+        {
+            std::uint32_t hits = 0;
+            std::uint32_t misses = 0;
+            std::uint32_t stores = 0;
+            std::uint32_t evictions = 0;
+        };
+
+        // Default cache size limit
+        static const std::uint64_t kDefaultMaxSize;
+
+        // Creates cache in specified folder, empty path disables the cache
+        ProgramCache(const std::string &path, std::uint64_t max_size = kDefaultMaxSize);
+
+        // Returns SHA-256 of the data as a hex string
+        static std::string ComputeHash(const std::string &data);
+        // Returns key identifying the combination of all parts
+        static std::string ComputeKey(const std::vector<std::string> &parts);
+
+        // Loads entry payload, returns false if entry is missing or corrupted
+        bool Load(const std::string &key, std::vector<std::uint8_t> &data);
+        // Stores entry and evicts old entries if cache grew over the limit
+        void Store(const std::string &key, const std::vector<std::uint8_t> &data);
+        // Removes least recently used entries until cache fits into size limit
+        void Evict(const std::string &keep_key = "");
+
+        bool IsEnabled() const { return !m_path.empty(); }
+        const Stats& GetStats() const { return m_stats; }
+        const std::string& GetPath() const { return m_path; }
+        std::uint64_t GetMaxSize() const { return m_max_size; }
+
+    private:
+        std::string GetEntryPath(const std::string &key) const;
+
+        std::string m_path;       ///< Cache folder path
+        std::uint64_t m_max_size; ///< Max total size of cache entries in bytes
+        Stats m_stats;
+    };
+}
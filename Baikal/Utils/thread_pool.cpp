@@ -0,0 +1,195 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace Baikal
+{
+    ThreadPool::ThreadPool(std::uint32_t num_threads)
+        : m_func(nullptr)
+        , m_num_queued(0)
+        , m_num_pending(0)
+        , m_stop(false)
+    {
+        if (!num_threads)
+        {
+            num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        for (auto i = 0u; i < num_threads; ++i)
+        {
+            m_queues.emplace_back(new Queue());
+        }
+
+        for (auto i = 1u; i < num_threads; ++i)
+        {
+            m_threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_wake.notify_all();
+
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    void ThreadPool::ParallelFor(std::size_t count, std::size_t grain_size, RangeFunction const& func)
+    {
+        if (!count)
+        {
+            return;
+        }
+
+        grain_size = std::max<std::size_t>(grain_size, 1);
+
+        std::lock_guard<std::mutex> call_lock(m_call_mutex);
+
+        auto num_tasks = (count + grain_size - 1) / grain_size;
+
+        m_func = &func;
+        m_error = nullptr;
+        m_num_pending = num_tasks;
+
+        for (auto i = 0u; i < num_tasks; ++i)
+        {
+            Task task{ i * grain_size, std::min(count, (i + 1) * grain_size) };
+
+            auto& queue = *m_queues[i % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(task);
+            ++m_num_queued;
+        }
+
+        // Workers check queued count under the lock, so they are either
+        // sleeping already or are going to see the tasks
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+
+        m_wake.notify_all();
+
+        // Calling thread works as well
+        Task task;
+        while (GetTask(0, task))
+        {
+            RunTask(task);
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this]() { return m_num_pending == 0; });
+        }
+
+        m_func = nullptr;
+
+        if (m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+    void ThreadPool::WorkerLoop(std::size_t queue_idx)
+    {
+        for (;;)
+        {
+            Task task;
+            if (GetTask(queue_idx, task))
+            {
+                RunTask(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() { return m_stop || m_num_queued > 0; });
+
+            if (m_stop)
+            {
+                return;
+            }
+        }
+    }
+
+    bool ThreadPool::GetTask(std::size_t queue_idx, Task& task)
+    {
+        auto num_queues = m_queues.size();
+
+        for (auto i = 0u; i < num_queues; ++i)
+        {
+            auto& queue = *m_queues[(queue_idx + i) % num_queues];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            if (queue.tasks.empty())
+            {
+                continue;
+            }
+
+            // Own tasks are taken from the back, stolen ones from the front
+            if (i == 0)
+            {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+
+            --m_num_queued;
+            return true;
+        }
+
+        return false;
+    }
+
+    void ThreadPool::RunTask(Task const& task)
+    {
+        try
+        {
+            (*m_func)(task.begin, task.end);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error)
+            {
+                m_error = std::current_exception();
+            }
+        }
+
+        if (--m_num_pending == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.notify_all();
+        }
+    }
+}
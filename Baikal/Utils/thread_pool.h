@@ -0,0 +1,106 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+
+/**
+ \file thread_pool.h
+ \version 1.0
+ \brief Work stealing thread pool used by CPU backend.
+
+ Every worker owns a queue of tasks, it takes tasks from the back of its own
+ queue and steals from the front of other queues when its own one is empty.
+ ParallelFor splits the range into chunks distributed round robin over the
+ queues and the calling thread takes part in the work until all chunks are done.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Baikal
+{
+    class ThreadPool
+    {
+    public:
+        // Range function called as func(begin, end)
+        using RangeFunction = std::function<void(std::size_t, std::size_t)>;
+
+        // Creates pool with num_threads threads in total including
+        // the calling one, 0 means hardware concurrency
+        explicit ThreadPool(std::uint32_t num_threads = 0);
+        ~ThreadPool();
+
+        // Number of threads taking part in ParallelFor
+        std::uint32_t GetNumThreads() const { return static_cast<std::uint32_t>(m_queues.size()); }
+
+        // Call func for chunks of [0, count) of at most grain_size elements
+        // and wait for completion. Rethrows the first exception thrown by func.
+        // Chunk boundaries do not depend on the number of threads.
+        void ParallelFor(std::size_t count, std::size_t grain_size, RangeFunction const& func);
+
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool& operator = (ThreadPool const&) = delete;
+
+    private:
+        struct Task
+        {
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        // Worker thread loop, queue 0 belongs to the calling thread
+        void WorkerLoop(std::size_t queue_idx);
+        // Take a task from own queue or steal one from others
+        bool GetTask(std::size_t queue_idx, Task& task);
+        // Run a task of the current ParallelFor
+        void RunTask(Task const& task);
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        std::vector<std::thread> m_threads;
+
+        // Serializes ParallelFor calls
+        std::mutex m_call_mutex;
+        // Protects sleeping and completion
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+
+        RangeFunction const* m_func;
+        std::atomic<std::size_t> m_num_queued;
+        std::atomic<std::size_t> m_num_pending;
+        std::exception_ptr m_error;
+        bool m_stop;
+    };
+}
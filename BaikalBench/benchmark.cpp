@@ -0,0 +1,350 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#include "benchmark.h"
+
+#include "CLW.h"
+#include "RenderFactory/clw_render_factory.h"
+#include "Renderers/monte_carlo_renderer.h"
+#include "Estimators/path_tracing_estimator.h"
+#include "Output/output.h"
+#include "SceneGraph/camera.h"
+#include "SceneGraph/scene1.h"
+#include "scene_io.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    double ElapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Nearest rank percentile of sorted values
+    double Percentile(std::vector<double> const& sorted, double percentile)
+    {
+        auto rank = static_cast<std::size_t>(std::ceil(percentile / 100.0 * sorted.size()));
+        return sorted[std::min(std::max(rank, std::size_t(1)), sorted.size()) - 1];
+    }
+
+    std::string EscapeJson(std::string const& str)
+    {
+        std::string result;
+
+        for (auto c : str)
+        {
+            switch (c)
+            {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\t': result += "\\t"; break;
+            default: result += c; break;
+            }
+        }
+
+        return result;
+    }
+
+    char const* kMemoryCategoryNames[] =
+    {
+        "geometry",
+        "textures",
+        "scene",
+        "work_buffers",
+        "outputs"
+    };
+
+    static_assert(sizeof(kMemoryCategoryNames) / sizeof(kMemoryCategoryNames[0]) ==
+        static_cast<std::size_t>(Baikal::ClwProfiler::MemoryCategory::kMax), "Memory category name is missing");
+
+    CLWContext CreateContext(int platform_index, int device_index)
+    {
+        std::vector<CLWPlatform> platforms;
+        CLWPlatform::CreateAllPlatforms(platforms);
+
+        if (platforms.empty())
+        {
+            throw std::runtime_error("No OpenCL platforms installed");
+        }
+
+        // Prefer GPU devices if nothing has been specified
+        if (platform_index == -1)
+        {
+            platform_index = 0;
+
+            for (auto j = 0u; j < platforms.size(); ++j)
+            {
+                for (auto i = 0u; i < platforms[j].GetDeviceCount(); ++i)
+                {
+                    if (platforms[j].GetDevice(i).GetType() == CL_DEVICE_TYPE_GPU)
+                    {
+                        platform_index = j;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (static_cast<std::size_t>(platform_index) >= platforms.size())
+        {
+            throw std::runtime_error("Invalid OpenCL platform index");
+        }
+
+        auto& platform = platforms[platform_index];
+
+        if (device_index == -1)
+        {
+            device_index = 0;
+
+            for (auto i = 0u; i < platform.GetDeviceCount(); ++i)
+            {
+                if (platform.GetDevice(i).GetType() == CL_DEVICE_TYPE_GPU)
+                {
+                    device_index = i;
+                    break;
+                }
+            }
+        }
+
+        if (static_cast<std::uint32_t>(device_index) >= platform.GetDeviceCount())
+        {
+            throw std::runtime_error("Invalid OpenCL device index");
+        }
+
+        return CLWContext::Create(platform.GetDevice(device_index));
+    }
+}
+
+namespace Baikal
+{
+    Benchmark::Benchmark(BenchmarkSettings const& settings)
+        : m_settings(settings)
+    {
+        if (m_settings.iterations == 0)
+        {
+            throw std::runtime_error("Number of timed iterations should be positive");
+        }
+    }
+
+    void Benchmark::Run()
+    {
+        m_results.clear();
+
+        // Scene files first, then procedural scenes for all light / material combinations
+        std::vector<std::string> scenes = m_settings.scenes;
+
+        if (scenes.empty() || m_settings.procedural)
+        {
+            for (auto lights : m_settings.lights)
+            {
+                for (auto materials : m_settings.materials)
+                {
+                    scenes.push_back("bench+l" + std::to_string(lights) + "+m" + std::to_string(materials) + ".test");
+                }
+            }
+        }
+
+        auto context = CreateContext(m_settings.platform_index, m_settings.device_index);
+        m_device_name = context.GetDevice(0).GetName();
+
+        auto factory = std::make_unique<ClwRenderFactory>(context, "cache");
+        auto& profiler = factory->GetProfiler();
+        profiler.SetTimingEnabled(true);
+
+        auto renderer = factory->CreateRenderer(ClwRenderFactory::RendererType::kUnidirectionalPathTracer);
+        auto controller = factory->CreateSceneController();
+
+        auto monte_carlo_renderer = static_cast<MonteCarloRenderer*>(renderer.get());
+        auto& estimator = dynamic_cast<PathTracingEstimator&>(*monte_carlo_renderer->m_estimator);
+
+        // Compile kernels in background while the first scene is loaded and compiled
+        auto& program_manager = factory->GetProgramManager();
+        program_manager.CompileProgramsAsync(program_manager.GetProgramVariants());
+
+        for (auto const& scene_name : scenes)
+        {
+            auto is_procedural = scene_name.compare(0, 5, "bench") == 0;
+            auto scene = is_procedural ?
+                SceneIo::LoadScene(scene_name, "") :
+                SceneIo::LoadScene(m_settings.path + scene_name, m_settings.path);
+
+            auto camera = PerspectiveCamera::Create(
+                m_settings.camera_pos,
+                m_settings.camera_at,
+                RadeonRays::float3(0.f, 1.f, 0.f));
+
+            camera->SetSensorSize(RadeonRays::float2(0.036f, 0.024f));
+            camera->SetDepthRange(RadeonRays::float2(0.0f, 100000.f));
+            camera->SetFocalLength(0.035f);
+            camera->SetFocusDistance(1.f);
+            camera->SetAperture(0.f);
+            scene->SetCamera(camera);
+
+            auto compile_start = Clock::now();
+            controller->CompileScene(scene);
+            context.Finish(0);
+            auto compile_time_ms = ElapsedMs(compile_start);
+
+            auto& clw_scene = controller->GetCachedScene(scene);
+
+            // Frame timings should not include kernel compilation
+            program_manager.WaitForWarmup();
+            auto warmup_status = program_manager.GetWarmupStatus();
+            m_num_kernel_variants = warmup_status.num_variants;
+            m_kernel_warmup_time_ms = warmup_status.elapsed_ms;
+
+            for (auto const& resolution : m_settings.resolutions)
+            {
+                auto output = factory->CreateOutput(resolution.x, resolution.y);
+                renderer->SetOutput(Renderer::OutputType::kColor, output.get());
+
+                for (auto bounces : m_settings.bounces)
+                {
+                    BenchmarkResult result;
+                    result.scene = is_procedural ? scene_name.substr(0, scene_name.rfind(".test")) : scene_name;
+                    result.resolution = resolution;
+                    result.bounces = bounces;
+                    result.compile_time_ms = compile_time_ms;
+
+                    monte_carlo_renderer->SetMaxBounces(bounces);
+                    renderer->SetRandomSeed(0);
+                    renderer->Clear(RadeonRays::float3(0.f), *output);
+
+                    for (auto i = 0u; i < m_settings.warmup_iterations; ++i)
+                    {
+                        renderer->Render(clw_scene);
+                    }
+
+                    // Drop warm-up timings and ray counts
+                    context.Finish(0);
+                    profiler.ResetTimings();
+                    estimator.ReadTracedRayCount();
+
+                    std::vector<double> frame_times;
+                    frame_times.reserve(m_settings.iterations);
+
+                    for (auto i = 0u; i < m_settings.iterations; ++i)
+                    {
+                        auto frame_start = Clock::now();
+                        renderer->Render(clw_scene);
+                        context.Finish(0);
+                        frame_times.push_back(ElapsedMs(frame_start));
+
+                        // Read per frame so the device counter does not overflow
+                        result.num_rays += estimator.ReadTracedRayCount();
+                    }
+
+                    auto total_time_ms = std::accumulate(frame_times.cbegin(), frame_times.cend(), 0.0);
+                    std::sort(frame_times.begin(), frame_times.end());
+
+                    result.mean_frame_time_ms = total_time_ms / frame_times.size();
+                    result.min_frame_time_ms = frame_times.front();
+                    result.max_frame_time_ms = frame_times.back();
+                    result.p50_frame_time_ms = Percentile(frame_times, 50.0);
+                    result.p90_frame_time_ms = Percentile(frame_times, 90.0);
+                    result.p99_frame_time_ms = Percentile(frame_times, 99.0);
+                    result.rays_per_second = total_time_ms > 0.0 ? result.num_rays / (total_time_ms * 1e-3) : 0.0;
+
+                    result.stages = profiler.GetKernelStatistics();
+                    result.memory = profiler.GetMemoryStatistics();
+
+                    m_results.push_back(std::move(result));
+                }
+
+                renderer->SetOutput(Renderer::OutputType::kColor, nullptr);
+            }
+        }
+    }
+
+    void Benchmark::WriteJson(std::ostream& stream) const
+    {
+        stream << std::fixed << std::setprecision(4);
+
+        stream << "{\n";
+        stream << "  \"device\": \"" << EscapeJson(m_device_name) << "\",\n";
+        stream << "  \"warmup_iterations\": " << m_settings.warmup_iterations << ",\n";
+        stream << "  \"iterations\": " << m_settings.iterations << ",\n";
+        stream << "  \"kernel_variants\": " << m_num_kernel_variants << ",\n";
+        stream << "  \"kernel_warmup_time_ms\": " << m_kernel_warmup_time_ms << ",\n";
+        stream << "  \"results\": [";
+
+        for (auto r = 0u; r < m_results.size(); ++r)
+        {
+            auto const& result = m_results[r];
+
+            stream << (r ? ",\n" : "\n") << "    {\n";
+            stream << "      \"scene\": \"" << EscapeJson(result.scene) << "\",\n";
+            stream << "      \"width\": " << result.resolution.x << ",\n";
+            stream << "      \"height\": " << result.resolution.y << ",\n";
+            stream << "      \"bounces\": " << result.bounces << ",\n";
+            stream << "      \"compile_time_ms\": " << result.compile_time_ms << ",\n";
+            stream << "      \"frame_time_ms\": { "
+                << "\"mean\": " << result.mean_frame_time_ms << ", "
+                << "\"min\": " << result.min_frame_time_ms << ", "
+                << "\"max\": " << result.max_frame_time_ms << ", "
+                << "\"p50\": " << result.p50_frame_time_ms << ", "
+                << "\"p90\": " << result.p90_frame_time_ms << ", "
+                << "\"p99\": " << result.p99_frame_time_ms << " },\n";
+            stream << "      \"rays\": " << result.num_rays << ",\n";
+            stream << "      \"rays_per_second\": " << result.rays_per_second << ",\n";
+
+            stream << "      \"memory_bytes\": { ";
+            for (auto i = 0u; i < static_cast<std::size_t>(ClwProfiler::MemoryCategory::kMax); ++i)
+            {
+                stream << "\"" << kMemoryCategoryNames[i] << "\": " << result.memory.category_bytes[i] << ", ";
+            }
+            stream << "\"total\": " << result.memory.total_bytes << ", ";
+            stream << "\"peak\": " << result.memory.peak_bytes << " },\n";
+
+            // Per frame kernel time is comparable between runs with different iteration counts
+            stream << "      \"stages\": [";
+            for (auto s = 0u; s < result.stages.size(); ++s)
+            {
+                auto const& stage = result.stages[s];
+
+                stream << (s ? ",\n" : "\n") << "        { "
+                    << "\"kernel\": \"" << EscapeJson(stage.name) << "\", "
+                    << "\"bounce\": " << stage.bounce << ", "
+                    << "\"launches\": " << stage.num_launches << ", "
+                    << "\"per_frame_ms\": " << stage.total_time_ms / m_settings.iterations << ", "
+                    << "\"total_ms\": " << stage.total_time_ms << ", "
+                    << "\"min_ms\": " << stage.min_time_ms << ", "
+                    << "\"max_ms\": " << stage.max_time_ms << " }";
+            }
+            stream << (result.stages.empty() ? "]\n" : "\n      ]\n");
+
+            stream << "    }";
+        }
+
+        stream << (m_results.empty() ? "]\n" : "\n  ]\n");
+        stream << "}\n";
+    }
+}
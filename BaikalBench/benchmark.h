@@ -0,0 +1,119 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+/**
+ \file benchmark.h
+ \version 1.0
+ \brief Headless renderer benchmark.
+
+ Benchmark renders every combination of scene, resolution and bounce count with
+ a fixed random seed: a number of warm-up frames are rendered first and then
+ a number of timed frames. Every timed frame is waited for, so frame times
+ include the whole GPU work of the frame. Results contain frame time statistics,
+ traced rays per second, per kernel timings and device memory usage and are
+ written as JSON to be compared between runs.
+ */
+#pragma once
+
+#include "Utils/clw_profiler.h"
+#include "math/int2.h"
+#include "math/float3.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Baikal
+{
+    struct BenchmarkSettings
+    {
+        // Scene files, loaded relative to path
+        std::vector<std::string> scenes;
+        std::string path;
+        // Run procedural scenes even if scene files are specified
+        bool procedural = false;
+
+        // Sweep parameters
+        std::vector<RadeonRays::int2> resolutions = { RadeonRays::int2(1280, 720) };
+        std::vector<std::uint32_t> bounces = { 5 };
+        // Number of lights and material complexity of procedural scenes
+        std::vector<std::uint32_t> lights = { 1 };
+        std::vector<std::uint32_t> materials = { 0 };
+
+        std::uint32_t warmup_iterations = 5;
+        std::uint32_t iterations = 50;
+
+        RadeonRays::float3 camera_pos = RadeonRays::float3(0.f, 3.f, 4.f);
+        RadeonRays::float3 camera_at = RadeonRays::float3(0.f, 0.5f, -2.4f);
+
+        // OpenCL platform & device, -1 picks the first GPU
+        int platform_index = -1;
+        int device_index = -1;
+    };
+
+    struct BenchmarkResult
+    {
+        std::string scene;
+        RadeonRays::int2 resolution;
+        std::uint32_t bounces = 0;
+
+        // Time to compile the scene for the first time
+        double compile_time_ms = 0.0;
+
+        // Frame time statistics over timed iterations
+        double mean_frame_time_ms = 0.0;
+        double min_frame_time_ms = 0.0;
+        double max_frame_time_ms = 0.0;
+        double p50_frame_time_ms = 0.0;
+        double p90_frame_time_ms = 0.0;
+        double p99_frame_time_ms = 0.0;
+
+        std::uint64_t num_rays = 0;
+        double rays_per_second = 0.0;
+
+        // Kernel timings over timed iterations
+        std::vector<ClwProfiler::KernelStatistics> stages;
+        ClwProfiler::MemoryStatistics memory;
+    };
+
+    class Benchmark
+    {
+    public:
+        explicit Benchmark(BenchmarkSettings const& settings);
+
+        // Render all configurations, throws on failure
+        void Run();
+
+        std::vector<BenchmarkResult> const& GetResults() const { return m_results; }
+
+        // Write settings and results as JSON
+        void WriteJson(std::ostream& stream) const;
+
+    private:
+        BenchmarkSettings m_settings;
+        std::string m_device_name;
+        // Ahead-of-time compilation of all kernel variants
+        std::uint32_t m_num_kernel_variants = 0;
+        std::uint32_t m_kernel_warmup_time_ms = 0;
+        std::vector<BenchmarkResult> m_results;
+    };
+}
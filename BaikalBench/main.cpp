@@ -0,0 +1,215 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    char const* kHelpMessage =
+        "BaikalBench [-p path_to_models][-f model_name[,model_name...]][-procedural][-res WxH[,WxH...]]"
+        "[-nb bounces[,bounces...]][-lights count[,count...]][-materials complexity[,complexity...]]"
+        "[-warmup number_of_frames][-iterations number_of_frames][-platform index][-device index]"
+        "[-cpx x][-cpy y][-cpz z][-tpx x][-tpy y][-tpz z][-o output_json]";
+
+    char* GetCmdOption(char** begin, char** end, std::string const& option)
+    {
+        char** itr = std::find(begin, end, option);
+        if (itr != end && ++itr != end)
+        {
+            return *itr;
+        }
+        return nullptr;
+    }
+
+    bool CmdOptionExists(char** begin, char** end, std::string const& option)
+    {
+        return std::find(begin, end, option) != end;
+    }
+
+    std::vector<std::string> SplitList(std::string const& list)
+    {
+        std::vector<std::string> result;
+        std::istringstream stream(list);
+        std::string item;
+
+        while (std::getline(stream, item, ','))
+        {
+            if (!item.empty())
+            {
+                result.push_back(item);
+            }
+        }
+
+        return result;
+    }
+
+    std::vector<std::uint32_t> ParseUintList(std::string const& list)
+    {
+        std::vector<std::uint32_t> result;
+
+        for (auto const& item : SplitList(list))
+        {
+            result.push_back(static_cast<std::uint32_t>(std::stoul(item)));
+        }
+
+        if (result.empty())
+        {
+            throw std::runtime_error("Empty list: " + list);
+        }
+
+        return result;
+    }
+
+    std::vector<RadeonRays::int2> ParseResolutionList(std::string const& list)
+    {
+        std::vector<RadeonRays::int2> result;
+
+        for (auto const& item : SplitList(list))
+        {
+            auto x = item.find('x');
+            if (x == std::string::npos)
+            {
+                throw std::runtime_error("Invalid resolution: " + item);
+            }
+
+            RadeonRays::int2 resolution(std::stoi(item.substr(0, x)), std::stoi(item.substr(x + 1)));
+            if (resolution.x <= 0 || resolution.y <= 0)
+            {
+                throw std::runtime_error("Invalid resolution: " + item);
+            }
+
+            result.push_back(resolution);
+        }
+
+        if (result.empty())
+        {
+            throw std::runtime_error("Empty list: " + list);
+        }
+
+        return result;
+    }
+
+    Baikal::BenchmarkSettings ParseSettings(int argc, char* argv[])
+    {
+        Baikal::BenchmarkSettings s;
+        char** end = argv + argc;
+
+        char* path = GetCmdOption(argv, end, "-p");
+        s.path = path ? path : s.path;
+
+        char* models = GetCmdOption(argv, end, "-f");
+        s.scenes = models ? SplitList(models) : s.scenes;
+
+        s.procedural = CmdOptionExists(argv, end, "-procedural");
+
+        char* resolutions = GetCmdOption(argv, end, "-res");
+        s.resolutions = resolutions ? ParseResolutionList(resolutions) : s.resolutions;
+
+        char* bounces = GetCmdOption(argv, end, "-nb");
+        s.bounces = bounces ? ParseUintList(bounces) : s.bounces;
+
+        char* lights = GetCmdOption(argv, end, "-lights");
+        s.lights = lights ? ParseUintList(lights) : s.lights;
+
+        char* materials = GetCmdOption(argv, end, "-materials");
+        s.materials = materials ? ParseUintList(materials) : s.materials;
+
+        char* warmup = GetCmdOption(argv, end, "-warmup");
+        s.warmup_iterations = warmup ? atoi(warmup) : s.warmup_iterations;
+
+        char* iterations = GetCmdOption(argv, end, "-iterations");
+        s.iterations = iterations ? atoi(iterations) : s.iterations;
+
+        char* platform_index = GetCmdOption(argv, end, "-platform");
+        s.platform_index = platform_index ? atoi(platform_index) : s.platform_index;
+
+        char* device_index = GetCmdOption(argv, end, "-device");
+        s.device_index = device_index ? atoi(device_index) : s.device_index;
+
+        char* camposx = GetCmdOption(argv, end, "-cpx");
+        s.camera_pos.x = camposx ? (float)atof(camposx) : s.camera_pos.x;
+
+        char* camposy = GetCmdOption(argv, end, "-cpy");
+        s.camera_pos.y = camposy ? (float)atof(camposy) : s.camera_pos.y;
+
+        char* camposz = GetCmdOption(argv, end, "-cpz");
+        s.camera_pos.z = camposz ? (float)atof(camposz) : s.camera_pos.z;
+
+        char* camatx = GetCmdOption(argv, end, "-tpx");
+        s.camera_at.x = camatx ? (float)atof(camatx) : s.camera_at.x;
+
+        char* camaty = GetCmdOption(argv, end, "-tpy");
+        s.camera_at.y = camaty ? (float)atof(camaty) : s.camera_at.y;
+
+        char* camatz = GetCmdOption(argv, end, "-tpz");
+        s.camera_at.z = camatz ? (float)atof(camatz) : s.camera_at.z;
+
+        return s;
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    if (CmdOptionExists(argv, argv + argc, "-help"))
+    {
+        std::cout << kHelpMessage << std::endl;
+        return 0;
+    }
+
+    try
+    {
+        auto settings = ParseSettings(argc, argv);
+
+        Baikal::Benchmark benchmark(settings);
+        benchmark.Run();
+
+        char* output = GetCmdOption(argv, argv + argc, "-o");
+        if (output)
+        {
+            std::ofstream file(output);
+            if (!file)
+            {
+                throw std::runtime_error(std::string("Cannot open file for writing: ") + output);
+            }
+
+            benchmark.WriteJson(file);
+            std::cout << "Results saved to " << output << std::endl;
+        }
+        else
+        {
+            benchmark.WriteJson(std::cout);
+        }
+    }
+    catch (std::exception& ex)
+    {
+        std::cout << ex.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include "image_io.h"
+#include "texture_compressor.h"
 #include "SceneGraph/texture.h"
+#include "Utils/block_compression.h"
 
 #include "OpenImageIO/imageio.h"
 
@@ -16,21 +18,24 @@ namespace Baikal
     {
         OIIO_NAMESPACE_USING
 
+        // Keep scalar and two channel maps compact instead of expanding them to RGBA
         if (spec.format.basetype == TypeDesc::UINT8)
-            return Texture::Format::kRgba8;
+            return spec.nchannels == 1 ? Texture::Format::kR8 :
+                (spec.nchannels == 2 ? Texture::Format::kRg8 : Texture::Format::kRgba8);
         else if (spec.format.basetype == TypeDesc::HALF)
-            return Texture::Format::kRgba16;
+            return spec.nchannels == 1 ? Texture::Format::kR16 :
+                (spec.nchannels == 2 ? Texture::Format::kRg16 : Texture::Format::kRgba16);
         else
-            return Texture::Format::kRgba32;
+            return spec.nchannels == 1 ? Texture::Format::kR32 : Texture::Format::kRgba32;
     }
 
     static OIIO_NAMESPACE::TypeDesc GetTextureFormat(Texture::Format fmt)
     {
         OIIO_NAMESPACE_USING
 
-        if (fmt == Texture::Format::kRgba8)
+        if (fmt == Texture::Format::kRgba8 || fmt == Texture::Format::kR8 || fmt == Texture::Format::kRg8)
             return  TypeDesc::UINT8;
-        else if (fmt == Texture::Format::kRgba16)
+        else if (fmt == Texture::Format::kRgba16 || fmt == Texture::Format::kR16 || fmt == Texture::Format::kRg16)
             return TypeDesc::HALF;
         else
             return TypeDesc::FLOAT;
@@ -50,64 +55,26 @@ namespace Baikal
         ImageSpec const& spec = input->spec();
 
         auto fmt = GetTextureFormat(spec);
-        char* texturedata = nullptr;
+        auto type = GetTextureFormat(fmt);
 
-        if (fmt == Texture::Format::kRgba8)
-        {
-            auto size = spec.width * spec.height * spec.depth * 4;
-
-            texturedata = new char[size];
-            memset(texturedata, 0, size);
-
-            // Read data to storage
-            input->read_image(TypeDesc::UINT8, texturedata, sizeof(char) * 4);
+        // Two channel float images have no compact format and are expanded to RGBA
+        auto num_channels = fmt == Texture::Format::kRgba8 || fmt == Texture::Format::kRgba16 ||
+            fmt == Texture::Format::kRgba32 ? 4 : spec.nchannels;
+        auto pixel_size = num_channels * type.size();
+        auto size = spec.width * spec.height * spec.depth * pixel_size;
 
-            if (spec.nchannels == 1)
-            {
-                // set B, G and A components to 
-                for (auto i = 0; i < size; i += 4)
-                {
-                    texturedata[i + 1] = texturedata[i];
-                    texturedata[i + 2] = texturedata[i];
-                    texturedata[i + 3] = texturedata[i];
-                }
+        // Resize storage
+        char* texturedata = new char[size];
+        memset(texturedata, 0, size);
 
-            }
-
-            // Close handle
-            input->close();
-        }
-        else if (fmt == Texture::Format::kRgba16)
-        {
-            auto size = spec.width * spec.height * spec.depth * sizeof(float) * 2;
+        // Read data to storage (missing channels stay zero)
+        input->read_image(type, texturedata, pixel_size);
 
-            // Resize storage
-            texturedata = new char[size];
-            memset(texturedata, 0, size);
-
-            // Read data to storage
-            input->read_image(TypeDesc::HALF, texturedata, sizeof(float) * 2);
-
-            // Close handle
-            input->close();
-        }
-        else
-        {
-            auto size = spec.width * spec.height * spec.depth * sizeof(RadeonRays::float3);
-
-            // Resize storage
-            texturedata = new char[size];
-            memset(texturedata, 0, size);
-
-            // Read data to storage
-            input->read_image(TypeDesc::FLOAT, texturedata, sizeof(RadeonRays::float3));
-
-            // Close handle
-            input->close();
-        }
+        // Close handle
+        input->close();
 
         //
-        return Texture::Create(texturedata, RadeonRays::int3(spec.width, spec.height, spec.depth), fmt);;
+        return Texture::Create(texturedata, RadeonRays::int3(spec.width, spec.height, spec.depth), fmt);
     }
 
     void Oiio::SaveImage(std::string const& filename, Texture::Ptr texture) const
@@ -121,10 +88,16 @@ namespace Baikal
             throw std::runtime_error("Can't create image file on disk");
         }
 
+        // Save decoded data for compressed textures
+        if (texture->IsCompressed())
+        {
+            texture = DecompressTexture(*texture);
+        }
+
         auto dim = texture->GetSize();
         auto fmt = GetTextureFormat(texture->GetFormat());
 
-        ImageSpec spec(dim.x, dim.y, 4, fmt);
+        ImageSpec spec(dim.x, dim.y, static_cast<int>(texture->GetNumChannels()), fmt);
 
         out->open(filename, spec);
 
@@ -133,6 +106,12 @@ namespace Baikal
         out->close();
     }
 
+    Texture::Ptr ImageIo::LoadCompressedImage(std::string const& filename, Texture::Format format) const
+    {
+        auto texture = LoadImage(filename);
+        return CompressTexture(*texture, format);
+    }
+
     std::unique_ptr<ImageIo> ImageIo::CreateImageIo()
     {
         return std::make_unique<Oiio>();
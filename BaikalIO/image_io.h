@@ -66,6 +66,9 @@ namespace Baikal
         // Load texture from file
         virtual Texture::Ptr LoadImage(std::string const& filename) const = 0;
         virtual void SaveImage(std::string const& filename, Texture::Ptr texture) const = 0;
+
+        // Load texture from file and compress it into block compressed format
+        Texture::Ptr LoadCompressedImage(std::string const& filename, Texture::Format format) const;
         
         // Disallow copying
         ImageIo(ImageIo const&) = delete;
@@ -0,0 +1,113 @@
+/**********************************************************************
+Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Baikal
+{
+#ifdef WIN32
+    MappedFile::MappedFile(std::string const& filename)
+        : m_data(nullptr)
+        , m_size(0)
+        , m_file(INVALID_HANDLE_VALUE)
+        , m_mapping(nullptr)
+    {
+        m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+        LARGE_INTEGER size;
+        if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size))
+        {
+            if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+            throw std::runtime_error("Cannot open file " + filename);
+        }
+
+        m_size = static_cast<std::size_t>(size.QuadPart);
+
+        if (m_size)
+        {
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            m_data = m_mapping ? static_cast<char const*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+
+            if (!m_data)
+            {
+                if (m_mapping) CloseHandle(m_mapping);
+                CloseHandle(m_file);
+                throw std::runtime_error("Cannot map file " + filename);
+            }
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (m_data) UnmapViewOfFile(m_data);
+        if (m_mapping) CloseHandle(m_mapping);
+        CloseHandle(m_file);
+    }
+#else
+    MappedFile::MappedFile(std::string const& filename)
+        : m_data(nullptr)
+        , m_size(0)
+        , m_file(open(filename.c_str(), O_RDONLY))
+    {
+        struct stat info;
+        if (m_file < 0 || fstat(m_file, &info) != 0)
+        {
+            if (m_file >= 0) close(m_file);
+            throw std::runtime_error("Cannot open file " + filename);
+        }
+
+        m_size = static_cast<std::size_t>(info.st_size);
+
+        if (m_size)
+        {
+            auto data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+
+            if (data == MAP_FAILED)
+            {
+                close(m_file);
+                throw std::runtime_error("Cannot map file " + filename);
+            }
+
+            m_data = static_cast<char const*>(data);
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (m_data) munmap(const_cast<char*>(m_data), m_size);
+        close(m_file);
+    }
+#endif
+}
@@ -0,0 +1,846 @@
+/**********************************************************************
+Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "obj_parser.h"
+#include "mapped_file.h"
+#include "math/mathutils.h"
+#include "Utils/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+namespace Baikal
+{
+    namespace
+    {
+        // Files are not split into chunks smaller than this
+        std::size_t const kMinChunkSize = 1 << 20;
+        // Number of chunks per thread, helps balancing lines of different cost
+        std::size_t const kChunksPerThread = 4;
+
+        // Call func(task) for each task in [0, num_tasks) using num_threads threads.
+        // Tasks are handed out in order, first exception thrown by a task is rethrown.
+        template <typename Func> void ParallelFor(std::size_t num_tasks, std::uint32_t num_threads, Func func)
+        {
+            num_threads = static_cast<std::uint32_t>(std::min<std::size_t>(num_threads, num_tasks));
+
+            if (num_threads < 2)
+            {
+                for (std::size_t task = 0; task < num_tasks; ++task)
+                {
+                    func(task);
+                }
+                return;
+            }
+
+            std::atomic<std::size_t> next(0);
+            std::vector<std::exception_ptr> errors(num_threads);
+            std::vector<std::thread> threads;
+            threads.reserve(num_threads);
+
+            for (auto i = 0u; i < num_threads; ++i)
+            {
+                threads.emplace_back([&, i]()
+                {
+                    try
+                    {
+                        for (auto task = next++; task < num_tasks; task = next++)
+                        {
+                            func(task);
+                        }
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                        next = num_tasks;
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            for (auto& error : errors)
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+
+        inline bool IsSpace(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        inline bool IsDigit(char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        inline char const* SkipSpace(char const* p, char const* end)
+        {
+            while (p < end && IsSpace(*p)) ++p;
+            return p;
+        }
+
+        // Check if [p, end) starts with keyword followed by a space or the end of line
+        inline bool IsKeyword(char const* p, char const* end, char const* keyword)
+        {
+            auto length = std::strlen(keyword);
+            return static_cast<std::size_t>(end - p) >= length && std::strncmp(p, keyword, length) == 0 &&
+                (p + length == end || IsSpace(p[length]));
+        }
+
+        // Read next whitespace delimited token
+        inline std::string ParseName(char const*& p, char const* end)
+        {
+            p = SkipSpace(p, end);
+            auto begin = p;
+            while (p < end && !IsSpace(*p)) ++p;
+            return std::string(begin, p);
+        }
+
+        // Read the rest of the line without surrounding whitespace
+        inline std::string ParseRest(char const* p, char const* end)
+        {
+            p = SkipSpace(p, end);
+            while (end > p && IsSpace(end[-1])) --end;
+            return std::string(p, end);
+        }
+
+        inline bool ParseInt(char const*& p, char const* end, std::int32_t& value)
+        {
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                negative = *p == '-';
+                ++p;
+            }
+
+            if (p == end || !IsDigit(*p))
+            {
+                return false;
+            }
+
+            std::int64_t result = 0;
+            for (; p < end && IsDigit(*p); ++p)
+            {
+                result = std::min<std::int64_t>(result * 10 + (*p - '0'), INT32_MAX);
+            }
+
+            value = static_cast<std::int32_t>(negative ? -result : result);
+            return true;
+        }
+
+        // Locale independent decimal float parser.
+        // Mantissa is accumulated in 64-bit integer, so the result is exact
+        // to double precision for up to 19 significant digits.
+        bool ParseFloat(char const*& p, char const* end, float& value)
+        {
+            static double const kPow10[] =
+            {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+
+            p = SkipSpace(p, end);
+            auto begin = p;
+
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                negative = *p == '-';
+                ++p;
+            }
+
+            std::uint64_t mantissa = 0;
+            int exponent = 0;
+            int num_digits = 0;
+
+            for (; p < end && IsDigit(*p); ++p, ++num_digits)
+            {
+                if (mantissa < 1000000000000000000ull) mantissa = mantissa * 10 + (*p - '0');
+                else ++exponent;
+            }
+
+            if (p < end && *p == '.')
+            {
+                for (++p; p < end && IsDigit(*p); ++p, ++num_digits)
+                {
+                    if (mantissa < 1000000000000000000ull)
+                    {
+                        mantissa = mantissa * 10 + (*p - '0');
+                        --exponent;
+                    }
+                }
+            }
+
+            if (!num_digits)
+            {
+                // nan, inf and other exotic forms
+                p = begin;
+                while (p < end && !IsSpace(*p)) ++p;
+
+                if (p == begin)
+                {
+                    return false;
+                }
+
+                std::string token(begin, p);
+                char* token_end = nullptr;
+                value = static_cast<float>(std::strtod(token.c_str(), &token_end));
+                return token_end != token.c_str();
+            }
+
+            if (p < end && (*p == 'e' || *p == 'E'))
+            {
+                auto q = p + 1;
+                std::int32_t e = 0;
+                if (ParseInt(q, end, e))
+                {
+                    exponent += e;
+                    p = q;
+                }
+            }
+
+            auto result = static_cast<double>(mantissa);
+
+            if (mantissa)
+            {
+                if (exponent >= 0 && exponent <= 22) result *= kPow10[exponent];
+                else if (exponent < 0 && exponent >= -22) result /= kPow10[-exponent];
+                else result *= std::pow(10.0, exponent);
+            }
+
+            value = static_cast<float>(negative ? -result : result);
+            return true;
+        }
+
+        // Zero based (position, texcoord, normal) indices, -1 if missing
+        struct Corner
+        {
+            std::int32_t index[3];
+
+            bool operator == (Corner const& other) const
+            {
+                return index[0] == other.index[0] && index[1] == other.index[1] && index[2] == other.index[2];
+            }
+        };
+
+        enum Attribute
+        {
+            kPosition = 0,
+            kTexcoord = 1,
+            kNormal = 2
+        };
+
+        // Statement affecting faces after it
+        struct Command
+        {
+            enum Type
+            {
+                kGroup,
+                kUseMaterial,
+                kMaterialLibrary
+            };
+
+            Type type;
+            std::string name;
+            // Number of triangles in the chunk preceding the command
+            std::size_t triangle;
+        };
+
+        // Parsing result of a line aligned part of the file
+        struct Chunk
+        {
+            char const* begin;
+            char const* end;
+
+            std::vector<RadeonRays::float3> positions;
+            std::vector<RadeonRays::float2> texcoords;
+            std::vector<RadeonRays::float3> normals;
+            // Three corners per triangle
+            std::vector<Corner> corners;
+            // Negative indices are relative to the current attribute count, so they
+            // are resolved against the chunk and listed here (as corner * 3 + attribute)
+            // to be offset by the number of attributes in preceding chunks
+            std::vector<std::size_t> relative;
+            std::vector<Command> commands;
+
+            std::size_t num_lines;
+            std::string error;
+        };
+
+        // Parse face corners and fan triangulate the polygon, face and face_relative are scratch buffers
+        void ParseFace(char const* p, char const* end, Chunk& chunk, std::vector<Corner>& face, std::vector<std::size_t>& face_relative)
+        {
+            face.clear();
+            face_relative.clear();
+
+            std::size_t const count[3] = { chunk.positions.size(), chunk.texcoords.size(), chunk.normals.size() };
+
+            for (p = SkipSpace(p, end); p < end; p = SkipSpace(p, end))
+            {
+                Corner corner = { { -1, -1, -1 } };
+
+                // v, v/vt, v//vn or v/vt/vn
+                for (auto attribute = 0u; attribute < 3; ++attribute)
+                {
+                    std::int32_t index = 0;
+
+                    if (ParseInt(p, end, index))
+                    {
+                        if (index == 0)
+                        {
+                            throw std::runtime_error("zero face index");
+                        }
+
+                        if (index > 0)
+                        {
+                            corner.index[attribute] = index - 1;
+                        }
+                        else
+                        {
+                            corner.index[attribute] = static_cast<std::int32_t>(count[attribute]) + index;
+                            face_relative.push_back(face.size() * 3 + attribute);
+                        }
+                    }
+                    else if (attribute == kPosition)
+                    {
+                        throw std::runtime_error("malformed face");
+                    }
+
+                    if (p == end || *p != '/')
+                    {
+                        break;
+                    }
+
+                    ++p;
+                }
+
+                if (p < end && !IsSpace(*p))
+                {
+                    throw std::runtime_error("malformed face");
+                }
+
+                face.push_back(corner);
+            }
+
+            // Degenerate faces (points or lines written as faces) are skipped
+            if (face.size() < 3)
+            {
+                return;
+            }
+
+            // Polygon -> triangle fan conversion
+            for (std::size_t k = 2; k < face.size(); ++k)
+            {
+                std::size_t const face_corner[3] = { 0, k - 1, k };
+
+                for (auto c = 0u; c < 3; ++c)
+                {
+                    for (auto slot : face_relative)
+                    {
+                        if (slot / 3 == face_corner[c])
+                        {
+                            chunk.relative.push_back(chunk.corners.size() * 3 + slot % 3);
+                        }
+                    }
+
+                    chunk.corners.push_back(face[face_corner[c]]);
+                }
+            }
+        }
+
+        void ParseChunk(Chunk& chunk)
+        {
+            std::vector<Corner> face;
+            std::vector<std::size_t> face_relative;
+            chunk.num_lines = 0;
+
+            for (auto line = chunk.begin; line < chunk.end; ++chunk.num_lines)
+            {
+                auto line_end = static_cast<char const*>(std::memchr(line, '\n', chunk.end - line));
+                if (!line_end) line_end = chunk.end;
+
+                auto p = SkipSpace(line, line_end);
+                auto next = line_end + 1;
+
+                try
+                {
+                    if (p == line_end || *p == '#')
+                    {
+                    }
+                    else if (IsKeyword(p, line_end, "v"))
+                    {
+                        p += 1;
+                        RadeonRays::float3 v;
+                        ParseFloat(p, line_end, v.x) && ParseFloat(p, line_end, v.y) && ParseFloat(p, line_end, v.z);
+                        chunk.positions.push_back(v);
+                    }
+                    else if (IsKeyword(p, line_end, "vt"))
+                    {
+                        p += 2;
+                        RadeonRays::float2 vt;
+                        ParseFloat(p, line_end, vt.x) && ParseFloat(p, line_end, vt.y);
+                        chunk.texcoords.push_back(vt);
+                    }
+                    else if (IsKeyword(p, line_end, "vn"))
+                    {
+                        p += 2;
+                        RadeonRays::float3 vn;
+                        ParseFloat(p, line_end, vn.x) && ParseFloat(p, line_end, vn.y) && ParseFloat(p, line_end, vn.z);
+                        chunk.normals.push_back(vn);
+                    }
+                    else if (IsKeyword(p, line_end, "f"))
+                    {
+                        ParseFace(p + 1, line_end, chunk, face, face_relative);
+                    }
+                    else if (IsKeyword(p, line_end, "g") || IsKeyword(p, line_end, "o"))
+                    {
+                        p += 1;
+                        chunk.commands.push_back({ Command::kGroup, ParseName(p, line_end), chunk.corners.size() / 3 });
+                    }
+                    else if (IsKeyword(p, line_end, "usemtl"))
+                    {
+                        p += 6;
+                        chunk.commands.push_back({ Command::kUseMaterial, ParseName(p, line_end), chunk.corners.size() / 3 });
+                    }
+                    else if (IsKeyword(p, line_end, "mtllib"))
+                    {
+                        p += 6;
+                        chunk.commands.push_back({ Command::kMaterialLibrary, ParseName(p, line_end), chunk.corners.size() / 3 });
+                    }
+                    // Other statements (lines, smoothing groups, free-form geometry) are ignored
+                }
+                catch (std::exception& e)
+                {
+                    chunk.error = e.what();
+                    return;
+                }
+
+                line = next;
+            }
+        }
+
+        void ParseMtl(std::string const& filename, std::vector<ObjMaterial>& materials, std::map<std::string, int>& material_map)
+        {
+            std::ifstream in(filename, std::ios::binary);
+
+            if (!in)
+            {
+                LogInfo("Warning: material library ", filename, " not found\n");
+                return;
+            }
+
+            std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+            ObjMaterial* material = nullptr;
+            auto end = data.c_str() + data.size();
+
+            auto parse_color = [](char const* p, char const* end)
+            {
+                RadeonRays::float3 color;
+                ParseFloat(p, end, color.x) && ParseFloat(p, end, color.y) && ParseFloat(p, end, color.z);
+                return color;
+            };
+
+            for (auto line = data.c_str(); line < end;)
+            {
+                auto line_end = static_cast<char const*>(std::memchr(line, '\n', end - line));
+                if (!line_end) line_end = end;
+
+                auto p = SkipSpace(line, line_end);
+                line = line_end + 1;
+
+                if (IsKeyword(p, line_end, "newmtl"))
+                {
+                    auto name = ParseRest(p + 6, line_end);
+
+                    // The first definition of the material wins
+                    if (material_map.emplace(name, static_cast<int>(materials.size())).second)
+                    {
+                        materials.emplace_back();
+                        material = &materials.back();
+                        material->name = name;
+                    }
+                    else
+                    {
+                        material = nullptr;
+                    }
+                }
+                else if (!material)
+                {
+                    continue;
+                }
+                else if (IsKeyword(p, line_end, "Kd"))
+                {
+                    material->diffuse = parse_color(p + 2, line_end);
+                }
+                else if (IsKeyword(p, line_end, "Ks"))
+                {
+                    material->specular = parse_color(p + 2, line_end);
+                }
+                else if (IsKeyword(p, line_end, "Kt"))
+                {
+                    material->transmittance = parse_color(p + 2, line_end);
+                }
+                else if (IsKeyword(p, line_end, "Ke"))
+                {
+                    material->emission = parse_color(p + 2, line_end);
+                }
+                else if (IsKeyword(p, line_end, "map_Kd"))
+                {
+                    material->diffuse_texname = ParseRest(p + 6, line_end);
+                }
+                else if (IsKeyword(p, line_end, "map_Ks"))
+                {
+                    material->specular_texname = ParseRest(p + 6, line_end);
+                }
+                else if (IsKeyword(p, line_end, "map_bump"))
+                {
+                    material->bump_texname = ParseRest(p + 8, line_end);
+                }
+                else if (IsKeyword(p, line_end, "bump"))
+                {
+                    material->bump_texname = ParseRest(p + 4, line_end);
+                }
+            }
+        }
+
+        // Open addressing map from corner to vertex index
+        class CornerMap
+        {
+        public:
+            explicit CornerMap(std::size_t max_size)
+            {
+                std::size_t capacity = 16;
+                while (capacity < max_size + max_size / 2) capacity <<= 1;
+
+                m_mask = capacity - 1;
+                m_entries.resize(capacity, Entry{ { { 0, 0, 0 } }, kEmpty });
+            }
+
+            // Returns index of the corner, inserts it with value if not present
+            std::uint32_t Insert(Corner const& corner, std::uint32_t value)
+            {
+                auto hash = static_cast<std::uint32_t>(corner.index[0]) * 73856093u;
+                hash ^= static_cast<std::uint32_t>(corner.index[1]) * 19349663u;
+                hash ^= static_cast<std::uint32_t>(corner.index[2]) * 83492791u;
+                hash ^= hash >> 15;
+
+                for (auto slot = hash & m_mask; ; slot = (slot + 1) & m_mask)
+                {
+                    auto& entry = m_entries[slot];
+
+                    if (entry.value == kEmpty)
+                    {
+                        entry.corner = corner;
+                        entry.value = value;
+                        return value;
+                    }
+
+                    if (entry.corner == corner)
+                    {
+                        return entry.value;
+                    }
+                }
+            }
+
+        private:
+            static std::uint32_t const kEmpty = 0xffffffffu;
+
+            struct Entry
+            {
+                Corner corner;
+                std::uint32_t value;
+            };
+
+            std::vector<Entry> m_entries;
+            std::size_t m_mask;
+        };
+
+        // Range of triangles in a chunk
+        struct Segment
+        {
+            std::size_t chunk;
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        void BuildMesh(std::vector<Chunk> const& chunks, std::vector<Segment> const& segments,
+            std::vector<RadeonRays::float3> const& positions,
+            std::vector<RadeonRays::float2> const& texcoords,
+            std::vector<RadeonRays::float3> const& normals,
+            ObjMesh& mesh)
+        {
+            std::size_t num_corners = 0;
+            for (auto const& segment : segments)
+            {
+                num_corners += (segment.end - segment.begin) * 3;
+            }
+
+            std::size_t const count[3] = { positions.size(), texcoords.size(), normals.size() };
+
+            CornerMap map(num_corners);
+            std::vector<bool> face_normal;
+
+            mesh.indices.reserve(num_corners);
+
+            for (auto const& segment : segments)
+            {
+                auto const& corners = chunks[segment.chunk].corners;
+
+                for (auto i = segment.begin * 3; i < segment.end * 3; ++i)
+                {
+                    auto const& corner = corners[i];
+
+                    for (auto attribute = 0u; attribute < 3; ++attribute)
+                    {
+                        auto index = corner.index[attribute];
+
+                        if ((index < 0 && attribute == kPosition) || index < -1 || (index >= 0 && static_cast<std::size_t>(index) >= count[attribute]))
+                        {
+                            throw std::runtime_error("face index out of range");
+                        }
+                    }
+
+                    auto num_vertices = static_cast<std::uint32_t>(mesh.vertices.size());
+                    auto index = map.Insert(corner, num_vertices);
+
+                    if (index == num_vertices)
+                    {
+                        mesh.vertices.push_back(positions[corner.index[kPosition]]);
+                        mesh.uvs.push_back(corner.index[kTexcoord] >= 0 ? texcoords[corner.index[kTexcoord]] : RadeonRays::float2(0.f, 0.f));
+                        mesh.normals.push_back(corner.index[kNormal] >= 0 ? normals[corner.index[kNormal]] : RadeonRays::float3(0.f, 0.f, 0.f));
+                        face_normal.push_back(corner.index[kNormal] < 0);
+                    }
+
+                    mesh.indices.push_back(index);
+                }
+            }
+
+            // Vertices without normal get the normal of the last face using them
+            for (std::size_t i = 0; i < mesh.indices.size(); i += 3)
+            {
+                auto i0 = mesh.indices[i];
+                auto i1 = mesh.indices[i + 1];
+                auto i2 = mesh.indices[i + 2];
+
+                if (!face_normal[i0] && !face_normal[i1] && !face_normal[i2])
+                {
+                    continue;
+                }
+
+                auto n = RadeonRays::cross(mesh.vertices[i1] - mesh.vertices[i0], mesh.vertices[i2] - mesh.vertices[i0]);
+                if (n.sqnorm() > 0.f)
+                {
+                    n = RadeonRays::normalize(n);
+                }
+
+                if (face_normal[i0]) mesh.normals[i0] = n;
+                if (face_normal[i1]) mesh.normals[i1] = n;
+                if (face_normal[i2]) mesh.normals[i2] = n;
+            }
+        }
+    }
+
+    ObjScene ParseObj(std::string const& filename, std::string const& mtl_basepath, std::uint32_t num_threads)
+    {
+        if (!num_threads)
+        {
+            num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        MappedFile file(filename);
+
+        auto data = file.GetData();
+        auto size = file.GetSize();
+
+        // Split the file into line aligned chunks
+        auto num_chunks = std::max<std::size_t>(std::min<std::size_t>(size / kMinChunkSize, num_threads * kChunksPerThread), 1);
+        std::vector<Chunk> chunks(num_chunks);
+
+        for (std::size_t i = 0; i < num_chunks; ++i)
+        {
+            auto begin = i ? chunks[i - 1].end : data;
+            auto end = data + size * (i + 1) / num_chunks;
+
+            if (end < begin)
+            {
+                end = begin;
+            }
+
+            if (end != data + size)
+            {
+                auto line_end = static_cast<char const*>(std::memchr(end, '\n', data + size - end));
+                end = line_end ? line_end + 1 : data + size;
+            }
+
+            chunks[i].begin = begin;
+            chunks[i].end = end;
+        }
+
+        ParallelFor(num_chunks, num_threads, [&](std::size_t i)
+        {
+            ParseChunk(chunks[i]);
+        });
+
+        // Offsets of chunk attributes in the whole file
+        std::vector<std::size_t> base[3];
+        std::size_t line = 0;
+        std::size_t count[3] = { 0, 0, 0 };
+
+        for (auto& chunk : chunks)
+        {
+            if (!chunk.error.empty())
+            {
+                throw std::runtime_error(filename + "(" + std::to_string(line + chunk.num_lines + 1) + "): " + chunk.error);
+            }
+
+            line += chunk.num_lines;
+
+            base[kPosition].push_back(count[kPosition]);
+            base[kTexcoord].push_back(count[kTexcoord]);
+            base[kNormal].push_back(count[kNormal]);
+
+            count[kPosition] += chunk.positions.size();
+            count[kTexcoord] += chunk.texcoords.size();
+            count[kNormal] += chunk.normals.size();
+        }
+
+        std::vector<RadeonRays::float3> positions(count[kPosition]);
+        std::vector<RadeonRays::float2> texcoords(count[kTexcoord]);
+        std::vector<RadeonRays::float3> normals(count[kNormal]);
+
+        ParallelFor(num_chunks, num_threads, [&](std::size_t i)
+        {
+            auto& chunk = chunks[i];
+
+            std::copy(chunk.positions.cbegin(), chunk.positions.cend(), positions.begin() + base[kPosition][i]);
+            std::copy(chunk.texcoords.cbegin(), chunk.texcoords.cend(), texcoords.begin() + base[kTexcoord][i]);
+            std::copy(chunk.normals.cbegin(), chunk.normals.cend(), normals.begin() + base[kNormal][i]);
+
+            for (auto slot : chunk.relative)
+            {
+                auto attribute = slot % 3;
+                chunk.corners[slot / 3].index[attribute] += static_cast<std::int32_t>(base[attribute][i]);
+            }
+
+            std::vector<RadeonRays::float3>().swap(chunk.positions);
+            std::vector<RadeonRays::float2>().swap(chunk.texcoords);
+            std::vector<RadeonRays::float3>().swap(chunk.normals);
+        });
+
+        ObjScene scene;
+
+        // Material libraries are loaded up front, so usemtl may precede mtllib
+        std::map<std::string, int> material_map;
+        for (auto const& chunk : chunks)
+        {
+            for (auto const& command : chunk.commands)
+            {
+                if (command.type == Command::kMaterialLibrary)
+                {
+                    ParseMtl(mtl_basepath + command.name, scene.materials, material_map);
+                }
+            }
+        }
+
+        // Collect triangle ranges of each (group, material) pair
+        std::vector<std::string> group_names(1);
+        std::map<std::pair<int, int>, std::vector<Segment>> mesh_segments;
+        int group = 0;
+        int material = -1;
+
+        for (std::size_t i = 0; i < num_chunks; ++i)
+        {
+            auto const& chunk = chunks[i];
+            std::size_t begin = 0;
+
+            auto add_segment = [&](std::size_t end)
+            {
+                if (end > begin)
+                {
+                    mesh_segments[std::make_pair(group, material)].push_back({ i, begin, end });
+                }
+                begin = end;
+            };
+
+            for (auto const& command : chunk.commands)
+            {
+                add_segment(command.triangle);
+
+                if (command.type == Command::kGroup)
+                {
+                    group_names.push_back(command.name);
+                    group = static_cast<int>(group_names.size()) - 1;
+                }
+                else if (command.type == Command::kUseMaterial)
+                {
+                    auto iter = material_map.find(command.name);
+                    material = iter != material_map.cend() ? iter->second : -1;
+                }
+            }
+
+            add_segment(chunk.corners.size() / 3);
+        }
+
+        // Weld vertices, meshes are independent and processed in parallel
+        scene.meshes.resize(mesh_segments.size());
+
+        std::vector<std::vector<Segment> const*> segments;
+        for (auto const& iter : mesh_segments)
+        {
+            auto& mesh = scene.meshes[segments.size()];
+            mesh.name = group_names[iter.first.first];
+            mesh.material = iter.first.second;
+            segments.push_back(&iter.second);
+        }
+
+        try
+        {
+            ParallelFor(scene.meshes.size(), num_threads, [&](std::size_t i)
+            {
+                BuildMesh(chunks, *segments[i], positions, texcoords, normals, scene.meshes[i]);
+            });
+        }
+        catch (std::exception& e)
+        {
+            throw std::runtime_error(filename + ": " + e.what());
+        }
+
+        return scene;
+    }
+}
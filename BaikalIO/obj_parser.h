@@ -0,0 +1,98 @@
+/**********************************************************************
+Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+/**
+ \file obj_parser.h
+ \version 1.0
+ \brief Multithreaded Wavefront OBJ/MTL parser.
+ */
+#pragma once
+
+#include "scene_io.h"
+#include "math/float3.h"
+#include "math/float2.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Baikal
+{
+    /**
+     \brief Subset of MTL material description used by scene loaders.
+     */
+    struct ObjMaterial
+    {
+        std::string name;
+
+        RadeonRays::float3 diffuse;
+        RadeonRays::float3 specular;
+        RadeonRays::float3 transmittance;
+        RadeonRays::float3 emission;
+
+        std::string diffuse_texname;  // map_Kd
+        std::string specular_texname; // map_Ks
+        std::string bump_texname;     // map_bump, bump
+    };
+
+    /**
+     \brief Triangle mesh with a single material.
+
+     Vertex attributes are indexed by the same index buffer and always have
+     the same size: missing texture coordinates are zero and missing normals
+     are replaced by face normals.
+     */
+    struct ObjMesh
+    {
+        // Name of the group or object the mesh comes from
+        std::string name;
+        // Index into ObjScene::materials or -1 if there is no material
+        int material;
+
+        std::vector<RadeonRays::float3> vertices;
+        std::vector<RadeonRays::float3> normals;
+        std::vector<RadeonRays::float2> uvs;
+        std::vector<std::uint32_t> indices;
+    };
+
+    struct ObjScene
+    {
+        std::vector<ObjMaterial> materials;
+        // Meshes are ordered by group, then by material index
+        std::vector<ObjMesh> meshes;
+    };
+
+    /**
+     \brief Parse OBJ file.
+
+     The file is memory mapped and split into line aligned chunks which are
+     tokenized concurrently. Faces are fan triangulated and (v, vt, vn) index
+     triples are welded per group and material. Material libraries are
+     looked up relative to mtl_basepath.
+
+     \param filename OBJ file name.
+     \param mtl_basepath Path prefix for mtllib files.
+     \param num_threads Number of worker threads, 0 means hardware concurrency.
+     \return Parsed scene, throws std::runtime_error on failure.
+     */
+    BAIKAL_API_ENTRY ObjScene ParseObj(std::string const& filename, std::string const& mtl_basepath, std::uint32_t num_threads = 0);
+}
@@ -1,243 +1,1339 @@
+/**********************************************************************
+Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
 #include "scene_binary_io.h"
 #include "SceneGraph/scene1.h"
+#include "SceneGraph/camera.h"
 #include "SceneGraph/iterator.h"
 #include "SceneGraph/shape.h"
 #include "SceneGraph/material.h"
 #include "SceneGraph/light.h"
 #include "SceneGraph/texture.h"
 #include "SceneGraph/uberv2material.h"
+#include "SceneGraph/inputmaps.h"
 #include "image_io.h"
+#include "mapped_file.h"
 #include "math/mathutils.h"
+#include "Utils/block_compression.h"
 #include "Utils/log.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 
 namespace Baikal
 {
     // Create static object to register loader. This object will be used as loader
     static SceneBinaryIo scene_binary_io_loader;
 
-    Scene1::Ptr SceneBinaryIo::LoadScene(std::string const& filename, std::string const& basepath) const
+    namespace
     {
-        auto scene = Scene1::Create();
-        auto image_io(ImageIo::CreateImageIo());
+        /*
+         File layout:
+            Header
+            Metadata: textures, input maps, materials, shapes, lights, camera and scene settings
+            Data: mesh arrays and embedded texels, starts at page boundary
 
-        std::map<std::string, Material*> mats;
+         Objects reference each other by index in their tables (kNullIndex for nullptr).
+         Data arrays are stored in memory layout at kDataAlignment boundaries, so meshes
+         reference the mapped file directly and opening the scene only touches metadata pages.
+         */
+        char const kMagic[8] = { 'B', 'A', 'I', 'K', 'A', 'L', 'S', 'C' };
+        std::uint32_t const kVersion = 1;
+        std::uint64_t const kPageSize = 4096;
+        std::uint64_t const kDataAlignment = 64;
+        std::uint32_t const kNullIndex = 0xffffffffu;
+        // Largest texture dimension accepted from a file
+        std::int32_t const kMaxTextureSize = 1 << 16;
 
-        struct less
+        struct Header
         {
-            bool operator ()(RadeonRays::float3 const& v1, RadeonRays::float3 const& v2) const {
-                return v1.x < v2.x;
-            }
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t reserved;
+            std::uint64_t metadata_offset;
+            std::uint64_t metadata_size;
+            std::uint64_t data_offset;
+            std::uint64_t data_size;
         };
 
-        std::map<RadeonRays::float3, Material::Ptr, less> c2mats;
+        enum class ShapeType : std::uint32_t
+        {
+            kMesh,
+            kInstance
+        };
 
-        std::string full_path = filename;
+        enum class MaterialType : std::uint32_t
+        {
+            kUberV2,
+            kVolume
+        };
 
-        std::ifstream in(full_path, std::ios::binary | std::ios::in);
+        enum class LightType : std::uint32_t
+        {
+            kPoint,
+            kDirectional,
+            kSpot,
+            kImageBased,
+            kArea,
+            kEmissiveMesh
+        };
 
-        if (!in)
+        enum class CameraType : std::uint32_t
         {
-            throw std::runtime_error("Cannot open file for reading");
-        }
+            kNone,
+            kPerspective,
+            kOrthographic
+        };
 
-        std::uint32_t num_meshes = 0;
-        in.read((char*)&num_meshes, sizeof(std::uint32_t));
+        enum class TextureSource : std::uint32_t
+        {
+            // Loaded from file relative to base path
+            kFile,
+            // Texels are stored in data section
+            kEmbedded
+        };
 
-        LogInfo("Number of objects: ", num_meshes, "\n");
+        // Serialized array: number of elements and offset in data section
+        struct ArrayRef
+        {
+            std::uint64_t size;
+            std::uint64_t offset;
+        };
 
-        for (auto i = 0U; i < num_meshes; ++i)
+        class MetadataWriter
         {
-            auto mesh = Mesh::Create();
+        public:
+            template <typename T> void Write(T const& value)
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be written");
+                auto bytes = reinterpret_cast<char const*>(&value);
+                m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(T));
+            }
+
+            void WriteString(std::string const& str)
+            {
+                Write(static_cast<std::uint32_t>(str.size()));
+                m_buffer.insert(m_buffer.end(), str.cbegin(), str.cend());
+            }
 
-            std::uint32_t num_indices = 0;
-            in.read((char*)&num_indices, sizeof(std::uint32_t));
+            void WriteMatrix(RadeonRays::matrix const& m)
+            {
+                for (auto i = 0; i < 4; ++i)
+                    for (auto j = 0; j < 4; ++j)
+                        Write(m.m[i][j]);
+            }
 
-            std::uint32_t num_vertices = 0;
-            in.read((char*)&num_vertices, sizeof(std::uint32_t));
+            std::vector<char> const& GetBuffer() const { return m_buffer; }
 
+        private:
+            std::vector<char> m_buffer;
+        };
 
-            std::uint32_t num_normals = 0;
-            in.read((char*)&num_normals, sizeof(std::uint32_t));
+        class MetadataReader
+        {
+        public:
+            MetadataReader(char const* data, std::size_t size)
+                : m_cur(data)
+                , m_end(data + size)
+            {
+            }
 
+            template <typename T> T Read()
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be read");
+                Check(sizeof(T));
 
-            std::uint32_t num_uvs = 0;
-            in.read((char*)&num_uvs, sizeof(std::uint32_t));
+                T value;
+                std::memcpy(&value, m_cur, sizeof(T));
+                m_cur += sizeof(T);
+                return value;
+            }
 
+            std::string ReadString()
             {
-                std::vector<std::uint32_t> indices(num_indices);
-                in.read((char*)&indices[0], num_indices * sizeof(std::uint32_t));
+                auto size = Read<std::uint32_t>();
+                Check(size);
 
-                mesh->SetIndices(&indices[0], num_indices);
+                std::string result(m_cur, m_cur + size);
+                m_cur += size;
+                return result;
             }
 
+            RadeonRays::matrix ReadMatrix()
             {
-                std::vector<RadeonRays::float3> vertices(num_vertices);
-                in.read((char*)&vertices[0], num_vertices * sizeof(RadeonRays::float3));
+                RadeonRays::matrix m;
+                for (auto i = 0; i < 4; ++i)
+                    for (auto j = 0; j < 4; ++j)
+                        m.m[i][j] = Read<float>();
+                return m;
+            }
 
-                mesh->SetVertices(&vertices[0], num_vertices);
+        private:
+            void Check(std::size_t size) const
+            {
+                if (static_cast<std::size_t>(m_end - m_cur) < size)
+                {
+                    throw std::runtime_error("SceneBinaryIo: truncated scene metadata");
+                }
             }
 
+            char const* m_cur;
+            char const* m_end;
+        };
+
+        // Indexed set of scene objects of one kind
+        template <typename T> class ObjectTable
+        {
+        public:
+            // Add object, returns false if it is already there
+            bool Add(std::shared_ptr<T> const& object)
             {
-                std::vector<RadeonRays::float3> normals(num_normals);
-                in.read((char*)&normals[0], num_normals * sizeof(RadeonRays::float3));
+                if (!object || m_indices.count(object.get()))
+                {
+                    return false;
+                }
 
-                mesh->SetNormals(&normals[0], num_normals);
+                m_indices.emplace(object.get(), static_cast<std::uint32_t>(m_objects.size()));
+                m_objects.push_back(object);
+                return true;
             }
 
+            std::uint32_t GetIndex(std::shared_ptr<T> const& object) const
             {
-                std::vector<RadeonRays::float2> uvs(num_uvs);
-                in.read((char*)&uvs[0], num_uvs * sizeof(RadeonRays::float2));
+                if (!object)
+                {
+                    return kNullIndex;
+                }
 
-                mesh->SetUVs(&uvs[0], num_uvs);
+                auto iter = m_indices.find(object.get());
+                return iter != m_indices.cend() ? iter->second : kNullIndex;
             }
 
+            std::vector<std::shared_ptr<T>> const& GetObjects() const { return m_objects; }
 
+        private:
+            std::map<T const*, std::uint32_t> m_indices;
+            std::vector<std::shared_ptr<T>> m_objects;
+        };
+
+        // Fetch object by index read from the file
+        template <typename T> T Resolve(std::vector<T> const& objects, std::uint32_t index)
+        {
+            if (index == kNullIndex)
             {
-                std::uint32_t flag = 0;
-                in.read(reinterpret_cast<char*>(&flag), sizeof(flag));
+                return nullptr;
+            }
+
+            if (index >= objects.size())
+            {
+                throw std::runtime_error("SceneBinaryIo: invalid object reference");
+            }
+
+            return objects[index];
+        }
 
-                if (!flag)
+        // Collects everything reachable from the scene in dependency order
+        struct SceneTables
+        {
+            ObjectTable<Texture> textures;
+            ObjectTable<InputMap> input_maps;
+            ObjectTable<Material> materials;
+            ObjectTable<Shape> shapes;
+            ObjectTable<Light> lights;
+            std::set<Shape const*> attached_shapes;
+            std::set<Light const*> attached_lights;
+
+            void AddInputMap(InputMap::Ptr const& input_map)
+            {
+                if (!input_map || input_maps.GetIndex(input_map) != kNullIndex)
                 {
-                    RadeonRays::float3 albedo;
-                    in.read(reinterpret_cast<char*>(&albedo.x), sizeof(RadeonRays::float3));
+                    return;
+                }
 
-                    /*auto iter = c2mats.find(albedo);
+                // Arguments go first
+                switch (input_map->m_type)
+                {
+                case InputMap::InputMapType::kConstantFloat3:
+                case InputMap::InputMapType::kConstantFloat:
+                    break;
+                case InputMap::InputMapType::kSampler:
+                case InputMap::InputMapType::kSamplerBumpmap:
+                    textures.Add(std::static_pointer_cast<InputMap_Sampler>(input_map)->GetTexture());
+                    break;
+                case InputMap::InputMapType::kAdd:
+                case InputMap::InputMapType::kSub:
+                case InputMap::InputMapType::kMul:
+                case InputMap::InputMapType::kDiv:
+                case InputMap::InputMapType::kMin:
+                case InputMap::InputMapType::kMax:
+                case InputMap::InputMapType::kDot3:
+                case InputMap::InputMapType::kDot4:
+                case InputMap::InputMapType::kCross3:
+                case InputMap::InputMapType::kCross4:
+                case InputMap::InputMapType::kPow:
+                case InputMap::InputMapType::kMod:
+                case InputMap::InputMapType::kShuffle2:
+                {
+                    //It's safe since all this types differs only in id value
+                    auto i = std::static_pointer_cast<InputMap_Add>(input_map);
+                    AddInputMap(i->GetA());
+                    AddInputMap(i->GetB());
+                    break;
+                }
+                case InputMap::InputMapType::kLerp:
+                {
+                    auto i = std::static_pointer_cast<InputMap_Lerp>(input_map);
+                    AddInputMap(i->GetA());
+                    AddInputMap(i->GetB());
+                    AddInputMap(i->GetControl());
+                    break;
+                }
+                case InputMap::InputMapType::kRemap:
+                {
+                    auto i = std::static_pointer_cast<InputMap_Remap>(input_map);
+                    AddInputMap(i->GetSourceRange());
+                    AddInputMap(i->GetDestinationRange());
+                    AddInputMap(i->GetData());
+                    break;
+                }
+                default:
+                {
+                    //It's safe since all this types differs only in id value
+                    AddInputMap(std::static_pointer_cast<InputMap_Sin>(input_map)->GetArg());
+                    break;
+                }
+                }
 
-                    if (iter != c2mats.cend())
+                input_maps.Add(input_map);
+            }
+
+            void AddMaterial(Material::Ptr const& material)
+            {
+                if (!materials.Add(material))
+                {
+                    return;
+                }
+
+                if (!std::dynamic_pointer_cast<UberV2Material>(material) && !std::dynamic_pointer_cast<VolumeMaterial>(material))
+                {
+                    throw std::runtime_error("SceneBinaryIo: material type is not supported");
+                }
+
+                for (std::size_t i = 0; i < material->GetNumInputs(); ++i)
+                {
+                    auto value = material->GetInput(i).value;
+
+                    switch (value.type)
                     {
-                        material = iter->second;
+                    case Material::InputType::kTexture:
+                        textures.Add(value.tex_value);
+                        break;
+                    case Material::InputType::kMaterial:
+                        AddMaterial(value.mat_value);
+                        break;
+                    case Material::InputType::kInputMap:
+                        AddInputMap(value.input_map_value);
+                        break;
+                    default:
+                        break;
                     }
-                    else
-                    {
-                        material = new SingleBxdf(SingleBxdf::BxdfType::kLambert);
-                        material->SetInputValue("albedo", albedo);
-                        c2mats[albedo] = material;
-                        scene->AttachAutoreleaseObject(material);
-                    }*/
                 }
-                else
+            }
+
+            void AddShape(Shape::Ptr const& shape)
+            {
+                if (shapes.GetIndex(shape) != kNullIndex)
                 {
-                    std::uint32_t size = 0;
-                    in.read(reinterpret_cast<char*>(&size), sizeof(size));
+                    return;
+                }
 
-                    std::vector<char> buff(size);
-                    in.read(&buff[0], sizeof(char) * size);
+                if (auto instance = std::dynamic_pointer_cast<Instance>(shape))
+                {
+                    // Base shape is written first, it might be not attached to the scene
+                    AddShape(instance->GetBaseShape());
+                }
+                else if (!std::dynamic_pointer_cast<Mesh>(shape))
+                {
+                    throw std::runtime_error("SceneBinaryIo: shape type is not supported");
+                }
 
-                    //std::string name(buff.cbegin(), buff.cend());
+                AddMaterial(shape->GetMaterial());
+                AddMaterial(shape->GetVolumeMaterial());
+                shapes.Add(shape);
+            }
 
-                    //auto iter = mats.find(name);
+            void AddLight(Light::Ptr const& light)
+            {
+                if (!lights.Add(light))
+                {
+                    return;
+                }
 
-                    //if (iter != mats.cend())
-                    //{
-                    //    material = iter->second;
-                    //}
-                    //else
-                    //{
-                    //    LogInfo("Loading texture ", name, "\n");
-                    //    auto texture = image_io->LoadImage(basepath + name);
-                    //    //material = new SingleBxdf(SingleBxdf::BxdfType::kLambert);
-                    //    //material->SetInputValue("albedo", texture);
-                    //    //mats[name] = material;
-                    //    //scene->AttachAutoreleaseObject(texture);
-                    //    //scene->AttachAutoreleaseObject(material);
-                    //}
+                if (auto ibl = std::dynamic_pointer_cast<ImageBasedLight>(light))
+                {
+                    textures.Add(ibl->GetTexture());
+                    textures.Add(ibl->GetReflectionTexture());
+                    textures.Add(ibl->GetRefractionTexture());
+                    textures.Add(ibl->GetTransparencyTexture());
+                    textures.Add(ibl->GetBackgroundTexture());
+                }
+                else if (auto area = std::dynamic_pointer_cast<AreaLight>(light))
+                {
+                    AddShape(area->GetShape());
+                }
+                else if (auto mesh_light = std::dynamic_pointer_cast<EmissiveMeshLight>(light))
+                {
+                    AddShape(mesh_light->GetShape());
+                }
+            }
+        };
+
+        LightType GetLightType(Light const& light)
+        {
+            if (dynamic_cast<PointLight const*>(&light)) return LightType::kPoint;
+            if (dynamic_cast<DirectionalLight const*>(&light)) return LightType::kDirectional;
+            if (dynamic_cast<SpotLight const*>(&light)) return LightType::kSpot;
+            if (dynamic_cast<ImageBasedLight const*>(&light)) return LightType::kImageBased;
+            if (dynamic_cast<AreaLight const*>(&light)) return LightType::kArea;
+            if (dynamic_cast<EmissiveMeshLight const*>(&light)) return LightType::kEmissiveMesh;
+
+            throw std::runtime_error("SceneBinaryIo: light type is not supported");
+        }
+
+        template <typename T> InputMap::Ptr CreateTwoArg(MetadataReader& reader, std::vector<InputMap::Ptr> const& input_maps)
+        {
+            auto a = Resolve(input_maps, reader.Read<std::uint32_t>());
+            auto b = Resolve(input_maps, reader.Read<std::uint32_t>());
+            return T::Create(a, b);
+        }
+
+        template <typename T> InputMap::Ptr CreateOneArg(MetadataReader& reader, std::vector<InputMap::Ptr> const& input_maps)
+        {
+            return T::Create(Resolve(input_maps, reader.Read<std::uint32_t>()));
+        }
+    }
+
+    Scene1::Ptr SceneBinaryIo::LoadScene(std::string const& filename, std::string const& basepath) const
+    {
+        auto file = std::make_shared<MappedFile>(filename);
+        // Meshes keep the mapping alive while they reference it
+        std::shared_ptr<void const> storage = file;
+
+        Header header;
+        if (file->GetSize() < sizeof(Header))
+        {
+            throw std::runtime_error("SceneBinaryIo: " + filename + " is not a Baikal scene");
+        }
+
+        std::memcpy(&header, file->GetData(), sizeof(Header));
+
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        {
+            throw std::runtime_error("SceneBinaryIo: " + filename + " is not a Baikal scene");
+        }
+
+        if (header.version != kVersion)
+        {
+            throw std::runtime_error("SceneBinaryIo: " + filename + " has unsupported version " + std::to_string(header.version));
+        }
+
+        if (header.metadata_offset + header.metadata_size > file->GetSize() ||
+            header.data_offset + header.data_size > file->GetSize() ||
+            header.data_offset % kDataAlignment != 0)
+        {
+            throw std::runtime_error("SceneBinaryIo: " + filename + " is truncated");
+        }
+
+        auto data = file->GetData() + header.data_offset;
+
+        // Locate array in data section
+        auto get_array = [&](ArrayRef const& ref, std::size_t element_size) -> char const*
+        {
+            if (ref.offset % kDataAlignment != 0 || ref.offset > header.data_size ||
+                ref.size > (header.data_size - ref.offset) / element_size)
+            {
+                throw std::runtime_error("SceneBinaryIo: invalid data reference");
+            }
+
+            return data + ref.offset;
+        };
+
+        MetadataReader reader(file->GetData() + header.metadata_offset, static_cast<std::size_t>(header.metadata_size));
+
+        auto scene = Scene1::Create();
+        auto image_io(ImageIo::CreateImageIo());
 
+        // Textures
+        std::vector<Texture::Ptr> textures(reader.Read<std::uint32_t>());
+        for (auto& texture : textures)
+        {
+            auto name = reader.ReadString();
+            auto source = reader.Read<TextureSource>();
+
+            if (source == TextureSource::kFile)
+            {
+                texture = LoadTexture(*image_io, *scene, basepath, name);
+            }
+            else
+            {
+                auto size = reader.Read<RadeonRays::int3>();
+                auto format = reader.Read<Texture::Format>();
+                auto ref = reader.Read<ArrayRef>();
+
+                // Limits keep the size computation below from overflowing
+                if (size.x <= 0 || size.y <= 0 || size.z <= 0 ||
+                    size.x > kMaxTextureSize || size.y > kMaxTextureSize || size.z > kMaxTextureSize ||
+                    format > Texture::Format::kRg16)
+                {
+                    throw std::runtime_error("SceneBinaryIo: invalid texture description");
+                }
+
+                // Texture owns its data, so texels are copied
+                auto texels = get_array(ref, 1);
+                auto texture_data = new char[ref.size];
+                std::copy(texels, texels + ref.size, texture_data);
+
+                texture = Texture::Create(texture_data, size, format);
+
+                if (texture->GetSizeInBytes() != ref.size)
+                {
+                    throw std::runtime_error("SceneBinaryIo: texture data size does not match its format");
                 }
 
-                mesh->SetMaterial(nullptr);
+                if (!IsCompressedDataValid(*texture))
+                {
+                    throw std::runtime_error("SceneBinaryIo: texture contains blocks with reserved compression modes");
+                }
+
+                texture->SetName(name);
             }
+        }
+
+        // Input maps, arguments always precede the maps using them
+        std::vector<InputMap::Ptr> input_maps(reader.Read<std::uint32_t>());
+        for (auto& input_map : input_maps)
+        {
+            auto name = reader.ReadString();
+            auto type = reader.Read<InputMap::InputMapType>();
 
-            scene->AttachShape(mesh);
+            switch (type)
+            {
+            case InputMap::InputMapType::kConstantFloat3:
+                input_map = InputMap_ConstantFloat3::Create(reader.Read<RadeonRays::float3>());
+                break;
+            case InputMap::InputMapType::kConstantFloat:
+                input_map = InputMap_ConstantFloat::Create(reader.Read<float>());
+                break;
+            case InputMap::InputMapType::kSampler:
+                input_map = InputMap_Sampler::Create(Resolve(textures, reader.Read<std::uint32_t>()));
+                break;
+            case InputMap::InputMapType::kSamplerBumpmap:
+                input_map = InputMap_SamplerBumpMap::Create(Resolve(textures, reader.Read<std::uint32_t>()));
+                break;
+            case InputMap::InputMapType::kAdd:
+                input_map = CreateTwoArg<InputMap_Add>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kSub:
+                input_map = CreateTwoArg<InputMap_Sub>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kMul:
+                input_map = CreateTwoArg<InputMap_Mul>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kDiv:
+                input_map = CreateTwoArg<InputMap_Div>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kMin:
+                input_map = CreateTwoArg<InputMap_Min>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kMax:
+                input_map = CreateTwoArg<InputMap_Max>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kDot3:
+                input_map = CreateTwoArg<InputMap_Dot3>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kDot4:
+                input_map = CreateTwoArg<InputMap_Dot4>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kCross3:
+                input_map = CreateTwoArg<InputMap_Cross3>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kCross4:
+                input_map = CreateTwoArg<InputMap_Cross4>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kPow:
+                input_map = CreateTwoArg<InputMap_Pow>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kMod:
+                input_map = CreateTwoArg<InputMap_Mod>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kSin:
+                input_map = CreateOneArg<InputMap_Sin>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kCos:
+                input_map = CreateOneArg<InputMap_Cos>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kTan:
+                input_map = CreateOneArg<InputMap_Tan>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kAsin:
+                input_map = CreateOneArg<InputMap_Asin>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kAcos:
+                input_map = CreateOneArg<InputMap_Acos>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kAtan:
+                input_map = CreateOneArg<InputMap_Atan>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kLength3:
+                input_map = CreateOneArg<InputMap_Length3>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kNormalize3:
+                input_map = CreateOneArg<InputMap_Normalize3>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kFloor:
+                input_map = CreateOneArg<InputMap_Floor>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kAbs:
+                input_map = CreateOneArg<InputMap_Abs>(reader, input_maps);
+                break;
+            case InputMap::InputMapType::kLerp:
+            {
+                auto a = Resolve(input_maps, reader.Read<std::uint32_t>());
+                auto b = Resolve(input_maps, reader.Read<std::uint32_t>());
+                auto control = Resolve(input_maps, reader.Read<std::uint32_t>());
+                input_map = InputMap_Lerp::Create(a, b, control);
+                break;
+            }
+            case InputMap::InputMapType::kSelect:
+            {
+                auto arg = Resolve(input_maps, reader.Read<std::uint32_t>());
+                input_map = InputMap_Select::Create(arg, reader.Read<InputMap_Select::Selection>());
+                break;
+            }
+            case InputMap::InputMapType::kShuffle:
+            {
+                auto arg = Resolve(input_maps, reader.Read<std::uint32_t>());
+                input_map = InputMap_Shuffle::Create(arg, reader.Read<std::array<std::uint32_t, 4>>());
+                break;
+            }
+            case InputMap::InputMapType::kShuffle2:
+            {
+                auto a = Resolve(input_maps, reader.Read<std::uint32_t>());
+                auto b = Resolve(input_maps, reader.Read<std::uint32_t>());
+                input_map = InputMap_Shuffle2::Create(a, b, reader.Read<std::array<std::uint32_t, 4>>());
+                break;
+            }
+            case InputMap::InputMapType::kMatMul:
+            {
+                auto arg = Resolve(input_maps, reader.Read<std::uint32_t>());
+                input_map = InputMap_MatMul::Create(arg, reader.ReadMatrix());
+                break;
+            }
+            case InputMap::InputMapType::kRemap:
+            {
+                auto src = Resolve(input_maps, reader.Read<std::uint32_t>());
+                auto dst = Resolve(input_maps, reader.Read<std::uint32_t>());
+                auto value = Resolve(input_maps, reader.Read<std::uint32_t>());
+                input_map = InputMap_Remap::Create(src, dst, value);
+                break;
+            }
+            default:
+                throw std::runtime_error("SceneBinaryIo: unknown input map type");
+            }
+
+            input_map->SetName(name);
         }
 
-        auto  ibl_texture = image_io->LoadImage("../Resources/Textures/Canopus_Ground_4k.exr");
+        // Materials, material inputs are resolved once all the materials are created
+        struct MaterialLink
+        {
+            Material::Ptr material;
+            std::string input;
+            std::uint32_t index;
+        };
 
-        auto ibl = ImageBasedLight::Create();
-        ibl->SetTexture(ibl_texture);
-        ibl->SetMultiplier(1.f);
+        std::vector<MaterialLink> material_links;
+        std::vector<Material::Ptr> materials(reader.Read<std::uint32_t>());
+        for (auto& material : materials)
+        {
+            auto type = reader.Read<MaterialType>();
+            auto name = reader.ReadString();
+            auto thin = reader.Read<std::uint32_t>();
 
-        // TODO: temporary code to add directional light
-        auto light = DirectionalLight::Create();
-        light->SetDirection(RadeonRays::normalize(RadeonRays::float3(-1.1f, -0.6f, -0.4f)));
-        light->SetEmittedRadiance(7.f * RadeonRays::float3(1.f, 0.95f, 0.92f));
+            if (type == MaterialType::kUberV2)
+            {
+                auto uberv2 = UberV2Material::Create();
+                uberv2->SetLayers(reader.Read<std::uint32_t>());
+                uberv2->LinkRefractionIOR(reader.Read<std::uint32_t>() != 0);
+                uberv2->SetDoubleSided(reader.Read<std::uint32_t>() != 0);
+                uberv2->SetMultiscatter(reader.Read<std::uint32_t>() != 0);
+                material = uberv2;
+            }
+            else if (type == MaterialType::kVolume)
+            {
+                material = VolumeMaterial::Create();
+            }
+            else
+            {
+                throw std::runtime_error("SceneBinaryIo: unknown material type");
+            }
 
-        auto light1 = DirectionalLight::Create();
-        light1->SetDirection(RadeonRays::float3(0.3f, -1.f, -0.5f));
-        light1->SetEmittedRadiance(RadeonRays::float3(1.f, 0.8f, 0.65f));
+            material->SetName(name);
+            material->SetThin(thin != 0);
 
-        scene->AttachLight(light);
-        //scene->AttachLight(light1);
-        scene->AttachLight(ibl);
+            auto num_inputs = reader.Read<std::uint32_t>();
+            for (auto i = 0u; i < num_inputs; ++i)
+            {
+                auto input = reader.ReadString();
+
+                switch (reader.Read<Material::InputType>())
+                {
+                case Material::InputType::kUint:
+                    material->SetInputValue(input, reader.Read<std::uint32_t>());
+                    break;
+                case Material::InputType::kFloat4:
+                    material->SetInputValue(input, reader.Read<RadeonRays::float4>());
+                    break;
+                case Material::InputType::kTexture:
+                    material->SetInputValue(input, Resolve(textures, reader.Read<std::uint32_t>()));
+                    break;
+                case Material::InputType::kMaterial:
+                    material_links.push_back({ material, input, reader.Read<std::uint32_t>() });
+                    break;
+                case Material::InputType::kInputMap:
+                    material->SetInputValue(input, Resolve(input_maps, reader.Read<std::uint32_t>()));
+                    break;
+                default:
+                    throw std::runtime_error("SceneBinaryIo: unknown material input type");
+                }
+            }
+        }
+
+        for (auto const& link : material_links)
+        {
+            link.material->SetInputValue(link.input, Resolve(materials, link.index));
+        }
+
+        // Shapes, instance base shapes always precede instances
+        std::vector<Shape::Ptr> shapes(reader.Read<std::uint32_t>());
+        for (auto& shape : shapes)
+        {
+            auto type = reader.Read<ShapeType>();
+            auto name = reader.ReadString();
+            auto attached = reader.Read<std::uint32_t>();
+            auto transform = reader.ReadMatrix();
+            auto material = Resolve(materials, reader.Read<std::uint32_t>());
+            auto volume = Resolve(materials, reader.Read<std::uint32_t>());
+            auto visibility_mask = reader.Read<std::uint32_t>();
+
+            if (type == ShapeType::kMesh)
+            {
+                auto mesh = Mesh::Create();
+
+                auto indices = reader.Read<ArrayRef>();
+                auto vertices = reader.Read<ArrayRef>();
+                auto normals = reader.Read<ArrayRef>();
+                auto uvs = reader.Read<ArrayRef>();
+
+                // Arrays are referenced in place, nothing is read from disk until they are used
+                if (indices.size)
+                {
+                    auto ptr = reinterpret_cast<std::uint32_t const*>(get_array(indices, sizeof(std::uint32_t)));
+                    mesh->SetIndices(ptr, static_cast<std::size_t>(indices.size), storage);
+                }
+
+                if (vertices.size)
+                {
+                    auto ptr = reinterpret_cast<RadeonRays::float3 const*>(get_array(vertices, sizeof(RadeonRays::float3)));
+                    mesh->SetVertices(ptr, static_cast<std::size_t>(vertices.size), storage);
+                }
+
+                if (normals.size)
+                {
+                    auto ptr = reinterpret_cast<RadeonRays::float3 const*>(get_array(normals, sizeof(RadeonRays::float3)));
+                    mesh->SetNormals(ptr, static_cast<std::size_t>(normals.size), storage);
+                }
+
+                if (uvs.size)
+                {
+                    auto ptr = reinterpret_cast<RadeonRays::float2 const*>(get_array(uvs, sizeof(RadeonRays::float2)));
+                    mesh->SetUVs(ptr, static_cast<std::size_t>(uvs.size), storage);
+                }
+
+                // Indices address vertices, normals and uvs alike, this touches the index pages only
+                if (indices.size % 3 != 0)
+                {
+                    throw std::runtime_error("SceneBinaryIo: mesh index count is not a multiple of 3");
+                }
+
+                auto index_limit = vertices.size;
+                index_limit = normals.size ? std::min(index_limit, normals.size) : index_limit;
+                index_limit = uvs.size ? std::min(index_limit, uvs.size) : index_limit;
+
+                for (std::size_t i = 0; i < mesh->GetNumIndices(); ++i)
+                {
+                    if (mesh->GetIndices()[i] >= index_limit)
+                    {
+                        throw std::runtime_error("SceneBinaryIo: mesh index is out of range");
+                    }
+                }
+
+                shape = mesh;
+            }
+            else if (type == ShapeType::kInstance)
+            {
+                auto base_index = reader.Read<std::uint32_t>();
+
+                if (base_index >= static_cast<std::uint32_t>(&shape - shapes.data()))
+                {
+                    throw std::runtime_error("SceneBinaryIo: invalid instance base shape");
+                }
+
+                shape = Instance::Create(shapes[base_index]);
+            }
+            else
+            {
+                throw std::runtime_error("SceneBinaryIo: unknown shape type");
+            }
+
+            shape->SetName(name);
+            shape->SetTransform(transform);
+            shape->SetMaterial(material);
+            shape->SetVolumeMaterial(std::dynamic_pointer_cast<VolumeMaterial>(volume));
+            shape->SetVisibilityMask(visibility_mask);
+
+            if (attached)
+            {
+                scene->AttachShape(shape);
+            }
+        }
+
+        // Lights
+        std::vector<Light::Ptr> lights(reader.Read<std::uint32_t>());
+        for (auto& light : lights)
+        {
+            auto type = reader.Read<LightType>();
+            auto name = reader.ReadString();
+            auto attached = reader.Read<std::uint32_t>();
+            auto position = reader.Read<RadeonRays::float3>();
+            auto direction = reader.Read<RadeonRays::float3>();
+            auto radiance = reader.Read<RadeonRays::float3>();
+
+            switch (type)
+            {
+            case LightType::kPoint:
+                light = PointLight::Create();
+                break;
+            case LightType::kDirectional:
+                light = DirectionalLight::Create();
+                break;
+            case LightType::kSpot:
+            {
+                auto spot = SpotLight::Create();
+                spot->SetConeShape(reader.Read<RadeonRays::float2>());
+                light = spot;
+                break;
+            }
+            case LightType::kImageBased:
+            {
+                auto ibl = ImageBasedLight::Create();
+                ibl->SetMultiplier(reader.Read<float>());
+                ibl->SetMirrorX(reader.Read<std::uint32_t>() != 0);
+                ibl->SetTexture(Resolve(textures, reader.Read<std::uint32_t>()));
+                ibl->SetReflectionTexture(Resolve(textures, reader.Read<std::uint32_t>()));
+                ibl->SetRefractionTexture(Resolve(textures, reader.Read<std::uint32_t>()));
+                ibl->SetTransparencyTexture(Resolve(textures, reader.Read<std::uint32_t>()));
+                ibl->SetBackgroundTexture(Resolve(textures, reader.Read<std::uint32_t>()));
+                light = ibl;
+                break;
+            }
+            case LightType::kArea:
+            {
+                auto shape = Resolve(shapes, reader.Read<std::uint32_t>());
+                light = AreaLight::Create(shape, static_cast<std::size_t>(reader.Read<std::uint64_t>()));
+                break;
+            }
+            case LightType::kEmissiveMesh:
+                light = EmissiveMeshLight::Create(Resolve(shapes, reader.Read<std::uint32_t>()));
+                break;
+            default:
+                throw std::runtime_error("SceneBinaryIo: unknown light type");
+            }
+
+            light->SetName(name);
+            light->SetPosition(position);
+            light->SetDirection(direction);
+            light->SetEmittedRadiance(radiance);
+
+            if (attached)
+            {
+                scene->AttachLight(light);
+            }
+        }
+
+        // Camera
+        auto camera_type = reader.Read<CameraType>();
+        if (camera_type != CameraType::kNone)
+        {
+            auto name = reader.ReadString();
+            auto position = reader.Read<RadeonRays::float3>();
+            auto forward = reader.Read<RadeonRays::float3>();
+            auto up = reader.Read<RadeonRays::float3>();
+            auto sensor_size = reader.Read<RadeonRays::float2>();
+            auto depth_range = reader.Read<RadeonRays::float2>();
+            auto volume = Resolve(materials, reader.Read<std::uint32_t>());
+
+            Camera::Ptr camera;
+
+            if (camera_type == CameraType::kPerspective)
+            {
+                auto perspective = PerspectiveCamera::Create(position, position + forward, up);
+                perspective->SetFocalLength(reader.Read<float>());
+                perspective->SetFocusDistance(reader.Read<float>());
+                perspective->SetAperture(reader.Read<float>());
+                camera = perspective;
+            }
+            else if (camera_type == CameraType::kOrthographic)
+            {
+                camera = OrthographicCamera::Create(position, position + forward, up);
+            }
+            else
+            {
+                throw std::runtime_error("SceneBinaryIo: unknown camera type");
+            }
+
+            camera->SetName(name);
+            camera->SetSensorSize(sensor_size);
+            camera->SetDepthRange(depth_range);
+            camera->SetVolume(std::dynamic_pointer_cast<VolumeMaterial>(volume));
+            scene->SetCamera(camera);
+        }
+
+        // Environment settings
+        auto background = Resolve(textures, reader.Read<std::uint32_t>());
+        if (background)
+        {
+            scene->SetBackgroundImage(background);
+        }
+
+        Scene1::EnvironmentOverride environment;
+        environment.m_reflection = std::dynamic_pointer_cast<ImageBasedLight>(Resolve(lights, reader.Read<std::uint32_t>()));
+        environment.m_refraction = std::dynamic_pointer_cast<ImageBasedLight>(Resolve(lights, reader.Read<std::uint32_t>()));
+        environment.m_transparency = std::dynamic_pointer_cast<ImageBasedLight>(Resolve(lights, reader.Read<std::uint32_t>()));
+        environment.m_background = std::dynamic_pointer_cast<ImageBasedLight>(Resolve(lights, reader.Read<std::uint32_t>()));
+        scene->SetEnvironmentOverride(environment);
+
+        LogInfo("Loaded ", shapes.size(), " shapes, ", lights.size(), " lights, ", materials.size(), " materials from ", filename, "\n");
 
         return scene;
     }
 
     void SceneBinaryIo::SaveScene(Scene1 const& scene, std::string const& filename, std::string const& basepath) const
     {
-        std::string full_path = filename;
+        SceneTables tables;
 
-        std::ofstream out(full_path, std::ios::binary | std::ios::out);
+        auto shape_iter = scene.CreateShapeIterator();
+        for (; shape_iter->IsValid(); shape_iter->Next())
+        {
+            auto shape = shape_iter->ItemAs<Shape>();
+            tables.attached_shapes.insert(shape.get());
+            tables.AddShape(shape);
+        }
 
-        if (!out)
+        auto light_iter = scene.CreateLightIterator();
+        for (; light_iter->IsValid(); light_iter->Next())
         {
-            throw std::runtime_error("Cannot open file for writing");
+            auto light = light_iter->ItemAs<Light>();
+            tables.attached_lights.insert(light.get());
+            tables.AddLight(light);
         }
 
-        auto default_material = UberV2Material::Create();
+        auto const& environment = scene.GetEnvironmentOverride();
+        tables.AddLight(environment.m_reflection);
+        tables.AddLight(environment.m_refraction);
+        tables.AddLight(environment.m_transparency);
+        tables.AddLight(environment.m_background);
 
-        auto num_shapes = (std::uint32_t)scene.GetNumShapes();
-        out.write((char*)&num_shapes, sizeof(std::uint32_t));
+        auto camera = scene.GetCamera();
+        if (camera)
+        {
+            tables.AddMaterial(camera->GetVolume());
+        }
 
-        auto shape_iter = scene.CreateShapeIterator();
+        tables.textures.Add(scene.GetBackgroundImage());
 
-        for (; shape_iter->IsValid(); shape_iter->Next())
+        // Data blocks are laid out while metadata is written and copied to the file afterwards
+        struct DataBlock
         {
-            auto mesh = shape_iter->ItemAs<Mesh>();
-            auto num_indices = (std::uint32_t)mesh->GetNumIndices();
-            out.write((char*)&num_indices, sizeof(std::uint32_t));
+            char const* data;
+            std::uint64_t size;
+            std::uint64_t offset;
+        };
+
+        std::vector<DataBlock> blocks;
+        std::uint64_t data_size = 0;
+
+        auto add_block = [&](void const* data, std::size_t element_size, std::size_t count)
+        {
+            ArrayRef ref = { count, count ? data_size : 0 };
+
+            if (count)
+            {
+                blocks.push_back({ static_cast<char const*>(data), element_size * count, data_size });
+                data_size = (data_size + element_size * count + kDataAlignment - 1) / kDataAlignment * kDataAlignment;
+            }
+
+            return ref;
+        };
+
+        MetadataWriter writer;
+
+        // Textures
+        writer.Write(static_cast<std::uint32_t>(tables.textures.GetObjects().size()));
+        for (auto const& texture : tables.textures.GetObjects())
+        {
+            auto name = texture->GetName();
+            writer.WriteString(name);
+
+            // Reference texture file if it can be found, embed texels otherwise
+            if (!name.empty() && std::ifstream(basepath + name))
+            {
+                writer.Write(TextureSource::kFile);
+            }
+            else
+            {
+                writer.Write(TextureSource::kEmbedded);
+                writer.Write(texture->GetSize());
+                writer.Write(texture->GetFormat());
+                writer.Write(add_block(texture->GetData(), 1, texture->GetSizeInBytes()));
+            }
+        }
+
+        // Input maps
+        writer.Write(static_cast<std::uint32_t>(tables.input_maps.GetObjects().size()));
+        for (auto const& input_map : tables.input_maps.GetObjects())
+        {
+            writer.WriteString(input_map->GetName());
+            writer.Write(input_map->m_type);
+
+            switch (input_map->m_type)
+            {
+            case InputMap::InputMapType::kConstantFloat3:
+                writer.Write(std::static_pointer_cast<InputMap_ConstantFloat3>(input_map)->GetValue());
+                break;
+            case InputMap::InputMapType::kConstantFloat:
+                writer.Write(std::static_pointer_cast<InputMap_ConstantFloat>(input_map)->GetValue());
+                break;
+            case InputMap::InputMapType::kSampler:
+            case InputMap::InputMapType::kSamplerBumpmap:
+                writer.Write(tables.textures.GetIndex(std::static_pointer_cast<InputMap_Sampler>(input_map)->GetTexture()));
+                break;
+            case InputMap::InputMapType::kAdd:
+            case InputMap::InputMapType::kSub:
+            case InputMap::InputMapType::kMul:
+            case InputMap::InputMapType::kDiv:
+            case InputMap::InputMapType::kMin:
+            case InputMap::InputMapType::kMax:
+            case InputMap::InputMapType::kDot3:
+            case InputMap::InputMapType::kDot4:
+            case InputMap::InputMapType::kCross3:
+            case InputMap::InputMapType::kCross4:
+            case InputMap::InputMapType::kPow:
+            case InputMap::InputMapType::kMod:
+            {
+                //It's safe since all this types differs only in id value
+                auto i = std::static_pointer_cast<InputMap_Add>(input_map);
+                writer.Write(tables.input_maps.GetIndex(i->GetA()));
+                writer.Write(tables.input_maps.GetIndex(i->GetB()));
+                break;
+            }
+            case InputMap::InputMapType::kLerp:
+            {
+                auto i = std::static_pointer_cast<InputMap_Lerp>(input_map);
+                writer.Write(tables.input_maps.GetIndex(i->GetA()));
+                writer.Write(tables.input_maps.GetIndex(i->GetB()));
+                writer.Write(tables.input_maps.GetIndex(i->GetControl()));
+                break;
+            }
+            case InputMap::InputMapType::kSelect:
+            {
+                auto i = std::static_pointer_cast<InputMap_Select>(input_map);
+                writer.Write(tables.input_maps.GetIndex(i->GetArg()));
+                writer.Write(i->GetSelection());
+                break;
+            }
+            case InputMap::InputMapType::kShuffle:
+            {
+                auto i = std::static_pointer_cast<InputMap_Shuffle>(input_map);
+                writer.Write(tables.input_maps.GetIndex(i->GetArg()));
+                writer.Write(i->GetMask());
+                break;
+            }
+            case InputMap::InputMapType::kShuffle2:
+            {
+                auto i = std::static_pointer_cast<InputMap_Shuffle2>(input_map);
+                writer.Write(tables.input_maps.GetIndex(i->GetA()));
+                writer.Write(tables.input_maps.GetIndex(i->GetB()));
+                writer.Write(i->GetMask());
+                break;
+            }
+            case InputMap::InputMapType::kMatMul:
+            {
+                auto i = std::static_pointer_cast<InputMap_MatMul>(input_map);
+                writer.Write(tables.input_maps.GetIndex(i->GetArg()));
+                writer.WriteMatrix(i->GetMatrix());
+                break;
+            }
+            case InputMap::InputMapType::kRemap:
+            {
+                auto i = std::static_pointer_cast<InputMap_Remap>(input_map);
+                writer.Write(tables.input_maps.GetIndex(i->GetSourceRange()));
+                writer.Write(tables.input_maps.GetIndex(i->GetDestinationRange()));
+                writer.Write(tables.input_maps.GetIndex(i->GetData()));
+                break;
+            }
+            default:
+            {
+                //It's safe since all this types differs only in id value
+                auto i = std::static_pointer_cast<InputMap_Sin>(input_map);
+                writer.Write(tables.input_maps.GetIndex(i->GetArg()));
+                break;
+            }
+            }
+        }
+
+        // Materials
+        writer.Write(static_cast<std::uint32_t>(tables.materials.GetObjects().size()));
+        for (auto const& material : tables.materials.GetObjects())
+        {
+            auto uberv2 = std::dynamic_pointer_cast<UberV2Material>(material);
+
+            writer.Write(uberv2 ? MaterialType::kUberV2 : MaterialType::kVolume);
+            writer.WriteString(material->GetName());
+            writer.Write(static_cast<std::uint32_t>(material->IsThin()));
+
+            if (uberv2)
+            {
+                writer.Write(uberv2->GetLayers());
+                writer.Write(static_cast<std::uint32_t>(uberv2->IsLinkRefractionIOR()));
+                writer.Write(static_cast<std::uint32_t>(uberv2->isDoubleSided()));
+                writer.Write(static_cast<std::uint32_t>(uberv2->IsMultiscatter()));
+            }
+
+            // Unset object inputs keep their defaults
+            std::vector<Material::Input> inputs;
+            for (std::size_t i = 0; i < material->GetNumInputs(); ++i)
+            {
+                auto input = material->GetInput(i);
+                auto const& value = input.value;
 
-            auto num_vertices = (std::uint32_t)mesh->GetNumVertices();
-            out.write((char*)&num_vertices, sizeof(std::uint32_t));
+                if ((value.type == Material::InputType::kTexture && !value.tex_value) ||
+                    (value.type == Material::InputType::kMaterial && !value.mat_value) ||
+                    (value.type == Material::InputType::kInputMap && !value.input_map_value))
+                {
+                    continue;
+                }
 
-            auto num_normals = (std::uint32_t)mesh->GetNumNormals();
-            out.write((char*)&num_normals, sizeof(std::uint32_t));
+                inputs.push_back(std::move(input));
+            }
 
-            auto num_uvs = (std::uint32_t)mesh->GetNumUVs();
-            out.write((char*)&num_uvs, sizeof(std::uint32_t));
+            writer.Write(static_cast<std::uint32_t>(inputs.size()));
+            for (auto const& input : inputs)
+            {
+                writer.WriteString(input.info.name);
+                writer.Write(input.value.type);
 
-            out.write((char const*)mesh->GetIndices(), mesh->GetNumIndices() * sizeof(std::uint32_t));
-            out.write((char const*)mesh->GetVertices(), mesh->GetNumVertices() * sizeof(RadeonRays::float3));
-            out.write((char const*)mesh->GetNormals(), mesh->GetNumNormals() * sizeof(RadeonRays::float3));
-            out.write((char const*)mesh->GetUVs(), mesh->GetNumUVs() * sizeof(RadeonRays::float2));
+                switch (input.value.type)
+                {
+                case Material::InputType::kUint:
+                    writer.Write(input.value.uint_value);
+                    break;
+                case Material::InputType::kFloat4:
+                    writer.Write(input.value.float_value);
+                    break;
+                case Material::InputType::kTexture:
+                    writer.Write(tables.textures.GetIndex(input.value.tex_value));
+                    break;
+                case Material::InputType::kMaterial:
+                    writer.Write(tables.materials.GetIndex(input.value.mat_value));
+                    break;
+                case Material::InputType::kInputMap:
+                    writer.Write(tables.input_maps.GetIndex(input.value.input_map_value));
+                    break;
+                }
+            }
+        }
 
-            auto material = mesh->GetMaterial();
+        // Shapes
+        writer.Write(static_cast<std::uint32_t>(tables.shapes.GetObjects().size()));
+        for (auto const& shape : tables.shapes.GetObjects())
+        {
+            auto mesh = std::dynamic_pointer_cast<Mesh>(shape);
 
-            /*if (!material)
+            writer.Write(mesh ? ShapeType::kMesh : ShapeType::kInstance);
+            writer.WriteString(shape->GetName());
+            writer.Write(static_cast<std::uint32_t>(tables.attached_shapes.count(shape.get())));
+            writer.WriteMatrix(shape->GetTransform());
+            writer.Write(tables.materials.GetIndex(shape->GetMaterial()));
+            writer.Write(tables.materials.GetIndex(shape->GetVolumeMaterial()));
+            writer.Write(shape->GetVisibilityMask());
+
+            if (mesh)
+            {
+                writer.Write(add_block(mesh->GetIndices(), sizeof(std::uint32_t), mesh->GetNumIndices()));
+                writer.Write(add_block(mesh->GetVertices(), sizeof(RadeonRays::float3), mesh->GetNumVertices()));
+                writer.Write(add_block(mesh->GetNormals(), sizeof(RadeonRays::float3), mesh->GetNumNormals()));
+                writer.Write(add_block(mesh->GetUVs(), sizeof(RadeonRays::float2), mesh->GetNumUVs()));
+            }
+            else
             {
-                material = default_material;
+                auto instance = std::static_pointer_cast<Instance>(shape);
+                writer.Write(tables.shapes.GetIndex(instance->GetBaseShape()));
             }
+        }
+
+        // Lights
+        writer.Write(static_cast<std::uint32_t>(tables.lights.GetObjects().size()));
+        for (auto const& light : tables.lights.GetObjects())
+        {
+            auto type = GetLightType(*light);
 
-            auto diffuse = std::dynamic_pointer_cast<SingleBxdf>(material);
+            writer.Write(type);
+            writer.WriteString(light->GetName());
+            writer.Write(static_cast<std::uint32_t>(tables.attached_lights.count(light.get())));
+            writer.Write(light->GetPosition());
+            writer.Write(light->GetDirection());
+            writer.Write(light->GetEmittedRadiance());
 
-            if (!diffuse)
+            switch (type)
             {
-                diffuse = std::dynamic_pointer_cast<SingleBxdf>(material->GetInputValue("base_material").mat_value);
+            case LightType::kSpot:
+                writer.Write(std::static_pointer_cast<SpotLight>(light)->GetConeShape());
+                break;
+            case LightType::kImageBased:
+            {
+                auto ibl = std::static_pointer_cast<ImageBasedLight>(light);
+                writer.Write(ibl->GetMultiplier());
+                writer.Write(static_cast<std::uint32_t>(ibl->GetMirrorX()));
+                writer.Write(tables.textures.GetIndex(ibl->GetTexture()));
+                writer.Write(tables.textures.GetIndex(ibl->GetReflectionTexture()));
+                writer.Write(tables.textures.GetIndex(ibl->GetRefractionTexture()));
+                writer.Write(tables.textures.GetIndex(ibl->GetTransparencyTexture()));
+                writer.Write(tables.textures.GetIndex(ibl->GetBackgroundTexture()));
+                break;
+            }
+            case LightType::kArea:
+            {
+                auto area = std::static_pointer_cast<AreaLight>(light);
+                writer.Write(tables.shapes.GetIndex(area->GetShape()));
+                writer.Write(static_cast<std::uint64_t>(area->GetPrimitiveIdx()));
+                break;
             }
+            case LightType::kEmissiveMesh:
+                writer.Write(tables.shapes.GetIndex(std::static_pointer_cast<EmissiveMeshLight>(light)->GetShape()));
+                break;
+            default:
+                break;
+            }
+        }
 
-            if (!diffuse)
+        // Camera
+        auto perspective = std::dynamic_pointer_cast<PerspectiveCamera>(camera);
+
+        if (!camera)
+        {
+            writer.Write(CameraType::kNone);
+        }
+        else
+        {
+            writer.Write(perspective ? CameraType::kPerspective : CameraType::kOrthographic);
+            writer.WriteString(camera->GetName());
+            writer.Write(camera->GetPosition());
+            writer.Write(camera->GetForwardVector());
+            writer.Write(camera->GetUpVector());
+            writer.Write(camera->GetSensorSize());
+            writer.Write(camera->GetDepthRange());
+            writer.Write(tables.materials.GetIndex(camera->GetVolume()));
+
+            if (perspective)
             {
-                throw std::runtime_error("Material not supported");
+                writer.Write(perspective->GetFocalLength());
+                writer.Write(perspective->GetFocusDistance());
+                writer.Write(perspective->GetAperture());
             }
-            diffuse->GetInputValue("albedo");
-            */
+        }
+
+        // Environment settings
+        writer.Write(tables.textures.GetIndex(scene.GetBackgroundImage()));
+        writer.Write(tables.lights.GetIndex(environment.m_reflection));
+        writer.Write(tables.lights.GetIndex(environment.m_refraction));
+        writer.Write(tables.lights.GetIndex(environment.m_transparency));
+        writer.Write(tables.lights.GetIndex(environment.m_background));
+
+        // Write the file
+        auto const& metadata = writer.GetBuffer();
+
+        Header header;
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.reserved = 0;
+        header.metadata_offset = sizeof(Header);
+        header.metadata_size = metadata.size();
+        header.data_offset = (header.metadata_offset + header.metadata_size + kPageSize - 1) / kPageSize * kPageSize;
+        header.data_size = data_size;
+
+        std::ofstream out(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+
+        if (!out)
+        {
+            throw std::runtime_error("Cannot open file for writing");
+        }
+
+        out.write(reinterpret_cast<char const*>(&header), sizeof(Header));
+        out.write(metadata.data(), metadata.size());
 
-            auto albedo = RadeonRays::float3(1.0f, 1.0f, 1.0f);
+        std::vector<char> padding(kPageSize, 0);
+        std::uint64_t position = header.metadata_offset + header.metadata_size;
 
-            std::uint32_t flag = 0;
-            out.write(reinterpret_cast<char const*>(&flag), sizeof(flag));
-            out.write(reinterpret_cast<char const*>(&albedo.x), sizeof(RadeonRays::float3));
+        for (auto const& block : blocks)
+        {
+            auto offset = header.data_offset + block.offset;
+            out.write(padding.data(), static_cast<std::streamsize>(offset - position));
+            out.write(block.data, static_cast<std::streamsize>(block.size));
+            position = offset + block.size;
+        }
+
+        // Pad the last block, so the data section has the size stored in the header
+        out.write(padding.data(), static_cast<std::streamsize>(header.data_offset + header.data_size - position));
+
+        if (!out)
+        {
+            throw std::runtime_error("Cannot write " + filename);
         }
     }
 }
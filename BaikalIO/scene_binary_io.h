@@ -28,13 +28,13 @@ THE SOFTWARE.
 
 namespace Baikal
 {
-    // Create fake test IO
+    // Versioned binary scene cache, mesh arrays are memory mapped on load
     class SceneBinaryIo : public SceneIo::Loader
     {
     public:
         SceneBinaryIo() : SceneIo::Loader("bin", this)
         {}
-        // Load scene (this class uses filename to determine what scene to generate)
+        // Load scene, texture files are resolved relative to basepath
         Scene1::Ptr LoadScene(std::string const& filename, std::string const& basepath) const override;
         void SaveScene(Scene1 const& scene, std::string const& filename, std::string const& basepath) const override;
     };
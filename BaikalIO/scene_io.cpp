@@ -48,7 +48,7 @@ namespace Baikal
 
     void SceneIo::SaveScene(Scene1 const& scene, std::string const& filename, std::string const& basepath)
     {
-        auto ext = filename.substr(filename.rfind("."));
+        auto ext = filename.substr(filename.rfind(".") + 1);
 
         SceneIo *instance = GetInstance();
         auto loader_it = instance->m_loaders.find(ext);
@@ -22,6 +22,7 @@ THE SOFTWARE.
 
 #include "scene_io.h"
 #include "image_io.h"
+#include "obj_parser.h"
 #include "SceneGraph/scene1.h"
 #include "SceneGraph/shape.h"
 #include "SceneGraph/material.h"
@@ -35,9 +36,7 @@ THE SOFTWARE.
 #include <string>
 #include <map>
 #include <set>
-#include <cassert>
 
-#include "Utils/tiny_obj_loader.h"
 #include "Utils/log.h"
 
 namespace Baikal
@@ -58,7 +57,7 @@ namespace Baikal
         }
 
     private:
-        Material::Ptr TranslateMaterialUberV2(ImageIo const& image_io, tinyobj::material_t const& mat, std::string const& basepath, Scene1& scene) const;
+        Material::Ptr TranslateMaterialUberV2(ImageIo const& image_io, ObjMaterial const& mat, std::string const& basepath, Scene1& scene) const;
 
         mutable std::map<std::string, Material::Ptr> m_material_cache;
     };
@@ -69,22 +68,11 @@ namespace Baikal
 
     Scene1::Ptr SceneIoObj::LoadScene(std::string const& filename, std::string const& basepath) const
     {
-        using namespace tinyobj;
-
         auto image_io(ImageIo::CreateImageIo());
 
-        // Loader data
-        std::vector<shape_t> objshapes;
-        std::vector<material_t> objmaterials;
-
         // Try loading file
         LogInfo("Loading a scene from OBJ: ", filename, " ... ");
-        std::string err;
-        auto res = LoadObj(objshapes, objmaterials, err, filename.c_str(), basepath.c_str(), triangulation|calculate_normals);
-        if (!res)
-        {
-            throw std::runtime_error(err);
-        }
+        auto objscene = ParseObj(filename, basepath);
         LogInfo("Success\n");
 
         // Allocate scene
@@ -93,11 +81,11 @@ namespace Baikal
         // Enumerate and translate materials
         // Keep track of emissive subset
         std::set<Material::Ptr> emissives;
-        std::vector<Material::Ptr> materials(objmaterials.size());
-        for (int i = 0; i < (int)objmaterials.size(); ++i)
+        std::vector<Material::Ptr> materials(objscene.materials.size());
+        for (int i = 0; i < (int)objscene.materials.size(); ++i)
         {
             // Translate material
-            materials[i] = TranslateMaterialUberV2(*image_io, objmaterials[i], basepath, *scene);
+            materials[i] = TranslateMaterialUberV2(*image_io, objscene.materials[i], basepath, *scene);
 
             // Add to emissive subset if needed
             if (materials[i]->HasEmission())
@@ -106,104 +94,34 @@ namespace Baikal
             }
         }
 
-        // Enumerate all shapes in the scene
-        for (int s = 0; s < (int)objshapes.size(); ++s)
+        // Parser splits shapes into meshes with only one material
+        for (auto& objmesh : objscene.meshes)
         {
-            const auto& shape = objshapes[s];
+            // Create empty mesh
+            auto mesh = Mesh::Create();
+
+            // Move vertex and index data, UVs are zero if the file does not have them
+            mesh->SetVertices(std::move(objmesh.vertices));
+            mesh->SetNormals(std::move(objmesh.normals));
+            mesh->SetUVs(std::move(objmesh.uvs));
+            mesh->SetIndices(std::move(objmesh.indices));
+
+            // Set material
+            auto used_material = objmesh.material;
+
+            if (used_material >= 0)
+            {
+                mesh->SetMaterial(materials[used_material]);
+            }
 
-            // Find all materials used by this shape.
-            std::set<int> used_materials(std::begin(shape.mesh.material_ids), std::end(shape.mesh.material_ids));
+            // Attach to the scene
+            scene->AttachShape(mesh);
 
-            // Split the mesh into multiple meshes, each with only one material.
-            for (int used_material : used_materials)
+            // If the mesh has emissive material we need to add emissive mesh light for it
+            if (used_material >= 0 && emissives.find(materials[used_material]) != emissives.cend())
             {
-                // Map from old index to new index.
-                std::map<unsigned int, unsigned int> used_indices;
-
-                // Remapped indices.
-                std::vector<unsigned int> indices;
-
-                // Collected vertex/normal/texcoord data.
-                std::vector<float> vertices, normals, texcoords;
-
-                // Go through each face in the mesh.
-                for (size_t i = 0; i < shape.mesh.material_ids.size(); ++i)
-                {
-                    // Skip faces which don't use the current material.
-                    if (shape.mesh.material_ids[i] != used_material) continue;
-
-                    const int num_face_vertices = shape.mesh.num_vertices[i];
-                    assert(num_face_vertices == 3 && "expected triangles");
-                    // For each vertex index of this face.
-                    for (int j = 0; j < num_face_vertices; ++j)
-                    {
-                        const unsigned int old_index = shape.mesh.indices[num_face_vertices * i + j];
-                        // Collect vertex/normal/texcoord data. Avoid inserting the same data twice.
-                        auto result = used_indices.emplace(old_index, (unsigned int)(vertices.size() / 3));
-                        if (result.second) // Did insert?
-                        {
-                            // Push the new data.
-                            for (int k = 0; k < 3; ++k)
-                                vertices.push_back(shape.mesh.positions[3 * old_index + k]);
-                            for (int k = 0; k < 3; ++k)
-                                normals.push_back(shape.mesh.normals[3 * old_index + k]);
-                            if (!shape.mesh.texcoords.empty())
-                                for (int k = 0; k < 2; ++k)
-                                    texcoords.push_back(shape.mesh.texcoords[2 * old_index + k]);
-                        }
-                        const unsigned int new_index = result.first->second;
-                        indices.push_back(new_index);
-                    }
-                }
-
-                // Create empty mesh
-                auto mesh = Mesh::Create();
-
-                // Set vertex and index data
-                auto num_vertices = vertices.size() / 3;
-                mesh->SetVertices(&vertices[0], num_vertices);
-
-                auto num_normals = normals.size() / 3;
-                mesh->SetNormals(&normals[0], num_normals);
-
-                auto num_uvs = texcoords.size() / 2;
-
-                // If we do not have UVs, generate zeroes
-                if (num_uvs)
-                {
-                    mesh->SetUVs(&texcoords[0], num_uvs);
-                }
-                else
-                {
-                    std::vector<RadeonRays::float2> zero(num_vertices);
-                    std::fill(zero.begin(), zero.end(), RadeonRays::float2(0, 0));
-                    mesh->SetUVs(&zero[0], num_vertices);
-                }
-
-                // Set indices
-                auto num_indices = indices.size();
-                mesh->SetIndices(reinterpret_cast<std::uint32_t const*>(&indices[0]), num_indices);
-
-                // Set material
-
-                if (used_material >= 0)
-                {
-                    mesh->SetMaterial(materials[used_material]);
-                }
-
-                // Attach to the scene
-                scene->AttachShape(mesh);
-
-                // If the mesh has emissive material we need to add area light for it
-                if (used_material >= 0 && emissives.find(materials[used_material]) != emissives.cend())
-                {
-                    // Add area light for each polygon of emissive mesh
-                    for (std::size_t l = 0; l < mesh->GetNumIndices() / 3; ++l)
-                    {
-                        auto light = AreaLight::Create(mesh, l);
-                        scene->AttachLight(light);
-                    }
-                }
+                auto light = EmissiveMeshLight::Create(mesh);
+                scene->AttachLight(light);
             }
         }
 
@@ -234,7 +152,7 @@ namespace Baikal
 
         return scene;
     }
-    Material::Ptr SceneIoObj::TranslateMaterialUberV2(ImageIo const& image_io, tinyobj::material_t const& mat, std::string const& basepath, Scene1& scene) const
+    Material::Ptr SceneIoObj::TranslateMaterialUberV2(ImageIo const& image_io, ObjMaterial const& mat, std::string const& basepath, Scene1& scene) const
     {
         auto iter = m_material_cache.find(mat.name);
 
@@ -245,7 +163,7 @@ namespace Baikal
 
         UberV2Material::Ptr material = UberV2Material::Create();
 
-        RadeonRays::float3 emission(mat.emission[0], mat.emission[1], mat.emission[2]);
+        auto emission = mat.emission;
 
         bool apply_gamma = true;
 
@@ -290,9 +208,9 @@ namespace Baikal
             }
         }
 
-        auto s = RadeonRays::float3(mat.specular[0], mat.specular[1], mat.specular[2]);
-        auto r = RadeonRays::float3(mat.transmittance[0], mat.transmittance[1], mat.transmittance[2]);
-        auto d = RadeonRays::float3(mat.diffuse[0], mat.diffuse[1], mat.diffuse[2]);
+        auto s = mat.specular;
+        auto r = mat.transmittance;
+        auto d = mat.diffuse;
 
         auto default_ior = Baikal::InputMap_ConstantFloat::Create(3.0f);
         auto default_roughness = Baikal::InputMap_ConstantFloat::Create(0.01f);
@@ -11,6 +11,9 @@
 
 #include <vector>
 #include <memory>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -141,6 +144,56 @@ namespace Baikal
         return mesh;
     }
 
+    // Get integer parameter of procedural scene name, "bench+l4+m2" has 'l' = 4 and 'm' = 2
+    static int GetSceneParameter(std::string const& name, char key, int default_value)
+    {
+        std::string token = std::string("+") + key;
+        auto pos = name.find(token);
+
+        if (pos == std::string::npos)
+        {
+            return default_value;
+        }
+
+        return std::atoi(name.c_str() + pos + token.size());
+    }
+
+    // Create material for procedural benchmark scene, complexity adds layers from 0 (diffuse only) to 3
+    auto CreateBenchMaterial(int complexity, RadeonRays::float3 const& color)
+    {
+        using namespace RadeonRays;
+
+        auto mat = UberV2Material::Create();
+        mat->SetInputValue("uberv2.diffuse.color", InputMap_ConstantFloat3::Create(color));
+        std::uint32_t layers = UberV2Material::Layers::kDiffuseLayer;
+
+        if (complexity > 0)
+        {
+            mat->SetInputValue("uberv2.reflection.color", InputMap_ConstantFloat3::Create(float3(0.9f, 0.9f, 0.9f)));
+            mat->SetInputValue("uberv2.reflection.roughness", InputMap_ConstantFloat::Create(0.1f));
+            mat->SetInputValue("uberv2.reflection.ior", InputMap_ConstantFloat::Create(1.5f));
+            layers |= UberV2Material::Layers::kReflectionLayer;
+        }
+
+        if (complexity > 1)
+        {
+            mat->SetInputValue("uberv2.coating.color", InputMap_ConstantFloat3::Create(float3(1.f, 1.f, 1.f)));
+            mat->SetInputValue("uberv2.coating.ior", InputMap_ConstantFloat::Create(1.4f));
+            layers |= UberV2Material::Layers::kCoatingLayer;
+        }
+
+        if (complexity > 2)
+        {
+            mat->SetInputValue("uberv2.refraction.color", InputMap_ConstantFloat3::Create(float3(0.9f, 0.9f, 0.9f)));
+            mat->SetInputValue("uberv2.refraction.roughness", InputMap_ConstantFloat::Create(0.05f));
+            mat->SetInputValue("uberv2.transparency", InputMap_ConstantFloat::Create(0.2f));
+            layers |= UberV2Material::Layers::kRefractionLayer | UberV2Material::Layers::kTransparencyLayer;
+        }
+
+        mat->SetLayers(layers);
+        return mat;
+    }
+
     Scene1::Ptr SceneIoTest::LoadScene(std::string const& filename, std::string const& basepath) const
     {
         using namespace RadeonRays;
@@ -620,7 +673,54 @@ namespace Baikal
             ibl->SetMultiplier(1.f);
             scene->AttachLight(ibl);
         }
+        else if (fname.compare(0, 5, "bench") == 0)
+        {
+            // Procedural benchmark scene, does not depend on resource files.
+            // Name is "bench[+l<number of lights>][+m<material complexity>]"
+            auto num_lights = std::max(GetSceneParameter(fname, 'l', 1), 1);
+            auto complexity = std::min(std::max(GetSceneParameter(fname, 'm', 0), 0), 3);
+
+            auto floor = CreateQuad(
+            {
+                RadeonRays::float3(-10, 0, -10),
+                RadeonRays::float3(10, 0, -10),
+                RadeonRays::float3(10, 0, 10),
+                RadeonRays::float3(-10, 0, 10),
+            }
+            , false);
+            floor->SetMaterial(CreateBenchMaterial(0, float3(0.6f, 0.6f, 0.6f)));
+            scene->AttachShape(floor);
+
+            // Grid of spheres with own material each
+            int const grid_size = 5;
+            float const spacing = 1.2f;
+
+            for (int i = 0; i < grid_size; ++i)
+            {
+                for (int j = 0; j < grid_size; ++j)
+                {
+                    auto sphere = CreateSphere(32, 16, 0.5f,
+                        float3((i - grid_size / 2) * spacing, 0.5f, -j * spacing));
+
+                    float3 color(0.2f + 0.15f * i, 0.8f - 0.15f * j, 0.5f);
+                    sphere->SetMaterial(CreateBenchMaterial(complexity, color));
+                    scene->AttachShape(sphere);
+                }
+            }
 
+            // Lights are placed on a circle above the grid, total power is kept constant
+            float3 center(0.f, 4.f, -(grid_size / 2) * spacing);
+
+            for (int l = 0; l < num_lights; ++l)
+            {
+                float angle = 2.f * (float)M_PI * l / num_lights;
+
+                auto light = PointLight::Create();
+                light->SetPosition(center + 3.f * float3(std::cos(angle), 0.f, std::sin(angle)));
+                light->SetEmittedRadiance(float3(30.f, 30.f, 30.f) * (1.f / num_lights));
+                scene->AttachLight(light);
+            }
+        }
 
         return scene;
     }
@@ -0,0 +1,421 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+#include "texture_compressor.h"
+#include "Utils/block_compression.h"
+#include "Utils/half.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace Baikal
+{
+    namespace
+    {
+        // Texel values of a single block
+        struct BlockTexels
+        {
+            float values[kBlockTexels][4];
+        };
+
+        void SetBits(std::uint8_t* block, int start, int count, std::uint32_t value)
+        {
+            for (auto i = 0; i < count; ++i)
+            {
+                auto bit = start + i;
+                block[bit / 8] = static_cast<std::uint8_t>((block[bit / 8] & ~(1 << (bit % 8))) | (((value >> i) & 1) << (bit % 8)));
+            }
+        }
+
+        // Location of texel index within the block
+        void GetIndexBits(Texture::Format format, int texel, int& start, int& count)
+        {
+            switch (format)
+            {
+            case Texture::Format::kBc1:
+                start = 32 + 2 * texel;
+                count = 2;
+                break;
+            case Texture::Format::kBc4:
+                start = 16 + 3 * texel;
+                count = 3;
+                break;
+            default:
+                // BC6H mode 11 and BC7 mode 6: anchor texel has one bit less
+                start = texel == 0 ? 65 : 64 + 4 * texel;
+                count = texel == 0 ? 3 : 4;
+                break;
+            }
+        }
+
+        // Nearest representable value for each texel, palette is obtained from the reference decoder
+        // by trying every possible index, so encoder and decoder always agree.
+        // Returns index of the anchor texel before it is written.
+        int WriteIndices(std::uint8_t* block, std::size_t block_size, Texture::Format format,
+                         BlockTexels const& texels, float const* channel_weights, bool write)
+        {
+            int start, count;
+            GetIndexBits(format, 1, start, count);
+
+            std::uint8_t tmp[16];
+            RadeonRays::float4 palette[16];
+            auto num_values = 1 << count;
+
+            for (auto i = 0; i < num_values; ++i)
+            {
+                std::memcpy(tmp, block, block_size);
+                SetBits(tmp, start, count, i);
+                palette[i] = DecodeBlockTexel(reinterpret_cast<char const*>(tmp), format, 1);
+            }
+
+            int anchor_index = 0;
+
+            for (auto t = 0; t < kBlockTexels; ++t)
+            {
+                auto best_index = 0;
+                auto best_error = std::numeric_limits<float>::max();
+
+                for (auto i = 0; i < num_values; ++i)
+                {
+                    float value[4] = { palette[i].x, palette[i].y, palette[i].z, palette[i].w };
+                    float error = 0.f;
+
+                    for (auto c = 0; c < 4; ++c)
+                    {
+                        auto d = value[c] - texels.values[t][c];
+                        error += channel_weights[c] * d * d;
+                    }
+
+                    if (error < best_error)
+                    {
+                        best_error = error;
+                        best_index = i;
+                    }
+                }
+
+                if (t == 0)
+                {
+                    anchor_index = best_index;
+                }
+
+                if (write)
+                {
+                    GetIndexBits(format, t, start, count);
+                    SetBits(block, start, count, std::min(best_index, (1 << count) - 1));
+                }
+            }
+
+            return anchor_index;
+        }
+
+        void GetBounds(BlockTexels const& texels, float* lo, float* hi)
+        {
+            for (auto c = 0; c < 4; ++c)
+            {
+                lo[c] = std::numeric_limits<float>::max();
+                hi[c] = -std::numeric_limits<float>::max();
+
+                for (auto t = 0; t < kBlockTexels; ++t)
+                {
+                    lo[c] = std::min(lo[c], texels.values[t][c]);
+                    hi[c] = std::max(hi[c], texels.values[t][c]);
+                }
+            }
+        }
+
+        // Endpoints of the block bounding box diagonal following the data:
+        // channels negatively correlated with the channel of the largest range are flipped
+        void GetEndpoints(BlockTexels const& texels, int num_channels, float* e0, float* e1)
+        {
+            float lo[4], hi[4];
+            GetBounds(texels, lo, hi);
+
+            auto ref = 0;
+            float mean[4] = { 0.f, 0.f, 0.f, 0.f };
+
+            for (auto c = 0; c < num_channels; ++c)
+            {
+                if (hi[c] - lo[c] > hi[ref] - lo[ref])
+                {
+                    ref = c;
+                }
+
+                for (auto t = 0; t < kBlockTexels; ++t)
+                {
+                    mean[c] += texels.values[t][c] / kBlockTexels;
+                }
+            }
+
+            for (auto c = 0; c < num_channels; ++c)
+            {
+                float covariance = 0.f;
+
+                for (auto t = 0; t < kBlockTexels; ++t)
+                {
+                    covariance += (texels.values[t][c] - mean[c]) * (texels.values[t][ref] - mean[ref]);
+                }
+
+                e0[c] = covariance < 0.f ? hi[c] : lo[c];
+                e1[c] = covariance < 0.f ? lo[c] : hi[c];
+            }
+        }
+
+        int Quantize(float value, int max_value)
+        {
+            return static_cast<int>(std::min(std::max(value, 0.f), 1.f) * max_value + 0.5f);
+        }
+
+        void EncodeBc1(BlockTexels const& texels, std::uint8_t* block)
+        {
+            float lo[4], hi[4];
+            GetEndpoints(texels, 3, lo, hi);
+
+            auto c0 = (Quantize(hi[0], 31) << 11) | (Quantize(hi[1], 63) << 5) | Quantize(hi[2], 31);
+            auto c1 = (Quantize(lo[0], 31) << 11) | (Quantize(lo[1], 63) << 5) | Quantize(lo[2], 31);
+
+            // Keep 4 color mode
+            if (c0 < c1)
+            {
+                std::swap(c0, c1);
+            }
+
+            SetBits(block, 0, 16, c0);
+            SetBits(block, 16, 16, c1);
+
+            // Solid block, all indices point to the first endpoint
+            if (c0 == c1)
+            {
+                return;
+            }
+
+            float const weights[4] = { 1.f, 1.f, 1.f, 0.f };
+            WriteIndices(block, 8, Texture::Format::kBc1, texels, weights, true);
+        }
+
+        // Encode single channel of the block as BC4
+        void EncodeBc4(BlockTexels const& texels, int channel, std::uint8_t* block)
+        {
+            BlockTexels channel_texels;
+
+            for (auto t = 0; t < kBlockTexels; ++t)
+            {
+                std::fill(channel_texels.values[t], channel_texels.values[t] + 4, texels.values[t][channel]);
+            }
+
+            float lo[4], hi[4];
+            GetBounds(channel_texels, lo, hi);
+
+            // r0 >= r1 selects 8 value mode
+            SetBits(block, 0, 8, Quantize(hi[0], 255));
+            SetBits(block, 8, 8, Quantize(lo[0], 255));
+
+            float const weights[4] = { 1.f, 0.f, 0.f, 0.f };
+            WriteIndices(block, 8, Texture::Format::kBc4, channel_texels, weights, true);
+        }
+
+        void EncodeBc6h(BlockTexels const& texels, std::uint8_t* block)
+        {
+            float lo[4], hi[4];
+            GetEndpoints(texels, 3, lo, hi);
+
+            int e0[3], e1[3];
+
+            for (auto c = 0; c < 3; ++c)
+            {
+                // Non-negative half bits are monotonic with the value,
+                // the decoder maps 10-bit endpoint q roughly into 31 * q
+                half hlo(std::min(std::max(lo[c], 0.f), 65504.f));
+                half hhi(std::min(std::max(hi[c], 0.f), 65504.f));
+                e0[c] = std::min((hlo.bits() + 15) / 31, 1023);
+                e1[c] = std::min((hhi.bits() + 15) / 31, 1023);
+            }
+
+            float const weights[4] = { 1.f, 1.f, 1.f, 0.f };
+
+            for (auto pass = 0; pass < 2; ++pass)
+            {
+                std::memset(block, 0, 16);
+                SetBits(block, 0, 5, 0x03);
+
+                for (auto c = 0; c < 3; ++c)
+                {
+                    SetBits(block, 5 + 10 * c, 10, e0[c]);
+                    SetBits(block, 35 + 10 * c, 10, e1[c]);
+                }
+
+                // Anchor texel index should fit into 3 bits, swap endpoints otherwise
+                if (pass == 0 && WriteIndices(block, 16, Texture::Format::kBc6h, texels, weights, false) >= 8)
+                {
+                    std::swap(e0, e1);
+                    continue;
+                }
+
+                WriteIndices(block, 16, Texture::Format::kBc6h, texels, weights, true);
+                break;
+            }
+        }
+
+        void EncodeBc7(BlockTexels const& texels, std::uint8_t* block)
+        {
+            float lo[4], hi[4];
+            GetEndpoints(texels, 4, lo, hi);
+
+            // 7-bit endpoints with shared lowest bit (p-bit) per endpoint
+            auto quantize_endpoint = [](float const* values, int* endpoint, int& pbit)
+            {
+                auto best_error = std::numeric_limits<int>::max();
+
+                for (auto p = 0; p < 2; ++p)
+                {
+                    int candidate[4];
+                    int error = 0;
+
+                    for (auto c = 0; c < 4; ++c)
+                    {
+                        auto v = Quantize(values[c], 255);
+                        candidate[c] = std::min(std::max((v - p + 1) / 2, 0), 127);
+                        error += std::abs(((candidate[c] << 1) | p) - v);
+                    }
+
+                    if (error < best_error)
+                    {
+                        best_error = error;
+                        std::copy(candidate, candidate + 4, endpoint);
+                        pbit = p;
+                    }
+                }
+            };
+
+            int e0[4], e1[4];
+            int p0 = 0, p1 = 0;
+            quantize_endpoint(lo, e0, p0);
+            quantize_endpoint(hi, e1, p1);
+
+            float const weights[4] = { 1.f, 1.f, 1.f, 1.f };
+
+            for (auto pass = 0; pass < 2; ++pass)
+            {
+                std::memset(block, 0, 16);
+                SetBits(block, 0, 7, 0x40);
+
+                for (auto c = 0; c < 4; ++c)
+                {
+                    SetBits(block, 7 + 14 * c, 7, e0[c]);
+                    SetBits(block, 14 + 14 * c, 7, e1[c]);
+                }
+
+                SetBits(block, 63, 1, p0);
+                SetBits(block, 64, 1, p1);
+
+                // Anchor texel index should fit into 3 bits, swap endpoints otherwise
+                if (pass == 0 && WriteIndices(block, 16, Texture::Format::kBc7, texels, weights, false) >= 8)
+                {
+                    std::swap(e0, e1);
+                    std::swap(p0, p1);
+                    continue;
+                }
+
+                WriteIndices(block, 16, Texture::Format::kBc7, texels, weights, true);
+                break;
+            }
+        }
+    }
+
+    Texture::Ptr CompressTexture(Texture const& texture, Texture::Format format)
+    {
+        std::size_t block_size = 0;
+
+        switch (format)
+        {
+        case Texture::Format::kBc1:
+        case Texture::Format::kBc4:
+            block_size = 8;
+            break;
+        case Texture::Format::kBc5:
+        case Texture::Format::kBc6h:
+        case Texture::Format::kBc7:
+            block_size = 16;
+            break;
+        default:
+            throw std::runtime_error("CompressTexture: target format is not block compressed");
+        }
+
+        auto size = texture.GetSize();
+
+        if (size.z > 1 || texture.IsCompressed())
+        {
+            throw std::runtime_error("CompressTexture: only uncompressed 2D textures are supported");
+        }
+
+        auto num_blocks_x = (size.x + 3) / 4;
+        auto num_blocks_y = (size.y + 3) / 4;
+        auto data = new char[block_size * num_blocks_x * num_blocks_y];
+        std::memset(data, 0, block_size * num_blocks_x * num_blocks_y);
+
+        for (auto by = 0; by < num_blocks_y; ++by)
+        {
+            for (auto bx = 0; bx < num_blocks_x; ++bx)
+            {
+                // Gather block texels clamping to texture borders
+                BlockTexels texels;
+
+                for (auto t = 0; t < kBlockTexels; ++t)
+                {
+                    auto x = std::min(4 * bx + t % 4, size.x - 1);
+                    auto y = std::min(4 * by + t / 4, size.y - 1);
+                    auto texel = texture.GetTexel(x, y);
+                    texels.values[t][0] = texel.x;
+                    texels.values[t][1] = texel.y;
+                    texels.values[t][2] = texel.z;
+                    texels.values[t][3] = texel.w;
+                }
+
+                auto block = reinterpret_cast<std::uint8_t*>(data + block_size * (by * num_blocks_x + bx));
+
+                switch (format)
+                {
+                case Texture::Format::kBc1:
+                    EncodeBc1(texels, block);
+                    break;
+                case Texture::Format::kBc4:
+                    EncodeBc4(texels, 0, block);
+                    break;
+                case Texture::Format::kBc5:
+                    EncodeBc4(texels, 0, block);
+                    EncodeBc4(texels, 1, block + 8);
+                    break;
+                case Texture::Format::kBc6h:
+                    EncodeBc6h(texels, block);
+                    break;
+                default:
+                    EncodeBc7(texels, block);
+                    break;
+                }
+            }
+        }
+
+        return Texture::Create(data, size, format);
+    }
+}
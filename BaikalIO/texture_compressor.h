@@ -0,0 +1,47 @@
+/**********************************************************************
+ Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ********************************************************************/
+
+/**
+ \file texture_compressor.h
+ \version 1.0
+ \brief Block compression of textures.
+ */
+#pragma once
+
+#include "image_io.h"
+
+namespace Baikal
+{
+    /**
+     \brief Compress texture into block compressed format.
+
+     Produces data which can be decoded by Utils/block_compression.h and texture kernels:
+        kBc1 - RGB, alpha is dropped
+        kBc4 - R channel
+        kBc5 - RG channels
+        kBc6h - unsigned HDR RGB (mode 11)
+        kBc7 - RGBA (mode 6)
+     Endpoints are chosen from the block bounding box, so quality is below the one of
+     dedicated offline compressors, but encoding is fast enough to run on load.
+     */
+    BAIKAL_API_ENTRY Texture::Ptr CompressTexture(Texture const& texture, Texture::Format format);
+}
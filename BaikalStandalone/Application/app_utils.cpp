@@ -26,7 +26,7 @@ THE SOFTWARE.
 namespace
 {
     char const* kHelpMessage =
-        "Baikal [-p path_to_models][-f model_name][-b][-r][-ns number_of_shadow_rays][-ao ao_radius][-w window_width][-h window_height][-nb number_of_indirect_bounces]";
+        "Baikal [-p path_to_models][-f model_name][-b][-r][-ns number_of_shadow_rays][-ao ao_radius][-w window_width][-h window_height][-nb number_of_indirect_bounces][-trace trace_file]";
 }
 
 namespace Baikal
@@ -102,6 +102,9 @@ namespace Baikal
         char* image_file_format = GetCmdOption(argv, argv + argc, "-iff");
         s.image_file_format = image_file_format ? image_file_format : s.image_file_format;
 
+        char* trace_file = GetCmdOption(argv, argv + argc, "-trace");
+        s.trace_file = trace_file ? trace_file : s.trace_file;
+
         char* camera_type = GetCmdOption(argv, argv + argc, "-ct");
 
         if (camera_type)
@@ -92,6 +92,9 @@ namespace Baikal
         std::string base_image_file_name;
         std::string image_file_format;
 
+        //profiling, kernel timings are written in Chrome trace format if set
+        std::string trace_file;
+
         //unused
         int num_shadow_rays;
         int samplecount;
@@ -149,6 +149,7 @@ namespace Baikal
         Baikal::DirectionalLight* directl = dynamic_cast<Baikal::DirectionalLight*>(l.get());
         Baikal::SpotLight* spotl = dynamic_cast<Baikal::SpotLight*>(l.get());
         Baikal::AreaLight* areal = dynamic_cast<Baikal::AreaLight*>(l.get());
+        Baikal::EmissiveMeshLight* meshl = dynamic_cast<Baikal::EmissiveMeshLight*>(l.get());
 
         tinyxml2::XMLDocument doc;
 
@@ -160,7 +161,7 @@ namespace Baikal
             doc.InsertFirstChild(root);
         }
 
-        if (areal)
+        if (areal || meshl)
         {
             //area lights are created when materials load, so ignore it;
             return;
@@ -697,6 +698,7 @@ namespace Baikal
                 }
 
                 m_cl->StopRenderThreads();
+                m_cl->SaveTrace(m_settings);
 
                 glfwDestroyWindow(m_window);
             }
@@ -717,6 +719,7 @@ namespace Baikal
             //compile scene
             m_cl->UpdateScene();
             m_cl->RunBenchmark(m_settings);
+            m_cl->SaveTrace(m_settings);
 
             auto minutes = (int)(m_settings.time_benchmark_time / 60.f);
             auto seconds = (int)(m_settings.time_benchmark_time - minutes * 60);
@@ -738,6 +741,9 @@ namespace Baikal
             std::cout << "\tPrimary: " << m_settings.stats.primary_throughput * 1e-6f << " Mrays/s\n";
             std::cout << "\tSecondary: " << m_settings.stats.secondary_throughput * 1e-6f << " Mrays/s\n";
             std::cout << "\tShadow: " << m_settings.stats.shadow_throughput * 1e-6f << " Mrays/s\n";
+            std::cout << "\tShading: " << m_settings.stats.shading_throughput * 1e-6f << " Mhits/s\n";
+            std::cout << "\tSecondary shading: " << m_settings.stats.secondary_shading_throughput * 1e-6f << " Mhits/s\n";
+            std::cout << "\tSecondary shading (sorted): " << m_settings.stats.sorted_secondary_shading_throughput * 1e-6f << " Mhits/s\n";
         }
     }
 
@@ -908,6 +914,9 @@ namespace Baikal
                 ImGui::Text("Primary rays: %f Mrays/s", stats.primary_throughput * 1e-6f);
                 ImGui::Text("Secondary rays: %f Mrays/s", stats.secondary_throughput * 1e-6f);
                 ImGui::Text("Shadow rays: %f Mrays/s", stats.shadow_throughput * 1e-6f);
+                ImGui::Text("Surface shading: %f Mhits/s", stats.shading_throughput * 1e-6f);
+                ImGui::Text("Secondary shading: %f Mhits/s", stats.secondary_shading_throughput * 1e-6f);
+                ImGui::Text("Secondary shading (sorted): %f Mhits/s", stats.sorted_secondary_shading_throughput * 1e-6f);
             }
 
 #ifdef ENABLE_DENOISER
@@ -33,6 +33,7 @@ THE SOFTWARE.
 
 #include "Renderers/monte_carlo_renderer.h"
 #include "Renderers/adaptive_renderer.h"
+#include "Controllers/clw_scene_controller.h"
 
 #include <fstream>
 #include <sstream>
@@ -84,6 +85,14 @@ namespace Baikal
 
         settings.interop = false;
 
+        if (!settings.trace_file.empty())
+        {
+            for (auto& cfg : m_cfgs)
+            {
+                static_cast<Baikal::ClwRenderFactory*>(cfg.factory.get())->GetProfiler().SetTimingEnabled(true);
+            }
+        }
+
         m_outputs.resize(m_cfgs.size());
         m_ctrl.reset(new ControlData[m_cfgs.size()]);
 
@@ -372,6 +381,9 @@ namespace Baikal
         auto& scene = m_cfgs[m_primary].controller->GetCachedScene(m_scene);
         m_cfgs[m_primary].renderer->Render(scene);
 
+        // Stream in texture tiles requested during the frame
+        static_cast<Baikal::ClwSceneController*>(m_cfgs[m_primary].controller.get())->UpdateTextureResidency(scene);
+
         if (m_shape_id_requested)
         {
             // offset in OpenCl memory till necessary item
@@ -546,6 +558,29 @@ namespace Baikal
         }
     }
 
+    void AppClRender::SaveTrace(AppSettings const& settings)
+    {
+        if (settings.trace_file.empty())
+        {
+            return;
+        }
+
+        auto& profiler = static_cast<Baikal::ClwRenderFactory*>(m_cfgs[m_primary].factory.get())->GetProfiler();
+        profiler.SaveChromeTrace(settings.trace_file);
+
+        std::cout << "Kernel timings:\n";
+        for (auto const& stats : profiler.GetKernelStatistics())
+        {
+            std::cout << "\t" << stats.name;
+            if (stats.bounce >= 0)
+            {
+                std::cout << " (bounce " << stats.bounce << ")";
+            }
+            std::cout << ": " << stats.total_time_ms / stats.num_launches << " ms avg, " << stats.num_launches << " launches\n";
+        }
+        std::cout << "Trace saved to " << settings.trace_file << "\n";
+    }
+
     void AppClRender::RunBenchmark(AppSettings& settings)
     {
         std::cout << "Running general benchmark...\n";
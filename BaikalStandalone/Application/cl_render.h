@@ -84,6 +84,9 @@ namespace Baikal
         void StopRenderThreads();
         void RunBenchmark(AppSettings& settings);
 
+        //save kernel timings of the primary device, if requested
+        void SaveTrace(AppSettings const& settings);
+
         //save cl frame buffer to file
         void SaveFrameBuffer(AppSettings& settings);
         void SaveImage(const std::string& name, int width, int height, const RadeonRays::float3* data);
@@ -55,7 +55,7 @@ public:
     struct Config
     {
         DeviceType type;
-        std::unique_ptr<Baikal::Renderer> renderer;
+        std::unique_ptr<Baikal::ClwRenderer> renderer;
         std::unique_ptr<Baikal::SceneController<Baikal::ClwScene>> controller;
         std::unique_ptr<Baikal::RenderFactory<Baikal::ClwScene>> factory;
         CLWContext context;
@@ -224,4 +224,116 @@ TEST_F(AovTest, Aov_Visibility)
     oss << test_name() << ".png";
     SaveOutput(oss.str(), output_ws.get());
     ASSERT_TRUE(CompareToReference(oss.str()));
-}
\ No newline at end of file
+}
+
+TEST_F(AovTest, Aov_Cache)
+{
+    auto& profiler = static_cast<Baikal::ClwRenderFactory*>(m_factory.get())->GetProfiler();
+    profiler.SetTimingEnabled(true);
+
+    auto num_aov_launches = [&profiler]()
+    {
+        auto stats = profiler.GetKernelStatistics();
+        std::uint32_t num_launches = 0;
+
+        for (auto const& s : stats)
+        {
+            if (s.name == "FillAOVsUberV2")
+            {
+                num_launches += s.num_launches;
+            }
+        }
+
+        return num_launches;
+    };
+
+    auto output_ws = m_factory->CreateOutput(
+        m_output->width(), m_output->height()
+    );
+
+    m_renderer->SetOutput(Baikal::Renderer::OutputType::kWorldPosition,
+        output_ws.get());
+
+    ClearOutput(output_ws.get());
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    auto& scene = m_controller->GetCachedScene(m_scene);
+
+    ASSERT_NO_THROW(m_renderer->Render(scene));
+    auto num_tile_launches = num_aov_launches();
+    ASSERT_GT(num_tile_launches, 0u);
+
+    // AOVs are filled once while nothing changes
+    for (auto i = 1u; i < kNumIterations; ++i)
+    {
+        ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+        ASSERT_NO_THROW(m_renderer->Render(scene));
+    }
+
+    ASSERT_EQ(num_aov_launches(), num_tile_launches);
+
+    // Camera change
+    m_camera->LookAt(
+        RadeonRays::float3(0.f, 0.f, -9.f),
+        RadeonRays::float3(0.f, 0.f, 0.f),
+        RadeonRays::float3(0.f, 1.f, 0.f));
+
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+    ASSERT_NO_THROW(m_renderer->Render(scene));
+    ASSERT_EQ(num_aov_launches(), 2 * num_tile_launches);
+
+    // Explicit invalidation
+    m_controller->InvalidateCachedScene(m_scene);
+    ASSERT_NO_THROW(m_renderer->Render(scene));
+    ASSERT_EQ(num_aov_launches(), 3 * num_tile_launches);
+
+    // Cleared AOV output
+    ClearOutput(output_ws.get());
+    ASSERT_NO_THROW(m_renderer->Render(scene));
+    ASSERT_EQ(num_aov_launches(), 4 * num_tile_launches);
+
+    // Camera change without clearing: AOV should contain the new view only
+    m_camera->LookAt(
+        RadeonRays::float3(2.f, 0.f, -6.f),
+        RadeonRays::float3(0.f, 0.f, 0.f),
+        RadeonRays::float3(0.f, 1.f, 0.f));
+
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    for (auto i = 0u; i < kNumIterations; ++i)
+    {
+        ASSERT_NO_THROW(m_renderer->Render(scene));
+    }
+
+    auto num_pixels = output_ws->width() * output_ws->height();
+    std::vector<RadeonRays::float3> cached(num_pixels);
+    output_ws->GetData(&cached[0]);
+
+    // Fresh AOV of the same view
+    auto output_ref = m_factory->CreateOutput(
+        m_output->width(), m_output->height()
+    );
+
+    m_renderer->SetOutput(Baikal::Renderer::OutputType::kWorldPosition,
+        output_ref.get());
+
+    ClearOutput(output_ref.get());
+    ASSERT_NO_THROW(m_renderer->Render(scene));
+
+    std::vector<RadeonRays::float3> reference(num_pixels);
+    output_ref->GetData(&reference[0]);
+
+    for (auto i = 0u; i < num_pixels; ++i)
+    {
+        ASSERT_EQ(cached[i].w, reference[i].w);
+
+        if (reference[i].w > 0.f)
+        {
+            auto cached_value = cached[i] * (1.f / cached[i].w);
+            auto reference_value = reference[i] * (1.f / reference[i].w);
+            ASSERT_NEAR(cached_value.x, reference_value.x, 1e-4f);
+            ASSERT_NEAR(cached_value.y, reference_value.y, 1e-4f);
+            ASSERT_NEAR(cached_value.z, reference_value.z, 1e-4f);
+        }
+    }
+}
@@ -27,15 +27,26 @@ THE SOFTWARE.
 #include "Renderers/renderer.h"
 #include "RenderFactory/clw_render_factory.h"
 #include "Output/output.h"
+#include "Output/clwoutput.h"
+#include "Renderers/monte_carlo_renderer.h"
+#include "Renderers/adaptive_renderer.h"
 #include "SceneGraph/camera.h"
+#include "Utils/block_compression.h"
+#include "Utils/clw_class.h"
 #include "scene_io.h"
+#include "texture_compressor.h"
 
 #include "OpenImageIO/imageio.h"
 
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <cstdlib>
+#include <fstream>
 #include <sstream>
 #include <iostream>
 
@@ -114,6 +125,7 @@ public:
         auto platform = platforms[platform_index];
         auto device = platform.GetDevice(device_index);
         auto context = CLWContext::Create(device);
+        m_context = context;
 
         ASSERT_NO_THROW(m_factory = std::make_unique<Baikal::ClwRenderFactory>(context, "cache"));
         ASSERT_NO_THROW(m_renderer = m_factory->CreateRenderer(Baikal::ClwRenderFactory::RendererType::kUnidirectionalPathTracer));
@@ -301,7 +313,8 @@ public:
         return std::find(begin, end, option) != end;
     }
 
-    std::unique_ptr<Baikal::Renderer> m_renderer;
+    CLWContext m_context;
+    std::unique_ptr<Baikal::ClwRenderer> m_renderer;
     std::unique_ptr<Baikal::SceneController<Baikal::ClwScene>> m_controller;
     std::unique_ptr<Baikal::RenderFactory<Baikal::ClwScene>> m_factory;
     std::unique_ptr<Baikal::Output> m_output;
@@ -339,6 +352,330 @@ TEST_F(BasicTest, RenderTestScene)
     ASSERT_TRUE(CompareToReference(test_name() + ".png"));
 }
 
+TEST_F(BasicTest, AsyncReadback)
+{
+    ClearOutput();
+
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    auto& scene = m_controller->GetCachedScene(m_scene);
+    auto output = static_cast<Baikal::ClwOutput*>(m_output.get());
+    auto convert_kernel = static_cast<Baikal::MonteCarloRenderer*>(m_renderer.get())->GetConvertKernel();
+
+    auto const num_pixels = kOutputWidth * kOutputHeight;
+    std::vector<RadeonRays::float3> data(num_pixels);
+
+    auto elapsed = [](std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000.f;
+    };
+
+    // Host time spent waiting for data when every frame is read back
+    float blocking_stall = 0.f;
+    for (auto i = 0u; i < kNumIterations; ++i)
+    {
+        ASSERT_NO_THROW(m_renderer->Render(scene));
+
+        auto start = std::chrono::high_resolution_clock::now();
+        output->GetData(&data[0]);
+        blocking_stall += elapsed(start);
+    }
+
+    // Readback of a frame is consumed after the next frame has been submitted
+    float async_stall = 0.f;
+    Baikal::ClwOutput::Readback previous;
+    for (auto i = 0u; i < kNumIterations; ++i)
+    {
+        ASSERT_NO_THROW(m_renderer->Render(scene));
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto readback = output->ReadDataAsync();
+
+        if (i > 0)
+        {
+            ASSERT_EQ(previous.GetSizeInBytes(), num_pixels * sizeof(RadeonRays::float3));
+            ASSERT_NE(previous.GetData(), nullptr);
+        }
+
+        previous = readback;
+        async_stall += elapsed(start);
+    }
+
+    RecordProperty("blocking_stall_ms", std::to_string(blocking_stall / kNumIterations));
+    RecordProperty("async_stall_ms", std::to_string(async_stall / kNumIterations));
+
+    // Both paths return the same data
+    output->GetData(&data[0]);
+    auto float4_data = static_cast<RadeonRays::float3 const*>(output->ReadDataAsync().GetData());
+    ASSERT_EQ(std::memcmp(float4_data, &data[0], num_pixels * sizeof(RadeonRays::float3)), 0);
+
+    // Device side RGBA8 conversion matches host one
+    auto rgba8 = output->ReadDataAsync(Baikal::ClwOutput::ReadbackFormat::kRgba8, convert_kernel);
+    ASSERT_EQ(rgba8.GetSizeInBytes(), num_pixels * 4u);
+
+    auto rgba8_data = static_cast<std::uint8_t const*>(rgba8.GetData());
+    for (auto i = 0u; i < num_pixels; ++i)
+    {
+        auto val = data[i] * (1.f / data[i].w);
+        float const rgb[] = { val.x, val.y, val.z };
+
+        for (auto c = 0; c < 3; ++c)
+        {
+            auto expected = std::min(std::max(std::pow(std::max(rgb[c], 0.f), 1.f / 2.2f), 0.f), 1.f) * 255.f;
+            ASSERT_NEAR(rgba8_data[4 * i + c], expected, 1.5f);
+        }
+
+        ASSERT_EQ(rgba8_data[4 * i + 3], 255);
+    }
+}
+
+TEST_F(BasicTest, KernelWarmup)
+{
+    auto& program_manager = static_cast<Baikal::ClwRenderFactory*>(m_factory.get())->GetProgramManager();
+
+    // Renderer, estimator and their kernel variants are registered on creation
+    auto variants = program_manager.GetProgramVariants();
+    ASSERT_GT(variants.size(), 0u);
+
+    ASSERT_NO_THROW(program_manager.CompileProgramsAsync(variants));
+
+    ClearOutput();
+
+    // Rendering waits only for variants it needs
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    auto& scene = m_controller->GetCachedScene(m_scene);
+
+    for (auto i = 0u; i < kNumIterations; ++i)
+    {
+        ASSERT_NO_THROW(m_renderer->Render(scene));
+    }
+
+    program_manager.WaitForWarmup();
+
+    auto status = program_manager.GetWarmupStatus();
+    ASSERT_TRUE(status.done);
+    ASSERT_EQ(status.num_variants, static_cast<std::uint32_t>(variants.size()));
+    ASSERT_EQ(status.num_ready, status.num_variants);
+
+    SaveOutput(test_name() + ".png");
+    ASSERT_TRUE(CompareToReference(test_name() + ".png"));
+}
+
+TEST_F(BasicTest, Profiler)
+{
+    auto& profiler = static_cast<Baikal::ClwRenderFactory*>(m_factory.get())->GetProfiler();
+    profiler.SetTimingEnabled(true);
+
+    ClearOutput();
+
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    auto& scene = m_controller->GetCachedScene(m_scene);
+
+    for (auto i = 0u; i < kNumIterations; ++i)
+    {
+        ASSERT_NO_THROW(m_renderer->Render(scene));
+    }
+
+    // Scene, estimator and output buffers are accounted
+    auto memory = profiler.GetMemoryStatistics();
+    ASSERT_GT(memory.category_bytes[static_cast<std::size_t>(Baikal::ClwProfiler::MemoryCategory::kGeometry)], 0u);
+    ASSERT_GT(memory.category_bytes[static_cast<std::size_t>(Baikal::ClwProfiler::MemoryCategory::kWorkBuffers)], 0u);
+    ASSERT_GE(memory.category_bytes[static_cast<std::size_t>(Baikal::ClwProfiler::MemoryCategory::kOutputs)],
+        kOutputWidth * kOutputHeight * sizeof(RadeonRays::float3));
+    ASSERT_GE(memory.peak_bytes, memory.total_bytes);
+
+    // Shading is timed for every bounce
+    auto stats = profiler.GetKernelStatistics();
+    for (auto bounce = 0; bounce < 5; ++bounce)
+    {
+        auto iter = std::find_if(stats.cbegin(), stats.cend(), [bounce](Baikal::ClwProfiler::KernelStatistics const& s)
+        {
+            return s.name == "ShadeSurfaceUberV2" && s.bounce == bounce;
+        });
+
+        ASSERT_NE(iter, stats.cend());
+        ASSERT_EQ(iter->num_launches, static_cast<std::uint32_t>(kNumIterations));
+        ASSERT_GT(iter->total_time_ms, 0.0);
+    }
+
+    std::ostringstream trace;
+    ASSERT_NO_THROW(profiler.WriteChromeTrace(trace));
+    ASSERT_EQ(trace.str().find("{\"traceEvents\":["), 0u);
+    ASSERT_NE(trace.str().find("\"name\":\"ShadeSurfaceUberV2\""), std::string::npos);
+
+    // Destroyed output releases its memory
+    auto output_bytes = memory.category_bytes[static_cast<std::size_t>(Baikal::ClwProfiler::MemoryCategory::kOutputs)];
+    auto output = m_factory->CreateOutput(kOutputWidth, kOutputHeight);
+    ASSERT_GT(profiler.GetMemoryStatistics().total_bytes, memory.total_bytes);
+    output.reset();
+    ASSERT_EQ(profiler.GetMemoryStatistics().category_bytes[static_cast<std::size_t>(Baikal::ClwProfiler::MemoryCategory::kOutputs)], output_bytes);
+}
+
+
+
+
+
+TEST_F(BasicTest, Texture_BlockCompressionGpuDecode)
+{
+    using namespace Baikal;
+
+    // Kernel decoding every texel of a compressed texture with the sampling code path
+    std::string const kernel_file = "BlockCompressionTest.cl";
+    {
+        std::ofstream out(kernel_file);
+        out <<
+            "#include <../Baikal/Kernels/CL/texture_bc.cl>\n"
+            "__kernel void DecodeBlockCompressed(__global char const* data, int width, int height, int fmt, __global float4* texels)\n"
+            "{\n"
+            "    int id = get_global_id(0);\n"
+            "    if (id < width * height)\n"
+            "    {\n"
+            "        texels[id] = Texture_LoadCompressedTexel(data, width, id % width, id / width, fmt);\n"
+            "    }\n"
+            "}\n";
+    }
+
+    auto& program_manager = static_cast<ClwRenderFactory*>(m_factory.get())->GetProgramManager();
+    ClwClass decoder(m_context, &program_manager, kernel_file);
+    CLWKernel kernel;
+    ASSERT_NO_THROW(kernel = decoder.GetKernel("DecodeBlockCompressed"));
+    std::remove(kernel_file.c_str());
 
+    // Size is not a multiple of the block size, so partial blocks are checked as well
+    int const width = 38;
+    int const height = 22;
+    auto data = new char[width * height * 4 * sizeof(float)];
+    auto values = reinterpret_cast<float*>(data);
+
+    for (auto i = 0; i < width * height; ++i)
+    {
+        auto x = i % width;
+        auto y = i / width;
+        values[4 * i] = 4.f * x / width;
+        values[4 * i + 1] = 4.f * y / height;
+        values[4 * i + 2] = static_cast<float>((i * 7919) % 256) / 64.f;
+        values[4 * i + 3] = 1.f - static_cast<float>(x) / width;
+    }
+
+    auto texture = Texture::Create(data, RadeonRays::int3(width, height, 1), Texture::Format::kRgba32);
+
+    std::pair<Texture::Format, ClwScene::TextureFormat> const formats[] =
+    {
+        { Texture::Format::kBc1, ClwScene::TextureFormat::BC1 },
+        { Texture::Format::kBc4, ClwScene::TextureFormat::BC4 },
+        { Texture::Format::kBc5, ClwScene::TextureFormat::BC5 },
+        { Texture::Format::kBc6h, ClwScene::TextureFormat::BC6H },
+        { Texture::Format::kBc7, ClwScene::TextureFormat::BC7 }
+    };
 
+    std::vector<std::pair<Texture::Ptr, ClwScene::TextureFormat>> textures;
 
+    for (auto const& format : formats)
+    {
+        textures.emplace_back(CompressTexture(*texture, format.first), format.second);
+    }
+
+    // Compressor uses only some of BC6H and BC7 modes, pseudo random blocks cover all of them
+    std::uint8_t const bc6h_modes[14] = { 0x00, 0x01, 0x02, 0x06, 0x0A, 0x0E, 0x12, 0x16, 0x1A, 0x1E, 0x03, 0x07, 0x0B, 0x0F };
+    auto const num_blocks = ((width + 3) / 4) * ((height + 3) / 4);
+    auto bc6h_data = new char[16 * num_blocks];
+    auto bc7_data = new char[16 * num_blocks];
+    std::uint32_t seed = 1;
+
+    for (auto i = 0; i < 16 * num_blocks; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        bc6h_data[i] = static_cast<char>(seed >> 24);
+        bc7_data[i] = static_cast<char>(seed >> 16);
+    }
+
+    for (auto i = 0; i < num_blocks; ++i)
+    {
+        auto mode_bits = i % 14 < 2 ? 2 : 5;
+        bc6h_data[16 * i] = static_cast<char>((bc6h_data[16 * i] & ~((1 << mode_bits) - 1)) | bc6h_modes[i % 14]);
+        bc7_data[16 * i] = static_cast<char>(((bc7_data[16 * i] >> (i % 8)) << (i % 8)) | (1 << (i % 8)));
+    }
+
+    textures.emplace_back(Texture::Create(bc6h_data, RadeonRays::int3(width, height, 1), Texture::Format::kBc6h), ClwScene::TextureFormat::BC6H);
+    textures.emplace_back(Texture::Create(bc7_data, RadeonRays::int3(width, height, 1), Texture::Format::kBc7), ClwScene::TextureFormat::BC7);
+
+    for (auto const& format : textures)
+    {
+        auto const& compressed = format.first;
+
+        auto blocks = m_context.CreateBuffer<char>(compressed->GetSizeInBytes(), CL_MEM_READ_ONLY);
+        auto texels = m_context.CreateBuffer<RadeonRays::float4>(width * height, CL_MEM_WRITE_ONLY);
+        m_context.WriteBuffer(0, blocks, compressed->GetData(), compressed->GetSizeInBytes()).Wait();
+
+        int argc = 0;
+        kernel.SetArg(argc++, blocks);
+        kernel.SetArg(argc++, width);
+        kernel.SetArg(argc++, height);
+        kernel.SetArg(argc++, static_cast<int>(format.second));
+        kernel.SetArg(argc++, texels);
+
+        m_context.Launch1D(0, ((width * height + 63) / 64) * 64, 64, kernel);
+
+        std::vector<RadeonRays::float4> gpu_texels(width * height);
+        m_context.ReadBuffer(0, texels, gpu_texels.data(), gpu_texels.size()).Wait();
+
+        // Integer math matches exactly, only the final float conversion may differ in the last bits
+        for (auto i = 0; i < width * height; ++i)
+        {
+            auto expected = compressed->GetTexel(i % width, i / width);
+            float const e[] = { expected.x, expected.y, expected.z, expected.w };
+            float const g[] = { gpu_texels[i].x, gpu_texels[i].y, gpu_texels[i].z, gpu_texels[i].w };
+
+            for (auto c = 0; c < 4; ++c)
+            {
+                ASSERT_NEAR(g[c], e[c], 1e-5f * (1.f + std::fabs(e[c])));
+            }
+        }
+    }
+}
+
+TEST_F(BasicTest, AdaptiveSampling_Convergence)
+{
+    std::unique_ptr<Baikal::ClwRenderer> renderer;
+    ASSERT_NO_THROW(renderer = m_factory->CreateRenderer(Baikal::ClwRenderFactory::RendererType::kAdaptivePathTracer));
+
+    auto adaptive_renderer = static_cast<Baikal::AdaptiveRenderer*>(renderer.get());
+    adaptive_renderer->SetTargetError(0.1f);
+
+    ASSERT_NO_THROW(renderer->SetOutput(Baikal::Renderer::OutputType::kColor, m_output.get()));
+    ASSERT_NO_THROW(renderer->SetRandomSeed(0));
+    ASSERT_NO_THROW(renderer->Clear(RadeonRays::float3(), *m_output));
+
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    auto& scene = m_controller->GetCachedScene(m_scene);
+
+    auto const kMaxIterations = 4096u;
+    auto num_iterations = 0u;
+    for (; num_iterations < kMaxIterations && !adaptive_renderer->IsConverged(); ++num_iterations)
+    {
+        ASSERT_NO_THROW(renderer->Render(scene));
+    }
+
+    RecordProperty("num_iterations", static_cast<int>(num_iterations));
+    ASSERT_TRUE(adaptive_renderer->IsConverged());
+
+    // Converged renderer does not add samples anymore
+    auto const num_pixels = kOutputWidth * kOutputHeight;
+    std::vector<RadeonRays::float3> data(num_pixels);
+    std::vector<RadeonRays::float3> converged_data(num_pixels);
+    m_output->GetData(&data[0]);
+    ASSERT_NO_THROW(renderer->Render(scene));
+    m_output->GetData(&converged_data[0]);
+    ASSERT_EQ(std::memcmp(&data[0], &converged_data[0], num_pixels * sizeof(RadeonRays::float3)), 0);
+
+    // Samples are distributed unevenly and every pixel got at least the uniform ones
+    auto min_max = std::minmax_element(data.begin(), data.end(),
+        [](RadeonRays::float3 const& a, RadeonRays::float3 const& b) { return a.w < b.w; });
+    ASSERT_GE(min_max.first->w, 32.f);
+    ASSERT_LT(min_max.first->w, min_max.second->w);
+
+    SaveOutput(test_name() + ".png");
+}
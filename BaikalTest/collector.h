@@ -0,0 +1,168 @@
+/**********************************************************************
+Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "RenderFactory/cpu_render_factory.h"
+#include "SceneGraph/Collector/collector.h"
+#include "SceneGraph/iterator.h"
+#include "SceneGraph/scene1.h"
+#include "SceneGraph/shape.h"
+#include "SceneGraph/light.h"
+#include "SceneGraph/camera.h"
+#include "SceneGraph/uberv2material.h"
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <string>
+
+namespace
+{
+    // Number of objects for micro benchmarks
+    std::uint32_t const kNumCollectorObjects = 100000;
+
+    float ElapsedMs(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start).count() / 1000.f;
+    }
+}
+
+// Item indices have to depend on object IDs only, not on collection order
+TEST(CollectorTest, Collector_DeterministicOrder)
+{
+    std::vector<Baikal::SceneObject::Ptr> materials;
+    for (auto i = 0u; i < 1000; ++i)
+    {
+        materials.push_back(Baikal::UberV2Material::Create());
+    }
+
+    Baikal::Collector forward;
+    Baikal::Collector backward;
+
+    {
+        Baikal::IteratorImpl<std::vector<Baikal::SceneObject::Ptr>::const_iterator> iter(materials.cbegin(), materials.cend());
+        forward.CollectInto(iter, [](Baikal::SceneObject::Ptr item, Baikal::Collector& collector)
+        {
+            // Duplicates are collected once
+            collector.Collect(item);
+            collector.Collect(item);
+        });
+    }
+
+    for (auto i = materials.crbegin(); i != materials.crend(); ++i)
+    {
+        backward.Collect(*i);
+    }
+
+    // Indices are not known before commit
+    ASSERT_THROW(backward.GetItemIndex(materials[0]), std::runtime_error);
+
+    forward.Commit();
+    backward.Commit();
+
+    ASSERT_EQ(materials.size(), forward.GetNumItems());
+    ASSERT_EQ(materials.size(), backward.GetNumItems());
+
+    for (auto i = 0u; i < materials.size(); ++i)
+    {
+        // Materials are created in ID order
+        ASSERT_EQ(i, forward.GetItemIndex(materials[i]));
+        ASSERT_EQ(i, backward.GetItemIndex(materials[i]));
+    }
+
+    std::unique_ptr<Baikal::Bundle> bundle(forward.CreateBundle());
+    for (auto& material : materials)
+    {
+        material->SetDirty(false);
+    }
+
+    ASSERT_FALSE(backward.NeedsUpdate(bundle.get()));
+    materials[materials.size() / 2]->SetDirty(true);
+    ASSERT_TRUE(backward.NeedsUpdate(bundle.get()));
+
+    ASSERT_THROW(forward.GetItemIndex(Baikal::UberV2Material::Create()), std::runtime_error);
+}
+
+// Measure CompileScene cost for a scene with many objects
+TEST(CollectorTest, Collector_CompileSceneBenchmark)
+{
+    auto scene = Baikal::Scene1::Create();
+
+    RadeonRays::float3 vertices[] = {
+        RadeonRays::float3(0.f, 0.f, 0.f),
+        RadeonRays::float3(1.f, 0.f, 0.f),
+        RadeonRays::float3(0.f, 1.f, 0.f)
+    };
+    std::uint32_t indices[] = { 0, 1, 2 };
+
+    Baikal::Material::Ptr first_material;
+    for (auto i = 0u; i < kNumCollectorObjects; ++i)
+    {
+        auto mesh = Baikal::Mesh::Create();
+        mesh->SetVertices(vertices, 3);
+        mesh->SetIndices(indices, 3);
+        mesh->SetMaterial(Baikal::UberV2Material::Create());
+        scene->AttachShape(mesh);
+
+        if (!first_material)
+        {
+            first_material = mesh->GetMaterial();
+        }
+    }
+
+    scene->AttachLight(Baikal::PointLight::Create());
+    scene->SetCamera(Baikal::PerspectiveCamera::Create(
+        RadeonRays::float3(0.f, 0.f, -6.f),
+        RadeonRays::float3(0.f, 0.f, 0.f),
+        RadeonRays::float3(0.f, 1.f, 0.f)));
+
+    Baikal::CpuRenderFactory factory;
+    auto controller = factory.CreateSceneController();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    ASSERT_NO_THROW(controller->CompileScene(scene));
+    auto full_compile = ElapsedMs(start);
+
+    // Nothing has changed
+    start = std::chrono::high_resolution_clock::now();
+    ASSERT_NO_THROW(controller->CompileScene(scene));
+    auto cached_compile = ElapsedMs(start);
+
+    // Single material change walks the scene graph and all collectors again
+    first_material->SetDirty(true);
+    start = std::chrono::high_resolution_clock::now();
+    ASSERT_NO_THROW(controller->CompileScene(scene));
+    auto material_compile = ElapsedMs(start);
+
+    RecordProperty("full_compile_ms", std::to_string(full_compile));
+    RecordProperty("unchanged_compile_ms", std::to_string(cached_compile));
+    RecordProperty("material_change_compile_ms", std::to_string(material_compile));
+
+    auto const& compiled = controller->GetCachedScene(scene);
+    ASSERT_EQ(kNumCollectorObjects, compiled.triangle_materials.size());
+    // Shapes are created in the same order as their materials
+    ASSERT_EQ(0, compiled.triangle_materials.front());
+    ASSERT_EQ(static_cast<int>(kNumCollectorObjects) - 1, compiled.triangle_materials.back());
+}
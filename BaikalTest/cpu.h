@@ -0,0 +1,225 @@
+/**********************************************************************
+Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "CLW.h"
+#include "RenderFactory/cpu_render_factory.h"
+#include "RenderFactory/clw_render_factory.h"
+#include "Renderers/cpu_renderer.h"
+#include "Output/cpuoutput.h"
+#include "SceneGraph/camera.h"
+#include "scene_io.h"
+
+#include "OpenImageIO/imageio.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+class CpuTest : public ::testing::Test
+{
+public:
+    static std::uint32_t constexpr kOutputWidth = 128;
+    static std::uint32_t constexpr kOutputHeight = 128;
+    static std::uint32_t constexpr kNumIterations = 8;
+
+    virtual void SetUp()
+    {
+        ASSERT_NO_THROW(m_scene = Baikal::SceneIo::LoadScene("sphere+ibl.test", ""));
+
+        auto camera = Baikal::PerspectiveCamera::Create(
+            RadeonRays::float3(0.f, 0.f, -6.f),
+            RadeonRays::float3(0.f, 0.f, 0.f),
+            RadeonRays::float3(0.f, 1.f, 0.f));
+
+        camera->SetSensorSize(RadeonRays::float2(0.036f, 0.036f));
+        camera->SetDepthRange(RadeonRays::float2(0.0f, 100000.f));
+        camera->SetFocalLength(0.035f);
+        camera->SetFocusDistance(1.f);
+        camera->SetAperture(0.f);
+
+        m_scene->SetCamera(camera);
+    }
+
+    // Render kNumIterations frames using given number of threads
+    std::vector<RadeonRays::float3> Render(std::uint32_t num_threads)
+    {
+        Baikal::CpuRenderFactory factory(num_threads);
+        return Render(factory, kNumIterations);
+    }
+
+    // Render given number of frames with renderer entities created by factory
+    template <typename Factory>
+    std::vector<RadeonRays::float3> Render(Factory const& factory, std::uint32_t num_iterations)
+    {
+        auto renderer = factory.CreateRenderer(Factory::RendererType::kUnidirectionalPathTracer);
+        auto controller = factory.CreateSceneController();
+        auto output = factory.CreateOutput(kOutputWidth, kOutputHeight);
+
+        renderer->SetOutput(Baikal::Renderer::OutputType::kColor, output.get());
+        renderer->SetRandomSeed(0);
+        renderer->Clear(RadeonRays::float3(), *output);
+
+        controller->CompileScene(m_scene);
+        auto& scene = controller->GetCachedScene(m_scene);
+
+        for (auto i = 0u; i < num_iterations; ++i)
+        {
+            renderer->Render(scene);
+        }
+
+        std::vector<RadeonRays::float3> data(kOutputWidth * kOutputHeight);
+        output->GetData(&data[0]);
+        return data;
+    }
+
+    // Create context on the first GPU device or on the first device if there is no GPU
+    static CLWContext CreateClwContext()
+    {
+        std::vector<CLWPlatform> platforms;
+        CLWPlatform::CreateAllPlatforms(platforms);
+
+        if (platforms.empty())
+        {
+            throw std::runtime_error("No OpenCL platforms found");
+        }
+
+        for (auto& platform : platforms)
+        {
+            for (auto i = 0u; i < platform.GetDeviceCount(); ++i)
+            {
+                if (platform.GetDevice(i).GetType() == CL_DEVICE_TYPE_GPU)
+                {
+                    return CLWContext::Create(platform.GetDevice(i));
+                }
+            }
+        }
+
+        return CLWContext::Create(platforms[0].GetDevice(0));
+    }
+
+    // Average radiance of the image
+    static RadeonRays::float3 ComputeMeanRadiance(std::vector<RadeonRays::float3> const& data)
+    {
+        RadeonRays::float3 mean;
+
+        for (auto const& v : data)
+        {
+            mean += v * (1.f / v.w);
+        }
+
+        return mean * (1.f / data.size());
+    }
+
+    void SaveOutput(std::string const& file_name, std::vector<RadeonRays::float3> const& data) const
+    {
+        OIIO_NAMESPACE_USING;
+        using namespace RadeonRays;
+
+        std::string path = "OutputImages/";
+        path.append(file_name);
+
+        std::vector<float3> data1(kOutputWidth * kOutputHeight);
+
+        for (auto y = 0u; y < kOutputHeight; ++y)
+            for (auto x = 0u; x < kOutputWidth; ++x)
+            {
+                float3 val = data[(kOutputHeight - 1 - y) * kOutputWidth + x];
+                val *= (1.f / val.w);
+                data1[y * kOutputWidth + x].x = std::pow(val.x, 1.f / 2.2f);
+                data1[y * kOutputWidth + x].y = std::pow(val.y, 1.f / 2.2f);
+                data1[y * kOutputWidth + x].z = std::pow(val.z, 1.f / 2.2f);
+            }
+
+        ImageOutput* out = ImageOutput::create(path);
+
+        if (!out)
+        {
+            throw std::runtime_error("Can't create image file on disk");
+        }
+
+        ImageSpec spec(kOutputWidth, kOutputHeight, 3, TypeDesc::FLOAT);
+
+        out->open(path, spec);
+        out->write_image(TypeDesc::FLOAT, &data1[0], sizeof(float3));
+        out->close();
+
+        delete out;
+    }
+
+    std::string test_name() const
+    {
+        return ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    }
+
+    Baikal::Scene1::Ptr m_scene;
+};
+
+// Renders with the same seed have to match regardless of the number of threads
+TEST_F(CpuTest, CpuRenderer_Deterministic)
+{
+    std::vector<RadeonRays::float3> single_threaded;
+    std::vector<RadeonRays::float3> multi_threaded;
+
+    ASSERT_NO_THROW(single_threaded = Render(1));
+    ASSERT_NO_THROW(multi_threaded = Render(4));
+
+    ASSERT_EQ(0, std::memcmp(single_threaded.data(), multi_threaded.data(),
+        single_threaded.size() * sizeof(RadeonRays::float3)));
+
+    auto num_lit = std::count_if(single_threaded.cbegin(), single_threaded.cend(),
+        [](RadeonRays::float3 const& v) { return v.x + v.y + v.z > 0.f; });
+    ASSERT_GT(num_lit, 0);
+    ASSERT_FLOAT_EQ(single_threaded[0].w, static_cast<float>(kNumIterations));
+
+    ASSERT_NO_THROW(SaveOutput(test_name() + ".png", single_threaded));
+}
+
+// CPU and OpenCL path tracers have to converge to the same image
+TEST_F(CpuTest, CpuRenderer_MatchesClw)
+{
+    std::uint32_t const num_iterations = 64;
+
+    std::vector<RadeonRays::float3> cpu_data;
+    std::vector<RadeonRays::float3> clw_data;
+
+    ASSERT_NO_THROW(cpu_data = Render(Baikal::CpuRenderFactory(), num_iterations));
+
+    CLWContext context;
+    ASSERT_NO_THROW(context = CreateClwContext());
+    ASSERT_NO_THROW(clw_data = Render(Baikal::ClwRenderFactory(context, "cache"), num_iterations));
+
+    auto cpu_mean = ComputeMeanRadiance(cpu_data);
+    auto clw_mean = ComputeMeanRadiance(clw_data);
+
+    ASSERT_GT(cpu_mean.x + cpu_mean.y + cpu_mean.z, 0.f);
+
+    // Renderers use different random sequences, so only the noise level is allowed to differ
+    float const tolerance = 0.03f;
+    ASSERT_NEAR(cpu_mean.x, clw_mean.x, tolerance * clw_mean.x);
+    ASSERT_NEAR(cpu_mean.y, clw_mean.y, tolerance * clw_mean.y);
+    ASSERT_NEAR(cpu_mean.z, clw_mean.z, tolerance * clw_mean.z);
+}
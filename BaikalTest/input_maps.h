@@ -25,6 +25,7 @@
 #include "SceneGraph/light.h"
 #include "SceneGraph/shape.h"
 #include "SceneGraph/material.h"
+#include "Controllers/clw_scene_controller.h"
 #include "image_io.h"
 #include "SceneGraph/uberv2material.h"
 #include "SceneGraph/inputmaps.h"
@@ -629,3 +630,108 @@ TEST_F(InputMapsTest, InputMap_Normal)
 
     RunAndSave(material, "quad");
 }
+
+TEST_F(InputMapsTest, InputMap_Bytecode)
+{
+    auto controller = dynamic_cast<Baikal::ClwSceneController*>(m_controller.get());
+    ASSERT_NE(controller, nullptr);
+    controller->SetInputMapMode(Baikal::ClwSceneController::InputMapMode::kBytecode);
+
+    auto material = Baikal::UberV2Material::Create();
+    material->SetLayers(Baikal::UberV2Material::Layers::kDiffuseLayer);
+
+    auto color1 = Baikal::InputMap_ConstantFloat3::Create(float3(1.0f, 0.0f, 0.0f));
+    auto color2 = Baikal::InputMap_ConstantFloat3::Create(float3(0.0f, 1.0f, 0.0f));
+    RadeonRays::matrix mat(
+        0.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 0.0f,
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 0.0f
+    );
+
+    // Graphs are replaced between renders without kernel recompilation
+    std::vector<std::pair<std::string, Baikal::InputMap::Ptr>> graphs =
+    {
+        { "add", Baikal::InputMap_Add::Create(color1, color2) },
+        { "lerp", Baikal::InputMap_Lerp::Create(color1, color2, Baikal::InputMap_ConstantFloat::Create(0.25f)) },
+        { "shuffle", Baikal::InputMap_Shuffle::Create(color1, { 1, 0, 2, 3 }) },
+        { "matmul", Baikal::InputMap_MatMul::Create(color1, mat) },
+        { "select", Baikal::InputMap_Select::Create(
+            Baikal::InputMap_Mul::Create(color1, Baikal::InputMap_ConstantFloat::Create(0.5f)),
+            Baikal::InputMap_Select::Selection::kX) }
+    };
+
+    auto& program_manager = static_cast<Baikal::ClwRenderFactory*>(m_factory.get())->GetProgramManager();
+
+    // Albedo is filled at pixel centers, so both modes have to produce the same values
+    auto albedo = m_factory->CreateOutput(m_output->width(), m_output->height());
+    m_renderer->SetOutput(Baikal::Renderer::OutputType::kAlbedo, albedo.get());
+
+    auto render = [&](Baikal::InputMap::Ptr graph)
+    {
+        material->SetInputValue("uberv2.diffuse.color", graph);
+        ClearOutput(albedo.get());
+
+        ApplyMaterialToObject("sphere", material);
+
+        ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+        auto& scene = m_controller->GetCachedScene(m_scene);
+
+        for (auto i = 0u; i < kNumIterations; ++i)
+        {
+            ASSERT_NO_THROW(m_renderer->Render(scene));
+        }
+    };
+
+    std::vector<std::vector<RadeonRays::float3>> bytecode_albedo;
+    std::uint32_t num_compiled = 0;
+
+    for (auto& graph : graphs)
+    {
+        ASSERT_NO_FATAL_FAILURE(render(graph.second));
+
+        // Only the first graph may compile kernels
+        if (&graph == &graphs.front())
+        {
+            num_compiled = program_manager.GetCacheStats().num_compiled;
+        }
+
+        ASSERT_EQ(program_manager.GetCacheStats().num_compiled, num_compiled);
+
+        {
+            std::ostringstream oss;
+            oss << test_name() << "_" << graph.first << ".png";
+            SaveOutput(oss.str());
+            ASSERT_TRUE(CompareToReference(oss.str()));
+        }
+
+        bytecode_albedo.emplace_back(albedo->width() * albedo->height());
+        albedo->GetData(&bytecode_albedo.back()[0]);
+    }
+
+    // Same graphs compiled into kernel code
+    controller->SetInputMapMode(Baikal::ClwSceneController::InputMapMode::kGenerated);
+
+    for (auto i = 0u; i < graphs.size(); ++i)
+    {
+        ASSERT_NO_FATAL_FAILURE(render(graphs[i].second));
+
+        std::vector<RadeonRays::float3> generated_albedo(albedo->width() * albedo->height());
+        albedo->GetData(&generated_albedo[0]);
+
+        for (auto j = 0u; j < generated_albedo.size(); ++j)
+        {
+            auto const& expected = generated_albedo[j];
+            auto const& actual = bytecode_albedo[i][j];
+            ASSERT_EQ(actual.w, expected.w);
+
+            if (expected.w > 0.f)
+            {
+                ASSERT_NEAR(actual.x / actual.w, expected.x / expected.w, 1e-4f) << graphs[i].first;
+                ASSERT_NEAR(actual.y / actual.w, expected.y / expected.w, 1e-4f) << graphs[i].first;
+                ASSERT_NEAR(actual.z / actual.w, expected.z / expected.w, 1e-4f) << graphs[i].first;
+            }
+        }
+    }
+}
@@ -22,8 +22,33 @@ THE SOFTWARE.
 #include "gtest/gtest.h"
 
 #include "Utils/distribution1d.h"
+#include "Utils/light_tree.h"
+#include "Utils/cl_uberv2_generator.h"
+#include "Utils/program_cache.h"
+#include "Controllers/scene_controller.h"
+#include "SceneGraph/uberv2material.h"
+#include "SceneGraph/texture.h"
+#include "Utils/block_compression.h"
+#include "Utils/half.h"
+#include "texture_compressor.h"
+#include "obj_parser.h"
+#include "scene_io.h"
+#include "SceneGraph/scene1.h"
+#include "SceneGraph/iterator.h"
+#include "SceneGraph/inputmaps.h"
+#include "SceneGraph/light.h"
+#include "SceneGraph/camera.h"
 #include "math/mathutils.h"
 
+// Reference OBJ loader for parser tests, compiled into this translation unit only
+#include "Utils/tiny_obj_loader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+
 class InternalTest : public ::testing::Test
 {
 
@@ -47,3 +72,1184 @@ TEST_F(InternalTest, Distribuiton1D)
 
     cnts[0] += cnts[1];
 }
+
+TEST_F(InternalTest, Distribution2D)
+{
+    // Dim environment with a small bright "sun"
+    std::uint32_t const num_u = 64;
+    std::uint32_t const num_v = 32;
+
+    std::vector<float> vals(num_u * num_v, 1.f);
+    vals[8 * num_u + 40] = vals[8 * num_u + 41] = 5000.f;
+
+    Baikal::Distribution2D dist(vals.data(), num_u, num_v);
+
+    // Sampled PDF should match evaluated one and integrate to 1
+    float integral = 0.f;
+    for (auto i = 0u; i < num_u * num_v; ++i)
+    {
+        integral += dist.pdf((i % num_u + 0.5f) / num_u, (i / num_u + 0.5f) / num_v) / (num_u * num_v);
+    }
+
+    ASSERT_NEAR(integral, 1.f, 1e-3f);
+
+    for (auto i = 0u; i < 1000; ++i)
+    {
+        float u, v, pdf;
+        dist.Sample2D(RadeonRays::rand_float(), RadeonRays::rand_float(), u, v, pdf);
+
+        ASSERT_GE(u, 0.f);
+        ASSERT_LE(u, 1.f);
+        ASSERT_GE(v, 0.f);
+        ASSERT_LE(v, 1.f);
+        ASSERT_NEAR(pdf, dist.pdf(u, v), 1e-3f * pdf);
+    }
+
+    // Monte Carlo estimate of the function integral with uniform and importance sampling
+    float reference = 0.f;
+    for (auto v : vals)
+    {
+        reference += v / vals.size();
+    }
+
+    auto f = [&](float u, float v)
+    {
+        auto x = std::min((std::uint32_t)(u * num_u), num_u - 1);
+        auto y = std::min((std::uint32_t)(v * num_v), num_v - 1);
+        return vals[y * num_u + x];
+    };
+
+    int const num_trials = 100;
+    int const num_samples = 64;
+    float uniform_error = 0.f;
+    float importance_error = 0.f;
+
+    for (auto t = 0; t < num_trials; ++t)
+    {
+        float uniform = 0.f;
+        float importance = 0.f;
+
+        for (auto i = 0; i < num_samples; ++i)
+        {
+            uniform += f(RadeonRays::rand_float(), RadeonRays::rand_float()) / num_samples;
+
+            float u, v, pdf;
+            dist.Sample2D(RadeonRays::rand_float(), RadeonRays::rand_float(), u, v, pdf);
+            importance += f(u, v) / pdf / num_samples;
+        }
+
+        uniform_error += (uniform - reference) * (uniform - reference) / num_trials;
+        importance_error += (importance - reference) * (importance - reference) / num_trials;
+    }
+
+    RecordProperty("uniform_rmse", std::to_string(std::sqrt(uniform_error)));
+    RecordProperty("importance_rmse", std::to_string(std::sqrt(importance_error)));
+
+    ASSERT_LT(std::sqrt(importance_error), 0.01f * std::sqrt(uniform_error));
+}
+
+TEST_F(InternalTest, LightTree)
+{
+    using namespace RadeonRays;
+
+    // Grid of small upward facing emitters with a single bright one
+    std::vector<Baikal::LightBounds> lights;
+
+    for (auto i = 0; i < 32; ++i)
+    {
+        for (auto j = 0; j < 32; ++j)
+        {
+            Baikal::LightBounds bounds;
+            bounds.pmin = float3(i * 1.f, 0.f, j * 1.f);
+            bounds.pmax = float3(i * 1.f + 0.1f, 0.f, j * 1.f + 0.1f);
+            bounds.axis = float3(0.f, 1.f, 0.f);
+            bounds.cos_theta_o = 1.f;
+            bounds.cos_theta_e = 0.f;
+            bounds.power = (i == 3 && j == 5) ? 100.f : 1.f;
+            bounds.two_sided = false;
+            lights.push_back(bounds);
+        }
+    }
+
+    // Light without power is never sampled
+    lights[7].power = 0.f;
+
+    Baikal::LightTree tree;
+    tree.Build(lights);
+
+    ASSERT_EQ(tree.m_nodes.size(), 2 * (lights.size() - 1) - 1);
+    ASSERT_EQ(tree.m_bit_trails[7], Baikal::LightTree::kInvalidTrail);
+
+    // Probabilities of all lights sum up to one and match sampling
+    auto p = float3(3.f, 1.f, 5.f);
+
+    float sum = 0.f;
+    for (auto i = 0u; i < lights.size(); ++i)
+    {
+        sum += tree.GetPdf(p, i);
+    }
+
+    ASSERT_NEAR(sum, 1.f, 1e-3f);
+    ASSERT_EQ(tree.GetPdf(p, 7), 0.f);
+
+    for (auto i = 0; i < 1000; ++i)
+    {
+        float pdf = 0.f;
+        auto light = tree.Sample(p, rand_float(), pdf);
+
+        ASSERT_GE(light, 0);
+        ASSERT_NEAR(pdf, tree.GetPdf(p, light), 1e-3f * pdf);
+    }
+
+    // Nearby bright light is preferred, lights below the horizon of their emission are never selected
+    ASSERT_GT(tree.GetPdf(p, 3 * 32 + 5), 0.5f);
+    ASSERT_EQ(tree.GetPdf(float3(3.f, -1.f, 5.f), 3 * 32 + 5), 0.f);
+}
+
+namespace
+{
+    struct CountingCompiledScene
+    {
+        std::unique_ptr<Baikal::Bundle> material_bundle;
+        std::unique_ptr<Baikal::Bundle> volume_bundle;
+        std::unique_ptr<Baikal::Bundle> texture_bundle;
+        std::unique_ptr<Baikal::Bundle> input_map_leafs_bundle;
+        std::unique_ptr<Baikal::Bundle> input_map_bundle;
+        std::uint64_t revision = 0;
+    };
+
+    // Scene controller recording the number of update calls
+    class CountingSceneController : public Baikal::SceneController<CountingCompiledScene>
+    {
+    public:
+        using Collector = Baikal::Collector;
+        using Scene1 = Baikal::Scene1;
+
+        CountingSceneController()
+            : m_default_material(Baikal::UberV2Material::Create())
+        {
+        }
+
+        void UpdateCamera(Scene1 const&, Collector&, Collector&, Collector&, CountingCompiledScene&) const override
+        { ++num_camera_updates; }
+        void UpdateShapes(Scene1 const&, Collector&, Collector&, Collector&, CountingCompiledScene&) const override
+        { ++num_other_updates; }
+        void UpdateShapeProperties(Scene1 const&, Collector&, Collector&, Collector&, CountingCompiledScene&) const override
+        { ++num_shape_property_updates; }
+        void UpdateLights(Scene1 const&, Collector&, Collector&, CountingCompiledScene&) const override
+        { ++num_light_updates; }
+        void UpdateMaterials(Scene1 const&, Collector& mat_collector, Collector&, CountingCompiledScene& out) const override
+        {
+            ++num_material_updates;
+            out.material_bundle.reset(mat_collector.CreateBundle());
+        }
+        void UpdateTextures(Scene1 const&, Collector&, Collector&, CountingCompiledScene&) const override
+        { ++num_texture_updates; }
+        void UpdateInputMaps(Scene1 const&, Collector&, Collector&, CountingCompiledScene&) const override
+        { ++num_other_updates; }
+        void UpdateLeafsData(Scene1 const&, Collector&, Collector&, CountingCompiledScene&) const override
+        { ++num_other_updates; }
+        Baikal::Material::Ptr GetDefaultMaterial() const override
+        { return m_default_material; }
+        void UpdateCurrentScene(Scene1 const&, CountingCompiledScene&) const override
+        { ++num_other_updates; }
+        void UpdateVolumes(Scene1 const&, Collector& vol_collector, Collector&, CountingCompiledScene& out) const override
+        {
+            ++num_other_updates;
+            out.volume_bundle.reset(vol_collector.CreateBundle());
+        }
+        void UpdateSceneAttributes(Scene1 const&, Collector&, CountingCompiledScene&) const override
+        { ++num_other_updates; }
+
+        int GetNumUpdates() const
+        {
+            return num_camera_updates + num_shape_property_updates + num_light_updates +
+                num_material_updates + num_texture_updates + num_other_updates;
+        }
+
+        void ResetCounters() const
+        {
+            num_camera_updates = 0;
+            num_shape_property_updates = 0;
+            num_light_updates = 0;
+            num_material_updates = 0;
+            num_texture_updates = 0;
+            num_other_updates = 0;
+        }
+
+        mutable int num_camera_updates = 0;
+        mutable int num_shape_property_updates = 0;
+        mutable int num_light_updates = 0;
+        mutable int num_material_updates = 0;
+        mutable int num_texture_updates = 0;
+        mutable int num_other_updates = 0;
+
+    private:
+        Baikal::Material::Ptr m_default_material;
+    };
+
+    // Compile scene of a given size and check the updates caused by camera, shape, light and material changes
+    void CheckIncrementalUpdate(std::size_t num_shapes)
+    {
+        using namespace RadeonRays;
+
+        auto scene = Baikal::Scene1::Create();
+        auto material = Baikal::UberV2Material::Create();
+        material->SetLayers(Baikal::UberV2Material::Layers::kDiffuseLayer);
+
+        std::vector<Baikal::Mesh::Ptr> meshes(num_shapes);
+        for (auto& mesh : meshes)
+        {
+            mesh = Baikal::Mesh::Create();
+            mesh->SetMaterial(material);
+            scene->AttachShape(mesh);
+        }
+
+        auto light = Baikal::PointLight::Create();
+        scene->AttachLight(light);
+
+        auto camera = Baikal::PerspectiveCamera::Create(
+            float3(0.f, 1.f, 3.f), float3(0.f, 0.f, 0.f), float3(0.f, 1.f, 0.f));
+        scene->SetCamera(camera);
+
+        CountingSceneController controller;
+        controller.CompileScene(scene);
+        // Settle down the state of objects which are not tracked by the first compilation
+        controller.CompileScene(scene);
+
+        controller.ResetCounters();
+
+        auto const& compiled_scene = controller.GetCachedScene(scene);
+        auto revision = compiled_scene.revision;
+
+        // Nothing changed: no updates at all
+        controller.CompileScene(scene);
+        ASSERT_EQ(controller.GetNumUpdates(), 0);
+        ASSERT_EQ(compiled_scene.revision, revision);
+
+        // Camera moved: only camera is updated
+        camera->LookAt(float3(0.f, 2.f, 3.f), float3(0.f, 0.f, 0.f), float3(0.f, 1.f, 0.f));
+        controller.CompileScene(scene);
+        ASSERT_EQ(controller.num_camera_updates, 1);
+        ASSERT_EQ(controller.GetNumUpdates(), 1);
+        ASSERT_FALSE(camera->IsDirty());
+        ASSERT_EQ(compiled_scene.revision, revision + 1);
+
+        // Second camera move changes revision once more
+        camera->LookAt(float3(0.f, 3.f, 3.f), float3(0.f, 0.f, 0.f), float3(0.f, 1.f, 0.f));
+        controller.CompileScene(scene);
+        ASSERT_EQ(controller.num_camera_updates, 2);
+        ASSERT_EQ(controller.GetNumUpdates(), 2);
+        ASSERT_EQ(compiled_scene.revision, revision + 2);
+
+        // Shape moved: only shape properties are updated
+        controller.ResetCounters();
+        meshes.back()->SetTransform(translation(float3(1.f, 0.f, 0.f)));
+        controller.CompileScene(scene);
+        ASSERT_EQ(controller.num_shape_property_updates, 1);
+        ASSERT_EQ(controller.GetNumUpdates(), 1);
+        ASSERT_FALSE(meshes.back()->IsDirty());
+        ASSERT_GT(compiled_scene.revision, revision + 2);
+
+        // Light moved: only lights are updated
+        controller.ResetCounters();
+        revision = compiled_scene.revision;
+        light->SetPosition(float3(0.f, 5.f, 0.f));
+        controller.CompileScene(scene);
+        ASSERT_EQ(controller.num_light_updates, 1);
+        ASSERT_EQ(controller.GetNumUpdates(), 1);
+        ASSERT_FALSE(light->IsDirty());
+        ASSERT_GT(compiled_scene.revision, revision);
+
+        // Material property changed: materials and lights depending on them are updated
+        controller.ResetCounters();
+        material->SetThin(true);
+        controller.CompileScene(scene);
+        ASSERT_EQ(controller.num_material_updates, 1);
+        ASSERT_EQ(controller.num_light_updates, 1);
+        ASSERT_EQ(controller.GetNumUpdates(), 2);
+        ASSERT_FALSE(material->IsDirty());
+
+        // Material got a new input map: scene graph is collected again
+        controller.ResetCounters();
+        material->SetInputValue("uberv2.diffuse.color", Baikal::InputMap_ConstantFloat3::Create(float3(1.f, 0.f, 0.f)));
+        controller.CompileScene(scene);
+        ASSERT_EQ(controller.num_material_updates, 1);
+        ASSERT_GT(controller.num_other_updates, 0);
+        ASSERT_FALSE(material->IsDirty());
+
+        // Revisions are unique across controllers, so caches keyed by them can not mix scenes up
+        auto other_scene = Baikal::Scene1::Create();
+        auto other_mesh = Baikal::Mesh::Create();
+        other_mesh->SetMaterial(material);
+        other_scene->AttachShape(other_mesh);
+        other_scene->SetCamera(camera);
+
+        CountingSceneController other_controller;
+        ASSERT_GT(other_controller.CompileScene(other_scene).revision, compiled_scene.revision);
+    }
+}
+
+TEST_F(InternalTest, SceneController_IncrementalUpdate)
+{
+    // The amount of work should not depend on scene size
+    CheckIncrementalUpdate(1);
+    CheckIncrementalUpdate(5000);
+}
+
+TEST_F(InternalTest, Texture_MipChain)
+{
+    using namespace Baikal;
+
+    // 4x4 texture, each texel value equals its index
+    auto data = new char[4 * 4 * 4 * sizeof(float)];
+    auto values = reinterpret_cast<float*>(data);
+
+    for (auto i = 0; i < 16; ++i)
+    {
+        values[4 * i] = values[4 * i + 1] = values[4 * i + 2] = values[4 * i + 3] = static_cast<float>(i);
+    }
+
+    auto texture = Texture::Create(data, RadeonRays::int3(4, 4, 1), Texture::Format::kRgba32);
+
+    ASSERT_EQ(texture->GetNumMipLevels(), 3u);
+    ASSERT_EQ(texture->GetMipSize(1).x, 2);
+    ASSERT_EQ(texture->GetMipSize(2).x, 1);
+    ASSERT_EQ(texture->GetMipData(0), texture->GetData());
+
+    // Each texel is an average of 2x2 block of the previous level
+    auto level1 = reinterpret_cast<float const*>(texture->GetMipData(1));
+    ASSERT_FLOAT_EQ(level1[0], (0.f + 1.f + 4.f + 5.f) / 4.f);
+    ASSERT_FLOAT_EQ(level1[4 * 3], (10.f + 11.f + 14.f + 15.f) / 4.f);
+
+    auto level2 = reinterpret_cast<float const*>(texture->GetMipData(2));
+    ASSERT_FLOAT_EQ(level2[0], 7.5f);
+
+    // Non-square textures are clamped to 1 texel along the short side
+    auto strip = Texture::Create(new char[8 * 4], RadeonRays::int3(8, 1, 1), Texture::Format::kRgba8);
+    ASSERT_EQ(strip->GetNumMipLevels(), 4u);
+    ASSERT_EQ(strip->GetMipSize(3).x, 1);
+    ASSERT_EQ(strip->GetMipSize(3).y, 1);
+}
+
+TEST_F(InternalTest, Texture_BlockCompressionDecode)
+{
+    using namespace Baikal;
+
+    // BC1: red and blue endpoints, texel i uses index i % 4
+    std::uint8_t bc1[8] = { 0x00, 0xF8, 0x1F, 0x00, 0xE4, 0xE4, 0xE4, 0xE4 };
+    RadeonRays::float4 texels[kBlockTexels];
+    DecodeBlock(reinterpret_cast<char const*>(bc1), Texture::Format::kBc1, texels);
+
+    ASSERT_EQ(texels[0].x, 1.f);
+    ASSERT_EQ(texels[0].z, 0.f);
+    ASSERT_EQ(texels[1].x, 0.f);
+    ASSERT_EQ(texels[1].z, 1.f);
+    ASSERT_EQ(texels[2].x, 170 / 255.f);
+    ASSERT_EQ(texels[2].z, 85 / 255.f);
+    ASSERT_EQ(texels[3].x, 85 / 255.f);
+    ASSERT_EQ(texels[3].w, 1.f);
+
+    // BC4: 8 value mode, texel 0 uses index 2
+    std::uint8_t bc4[8] = { 200, 100, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    ASSERT_EQ(DecodeBlockTexel(reinterpret_cast<char const*>(bc4), Texture::Format::kBc4, 0).x, 186 / 255.f);
+    ASSERT_EQ(DecodeBlockTexel(reinterpret_cast<char const*>(bc4), Texture::Format::kBc4, 1).x, 200 / 255.f);
+
+    // BC6H/BC7 fields are packed starting from the least significant bit
+    auto write_bits = [](std::uint8_t* block, int& pos, std::uint32_t value, int count)
+    {
+        for (auto i = 0; i < count; ++i, ++pos)
+        {
+            block[pos / 8] |= static_cast<std::uint8_t>(((value >> i) & 0x1) << (pos % 8));
+        }
+    };
+
+    // BC7 mode 0: partition 0 has texel 0 in subset 0, texel 2 in subset 1 and texel 15 in subset 2.
+    // Subsets are red, green and blue, all p-bits are set.
+    std::uint8_t bc7[16] = { 0 };
+    int pos = 0;
+    write_bits(bc7, pos, 0x1, 1);
+    write_bits(bc7, pos, 0, 4);
+    for (auto c = 0; c < 3; ++c)
+    {
+        for (auto e = 0; e < 6; ++e)
+        {
+            write_bits(bc7, pos, e / 2 == c ? 0xF : 0, 4);
+        }
+    }
+    write_bits(bc7, pos, 0x3F, 6);
+
+    auto texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc7), Texture::Format::kBc7, 0);
+    ASSERT_EQ(texel.x, 1.f);
+    ASSERT_EQ(texel.y, 8 / 255.f);
+    ASSERT_EQ(texel.w, 1.f);
+    texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc7), Texture::Format::kBc7, 2);
+    ASSERT_EQ(texel.x, 8 / 255.f);
+    ASSERT_EQ(texel.y, 1.f);
+    texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc7), Texture::Format::kBc7, 15);
+    ASSERT_EQ(texel.y, 8 / 255.f);
+    ASSERT_EQ(texel.z, 1.f);
+
+    // BC7 mode 1: partition 0 splits columns 0-1 (red) and 2-3 (green), p-bits are shared by subsets
+    std::fill(bc7, bc7 + 16, 0);
+    pos = 0;
+    write_bits(bc7, pos, 0x2, 2);
+    write_bits(bc7, pos, 0, 6);
+    for (auto c = 0; c < 3; ++c)
+    {
+        for (auto e = 0; e < 4; ++e)
+        {
+            write_bits(bc7, pos, e / 2 == c ? 0x3F : 0, 6);
+        }
+    }
+    write_bits(bc7, pos, 0x1, 1);
+    write_bits(bc7, pos, 0x0, 1);
+
+    texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc7), Texture::Format::kBc7, 4);
+    ASSERT_EQ(texel.x, 1.f);
+    ASSERT_EQ(texel.y, 2 / 255.f);
+    texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc7), Texture::Format::kBc7, 7);
+    ASSERT_EQ(texel.x, 0.f);
+    ASSERT_EQ(texel.y, 253 / 255.f);
+
+    // BC7 mode 5: red ramp with separate alpha indices, rotation swaps red and alpha
+    std::fill(bc7, bc7 + 16, 0);
+    pos = 0;
+    write_bits(bc7, pos, 0x20, 6);
+    write_bits(bc7, pos, 1, 2);
+    write_bits(bc7, pos, 0, 7);
+    write_bits(bc7, pos, 0x7F, 7);
+    pos += 4 * 7;
+    write_bits(bc7, pos, 0x80, 8);
+    write_bits(bc7, pos, 0x80, 8);
+    // Texel 0 color index has 1 bit, texel 1 uses the second endpoint
+    pos += 1;
+    write_bits(bc7, pos, 0x3, 2);
+
+    texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc7), Texture::Format::kBc7, 0);
+    ASSERT_EQ(texel.x, 128 / 255.f);
+    ASSERT_EQ(texel.w, 0.f);
+    texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc7), Texture::Format::kBc7, 1);
+    ASSERT_EQ(texel.x, 128 / 255.f);
+    ASSERT_EQ(texel.w, 1.f);
+
+    // BC7 block without mode bit is reserved and decodes to zero
+    std::fill(bc7, bc7 + 16, 0);
+    ASSERT_EQ(DecodeBlockTexel(reinterpret_cast<char const*>(bc7), Texture::Format::kBc7, 0).w, 0.f);
+
+    // BC6H mode 3: two regions, 11-bit red base endpoint 1024, the first endpoint
+    // of the second region (texel 2 of partition 0) has -1 red delta
+    std::uint8_t bc6h[16] = { 0 };
+    pos = 0;
+    write_bits(bc6h, pos, 0x02, 5);
+    pos += 30;
+    pos += 5;
+    write_bits(bc6h, pos, 1, 1);
+    pos += 24;
+    write_bits(bc6h, pos, 0x1F, 5);
+
+    texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc6h), Texture::Format::kBc6h, 0);
+    ASSERT_FLOAT_EQ(texel.x, 1.5068359375f);
+    ASSERT_EQ(texel.y, 0.f);
+    texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc6h), Texture::Format::kBc6h, 2);
+    ASSERT_FLOAT_EQ(texel.x, 1.4921875f);
+    ASSERT_EQ(texel.z, 0.f);
+
+    // BC6H mode 12: single region, deltas of the second endpoint are +255 for red and -1 for green,
+    // texel 1 uses the second endpoint
+    std::fill(bc6h, bc6h + 16, 0);
+    pos = 0;
+    write_bits(bc6h, pos, 0x07, 5);
+    pos += 30;
+    write_bits(bc6h, pos, 0xFF, 9);
+    pos += 1;
+    write_bits(bc6h, pos, 0x1FF, 9);
+    pos = 68;
+    write_bits(bc6h, pos, 0xF, 4);
+
+    texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc6h), Texture::Format::kBc6h, 0);
+    ASSERT_EQ(texel.x, 0.f);
+    ASSERT_EQ(texel.y, 0.f);
+    texel = DecodeBlockTexel(reinterpret_cast<char const*>(bc6h), Texture::Format::kBc6h, 1);
+    ASSERT_FLOAT_EQ(texel.x, 0.0004558563232421875f);
+    ASSERT_FLOAT_EQ(texel.y, 65504.f);
+
+    // BC6H reserved mode decodes to zero and is rejected by validation
+    std::fill(bc6h, bc6h + 16, 0);
+    bc6h[0] = 0x13;
+    ASSERT_EQ(DecodeBlockTexel(reinterpret_cast<char const*>(bc6h), Texture::Format::kBc6h, 0).w, 0.f);
+
+    auto data = new char[16];
+    std::copy(bc6h, bc6h + 16, data);
+    auto texture = Texture::Create(data, RadeonRays::int3(4, 4, 1), Texture::Format::kBc6h);
+    ASSERT_FALSE(IsCompressedDataValid(*texture));
+
+    data = new char[16];
+    std::copy(bc7, bc7 + 16, data);
+    data[0] = 0x40;
+    texture = Texture::Create(data, RadeonRays::int3(4, 4, 1), Texture::Format::kBc7);
+    ASSERT_TRUE(IsCompressedDataValid(*texture));
+}
+
+TEST_F(InternalTest, Texture_BlockCompressionRoundtrip)
+{
+    using namespace Baikal;
+
+    // Ramp texture with alpha going in the opposite direction
+    int const size = 8;
+    auto data = new char[size * size * 4 * sizeof(float)];
+    auto values = reinterpret_cast<float*>(data);
+
+    for (auto i = 0; i < size * size; ++i)
+    {
+        float v = i / float(size * size - 1);
+        values[4 * i] = values[4 * i + 1] = values[4 * i + 2] = v;
+        values[4 * i + 3] = 1.f - v;
+    }
+
+    auto texture = Texture::Create(data, RadeonRays::int3(size, size, 1), Texture::Format::kRgba32);
+
+    struct FormatTolerance
+    {
+        Texture::Format format;
+        int num_channels;
+        float tolerance;
+    };
+
+    FormatTolerance const formats[] =
+    {
+        { Texture::Format::kBc1, 3, 0.1f },
+        { Texture::Format::kBc4, 1, 0.04f },
+        { Texture::Format::kBc5, 2, 0.04f },
+        { Texture::Format::kBc7, 4, 0.03f }
+    };
+
+    for (auto const& f : formats)
+    {
+        auto compressed = CompressTexture(*texture, f.format);
+
+        ASSERT_TRUE(compressed->IsCompressed());
+        ASSERT_EQ(compressed->GetSizeInBytes(), compressed->GetBlockSizeInBytes() * 4);
+
+        auto decompressed = DecompressTexture(*compressed);
+        auto decoded = reinterpret_cast<float const*>(decompressed->GetData());
+
+        for (auto i = 0; i < size * size; ++i)
+        {
+            for (auto c = 0; c < f.num_channels; ++c)
+            {
+                ASSERT_NEAR(decoded[4 * i + c], values[4 * i + c], f.tolerance);
+            }
+        }
+    }
+
+    // HDR data, values stay within a single exponent range of half
+    auto hdr_data = new char[size * size * 4 * sizeof(float)];
+    values = reinterpret_cast<float*>(hdr_data);
+
+    for (auto i = 0; i < size * size; ++i)
+    {
+        values[4 * i] = values[4 * i + 1] = values[4 * i + 2] = 1.f + i / float(size * size);
+        values[4 * i + 3] = 1.f;
+    }
+
+    texture = Texture::Create(hdr_data, RadeonRays::int3(size, size, 1), Texture::Format::kRgba32);
+
+    auto compressed = CompressTexture(*texture, Texture::Format::kBc6h);
+    auto decompressed = DecompressTexture(*compressed);
+    auto decoded = reinterpret_cast<float const*>(decompressed->GetData());
+
+    for (auto i = 0; i < size * size; ++i)
+    {
+        for (auto c = 0; c < 3; ++c)
+        {
+            ASSERT_NEAR(decoded[4 * i + c], values[4 * i + c], 0.06f);
+        }
+    }
+}
+
+TEST_F(InternalTest, Texture_ScalarFormats)
+{
+    using namespace Baikal;
+
+    int const size = 4;
+
+    // Single channel 8 bit map: 4 times smaller than RGBA and replicated on read
+    auto r8 = new char[size * size];
+    for (auto i = 0; i < size * size; ++i)
+    {
+        r8[i] = static_cast<char>(i * 16);
+    }
+
+    auto texture = Texture::Create(r8, RadeonRays::int3(size, size, 1), Texture::Format::kR8);
+
+    ASSERT_EQ(texture->GetNumChannels(), 1u);
+    ASSERT_EQ(texture->GetSizeInBytes(), static_cast<std::size_t>(size * size));
+
+    auto texel = texture->GetTexel(1, 0);
+    ASSERT_NEAR(texel.x, 16.f / 255.f, 1e-6f);
+    ASSERT_EQ(texel.x, texel.y);
+    ASSERT_EQ(texel.x, texel.z);
+    ASSERT_EQ(texel.w, 1.f);
+
+    // Mips keep the format
+    auto mip = reinterpret_cast<std::uint8_t const*>(texture->GetMipData(1));
+    ASSERT_EQ(mip[0], static_cast<std::uint8_t>((0 + 16 + 64 + 80) / 4));
+
+    // Dual channel half map
+    auto rg16 = new char[size * size * 2 * sizeof(std::uint16_t)];
+    auto rg16_data = reinterpret_cast<std::uint16_t*>(rg16);
+    for (auto i = 0; i < size * size; ++i)
+    {
+        rg16_data[2 * i] = half(0.5f).bits();
+        rg16_data[2 * i + 1] = half(0.25f).bits();
+    }
+
+    texture = Texture::Create(rg16, RadeonRays::int3(size, size, 1), Texture::Format::kRg16);
+
+    ASSERT_EQ(texture->GetSizeInBytes(), static_cast<std::size_t>(size * size * 4));
+
+    auto avg = texture->ComputeAverageValue();
+    ASSERT_NEAR(avg.x, 0.5f, 1e-6f);
+    ASSERT_NEAR(avg.y, 0.25f, 1e-6f);
+    ASSERT_NEAR(avg.z, 0.f, 1e-6f);
+
+    // Single channel float map
+    auto r32 = new char[size * size * sizeof(float)];
+    auto r32_data = reinterpret_cast<float*>(r32);
+    for (auto i = 0; i < size * size; ++i)
+    {
+        r32_data[i] = 2.f;
+    }
+
+    texture = Texture::Create(r32, RadeonRays::int3(size, size, 1), Texture::Format::kR32);
+
+    ASSERT_NEAR(texture->ComputeAverageValue().z, 2.f, 1e-6f);
+    ASSERT_EQ(reinterpret_cast<float const*>(texture->GetMipData(2))[0], 2.f);
+}
+
+TEST_F(InternalTest, Texture_Statistics)
+{
+    using namespace Baikal;
+
+    // Large enough to be reduced on several threads
+    int const width = 1536;
+    int const height = 1024;
+    auto const num_texels = width * height;
+
+    auto elapsed = [](std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000.f;
+    };
+
+    for (auto format : { Texture::Format::kRgba8, Texture::Format::kRgba16, Texture::Format::kRgba32, Texture::Format::kRg16 })
+    {
+        auto texture = Texture::Create(nullptr, RadeonRays::int3(width, height, 1), format);
+        auto data = new char[texture->GetSizeInBytes()];
+        auto num_values = num_texels * texture->GetNumChannels();
+
+        for (auto i = 0u; i < num_values; ++i)
+        {
+            auto value = static_cast<float>((i * 7919u) % 256u) / 255.f;
+
+            switch (format)
+            {
+            case Texture::Format::kRgba8:
+                reinterpret_cast<std::uint8_t*>(data)[i] = static_cast<std::uint8_t>(value * 255.f + 0.5f);
+                break;
+            case Texture::Format::kRgba32:
+                reinterpret_cast<float*>(data)[i] = value * 16.f;
+                break;
+            default:
+                reinterpret_cast<std::uint16_t*>(data)[i] = half(value * 16.f).bits();
+                break;
+            }
+        }
+
+        texture->SetData(data, RadeonRays::int3(width, height, 1), format);
+
+        // Scalar reference
+        double sum[3] = { 0.0, 0.0, 0.0 };
+        float max[3] = { 0.f, 0.f, 0.f };
+        for (auto y = 0; y < height; ++y)
+        {
+            for (auto x = 0; x < width; ++x)
+            {
+                auto texel = texture->GetTexel(x, y);
+                float const rgb[] = { texel.x, texel.y, texel.z };
+
+                for (auto c = 0; c < 3; ++c)
+                {
+                    sum[c] += rgb[c];
+                    max[c] = std::max(max[c], rgb[c]);
+                }
+            }
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto const& statistics = texture->GetStatistics();
+        auto compute_time = elapsed(start);
+
+        float const average[] = { statistics.average.x, statistics.average.y, statistics.average.z };
+        float const maximum[] = { statistics.max.x, statistics.max.y, statistics.max.z };
+
+        for (auto c = 0; c < 3; ++c)
+        {
+            ASSERT_NEAR(average[c], sum[c] / num_texels, 1e-5 * (1.0 + sum[c] / num_texels));
+            ASSERT_FLOAT_EQ(maximum[c], max[c]);
+        }
+
+        ASSERT_NEAR(statistics.luminance_sum, 0.2126 * sum[0] + 0.7152 * sum[1] + 0.0722 * sum[2], 1e-5 * statistics.luminance_sum);
+
+        // Statistics are cached until the data changes
+        start = std::chrono::high_resolution_clock::now();
+        ASSERT_EQ(&texture->GetStatistics(), &statistics);
+        auto cached_time = elapsed(start);
+
+        auto key = "format_" + std::to_string(static_cast<int>(format));
+        RecordProperty(key + "_statistics_ms", std::to_string(compute_time));
+        RecordProperty(key + "_cached_ms", std::to_string(cached_time));
+
+        auto texel = new char[texture->GetPixelSizeInBytes()]();
+        texture->SetData(texel, RadeonRays::int3(1, 1, 1), format);
+        ASSERT_EQ(texture->ComputeAverageValue().x, 0.f);
+    }
+}
+
+TEST_F(InternalTest, UberV2Generator_Dispatch)
+{
+    using namespace Baikal;
+
+    auto diffuse = UberV2Material::Create();
+    diffuse->SetLayers(UberV2Material::Layers::kDiffuseLayer);
+    auto another_diffuse = UberV2Material::Create();
+    another_diffuse->SetLayers(UberV2Material::Layers::kDiffuseLayer);
+
+    // Single layer combination: selectors should call specialized functions directly
+    {
+        CLUberV2Generator generator;
+        generator.AddMaterial(diffuse);
+        generator.AddMaterial(another_diffuse);
+
+        auto source = generator.BuildSource();
+        ASSERT_EQ(source.find("switch (dg->mat.layers)"), std::string::npos);
+        ASSERT_EQ(source.find("switch(dg->mat.layers)"), std::string::npos);
+        ASSERT_NE(source.find("return UberV2_Evaluate16(dg, wi_t, wo_t"), std::string::npos);
+    }
+
+    // Different layer combinations: selectors should switch on layers
+    {
+        auto coated = UberV2Material::Create();
+        coated->SetLayers(UberV2Material::Layers::kDiffuseLayer | UberV2Material::Layers::kCoatingLayer);
+
+        CLUberV2Generator generator;
+        generator.AddMaterial(diffuse);
+        generator.AddMaterial(coated);
+
+        auto source = generator.BuildSource();
+        ASSERT_NE(source.find("switch (dg->mat.layers)"), std::string::npos);
+        ASSERT_NE(source.find("case 16:"), std::string::npos);
+        ASSERT_NE(source.find("case 20:"), std::string::npos);
+    }
+}
+
+TEST_F(InternalTest, ProgramCache)
+{
+    using namespace Baikal;
+
+    ASSERT_EQ(ProgramCache::ComputeHash("abc"),
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    ASSERT_EQ(ProgramCache::ComputeHash(std::string(1000, 'a')),
+        "41edece42d63e8d9bf515a9ba6932e1c20cbc9f5a5d134645adb5db1b9737ea3");
+    ASSERT_NE(ProgramCache::ComputeKey({ "ab", "c" }), ProgramCache::ComputeKey({ "a", "bc" }));
+
+    std::string const path = "ProgramCacheTest";
+    std::size_t const entry_size = 1024;
+    ProgramCache cache(path, 3 * entry_size);
+
+    // Start from empty folder
+    cache.Evict();
+    ProgramCache(path, 0).Evict();
+
+    std::vector<std::uint8_t> data(entry_size);
+    std::vector<std::uint8_t> loaded;
+
+    for (auto i = 0u; i < 8; ++i)
+    {
+        std::fill(data.begin(), data.end(), (std::uint8_t)i);
+        auto key = "entry" + std::to_string(i);
+
+        ASSERT_FALSE(cache.Load(key, loaded));
+        cache.Store(key, data);
+
+        // Just stored entry should always survive eviction
+        ASSERT_TRUE(cache.Load(key, loaded));
+        ASSERT_EQ(loaded, data);
+    }
+
+    ASSERT_EQ(cache.GetStats().stores, 8u);
+    ASSERT_EQ(cache.GetStats().hits, 8u);
+    ASSERT_EQ(cache.GetStats().misses, 8u);
+    // Each entry has a small header, so only two entries fit into the limit
+    ASSERT_EQ(cache.GetStats().evictions, 6u);
+
+    // Truncated entry is rejected
+    {
+        std::ofstream out(path + "/entry7.bin", std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<char const*>(data.data()), 16);
+    }
+
+    ASSERT_FALSE(cache.Load("entry7", loaded));
+
+    // Entry claiming more data than the file holds is rejected without allocating it
+    {
+        std::fstream file(path + "/entry6.bin", std::ios::in | std::ios::out | std::ios::binary);
+        std::uint64_t const size = ~0ull;
+        // Size follows magic and version
+        file.seekp(2 * sizeof(std::uint32_t));
+        file.write(reinterpret_cast<char const*>(&size), sizeof(size));
+    }
+
+    ASSERT_FALSE(cache.Load("entry6", loaded));
+    ASSERT_TRUE(loaded.empty());
+    ASSERT_FALSE(std::ifstream(path + "/entry6.bin").good());
+
+    ProgramCache(path, 0).Evict();
+}
+
+TEST_F(InternalTest, ObjParser_Benchmark)
+{
+    std::string const filename = "ObjParserTest.obj";
+
+    // Write a grid of quads using relative indices, with material switching every row
+    auto write_grid = [&](std::uint32_t resolution)
+    {
+        {
+            std::ofstream mtl("ObjParserTest.mtl");
+            mtl << "newmtl red\nKd 1 0 0\nnewmtl light\nKd 0 0 0\nKe 5 5 5\n";
+        }
+
+        std::ofstream out(filename);
+        out << "mtllib ObjParserTest.mtl\no grid\n";
+
+        auto const num_vertices = (resolution + 1) * (resolution + 1);
+        for (auto y = 0u; y <= resolution; ++y)
+        {
+            for (auto x = 0u; x <= resolution; ++x)
+            {
+                out << "v " << x * 0.25f << " " << (x * y % 7) * 0.001f << " " << y * -0.125f << "\n";
+                out << "vt " << x / (float)resolution << " " << y / (float)resolution << "\n";
+            }
+        }
+
+        out << "vn 0 1 0\nvn 0 0.7071068 0.7071068\n";
+
+        for (auto y = 0u; y < resolution; ++y)
+        {
+            out << "usemtl " << (y % 2 ? "light" : "red") << "\n";
+
+            for (auto x = 0u; x < resolution; ++x)
+            {
+                int const quad[] = { 0, 1, (int)resolution + 2, (int)resolution + 1 };
+                int const first = (int)(y * (resolution + 1) + x) - (int)num_vertices;
+
+                out << "f";
+                for (auto corner : quad)
+                {
+                    out << " " << first + corner << "/" << first + corner << "/" << 1 + x % 2;
+                }
+                out << "\n";
+            }
+        }
+    };
+
+    // Previous loading path: tinyobj followed by per material re-indexing
+    auto load_reference = [&]()
+    {
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string err;
+        EXPECT_TRUE(tinyobj::LoadObj(shapes, materials, err, filename.c_str(), "", tinyobj::triangulation | tinyobj::calculate_normals));
+
+        std::vector<Baikal::ObjMesh> meshes;
+        for (auto const& shape : shapes)
+        {
+            std::set<int> used_materials(shape.mesh.material_ids.cbegin(), shape.mesh.material_ids.cend());
+
+            for (auto used_material : used_materials)
+            {
+                Baikal::ObjMesh mesh;
+                mesh.material = used_material;
+                std::map<unsigned int, unsigned int> used_indices;
+
+                for (std::size_t i = 0; i < shape.mesh.material_ids.size(); ++i)
+                {
+                    if (shape.mesh.material_ids[i] != used_material) continue;
+
+                    for (auto j = 0u; j < 3; ++j)
+                    {
+                        auto old_index = shape.mesh.indices[3 * i + j];
+                        auto result = used_indices.emplace(old_index, (unsigned int)mesh.vertices.size());
+                        if (result.second)
+                        {
+                            auto const* p = &shape.mesh.positions[3 * old_index];
+                            auto const* n = &shape.mesh.normals[3 * old_index];
+                            auto const* t = &shape.mesh.texcoords[2 * old_index];
+                            mesh.vertices.push_back(RadeonRays::float3(p[0], p[1], p[2]));
+                            mesh.normals.push_back(RadeonRays::float3(n[0], n[1], n[2]));
+                            mesh.uvs.push_back(RadeonRays::float2(t[0], t[1]));
+                        }
+                        mesh.indices.push_back(result.first->second);
+                    }
+                }
+
+                meshes.push_back(std::move(mesh));
+            }
+        }
+
+        return meshes;
+    };
+
+    auto elapsed = [](std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000.f;
+    };
+
+    for (auto resolution : { 16u, 256u, 1024u })
+    {
+        write_grid(resolution);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto reference = load_reference();
+        auto reference_time = elapsed(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        auto single = Baikal::ParseObj(filename, "", 1);
+        auto single_time = elapsed(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        auto parallel = Baikal::ParseObj(filename, "");
+        auto parallel_time = elapsed(start);
+
+        // Both parsers number vertices in order of first use, so buffers should match exactly
+        ASSERT_EQ(parallel.materials.size(), 2u);
+        ASSERT_EQ(parallel.materials[1].emission.x, 5.f);
+        ASSERT_EQ(parallel.meshes.size(), reference.size());
+
+        for (auto i = 0u; i < reference.size(); ++i)
+        {
+            auto const& expected = reference[i];
+
+            for (auto const* mesh : { &single.meshes[i], &parallel.meshes[i] })
+            {
+                ASSERT_EQ(mesh->material, expected.material);
+                ASSERT_EQ(mesh->indices, expected.indices);
+                ASSERT_EQ(mesh->vertices.size(), expected.vertices.size());
+
+                for (auto v = 0u; v < expected.vertices.size(); ++v)
+                {
+                    ASSERT_EQ((mesh->vertices[v] - expected.vertices[v]).sqnorm(), 0.f);
+                    ASSERT_EQ((mesh->normals[v] - expected.normals[v]).sqnorm(), 0.f);
+                    ASSERT_EQ(mesh->uvs[v].x, expected.uvs[v].x);
+                    ASSERT_EQ(mesh->uvs[v].y, expected.uvs[v].y);
+                }
+            }
+        }
+
+        auto key = std::to_string(resolution * resolution) + "_quads_";
+        RecordProperty(key + "tinyobj_ms", std::to_string(reference_time));
+        RecordProperty(key + "single_thread_ms", std::to_string(single_time));
+        RecordProperty(key + "parallel_ms", std::to_string(parallel_time));
+    }
+
+    std::remove(filename.c_str());
+    std::remove("ObjParserTest.mtl");
+}
+
+TEST_F(InternalTest, SceneBinaryIo_Roundtrip)
+{
+    using namespace Baikal;
+    using namespace RadeonRays;
+
+    std::string const filename = "SceneBinaryIoTest.bin";
+
+    auto create_scene = [](std::uint32_t resolution)
+    {
+        auto scene = Scene1::Create();
+
+        auto mesh = Mesh::Create();
+        std::vector<float3> vertices;
+        std::vector<float3> normals;
+        std::vector<float2> uvs;
+        std::vector<std::uint32_t> indices;
+
+        for (auto y = 0u; y <= resolution; ++y)
+        {
+            for (auto x = 0u; x <= resolution; ++x)
+            {
+                vertices.push_back(float3((float)x, 0.f, (float)y));
+                normals.push_back(float3(0.f, 1.f, 0.f));
+                uvs.push_back(float2(x / (float)resolution, y / (float)resolution));
+            }
+        }
+
+        for (auto y = 0u; y < resolution; ++y)
+        {
+            for (auto x = 0u; x < resolution; ++x)
+            {
+                auto first = y * (resolution + 1) + x;
+                std::uint32_t const quad[] = { first, first + 1, first + resolution + 2, first, first + resolution + 2, first + resolution + 1 };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+
+        mesh->SetVertices(std::move(vertices));
+        mesh->SetNormals(std::move(normals));
+        mesh->SetUVs(std::move(uvs));
+        mesh->SetIndices(std::move(indices));
+        mesh->SetName("grid");
+
+        // Unnamed texture is embedded into the file
+        auto texels = new char[4 * 4 * 4];
+        for (auto i = 0; i < 4 * 4 * 4; ++i) texels[i] = (char)i;
+        auto texture = Texture::Create(texels, int3(4, 4, 1), Texture::Format::kRgba8);
+
+        auto diffuse = InputMap_Lerp::Create(
+            InputMap_Sampler::Create(texture),
+            InputMap_ConstantFloat3::Create(float3(0.1f, 0.2f, 0.3f)),
+            InputMap_Select::Create(InputMap_ConstantFloat3::Create(float3(0.5f, 0.f, 0.f)), InputMap_Select::Selection::kX));
+
+        auto material = UberV2Material::Create();
+        material->SetLayers(UberV2Material::Layers::kDiffuseLayer | UberV2Material::Layers::kReflectionLayer);
+        material->SetInputValue("uberv2.diffuse.color", diffuse);
+        material->SetInputValue("uberv2.reflection.roughness", InputMap_ConstantFloat::Create(0.25f));
+        material->SetName("grid_material");
+        mesh->SetMaterial(material);
+        scene->AttachShape(mesh);
+
+        auto instance = Instance::Create(mesh);
+        instance->SetTransform(translation(float3(0.f, 1.f, 0.f)));
+        scene->AttachShape(instance);
+
+        auto point = PointLight::Create();
+        point->SetPosition(float3(1.f, 2.f, 3.f));
+        point->SetEmittedRadiance(float3(10.f, 10.f, 10.f));
+        scene->AttachLight(point);
+
+        auto spot = SpotLight::Create();
+        spot->SetConeShape(float2(0.25f, 0.5f));
+        scene->AttachLight(spot);
+
+        auto ibl = ImageBasedLight::Create();
+        ibl->SetTexture(texture);
+        ibl->SetMultiplier(2.f);
+        scene->AttachLight(ibl);
+
+        auto camera = PerspectiveCamera::Create(float3(0.f, 1.f, -5.f), float3(0.f, 1.f, 0.f), float3(0.f, 1.f, 0.f));
+        camera->SetSensorSize(float2(0.036f, 0.024f));
+        camera->SetFocalLength(0.035f);
+        scene->SetCamera(camera);
+
+        return scene;
+    };
+
+    auto elapsed = [](std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000.f;
+    };
+
+    for (auto resolution : { 16u, 1024u })
+    {
+        auto scene = create_scene(resolution);
+        ASSERT_NO_THROW(SceneIo::SaveScene(*scene, filename, ""));
+
+        auto start = std::chrono::high_resolution_clock::now();
+        Scene1::Ptr loaded;
+        ASSERT_NO_THROW(loaded = SceneIo::LoadScene(filename, ""));
+        auto load_time = elapsed(start);
+
+        ASSERT_EQ(loaded->GetNumShapes(), 2u);
+        ASSERT_EQ(loaded->GetNumLights(), 3u);
+
+        Mesh::Ptr mesh;
+        Instance::Ptr instance;
+        for (auto iter = loaded->CreateShapeIterator(); iter->IsValid(); iter->Next())
+        {
+            if (!mesh) mesh = std::dynamic_pointer_cast<Mesh>(iter->Item());
+            if (!instance) instance = std::dynamic_pointer_cast<Instance>(iter->Item());
+        }
+
+        ASSERT_TRUE(mesh && instance);
+        ASSERT_EQ(instance->GetBaseShape(), mesh);
+        ASSERT_EQ(instance->GetTransform().m[1][3], 1.f);
+        ASSERT_EQ(mesh->GetName(), "grid");
+
+        auto expected = std::static_pointer_cast<Mesh>(scene->CreateShapeIterator()->Item());
+        ASSERT_EQ(mesh->GetNumIndices(), expected->GetNumIndices());
+        ASSERT_EQ(mesh->GetNumVertices(), expected->GetNumVertices());
+        ASSERT_EQ(mesh->GetNumUVs(), expected->GetNumUVs());
+        ASSERT_EQ(std::memcmp(mesh->GetIndices(), expected->GetIndices(), mesh->GetNumIndices() * sizeof(std::uint32_t)), 0);
+        ASSERT_EQ(std::memcmp(mesh->GetVertices(), expected->GetVertices(), mesh->GetNumVertices() * sizeof(float3)), 0);
+        ASSERT_EQ(std::memcmp(mesh->GetUVs(), expected->GetUVs(), mesh->GetNumUVs() * sizeof(float2)), 0);
+
+        // Arrays are referenced in the mapped file at aligned offsets
+        ASSERT_EQ(reinterpret_cast<std::uintptr_t>(mesh->GetVertices()) % 64, 0u);
+        ASSERT_EQ(reinterpret_cast<std::uintptr_t>(mesh->GetIndices()) % 64, 0u);
+
+        // Input map graph and embedded texture survive the roundtrip
+        auto material = std::dynamic_pointer_cast<UberV2Material>(mesh->GetMaterial());
+        ASSERT_TRUE(material != nullptr);
+        ASSERT_EQ(material->GetName(), "grid_material");
+        ASSERT_EQ(material->GetLayers(), (std::uint32_t)(UberV2Material::Layers::kDiffuseLayer | UberV2Material::Layers::kReflectionLayer));
+
+        auto lerp = std::dynamic_pointer_cast<InputMap_Lerp>(material->GetInputValue("uberv2.diffuse.color").input_map_value);
+        ASSERT_TRUE(lerp != nullptr);
+        auto sampler = std::dynamic_pointer_cast<InputMap_Sampler>(lerp->GetA());
+        ASSERT_TRUE(sampler != nullptr);
+        ASSERT_EQ(sampler->GetTexture()->GetFormat(), Texture::Format::kRgba8);
+        ASSERT_EQ(std::memcmp(sampler->GetTexture()->GetData(), std::static_pointer_cast<InputMap_Sampler>(
+            std::static_pointer_cast<InputMap_Lerp>(scene->CreateShapeIterator()->ItemAs<Shape>()->GetMaterial()
+            ->GetInputValue("uberv2.diffuse.color").input_map_value)->GetA())->GetTexture()->GetData(), 4 * 4 * 4), 0);
+        ASSERT_EQ(std::static_pointer_cast<InputMap_ConstantFloat3>(lerp->GetB())->GetValue().z, 0.3f);
+        ASSERT_EQ(std::static_pointer_cast<InputMap_Select>(lerp->GetControl())->GetSelection(), InputMap_Select::Selection::kX);
+
+        // IBL shares the texture with the sampler
+        for (auto iter = loaded->CreateLightIterator(); iter->IsValid(); iter->Next())
+        {
+            if (auto ibl = std::dynamic_pointer_cast<ImageBasedLight>(iter->Item()))
+            {
+                ASSERT_EQ(ibl->GetTexture(), sampler->GetTexture());
+                ASSERT_EQ(ibl->GetMultiplier(), 2.f);
+            }
+            else if (auto spot = std::dynamic_pointer_cast<SpotLight>(iter->Item()))
+            {
+                ASSERT_EQ(spot->GetConeShape().y, 0.5f);
+            }
+            else
+            {
+                ASSERT_EQ(iter->ItemAs<Light>()->GetPosition().z, 3.f);
+            }
+        }
+
+        auto camera = std::dynamic_pointer_cast<PerspectiveCamera>(loaded->GetCamera());
+        ASSERT_TRUE(camera != nullptr);
+        ASSERT_EQ(camera->GetFocalLength(), 0.035f);
+        ASSERT_EQ(camera->GetSensorSize().x, 0.036f);
+
+        RecordProperty(std::to_string(resolution * resolution) + "_quads_open_ms", std::to_string(load_time));
+    }
+
+    // Out of range indices are rejected on load
+    {
+        auto scene = create_scene(4);
+        auto mesh = std::static_pointer_cast<Mesh>(scene->CreateShapeIterator()->Item());
+        std::vector<std::uint32_t> indices(mesh->GetIndices(), mesh->GetIndices() + mesh->GetNumIndices());
+        indices.back() = static_cast<std::uint32_t>(mesh->GetNumVertices());
+        mesh->SetIndices(std::move(indices));
+
+        ASSERT_NO_THROW(SceneIo::SaveScene(*scene, filename, ""));
+        ASSERT_THROW(SceneIo::LoadScene(filename, ""), std::runtime_error);
+    }
+
+    std::remove(filename.c_str());
+}
@@ -27,11 +27,14 @@ THE SOFTWARE.
 #include "SceneGraph/material.h"
 #include "SceneGraph/uberv2material.h"
 #include "SceneGraph/inputmaps.h"
+#include "Controllers/clw_scene_controller.h"
 
 #include "image_io.h"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <chrono>
+#include <limits>
 
 using namespace RadeonRays;
 
@@ -42,6 +45,79 @@ public:
     {
         m_scene = Baikal::SceneIo::LoadScene("sphere+plane.test", "");
     }
+
+    // Create emissive 4x4 ceiling quad tessellated into resolution x resolution cells
+    Baikal::Mesh::Ptr CreateEmissiveGrid(std::uint32_t resolution)
+    {
+        std::vector<float3> vertices;
+        std::vector<float3> normals;
+        std::vector<float2> uvs;
+        std::vector<std::uint32_t> indices;
+
+        for (auto j = 0u; j <= resolution; ++j)
+        {
+            for (auto i = 0u; i <= resolution; ++i)
+            {
+                auto u = float(i) / resolution;
+                auto v = float(j) / resolution;
+                vertices.push_back(float3(-2.f + 4.f * u, 6.f, -2.f + 4.f * v));
+                normals.push_back(float3(0.f, -1.f, 0.f));
+                uvs.push_back(float2(u, v));
+            }
+        }
+
+        for (auto j = 0u; j < resolution; ++j)
+        {
+            for (auto i = 0u; i < resolution; ++i)
+            {
+                auto a = j * (resolution + 1) + i;
+                auto b = a + 1;
+                auto c = b + resolution + 1;
+                auto d = a + resolution + 1;
+                indices.insert(indices.end(), { a, b, c, a, c, d });
+            }
+        }
+
+        auto emission = Baikal::UberV2Material::Create();
+        emission->SetLayers(Baikal::UberV2Material::Layers::kEmissionLayer);
+        emission->SetInputValue("uberv2.emission.color",
+            Baikal::InputMap_ConstantFloat3::Create(float3(3.1f, 3.f, 2.8f)));
+
+        auto mesh = Baikal::Mesh::Create();
+        mesh->SetVertices(std::move(vertices));
+        mesh->SetNormals(std::move(normals));
+        mesh->SetUVs(std::move(uvs));
+        mesh->SetIndices(std::move(indices));
+        mesh->SetMaterial(emission);
+        mesh->SetName("grid");
+
+        return mesh;
+    }
+
+    // Render and return average radiance of the output
+    RadeonRays::float3 RenderAverage(std::uint32_t num_samples)
+    {
+        m_controller->CompileScene(m_scene);
+        auto& scene = m_controller->GetCachedScene(m_scene);
+
+        ClearOutput();
+
+        for (auto i = 0u; i < num_samples; ++i)
+        {
+            m_renderer->Render(scene);
+        }
+
+        std::vector<RadeonRays::float3> data(kOutputWidth * kOutputHeight);
+        m_output->GetData(&data[0]);
+
+        RadeonRays::float3 average;
+        for (auto const& value : data)
+        {
+            average += value * (1.f / value.w);
+        }
+
+        return average * (1.f / data.size());
+    }
 };
 
 TEST_F(LightTest, Light_PointLight)
@@ -543,6 +619,126 @@ TEST_F(LightTest, Light_EmissiveSphere)
     }
 }
 
+// Emissive mesh light should converge to the same image as per-triangle area lights
+TEST_F(LightTest, Light_EmissiveMesh)
+{
+    m_camera->LookAt(
+        RadeonRays::float3(0.f, 2.f, -10.f),
+        RadeonRays::float3(0.f, 2.f, 0.f),
+        RadeonRays::float3(0.f, 1.f, 0.f));
+
+    LoadTestScene();
+    m_scene->SetCamera(m_camera);
+
+    auto mesh = CreateEmissiveGrid(8);
+    m_scene->AttachShape(mesh);
+
+    std::vector<Baikal::Light::Ptr> area_lights;
+    for (auto i = 0u; i < mesh->GetNumIndices() / 3; ++i)
+    {
+        area_lights.push_back(Baikal::AreaLight::Create(mesh, i));
+        m_scene->AttachLight(area_lights.back());
+    }
+
+    RadeonRays::float3 reference;
+    ASSERT_NO_THROW(reference = RenderAverage(kNumIterations));
+
+    for (auto const& light : area_lights)
+    {
+        m_scene->DetachLight(light);
+    }
+
+    auto mesh_light = Baikal::EmissiveMeshLight::Create(mesh);
+    m_scene->AttachLight(mesh_light);
+
+    ASSERT_EQ(mesh_light->GetPrimitiveDistribution().m_num_segments, mesh->GetNumIndices() / 3);
+    ASSERT_NEAR(mesh_light->GetArea(), 16.f, 1e-3f);
+
+    RadeonRays::float3 result;
+    ASSERT_NO_THROW(result = RenderAverage(kNumIterations));
+
+    for (auto c = 0; c < 3; ++c)
+    {
+        ASSERT_NEAR(result[c], reference[c], 0.05f * reference[c] + 1e-4f);
+    }
+
+    // Changes of the mesh have to trigger light update
+    ASSERT_FALSE(mesh_light->IsDirty());
+    mesh->SetTransform(translation(float3(0.f, -1.f, 0.f)));
+    ASSERT_TRUE(mesh_light->IsDirty());
+    ASSERT_NO_THROW(RenderAverage(1));
+    ASSERT_FALSE(mesh_light->IsDirty());
+
+    // Area is measured in world space
+    ASSERT_NEAR(mesh_light->GetArea(), 16.f, 1e-3f);
+    mesh->SetTransform(scale(float3(2.f, 1.f, 1.f)));
+    ASSERT_NEAR(mesh_light->GetArea(), 32.f, 1e-3f);
+}
+
+// Frame time against the number of emissive triangles:
+// one area light per triangle vs single emissive mesh light
+TEST_F(LightTest, Light_EmissiveMeshBenchmark)
+{
+    m_camera->LookAt(
+        RadeonRays::float3(0.f, 2.f, -10.f),
+        RadeonRays::float3(0.f, 2.f, 0.f),
+        RadeonRays::float3(0.f, 1.f, 0.f));
+
+    auto const num_frames = 16u;
+
+    auto measure = [&](bool use_mesh_light, std::uint32_t resolution)
+    {
+        LoadTestScene();
+        m_scene->SetCamera(m_camera);
+
+        auto mesh = CreateEmissiveGrid(resolution);
+        m_scene->AttachShape(mesh);
+
+        if (use_mesh_light)
+        {
+            m_scene->AttachLight(Baikal::EmissiveMeshLight::Create(mesh));
+        }
+        else
+        {
+            for (auto i = 0u; i < mesh->GetNumIndices() / 3; ++i)
+            {
+                m_scene->AttachLight(Baikal::AreaLight::Create(mesh, i));
+            }
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        m_controller->CompileScene(m_scene);
+        auto compiled = std::chrono::high_resolution_clock::now();
+
+        auto& scene = m_controller->GetCachedScene(m_scene);
+        ClearOutput();
+
+        for (auto i = 0u; i < num_frames; ++i)
+        {
+            m_renderer->Render(scene);
+        }
+
+        // Make sure all the frames are done
+        std::vector<RadeonRays::float3> data(kOutputWidth * kOutputHeight);
+        m_output->GetData(&data[0]);
+
+        auto rendered = std::chrono::high_resolution_clock::now();
+
+        auto compile_time = std::chrono::duration_cast<std::chrono::microseconds>(compiled - start).count() / 1000.f;
+        auto frame_time = std::chrono::duration_cast<std::chrono::microseconds>(rendered - compiled).count() / 1000.f / num_frames;
+
+        auto key = std::string(use_mesh_light ? "mesh_light_" : "area_lights_") + std::to_string(mesh->GetNumIndices() / 3);
+        RecordProperty(key + "_compile_ms", std::to_string(compile_time));
+        RecordProperty(key + "_frame_ms", std::to_string(frame_time));
+    };
+
+    for (auto resolution : { 1u, 8u, 32u, 128u })
+    {
+        ASSERT_NO_THROW(measure(false, resolution));
+        ASSERT_NO_THROW(measure(true, resolution));
+    }
+}
+
 TEST_F(LightTest, Light_DirectionalAndEmissiveSphere)
 {
     m_camera->LookAt(
@@ -664,6 +860,97 @@ TEST_F(LightTest, Light_ImageBasedLight)
     }
 }
 
+// Convergence of environment light sampling: RMSE against high sample count
+// render should drop as the number of samples grows
+TEST_F(LightTest, Light_ImageBasedLightConvergence)
+{
+    m_camera->LookAt(
+        RadeonRays::float3(0.f, 2.f, -10.f),
+        RadeonRays::float3(0.f, 2.f, 0.f),
+        RadeonRays::float3(0.f, 1.f, 0.f));
+
+    LoadTestScene();
+    m_scene->SetCamera(m_camera);
+
+    auto image_io(Baikal::ImageIo::CreateImageIo());
+    auto light_texture = image_io->LoadImage("../Resources/Textures/studio015.hdr");
+    auto light = Baikal::ImageBasedLight::Create();
+
+    light->SetTexture(light_texture);
+    light->SetMultiplier(1.f);
+    m_scene->AttachLight(light);
+
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    auto& scene = m_controller->GetCachedScene(m_scene);
+
+    auto render = [&](std::uint32_t num_samples, std::vector<RadeonRays::float3>& data)
+    {
+        ClearOutput();
+
+        for (auto i = 0u; i < num_samples; ++i)
+        {
+            m_renderer->Render(scene);
+        }
+
+        data.resize(kOutputWidth * kOutputHeight);
+        m_output->GetData(&data[0]);
+
+        for (auto& v : data)
+        {
+            v *= (1.f / v.w);
+        }
+    };
+
+    std::vector<RadeonRays::float3> reference;
+    ASSERT_NO_THROW(render(16 * kNumIterations, reference));
+
+    auto get_rmse = [&](std::vector<RadeonRays::float3> const& data)
+    {
+        float error = 0.f;
+        for (auto i = 0u; i < data.size(); ++i)
+        {
+            auto diff = data[i] - reference[i];
+            error += diff.x * diff.x + diff.y * diff.y + diff.z * diff.z;
+        }
+
+        return std::sqrt(error / (3 * data.size()));
+    };
+
+    float prev_rmse = std::numeric_limits<float>::max();
+
+    for (auto num_samples : { 1u, 4u, 16u })
+    {
+        std::vector<RadeonRays::float3> data;
+        ASSERT_NO_THROW(render(num_samples, data));
+
+        float rmse = get_rmse(data);
+        RecordProperty("rmse_" + std::to_string(num_samples), std::to_string(rmse));
+
+        ASSERT_LT(rmse, prev_rmse);
+        prev_rmse = rmse;
+    }
+
+    // Uniform sampling baseline with the same sample count
+    auto controller = dynamic_cast<Baikal::ClwSceneController*>(m_controller.get());
+    ASSERT_NE(controller, nullptr);
+
+    controller->SetEnvironmentImportanceSampling(false);
+    light->SetMultiplier(1.f);
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    std::vector<RadeonRays::float3> uniform;
+    ASSERT_NO_THROW(render(16u, uniform));
+
+    float uniform_rmse = get_rmse(uniform);
+    RecordProperty("rmse_uniform_16", std::to_string(uniform_rmse));
+
+    // Importance sampling should be clearly better than uniform sampling
+    ASSERT_LT(prev_rmse, 0.75f * uniform_rmse);
+
+    controller->SetEnvironmentImportanceSampling(true);
+}
+
 TEST_F(LightTest, Light_ImageBasedLightAndLightChanging)
 {
     m_camera->LookAt(
@@ -25,6 +25,8 @@ THE SOFTWARE.
 
 #include "internal.h"
 #include "basic.h"
+#include "cpu.h"
+#include "collector.h"
 #include "camera.h"
 #include "light.h"
 #include "material.h"
@@ -25,6 +25,7 @@ THE SOFTWARE.
 #include "SceneGraph/light.h"
 #include "SceneGraph/shape.h"
 #include "SceneGraph/material.h"
+#include "Controllers/clw_scene_controller.h"
 #include "image_io.h"
 
 #define _USE_MATH_DEFINES
@@ -953,3 +954,98 @@ TEST_F(MaterialTest, Material_PhaseFunction)
     }
 }
 
+
+TEST_F(MaterialTest, Material_SparseUpload)
+{
+    using namespace Baikal;
+
+    auto controller = dynamic_cast<ClwSceneController*>(m_controller.get());
+    ASSERT_NE(controller, nullptr);
+
+    auto material = UberV2Material::Create();
+    material->SetLayers(UberV2Material::Layers::kDiffuseLayer);
+    material->SetInputValue("uberv2.diffuse.color", InputMap_ConstantFloat3::Create(float3(0.5f, 0.5f, 0.5f)));
+    ApplyMaterialToObject("sphere", material);
+
+    controller->ResetUploadStatistics();
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    auto full_upload = controller->GetUploadStatistics();
+    ASSERT_GT(full_upload.material_bytes, 0u);
+
+    // Camera movement does not touch scene buffers
+    controller->ResetUploadStatistics();
+    m_camera->LookAt(
+        RadeonRays::float3(0.f, 2.f, -10.f),
+        RadeonRays::float3(0.f, 2.f, 0.f),
+        RadeonRays::float3(0.f, 1.f, 0.f));
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    ASSERT_EQ(controller->GetUploadStatistics().shape_bytes, 0u);
+    ASSERT_EQ(controller->GetUploadStatistics().material_bytes, 0u);
+    ASSERT_EQ(controller->GetUploadStatistics().light_bytes, 0u);
+    ASSERT_EQ(controller->GetUploadStatistics().texture_bytes, 0u);
+
+    // Changing single material input uploads only a part of material data
+    controller->ResetUploadStatistics();
+    material->SetInputValue("uberv2.diffuse.color", InputMap_ConstantFloat3::Create(float3(0.9f, 0.2f, 0.1f)));
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    ASSERT_GT(controller->GetUploadStatistics().material_bytes, 0u);
+    ASSERT_LT(controller->GetUploadStatistics().material_bytes, full_upload.material_bytes);
+    ASSERT_EQ(controller->GetUploadStatistics().texture_bytes, 0u);
+}
+
+TEST_F(MaterialTest, Material_TexturePoolOnDemand)
+{
+    using namespace Baikal;
+
+    auto controller = dynamic_cast<ClwSceneController*>(m_controller.get());
+    ASSERT_NE(controller, nullptr);
+
+    // Checker texture large enough to span several tiles
+    int const size = 512;
+    auto data = new char[size * size * 4];
+
+    for (auto y = 0; y < size; ++y)
+    {
+        for (auto x = 0; x < size; ++x)
+        {
+            char value = ((x / 32 + y / 32) % 2) ? (char)0xFF : (char)0x00;
+            std::fill(data + 4 * (y * size + x), data + 4 * (y * size + x + 1), value);
+        }
+    }
+
+    auto texture = Texture::Create(data, RadeonRays::int3(size, size, 1), Texture::Format::kRgba8);
+
+    auto material = UberV2Material::Create();
+    material->SetLayers(UberV2Material::Layers::kDiffuseLayer);
+    material->SetInputValue("uberv2.diffuse.color", InputMap_Sampler::Create(texture));
+    ApplyMaterialToObject("sphere", material);
+
+    controller->SetTexturePoolMode(ClwSceneController::TexturePoolMode::kTiledOnDemand);
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    auto& scene = m_controller->GetCachedScene(m_scene);
+
+    // Only the coarsest levels are resident initially
+    auto initial = controller->GetTextureMemoryStatistics(scene);
+    ASSERT_GT(initial.num_pages, 0u);
+    ASSERT_GT(initial.num_resident_pages, 0u);
+    ASSERT_LT(initial.num_resident_pages, initial.num_pages);
+
+    std::size_t num_uploaded = 0;
+
+    for (auto i = 0u; i < kNumIterations; ++i)
+    {
+        ASSERT_NO_THROW(m_renderer->Render(scene));
+        num_uploaded += controller->UpdateTextureResidency(scene);
+    }
+
+    // Tiles hit by rays are streamed in
+    auto stats = controller->GetTextureMemoryStatistics(scene);
+    ASSERT_GT(num_uploaded, 0u);
+    ASSERT_EQ(stats.num_resident_pages, initial.num_resident_pages + num_uploaded);
+    ASSERT_LE(stats.resident_bytes, stats.pool_bytes);
+    ASSERT_LE(stats.resident_bytes, stats.total_bytes);
+}
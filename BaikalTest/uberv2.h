@@ -25,6 +25,8 @@ THE SOFTWARE.
 #include "SceneGraph/light.h"
 #include "SceneGraph/shape.h"
 #include "SceneGraph/material.h"
+#include "Renderers/monte_carlo_renderer.h"
+#include "Estimators/path_tracing_estimator.h"
 #include "image_io.h"
 
 #define _USE_MATH_DEFINES
@@ -70,3 +72,141 @@ TEST_F(UberV2Test, UberV2_Basic)
         ASSERT_TRUE(CompareToReference(oss.str()));
     }
 }
+
+TEST_F(UberV2Test, UberV2_MaterialSorting)
+{
+    m_camera->LookAt(
+        RadeonRays::float3(0.f, 0.f, 10.f),
+        RadeonRays::float3(0.f, 0.f, 9.f),
+        RadeonRays::float3(0.f, 1.f, 0.f));
+
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    auto& scene = m_controller->GetCachedScene(m_scene);
+
+    auto& estimator = dynamic_cast<Baikal::PathTracingEstimator&>(
+        *static_cast<Baikal::MonteCarloRenderer*>(m_renderer.get())->m_estimator);
+
+    // Sorting only changes shading order, so both modes should converge to the same image
+    auto render_average = [&](Baikal::PathTracingEstimator::MaterialSortMode mode)
+    {
+        estimator.SetMaterialSortMode(mode);
+        ClearOutput();
+
+        for (auto i = 0u; i < kNumIterations; ++i)
+        {
+            m_renderer->Render(scene);
+        }
+
+        std::vector<RadeonRays::float3> data(m_output->width() * m_output->height());
+        m_output->GetData(&data[0]);
+
+        RadeonRays::float3 average;
+        for (auto const& value : data)
+        {
+            average += value * (1.f / value.w);
+        }
+
+        return average * (1.f / data.size());
+    };
+
+    auto unsorted = render_average(Baikal::PathTracingEstimator::MaterialSortMode::kDisabled);
+    auto sorted = render_average(Baikal::PathTracingEstimator::MaterialSortMode::kEnabled);
+
+    for (auto c = 0; c < 3; ++c)
+    {
+        ASSERT_NEAR(sorted[c], unsorted[c], 0.02f * unsorted[c] + 1e-4f);
+    }
+
+    // Spheres with different materials make secondary bounces divergent
+    estimator.SetMaterialSortMode(Baikal::PathTracingEstimator::MaterialSortMode::kAdaptive);
+
+    for (auto i = 0u; i < 32; ++i)
+    {
+        m_renderer->Render(scene);
+    }
+
+    ASSERT_GT(estimator.GetMaterialDivergence(1), 0.f);
+}
+
+TEST_F(UberV2Test, UberV2_PathRegeneration)
+{
+    m_camera->LookAt(
+        RadeonRays::float3(0.f, 0.f, 10.f),
+        RadeonRays::float3(0.f, 0.f, 9.f),
+        RadeonRays::float3(0.f, 1.f, 0.f));
+
+    ASSERT_NO_THROW(m_controller->CompileScene(m_scene));
+
+    auto& scene = m_controller->GetCachedScene(m_scene);
+
+    auto& estimator = dynamic_cast<Baikal::PathTracingEstimator&>(
+        *static_cast<Baikal::MonteCarloRenderer*>(m_renderer.get())->m_estimator);
+
+    auto const num_frames = 16u;
+    auto const num_pixels = m_output->width() * m_output->height();
+
+    struct Result
+    {
+        RadeonRays::float3 average;
+        float rays_per_second;
+        float rays_per_pass;
+    };
+
+    // Regeneration only changes how samples are scheduled, so both modes should converge to the same image
+    auto render = [&](std::uint32_t regeneration_passes)
+    {
+        estimator.SetRegenerationPasses(regeneration_passes);
+        ClearOutput();
+
+        // Warm up kernel compilation
+        m_renderer->Render(scene);
+        ClearOutput();
+        estimator.ReadTracedRayCount();
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (auto i = 0u; i < num_frames; ++i)
+        {
+            m_renderer->Render(scene);
+        }
+
+        auto num_rays = estimator.ReadTracedRayCount();
+        auto delta = std::chrono::high_resolution_clock::now() - start;
+
+        std::vector<RadeonRays::float3> data(num_pixels);
+        m_output->GetData(&data[0]);
+
+        Result result;
+        for (auto const& value : data)
+        {
+            result.average += value * (1.f / value.w);
+        }
+
+        result.average = result.average * (1.f / data.size());
+
+        auto seconds = std::chrono::duration_cast<std::chrono::microseconds>(delta).count() / 1000000.f;
+        auto num_passes = num_frames * (estimator.GetMaxBounces() + regeneration_passes);
+        result.rays_per_second = num_rays / seconds;
+        result.rays_per_pass = (float)num_rays / num_passes;
+
+        auto key = std::string(regeneration_passes > 0 ? "regeneration" : "bounce_synchronous");
+        RecordProperty(key + "_mrays_per_second", std::to_string(result.rays_per_second * 1e-6f));
+        RecordProperty(key + "_occupancy_percent", std::to_string(result.rays_per_pass / num_pixels * 100.f));
+
+        return result;
+    };
+
+    auto synchronous = render(0u);
+    auto regenerated = render(2u * estimator.GetMaxBounces());
+
+    estimator.SetRegenerationPasses(0u);
+
+    for (auto c = 0; c < 3; ++c)
+    {
+        ASSERT_NEAR(regenerated.average[c], synchronous.average[c], 0.02f * synchronous.average[c] + 1e-4f);
+    }
+
+    // Refilled slots keep more of the work buffer busy every pass
+    ASSERT_GT(regenerated.rays_per_pass, synchronous.rays_per_pass);
+}
@@ -1267,7 +1267,7 @@ rpr_int rprMeshGetInfo(rpr_shape in_mesh, rpr_mesh_info in_mesh_info, size_t in_
     {
     case RPR_MESH_POLYGON_COUNT:
     {
-        uint64_t value = mesh->GetVertexCount() / 3;
+        uint64_t value = mesh->GetIndicesCount() / 3;
         size_ret = sizeof(value);
         data.resize(size_ret);
         memcpy(&data[0], &value, size_ret);
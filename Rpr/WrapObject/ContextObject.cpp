@@ -130,18 +130,27 @@ void ContextObject::GetRenderStatistics(void * out_data, size_t * out_size_ret)
 {
     if (out_data)
     {
-        //TODO: more statistics
         rpr_render_statistics* rs = static_cast<rpr_render_statistics*>(out_data);
         rs->gpumem_usage = 0;
         rs->gpumem_total = 0;
         rs->gpumem_max_allocation = 0;
-        //for (const auto& cfg : m_cfgs)
-        //{
-            // TODO: implement me
-            //rs->gpumem_usage += cfg.renderer->GetWorkingSetSize();
-            //rs->gpumem_total += cfg.renderer->GetWorkingSetSize();
-            //rs->gpumem_max_allocation += cfg.renderer->GetWorkingSetSize();
-        //}
+        rs->sysmem_usage = 0;
+        for (const auto& cfg : m_cfgs)
+        {
+            // Device memory allocated by all entities of the config
+            auto factory = static_cast<Baikal::ClwRenderFactory const*>(cfg.factory.get());
+            rs->gpumem_usage += factory->GetProfiler().GetMemoryStatistics().total_bytes;
+
+            CLWContext context = cfg.context;
+            cl_device_id device = context.GetDevice(0).GetID();
+            cl_ulong global_mem_size = 0;
+            cl_ulong max_alloc_size = 0;
+            clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(global_mem_size), &global_mem_size, nullptr);
+            clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc_size), &max_alloc_size, nullptr);
+
+            rs->gpumem_total += global_mem_size;
+            rs->gpumem_max_allocation = std::max(rs->gpumem_max_allocation, static_cast<rpr_longlong>(max_alloc_size));
+        }
     }
     if (out_size_ret)
     {
@@ -82,6 +82,12 @@ void FramebufferObject::GetData(void* out_data)
     m_output->GetData(static_cast<RadeonRays::float3*>(out_data));
 }
 
+Baikal::ClwOutput::Readback FramebufferObject::ReadDataAsync(Baikal::ClwOutput::ReadbackFormat format, CLWKernel convert_kernel)
+{
+    Baikal::ClwOutput* output = static_cast<Baikal::ClwOutput*>(m_output);
+    return output->ReadDataAsync(format, convert_kernel);
+}
+
 void FramebufferObject::Clear()
 {
     Baikal::ClwOutput* output = dynamic_cast<Baikal::ClwOutput*>(m_output);
@@ -120,8 +126,9 @@ void FramebufferObject::SaveToFile(const char* path)
     std::size_t width = Width();
     size_t height = Height();
     std::vector<RadeonRays::float3> tempbuf(width * height);
-    GetData(tempbuf.data());
-    std::vector<RadeonRays::float3> data(tempbuf);
+
+    //read into pinned staging memory and convert from there, so pixels are copied once
+    auto data = static_cast<RadeonRays::float3 const*>(ReadDataAsync().GetData());
 
     //convert pixels
     for (std::size_t y = 0; y < height; ++y)
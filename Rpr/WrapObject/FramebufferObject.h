@@ -45,6 +45,9 @@ public:
     std::size_t Width();
     std::size_t Height();
     void GetData(void* out_data);
+    //start readback into pinned staging memory without blocking (see Baikal::ClwOutput::ReadDataAsync)
+    Baikal::ClwOutput::Readback ReadDataAsync(Baikal::ClwOutput::ReadbackFormat format = Baikal::ClwOutput::ReadbackFormat::kFloat4,
+                                              CLWKernel convert_kernel = CLWKernel());
 
     void Clear();
     void SaveToFile(const char* path);
@@ -65,9 +65,23 @@ ImageMaterialObject::ImageMaterialObject(rpr_image_format const in_format, rpr_i
         throw Exception(RPR_ERROR_INVALID_PARAMETER, "TextureObject: invalid format type.");
     }
     pixel_bytes *= component_bytes;
-    int data_size = 4 * component_bytes * pixels_count;//4 component baikal texture
+
+    //single and dual channel images are kept compact where baikal has matching format
+    if (in_format.num_components == 1)
+    {
+        data_format = component_bytes == 1 ? Texture::Format::kR8 :
+            (component_bytes == 2 ? Texture::Format::kR16 : Texture::Format::kR32);
+    }
+    else if (in_format.num_components == 2 && component_bytes < 4)
+    {
+        data_format = component_bytes == 1 ? Texture::Format::kRg8 : Texture::Format::kRg16;
+    }
+
+    int num_components = (data_format == Texture::Format::kRgba8 || data_format == Texture::Format::kRgba16 ||
+        data_format == Texture::Format::kRgba32) ? 4 : in_format.num_components;
+    int data_size = num_components * component_bytes * pixels_count;
     char* data = new char[data_size];
-    if (in_format.num_components == 4)
+    if (in_format.num_components == static_cast<unsigned int>(num_components))
     {
         //copy data
         memcpy(data, in_data, data_size);
@@ -89,19 +89,23 @@ rpr_image_format TextureMaterialObject::GetImageFormat() const
     switch (m_tex->GetFormat())
     {
     case Baikal::Texture::Format::kRgba8:
+    case Baikal::Texture::Format::kR8:
+    case Baikal::Texture::Format::kRg8:
         type = RPR_COMPONENT_TYPE_UINT8;
         break;
     case Baikal::Texture::Format::kRgba16:
+    case Baikal::Texture::Format::kR16:
+    case Baikal::Texture::Format::kRg16:
         type = RPR_COMPONENT_TYPE_FLOAT16;
         break;
     case Baikal::Texture::Format::kRgba32:
+    case Baikal::Texture::Format::kR32:
         type = RPR_COMPONENT_TYPE_FLOAT32;
         break;
     default:
         throw Exception(RPR_ERROR_INTERNAL_ERROR, "MaterialObject: invalid image format.");
     }
-    //only 4component textures used
-    return{ 4, type };
+    return{ m_tex->GetNumChannels(), type };
 }
 
 Baikal::Texture::Ptr TextureMaterialObject::GetTexture() 
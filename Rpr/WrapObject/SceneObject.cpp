@@ -45,6 +45,7 @@ void SceneObject::Clear()
 {
     m_shapes.clear();
     m_lights.clear();
+    m_emissive_lights.clear();
 
     //remove lights
     for (std::unique_ptr<Baikal::Iterator> it_light(m_scene->CreateLightIterator()); it_light->IsValid();)
@@ -139,15 +140,10 @@ RadeonRays::bbox SceneObject::GetBBox()
 
 void SceneObject::AddEmissive()
 {
-    //TODO: check scene isn't changed
-    //recreate amissives if scene is dirty
-    if (!m_scene->GetDirtyFlags())
-    {
-        return;
-    }
-    RemoveEmissive();
+    // Find shapes with emissive material, this is cheap compared to
+    // rebuilding the lights so it is done on every call
+    std::map<Baikal::Shape::Ptr, Baikal::EmissiveMeshLight::Ptr> emissive_lights;
 
-    //handle emissive materials
     for (std::unique_ptr<Baikal::Iterator> it_shape(m_scene->CreateShapeIterator()); it_shape->IsValid(); it_shape->Next())
     {
         auto shape = it_shape->ItemAs<Baikal::Shape>();
@@ -162,32 +158,41 @@ void SceneObject::AddEmissive()
         assert(mesh);
 
         auto mat = mesh->GetMaterial();
-        if (!mat)
+        if (!mat || !mat->HasEmission())
         {
             continue;
         }
-        //fine shapes with emissive material
-        if (mat->HasEmission())
+
+        // Keep the light if the shape has been emissive already,
+        // it picks up geometry changes of the mesh by itself
+        auto it = m_emissive_lights.find(shape);
+        if (it != m_emissive_lights.end())
+        {
+            emissive_lights.insert(*it);
+            m_emissive_lights.erase(it);
+        }
+        else
         {
-            // Add area light for each polygon of emissive mesh
-            for (std::size_t l = 0; l < mesh->GetNumIndices() / 3; ++l)
-            {
-                auto light = Baikal::AreaLight::Create(mesh, l);
-                m_scene->AttachLight(light);
-                m_emmisive_lights.push_back(light);
-            }
+            auto light = Baikal::EmissiveMeshLight::Create(shape);
+            m_scene->AttachLight(light);
+            emissive_lights.emplace(shape, light);
         }
     }
+
+    // Remaining lights belong to removed or not emissive anymore shapes
+    RemoveEmissive();
+
+    m_emissive_lights = std::move(emissive_lights);
 }
 
 void SceneObject::RemoveEmissive()
 {
-    for (auto light : m_emmisive_lights)
+    for (auto& light : m_emissive_lights)
     {
-        m_scene->DetachLight(light);
+        m_scene->DetachLight(light.second);
     }
     
-    m_emmisive_lights.clear();
+    m_emissive_lights.clear();
 }
 
 bool SceneObject::IsDirty()
@@ -26,6 +26,7 @@ THE SOFTWARE.
 #include "SceneGraph/shape.h"
 #include "SceneGraph/light.h"
 
+#include <map>
 #include <vector>
 
 class ShapeObject;
@@ -86,7 +87,7 @@ public:
 private:
     Baikal::Scene1::Ptr m_scene;
     CameraObject* m_current_camera = nullptr;
-    std::vector<Baikal::AreaLight::Ptr> m_emmisive_lights;//area lights fro emissive shapes
+    std::map<Baikal::Shape::Ptr, Baikal::EmissiveMeshLight::Ptr> m_emissive_lights;//lights for emissive shapes
     std::vector<ShapeObject*> m_shapes;
     std::vector<LightObject*> m_lights;
     MaterialObject *m_background_image = nullptr;
@@ -20,8 +20,11 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 ********************************************************************/
 
-#include <vector>
+#include <algorithm>
 #include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "WrapObject/ShapeObject.h"
 #include "WrapObject/Exception.h"
@@ -32,41 +35,143 @@ using namespace Baikal;
 
 namespace
 {
-    template<typename T, int size = 3> std::vector<T> merge(const T* in_data, size_t in_data_num, rpr_int in_data_stride,
-        rpr_int const * in_data_indices, rpr_int in_didx_stride,
-        rpr_int const * in_num_face_vertices, size_t in_num_faces)
+    // Meshes with more face corners are welded using multiple threads
+    std::size_t const kParallelWeldThreshold = 1 << 16;
+
+    // Face corner: indices of position, normal and texcoord (-1 if the stream is missing)
+    struct Corner
+    {
+        rpr_int vertex;
+        rpr_int normal;
+        rpr_int texcoord;
+
+        bool operator == (Corner const& other) const
+        {
+            return vertex == other.vertex && normal == other.normal && texcoord == other.texcoord;
+        }
+    };
+
+    struct CornerHash
+    {
+        std::size_t operator()(Corner const& corner) const
+        {
+            auto hash = static_cast<std::size_t>(static_cast<std::uint32_t>(corner.vertex)) * 73856093u;
+            hash ^= static_cast<std::size_t>(static_cast<std::uint32_t>(corner.normal)) * 19349663u;
+            hash ^= static_cast<std::size_t>(static_cast<std::uint32_t>(corner.texcoord)) * 83492791u;
+            return hash;
+        }
+    };
+
+    // Fetch index of the corner from strided index array, -1 if data or indices are missing
+    inline rpr_int GetIndex(rpr_float const* data, size_t num, rpr_int const* indices, rpr_int stride, std::size_t corner)
+    {
+        if (!data || !indices)
+        {
+            return -1;
+        }
+
+        auto index = indices[corner * stride / sizeof(rpr_int)];
+        if (index < 0 || static_cast<size_t>(index) >= num)
+        {
+            throw Exception(RPR_ERROR_INVALID_PARAMETER, "ShapeObject: mesh index out of range.");
+        }
+
+        return index;
+    }
+
+    // Call func(task) for each task in [0, num_tasks), tasks are run in parallel if requested
+    template <typename Func> void ParallelFor(std::uint32_t num_tasks, bool parallel, Func func)
     {
-        std::vector<T> result;
-        if (!in_data || !in_data_indices)
+        if (!parallel || num_tasks < 2)
         {
-            std::cout << "Warning: missing mesh data, fill it with NULL.\n";
-            int count = 0;
-            for (std::size_t i = 0; i < in_num_faces; ++i)
+            for (auto task = 0u; task < num_tasks; ++task)
             {
-                count += in_num_face_vertices[i];
+                func(task);
             }
-            result.resize(count * size);
-            std::fill(result.begin(), result.end(), 0.f);
+            return;
+        }
+
+        std::vector<std::thread> threads;
+        threads.reserve(num_tasks);
+
+        for (auto task = 0u; task < num_tasks; ++task)
+        {
+            threads.emplace_back(func, task);
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Weld face corners sharing the same (position, normal, texcoord) index tuple.
+    // Returns vertex index of each corner, vertices are numbered in order of first occurrence,
+    // out_unique receives first corner of each vertex.
+    std::vector<std::uint32_t> Weld(std::vector<Corner> const& corners, std::vector<std::uint32_t>& out_unique)
+    {
+        auto num_corners = corners.size();
+        auto parallel = num_corners > kParallelWeldThreshold;
+        auto num_partitions = parallel ? std::max(std::thread::hardware_concurrency(), 1u) : 1u;
 
-            return result;
+        // Each partition owns the keys hashing into it, so partitions can be processed
+        // independently and the result does not depend on the number of threads
+        std::vector<std::uint32_t> first(num_corners);
+
+        // Bucket corners by partition in a single pass (counting sort keeps them in order)
+        CornerHash hasher;
+        std::vector<std::uint32_t> partition_of(num_corners);
+        std::vector<std::size_t> offsets(num_partitions + 1, 0);
+
+        for (std::size_t i = 0; i < num_corners; ++i)
+        {
+            partition_of[i] = static_cast<std::uint32_t>(hasher(corners[i]) % num_partitions);
+            ++offsets[partition_of[i] + 1];
+        }
+
+        for (auto partition = 0u; partition < num_partitions; ++partition)
+        {
+            offsets[partition + 1] += offsets[partition];
+        }
+
+        std::vector<std::uint32_t> buckets(num_corners);
+        std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+
+        for (std::size_t i = 0; i < num_corners; ++i)
+        {
+            buckets[fill[partition_of[i]]++] = static_cast<std::uint32_t>(i);
         }
 
-        int indent = 0;
-        for (std::size_t i = 0; i < in_num_faces; ++i)
+        ParallelFor(num_partitions, parallel, [&](std::uint32_t partition)
         {
-            int face = in_num_face_vertices[i];
-            for (int f = indent; f < face + indent; ++f)
+            std::unordered_map<Corner, std::uint32_t, CornerHash> map;
+            map.reserve(offsets[partition + 1] - offsets[partition]);
+
+            for (auto j = offsets[partition]; j < offsets[partition + 1]; ++j)
             {
-                int index = in_data_stride / sizeof(T) * in_data_indices[f*in_didx_stride / sizeof(rpr_int)];
-                for (int s = 0; s < size; ++s)
-                {
-                    result.push_back(in_data[index + s]);
-                }
+                auto i = buckets[j];
+                first[i] = map.emplace(corners[i], i).first->second;
             }
+        });
+
+        // First occurrence always precedes the duplicates
+        std::vector<std::uint32_t> remap(num_corners);
+        out_unique.clear();
 
-            indent += face;
+        for (std::size_t i = 0; i < num_corners; ++i)
+        {
+            if (first[i] == i)
+            {
+                remap[i] = static_cast<std::uint32_t>(out_unique.size());
+                out_unique.push_back(static_cast<std::uint32_t>(i));
+            }
+            else
+            {
+                remap[i] = remap[first[i]];
+            }
         }
-        return result;
+
+        return remap;
     }
 }
 
@@ -107,50 +212,101 @@ ShapeObject* ShapeObject::CreateMesh(rpr_float const * in_vertices, size_t in_nu
                         rpr_int const * in_texcoord_indices, rpr_int in_tidx_stride,
                         rpr_int const * in_num_face_vertices, size_t in_num_faces)
 {
-    //merge data
-    std::vector<float> verts = merge(in_vertices, in_num_vertices, in_vertex_stride,
-        in_vertex_indices, in_vidx_stride,
-        in_num_face_vertices, in_num_faces);
-    std::vector<float> normals = merge(in_normals, in_num_normals, in_normal_stride,
-        in_normal_indices, in_nidx_stride,
-        in_num_face_vertices, in_num_faces);
-    std::vector<float> uvs = merge<float, 2>(in_texcoords, in_num_texcoords, in_texcoord_stride,
-        in_texcoord_indices, in_tidx_stride,
-        in_num_face_vertices, in_num_faces);
+    //count corners and triangles, arbitrary polygons are triangulated as fans
+    std::size_t num_corners = 0;
+    std::size_t num_triangles = 0;
+    for (std::size_t i = 0; i < in_num_faces; ++i)
+    {
+        int face = in_num_face_vertices[i];
+        if (face < 3)
+        {
+            throw Exception(RPR_ERROR_INVALID_PARAMETER, "ShapeObject: invalid face value.");
+        }
+        num_corners += face;
+        num_triangles += face - 2;
+    }
 
-    //generate indices
-    std::vector<std::uint32_t> inds;
-    std::uint32_t indent = 0;
-    for (std::uint32_t i = 0; i < in_num_faces; ++i)
+    if (!in_vertices || !in_vertex_indices || !in_normals || !in_normal_indices || !in_texcoords || !in_texcoord_indices)
+    {
+        std::cout << "Warning: missing mesh data, fill it with NULL.\n";
+    }
+
+    //missing streams have -1 index, so those do not split vertices
+    std::vector<Corner> corners(num_corners);
+    for (std::size_t i = 0; i < num_corners; ++i)
     {
-        inds.push_back(indent);
-        inds.push_back(indent + 1);
-        inds.push_back(indent + 2);
+        auto& corner = corners[i];
+        corner.vertex = GetIndex(in_vertices, in_num_vertices, in_vertex_indices, in_vidx_stride, i);
+        corner.normal = GetIndex(in_normals, in_num_normals, in_normal_indices, in_nidx_stride, i);
+        corner.texcoord = GetIndex(in_texcoords, in_num_texcoords, in_texcoord_indices, in_tidx_stride, i);
+    }
 
-        int face = in_num_face_vertices[i];
+    //weld corners into shared vertices
+    std::vector<std::uint32_t> unique;
+    auto remap = Weld(corners, unique);
 
-        //triangulation
-        if (face == 4)
+    auto num_vertices = unique.size();
+    std::vector<RadeonRays::float3> verts(num_vertices);
+    std::vector<RadeonRays::float3> normals(num_vertices);
+    std::vector<RadeonRays::float2> uvs(num_vertices);
+
+    auto parallel = num_corners > kParallelWeldThreshold;
+    auto num_tasks = parallel ? std::max(std::thread::hardware_concurrency(), 1u) : 1u;
+
+    ParallelFor(num_tasks, parallel, [&](std::uint32_t task)
+    {
+        auto begin = num_vertices * task / num_tasks;
+        auto end = num_vertices * (task + 1) / num_tasks;
+
+        for (auto i = begin; i < end; ++i)
         {
-            inds.push_back(indent + 0);
-            inds.push_back(indent + 2);
-            inds.push_back(indent + 3);
+            auto const& corner = corners[unique[i]];
+
+            if (corner.vertex >= 0)
+            {
+                auto data = in_vertices + in_vertex_stride / sizeof(rpr_float) * corner.vertex;
+                verts[i] = RadeonRays::float3(data[0], data[1], data[2]);
+            }
+
+            if (corner.normal >= 0)
+            {
+                auto data = in_normals + in_normal_stride / sizeof(rpr_float) * corner.normal;
+                normals[i] = RadeonRays::float3(data[0], data[1], data[2]);
+            }
 
+            if (corner.texcoord >= 0)
+            {
+                auto data = in_texcoords + in_texcoord_stride / sizeof(rpr_float) * corner.texcoord;
+                uvs[i] = RadeonRays::float2(data[0], data[1]);
+            }
         }
-        //only triangles and quads supported
-        else if (face != 3)
+    });
+
+    //generate indices
+    std::vector<std::uint32_t> inds(num_triangles * 3);
+    std::size_t indent = 0;
+    std::size_t t = 0;
+    for (std::size_t i = 0; i < in_num_faces; ++i)
+    {
+        int face = in_num_face_vertices[i];
+
+        //triangulation
+        for (int k = 1; k < face - 1; ++k)
         {
-            throw Exception(RPR_ERROR_INVALID_PARAMETER, "ShapeObject: invalid face value.");
+            inds[t++] = remap[indent];
+            inds[t++] = remap[indent + k];
+            inds[t++] = remap[indent + k + 1];
         }
+
         indent += face;
     }
 
     //create mesh
     auto mesh = Baikal::Mesh::Create();
-    mesh->SetVertices(verts.data(), verts.size() / 3);
-    mesh->SetNormals(normals.data(), normals.size() / 3);
-    mesh->SetUVs(uvs.data(), uvs.size() / 2);
-    mesh->SetIndices(inds.data(), inds.size());
+    mesh->SetVertices(std::move(verts));
+    mesh->SetNormals(std::move(normals));
+    mesh->SetUVs(std::move(uvs));
+    mesh->SetIndices(std::move(inds));
 
     return new ShapeObject(mesh, nullptr);
 }
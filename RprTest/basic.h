@@ -820,3 +820,77 @@ TEST_F(BasicTest, Basic_MultiUV)
         texcoord_indices, tidx_stride,
         num_face_vertices, num_faces, &mesh), RPR_ERROR_UNIMPLEMENTED);
 }
+
+// Mesh creation keeps vertices shared between faces
+TEST_F(BasicTest, Basic_MeshWelding)
+{
+    CreateScene(SceneType::kThreeSpheres);
+
+    std::size_t total_corners = 0;
+    std::size_t total_vertices = 0;
+
+    for (auto const& shape : { "plane", "sphere_specular", "sphere_refract", "sphere_transparent" })
+    {
+        std::uint64_t num_vertices = 0;
+        std::uint64_t num_polygons = 0;
+        ASSERT_EQ(rprMeshGetInfo(GetShape(shape), RPR_MESH_VERTEX_COUNT, sizeof(num_vertices), &num_vertices, nullptr), RPR_SUCCESS);
+        ASSERT_EQ(rprMeshGetInfo(GetShape(shape), RPR_MESH_POLYGON_COUNT, sizeof(num_polygons), &num_polygons, nullptr), RPR_SUCCESS);
+
+        total_corners += 3 * num_polygons;
+        total_vertices += num_vertices;
+    }
+
+    // Input vertex arrays are already shared: 4 for the plane and (lat - 2) * lon + 2 per sphere
+    ASSERT_EQ(total_vertices, 4u + 3u * (30u * 64u + 2u));
+
+    // Position, normal and uv per vertex
+    auto vertex_size = 2 * sizeof(float3) + sizeof(float2);
+    RecordProperty("vertices", std::to_string(total_vertices));
+    RecordProperty("vertices_unwelded", std::to_string(total_corners));
+    RecordProperty("vertex_memory_kb", std::to_string(total_vertices * vertex_size / 1024));
+    RecordProperty("vertex_memory_unwelded_kb", std::to_string(total_corners * vertex_size / 1024));
+
+    // Polygons with more than 4 vertices are triangulated
+    float vertices[] =
+    {
+        0.f, 0.f, 0.f,
+        1.f, 0.f, 0.f,
+        1.5f, 1.f, 0.f,
+        0.5f, 2.f, 0.f,
+        -0.5f, 1.f, 0.f
+    };
+
+    rpr_int indices[] = { 0, 1, 2, 3, 4 };
+    rpr_int num_face_vertices[] = { 5 };
+
+    rpr_shape pentagon = nullptr;
+    ASSERT_EQ(rprContextCreateMesh(m_context,
+        vertices, 5, 3 * sizeof(float),
+        vertices, 5, 3 * sizeof(float),
+        vertices, 5, 3 * sizeof(float),
+        indices, sizeof(rpr_int),
+        indices, sizeof(rpr_int),
+        indices, sizeof(rpr_int),
+        num_face_vertices, 1, &pentagon), RPR_SUCCESS);
+    AddShape("pentagon", pentagon);
+
+    std::uint64_t num_vertices = 0;
+    std::uint64_t num_polygons = 0;
+    ASSERT_EQ(rprMeshGetInfo(pentagon, RPR_MESH_VERTEX_COUNT, sizeof(num_vertices), &num_vertices, nullptr), RPR_SUCCESS);
+    ASSERT_EQ(rprMeshGetInfo(pentagon, RPR_MESH_POLYGON_COUNT, sizeof(num_polygons), &num_polygons, nullptr), RPR_SUCCESS);
+    ASSERT_EQ(num_vertices, 5u);
+    ASSERT_EQ(num_polygons, 3u);
+
+    // Out of range indices are rejected
+    rpr_int invalid_indices[] = { 0, 1, 5 };
+    rpr_int num_triangle_vertices[] = { 3 };
+    rpr_shape invalid = nullptr;
+    ASSERT_EQ(rprContextCreateMesh(m_context,
+        vertices, 5, 3 * sizeof(float),
+        nullptr, 0, 0,
+        nullptr, 0, 0,
+        invalid_indices, sizeof(rpr_int),
+        nullptr, 0,
+        nullptr, 0,
+        num_triangle_vertices, 1, &invalid), RPR_ERROR_INVALID_PARAMETER);
+}